@@ -30,6 +30,8 @@
 #include <QProgressDialog>
 #include <QtDebug>
 #include "RealtimeData.h"
+#include "GcTrace.h"
+#include <string.h> // memchr
 
 #ifdef Q_OS_LINUX // to get stat /dev/xxx for major/minor
 #include <sys/types.h>
@@ -84,10 +86,8 @@ ANT::ANT(QObject *parent, DeviceConfiguration *devConf) : QThread(parent), devCo
     powerchannels=0;
     configuring = false;
 
-    // state machine
-    state = ST_WAIT_FOR_SYNC;
-    length = bytes = 0;
-    checksum = ANT_SYNC_BYTE;
+    // receive buffer
+    rxLength = 0;
 
     // ant ids - may not be configured of course
     if (devConf && devConf->deviceProfile.length())
@@ -175,9 +175,7 @@ void ANT::run()
 
     for (int i=0; i<ANT_MAX_CHANNELS; i++) antChannel[i]->init();
 
-    state = ST_WAIT_FOR_SYNC;
-    length = bytes = 0;
-    checksum = ANT_SYNC_BYTE;
+    rxLength = 0;
 
     if (openPort() == 0) {
 
@@ -192,10 +190,15 @@ void ANT::run()
 
     while(1)
     {
-        // read more bytes from the device
-        uint8_t byte;
-        if (rawRead(&byte, 1) > 0) receiveByte((unsigned char)byte);
-        else msleep(5);
+        // read whatever the device has, rawRead blocks until data
+        // arrives or times out so we still listen to the controller
+        int rc = rawRead(rxBuffer + rxLength, qMin(ANT_RX_BUFFER_SIZE - rxLength, ANT_RX_READ_SIZE));
+        if (rc > 0) {
+            GC_TRACE("ANT::receiveBytes", "train");
+            GC_TRACE_COUNTER("ant bytes", rc);
+            rxLength += rc;
+            receiveBytes(get_timestamp()); // all messages in a read arrived together
+        } else if (rc < 0) msleep(5); // don't spin on errors
 
         //----------------------------------------------------------------------
         // LISTEN TO CONTROLLER FOR COMMANDS
@@ -644,52 +647,52 @@ ANT::sendMessage(ANTMessage m) {
     rawWrite((uint8_t*)padding, 5);
 }
 
+//
+// Decode all the complete messages in the receive buffer, the
+// sync byte is found with memchr which libc vectorises, and
+// anything that isn't a valid message is skipped a byte at a
+// time until we find one that is
+//
 void
-ANT::receiveByte(unsigned char byte) {
-
-    switch (state) {
-        case ST_WAIT_FOR_SYNC:
-            if (byte == ANT_SYNC_BYTE) {
-                state = ST_GET_LENGTH;
-                checksum = ANT_SYNC_BYTE;
-                rxMessage[0] = byte;
-            }
-            break;
+ANT::receiveBytes(double received)
+{
+    int index = 0;
+    while (index < rxLength) {
 
-        case ST_GET_LENGTH:
-            if ((byte == 0) || (byte > ANT_MAX_LENGTH)) {
-                state = ST_WAIT_FOR_SYNC;
-            }
-            else {
-              rxMessage[ANT_OFFSET_LENGTH] = byte;
-                checksum ^= byte;
-                length = byte;
-                bytes = 0;
-                state = ST_GET_MESSAGE_ID;
-            }
+        uint8_t *sync = (uint8_t*)memchr(rxBuffer + index, ANT_SYNC_BYTE, rxLength - index);
+        if (!sync) {
+            index = rxLength; // all garbage
             break;
+        }
+        index = sync - rxBuffer;
+
+        // wait for the length
+        if (rxLength - index < 2) break;
+        int length = rxBuffer[index + ANT_OFFSET_LENGTH];
+        if (length == 0 || length > ANT_MAX_LENGTH) {
+            index++;
+            continue;
+        }
 
-        case ST_GET_MESSAGE_ID:
-            rxMessage[ANT_OFFSET_ID] = byte;
-            checksum ^= byte;
-            state = ST_GET_DATA;
-            break;
+        // sync, length, id, data and checksum
+        int size = length + 4;
+        if (rxLength - index < size) break; // wait for the rest
 
-        case ST_GET_DATA:
-            rxMessage[ANT_OFFSET_DATA + bytes] = byte;
-            checksum ^= byte;
-            if (++bytes >= length){
-                state = ST_VALIDATE_PACKET;
-            }
-            break;
+        uint8_t checksum = 0;
+        for (int i=0; i < size-1; i++) checksum ^= rxBuffer[index + i];
 
-        case ST_VALIDATE_PACKET:
-            if (checksum == byte){
-                processMessage();
-            }
-            state = ST_WAIT_FOR_SYNC;
-            break;
+        if (checksum == rxBuffer[index + size - 1]) {
+            memcpy(rxMessage, rxBuffer + index, size - 1); // no checksum
+            processMessage(received);
+            index += size;
+        } else {
+            index++;
+        }
     }
+
+    // keep any partial message for the next read
+    rxLength -= index;
+    if (rxLength > 0 && index > 0) memmove(rxBuffer, rxBuffer + index, rxLength);
 }
 
 
@@ -707,24 +710,30 @@ ANT::handleChannelEvent(void) {
 }
 
 void
-ANT::processMessage(void) {
+ANT::processMessage(double received) {
 
     ANTMessage m(this, rxMessage); // for debug!
+    m.timestamp = received; // when it arrived, not when we decoded it
 
 //fprintf(stderr, "<< receive: ");
 //for(int i=0; i<m.length+3; i++) fprintf(stderr, "%02x ", m.data[i]);
 //fprintf(stderr, "\n");
 
     struct timeval timestamp;
-    gettimeofday (&timestamp, NULL);
+    timestamp.tv_sec = (long)received;
+    timestamp.tv_usec = (long)((received - timestamp.tv_sec) * 1000000.0);
     emit receivedAntMessage(m, timestamp);
 
     switch (rxMessage[ANT_OFFSET_ID]) {
         case ANT_ACK_DATA:
         case ANT_BROADCAST_DATA:
+        case ANT_BURST_DATA:
+            telemetry.setReceived(received); // for latency, see TrainSidebar::guiUpdate
+            handleChannelEvent();
+            break;
+
         case ANT_CHANNEL_STATUS:
         case ANT_CHANNEL_ID:
-        case ANT_BURST_DATA:
             handleChannelEvent();
             break;
 
@@ -926,7 +935,12 @@ int ANT::rawRead(uint8_t bytes[], int size)
 #ifdef WIN32
     switch (usbMode) {
     case USB1:
-        return USBXpress::read(&devicePort, bytes, size);
+        {
+            // doesn't wait for data, so no data is an error
+            // and the receive loop sleeps before trying again
+            int rc = USBXpress::read(&devicePort, bytes, size);
+            return rc > 0 ? rc : -1;
+        }
         break;
     case USB2:
         return usb2->read((char *)bytes, size);
@@ -942,17 +956,21 @@ int ANT::rawRead(uint8_t bytes[], int size)
         return usb2->read((char *)bytes, size);
     }
 #endif
-    int i=0;
-    uint8_t byte;
-
-    // read one byte at a time sleeping when no data ready
-    // until we timeout waiting then return error
-    for (i=0; i<size; i++) {
-        int rc = read(devicePort, &byte, 1);
-        if (rc == -1 || rc == 0) return -1; // error!
-        else bytes[i] = byte;
-    }
-    return i;
+    // wait for data to arrive (this works for a pty too), then
+    // take everything that's there in one read
+    struct pollfd fds;
+    fds.fd = devicePort;
+    fds.events = POLLIN;
+    fds.revents = 0;
+
+    int rc = poll(&fds, 1, ANT_RX_TIMEOUT);
+    if (rc == 0) return 0; // timed out
+    if (rc < 0) return errno == EINTR ? 0 : -1;
+    if (!(fds.revents & POLLIN)) return -1; // unplugged
+
+    rc = read(devicePort, bytes, size);
+    if (rc == -1 && (errno == EAGAIN || errno == EINTR)) return 0;
+    return rc == 0 ? -1 : rc; // 0 is end of file
 
 #endif
     return -1; // keep compiler happy.
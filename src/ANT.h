@@ -65,6 +65,7 @@
 #include <termios.h> // unix!!
 #include <unistd.h> // unix!!
 #include <sys/ioctl.h>
+#include <poll.h>
 #ifndef N_TTY // for OpenBSD
 #define N_TTY 0
 #endif
@@ -182,6 +183,11 @@ struct setChannelAtom {
 #define ANT_MAX_MESSAGE_SIZE 12
 #define ANT_MAX_CHANNELS     8
 
+// receive buffering
+#define ANT_RX_BUFFER_SIZE   256
+#define ANT_RX_READ_SIZE     64   // the USB2 sticks bulk read 64 bytes
+#define ANT_RX_TIMEOUT       50   // ms to wait for data before checking for commands
+
 // Channel messages
 #define RESPONSE_NO_ERROR               0
 #define EVENT_RX_SEARCH_TIMEOUT         1
@@ -323,9 +329,9 @@ public:
 
     // transmission
     void sendMessage(ANTMessage);
-    void receiveByte(unsigned char byte);
+    void receiveBytes(double received);
     void handleChannelEvent(void);
-    void processMessage(void);
+    void processMessage(double received);
 
 
     // serial i/o lifted from Computrainer.cpp
@@ -333,7 +339,7 @@ public:
     void setBaud(int baud);
     int openPort();
     int closePort();
-    int rawRead(uint8_t bytes[], int size);
+    int rawRead(uint8_t bytes[], int size); // waits up to ANT_RX_TIMEOUT ms, 0 if nothing arrived
     int rawWrite(uint8_t *bytes, int size);
 
     // channels update our telemetry
@@ -389,12 +395,10 @@ private:
 
     unsigned char rxMessage[ANT_MAX_MESSAGE_SIZE];
 
-    // state machine whilst receiving bytes
-    enum States {ST_WAIT_FOR_SYNC, ST_GET_LENGTH, ST_GET_MESSAGE_ID, ST_GET_DATA, ST_VALIDATE_PACKET} state;
-    //enum States state;
-    int length;
-    int bytes;
-    int checksum;
+    // bytes read but not yet decoded, at most a partial
+    // message is kept between reads
+    uint8_t rxBuffer[ANT_RX_BUFFER_SIZE];
+    int rxLength;
     int powerchannels; // how many power channels do we have?
 
     QQueue<setChannelAtom> channelQueue; // messages for configuring channels from controller
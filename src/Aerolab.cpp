@@ -306,11 +306,6 @@ Aerolab::configChanged()
 void
 Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
 
-  // HARD-CODED DATA: p1->kph
-  double vfactor = 3.600;
-  double m       =  totalMass;
-  double small_number = 0.00001;
-
   rideItem = _rideItem;
   RideFile *ride = rideItem->ride();
 
@@ -326,14 +321,26 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
 
     if( dataPresent->watts ) {
 
+      // the terms that don't depend on the parameters are only
+      // computed when the ride changes, moving a slider just
+      // needs the virtual elevation recomputing
+      if (new_zoom || !engine.isFor(ride)) {
+        engine.setRide(ride);
+
+        // the terms are stale as soon as the data is edited
+        connect(ride, SIGNAL(modified()), this, SLOT(rideChanged()), Qt::UniqueConnection);
+        connect(ride, SIGNAL(reverted()), this, SLOT(rideChanged()), Qt::UniqueConnection);
+        connect(ride, SIGNAL(destroyed()), this, SLOT(rideChanged()), Qt::UniqueConnection);
+      }
+
       // If watts are present, then we can fill the veArray data:
-      const RideFileDataPresent *dataPresent = ride->areDataPresent();
-      int npoints = ride->dataPoints().size();
-      double dt = ride->recIntSecs();
-      veArray.resize(dataPresent->watts ? npoints : 0);
+      int npoints = engine.points();
+      arrayLength = npoints;
+      timeArray = engine.time();
+      distanceArray = engine.distance();
+      engine.virtualElevation(veArray, cda, crr, totalMass, rho, eta, eoffset);
+
       altArray.resize(dataPresent->alt || constantAlt ? npoints : 0);
-      timeArray.resize(dataPresent->watts ? npoints : 0);
-      distanceArray.resize(dataPresent->watts ? npoints : 0);
 
       // quickly erase old data
       veCurve->setVisible(false);
@@ -347,76 +354,21 @@ Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
       }
 
       // detach and re-attach the ve curve:
-      bool have_recorded_alt_curve = false;
       altCurve->detach();
       if (!altArray.empty()) {
-        have_recorded_alt_curve = true;
         altCurve->attach(this);
         altCurve->setVisible(dataPresent->alt || constantAlt );
-      }
-
-      // Fill the virtual elevation profile with data from the ride data:
-      double t = 0.0;
-      double vlast = 0.0;
-      double e     = 0.0;
-      arrayLength = 0;
-      foreach(const RideFilePoint *p1, ride->dataPoints()) {
-      if ( arrayLength == 0 )
-        e = eoffset;
-
-      timeArray[arrayLength]  = p1->secs / 60.0;
-      if ( have_recorded_alt_curve ) {
-          if ( constantAlt && arrayLength > 0) {
-              altArray[arrayLength] = altArray[arrayLength-1];
-          }
-          else  {
-              if ( constantAlt && !dataPresent->alt)
-                  altArray[arrayLength] = 0;
-              else
-                altArray[arrayLength] = (context->athlete->useMetricUnits
-                   ? p1->alt
-                   : p1->alt * FEET_PER_METER);
-          }
-      }
-
-      // Unpack:
-      double power = max(0, p1->watts);
-      double v     = p1->kph/vfactor;
-      double headwind = v;
-      if( dataPresent->headwind ) {
-        headwind   = p1->headwind/vfactor;
-      }
-      double f     = 0.0;
-      double a     = 0.0;
-
-      // Use km data insteed of formula for file with a stop (gap).
-      //d += v * dt;
-      //distanceArray[arrayLength] = d/1000;
-
-      distanceArray[arrayLength] = p1->km;
-
-
 
-      if( v > small_number ) {
-        f  = power/v;
-        a  = ( v*v - vlast*vlast ) / ( 2.0 * dt * v );
-      } else {
-        a = ( v - vlast ) / dt;
+        const double *alt = engine.altitude().constData();
+        double *a = altArray.data();
+        double factor = context->athlete->useMetricUnits ? 1.0 : FEET_PER_METER;
+        for (int i=0; i<npoints; i++) {
+          if (constantAlt && i > 0) a[i] = a[i-1];
+          else if (constantAlt && !dataPresent->alt) a[i] = 0;
+          else a[i] = alt[i] * factor;
+        }
       }
 
-      f *= eta; // adjust for drivetrain efficiency if using a crank-based meter
-      double s   = slope( f, a, m, crr, cda, rho, headwind );
-      double de  = s * v * dt;
-
-      e += de;
-      t += dt;
-      veArray[arrayLength] = e;
-
-      vlast = v;
-
-      ++arrayLength;
-    }
-
   } else {
       veCurve->setVisible(false);
       altCurve->setVisible(false);
@@ -803,7 +755,8 @@ QString Aerolab::estimateCdACrr(RideItem *rideItem)
         if(( dataPresent->alt || constantAlt )  && dataPresent->watts) {
             double dt = ride->recIntSecs();
             int npoints = ride->dataPoints().size();
-            double X1[npoints], X2[npoints], Egain[npoints];
+            // a segment can close at every point, so there can be npoints+1
+            QVector<double> X1(npoints+1), X2(npoints+1), Egain(npoints+1);
             int nSeg = -1;
             double altInit = 0, vInit = 0;
             /* For each segment, defined between points with alt != 0,
@@ -896,10 +849,11 @@ QString Aerolab::estimateCdACrr(RideItem *rideItem)
                         errMsg = tr("Estimates out-of-range");
                     }
                 } else {
-                    errMsg = tr("At least two segments must be independent");
+                    errMsg = sweepCdACrr(ride, tr("At least two segments must be independent"));
                 }
             } else {
-                errMsg = tr("At least two segments must be defined");
+                // e.g. constant altitude with no altitude recorded
+                errMsg = sweepCdACrr(ride, tr("At least two segments must be defined"));
             }
         } else {
             errMsg = tr("Altitude and Power data must be present");
@@ -909,3 +863,66 @@ QString Aerolab::estimateCdACrr(RideItem *rideItem)
     }
     return errMsg;
 }
+
+void
+Aerolab::rideChanged()
+{
+  // only if it's the ride we have the terms for, we may
+  // still be connected to rides we looked at before
+  if (sender() == static_cast<const QObject*>(engine.rideFile())) engine.clear();
+}
+
+/*
+ * When there are no segments to work with, fit CdA and Crr by sweeping
+ * the slider ranges for the combination where the virtual elevation
+ * best matches the recorded (or constant) altitude, then refine around
+ * it. Returns errMsg if we can't do any better.
+ */
+QString Aerolab::sweepCdACrr(RideFile *ride, QString errMsg)
+{
+    AerolabEngine local;
+    const AerolabEngine *e = &engine;
+    if (!engine.isFor(ride)) {
+        local.setRide(ride);
+        e = &local;
+    }
+    if (e->points() < 2) return errMsg;
+
+    // the offset is fitted, so for constant altitude any value will do
+    QVector<double> target(e->points(), 0.0);
+    if (ride->areDataPresent()->alt && !constantAlt) target = e->altitude();
+
+    double cdaLo = 0.001, cdaHi = 1.0, crrLo = 0.0001, crrHi = 0.1;
+    double bestCda = cda, bestCrr = crr;
+    const int steps = 100;
+
+    for (int pass=0; pass < 3; pass++) {
+
+        QVector<double> cdas(steps+1), crrs(steps+1);
+        for (int i=0; i<=steps; i++) {
+            cdas[i] = cdaLo + (cdaHi - cdaLo) * i / steps;
+            crrs[i] = crrLo + (crrHi - crrLo) * i / steps;
+        }
+
+        QVector<double> residuals = e->sweep(target, cdas, crrs, totalMass, rho, eta);
+        int best = 0;
+        for (int i=1; i<residuals.count(); i++) if (residuals[i] < residuals[best]) best = i;
+        bestCda = cdas[best / (steps+1)];
+        bestCrr = crrs[best % (steps+1)];
+
+        // zoom in a couple of steps either side
+        double cdaStep = (cdaHi - cdaLo) / steps, crrStep = (crrHi - crrLo) / steps;
+        cdaLo = max(0.001, bestCda - 2 * cdaStep);
+        cdaHi = min(1.0, bestCda + 2 * cdaStep);
+        crrLo = max(0.0001, bestCrr - 2 * crrStep);
+        crrHi = min(0.1, bestCrr + 2 * crrStep);
+    }
+
+    // at the edge of the range is no fit at all
+    if (bestCda <= 0.001 || bestCda >= 1.0 || bestCrr <= 0.0001 || bestCrr >= 0.1) return errMsg;
+
+    // round to the slider resolution
+    cda = floor(10000 * bestCda + 0.5) / 10000;
+    crr = floor(1000000 * bestCrr + 0.5) / 1000000;
+    return "";
+}
@@ -32,9 +32,11 @@
 #include <QStackedWidget>
 
 #include "LTMWindow.h" // for tooltip/canvaspicker
+#include "AerolabEngine.h"
 
 // forward references
 class RideItem;
+class RideFile;
 struct RideFilePoint;
 class QwtPlotCurve;
 class QwtPlotGrid;
@@ -79,6 +81,9 @@ class Aerolab : public QwtPlot {
 
   void pointHover( QwtPlotCurve *, int );
 
+  // the engine's ride was edited, reverted or deleted
+  void rideChanged();
+
   signals:
 
   protected:
@@ -108,6 +113,9 @@ class Aerolab : public QwtPlot {
   QVector<double> timeArray;
   QVector<double> distanceArray;
 
+  // precomputed per ride, so parameter changes are cheap
+  AerolabEngine engine;
+
   int smooth;
   bool bydist;
   bool autoEoffset;
@@ -146,6 +154,7 @@ class Aerolab : public QwtPlot {
   int      intEta() const { return (int)( eta * 10000); }
   int      intEoffset() const { return (int)( eoffset * 100); }
   QString  estimateCdACrr(RideItem* rideItem);
+  QString  sweepCdACrr(RideFile *ride, QString errMsg);
 
 };
 
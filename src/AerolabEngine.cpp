@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "AerolabEngine.h"
+#include "RideFile.h"
+#include <math.h>
+
+static const double g = 9.80665;
+
+AerolabEngine::AerolabEngine() : ride(NULL), count(0)
+{
+}
+
+void
+AerolabEngine::clear()
+{
+    ride = NULL;
+    count = 0;
+    minutes.clear();
+    km.clear();
+    alt.clear();
+    power.clear();
+    dist.clear();
+    aero.clear();
+    accel.clear();
+}
+
+bool
+AerolabEngine::isFor(const RideFile *ride) const
+{
+    return ride != NULL && this->ride == ride && count == ride->dataPoints().count();
+}
+
+void
+AerolabEngine::setRide(RideFile *ride)
+{
+    clear();
+    if (!ride) return;
+
+    // HARD-CODED DATA: p1->kph
+    const double vfactor = 3.600;
+    const double small_number = 0.00001;
+    const double dt = ride->recIntSecs();
+    const bool hasHeadwind = ride->areDataPresent()->headwind;
+
+    this->ride = ride;
+    count = ride->dataPoints().count();
+
+    minutes.resize(count);
+    km.resize(count);
+    alt.resize(count);
+    power.resize(count);
+    dist.resize(count);
+    aero.resize(count);
+    accel.resize(count);
+
+    double vlast = 0.0;
+    double P = 0.0, D = 0.0, W = 0.0, A = 0.0;
+    for (int i=0; i<count; i++) {
+        const RideFilePoint *p1 = ride->dataPoints()[i];
+
+        minutes[i] = p1->secs / 60.0;
+        km[i] = p1->km;
+        alt[i] = p1->alt;
+
+        // Unpack:
+        double watts = p1->watts > 0 ? p1->watts : 0;
+        double v = p1->kph/vfactor;
+        double headwind = hasHeadwind ? p1->headwind/vfactor : v;
+        double f = 0.0;
+        double a = 0.0;
+
+        if (v > small_number) {
+            f = watts/v;
+            a = (v*v - vlast*vlast) / (2.0 * dt * v);
+        } else {
+            a = (v - vlast) / dt;
+        }
+
+        double ds = v * dt;
+        power[i] = (P += f * ds);
+        dist[i] = (D += ds);
+        aero[i] = (W += headwind * headwind * ds);
+        accel[i] = (A += a * ds);
+
+        vlast = v;
+    }
+}
+
+void
+AerolabEngine::virtualElevation(QVector<double> &ve, double cda, double crr, double mass,
+                                double rho, double eta, double eoffset) const
+{
+    ve.resize(count);
+
+    const double kP = eta / (mass * g);
+    const double kW = cda * rho / (2.0 * mass * g);
+    const double kA = 1.0 / g;
+
+    const double *P = power.constData();
+    const double *D = dist.constData();
+    const double *W = aero.constData();
+    const double *A = accel.constData();
+    double *e = ve.data();
+
+    for (int i=0; i<count; i++)
+        e[i] = eoffset + kP * P[i] - crr * D[i] - kW * W[i] - kA * A[i];
+}
+
+QVector<double>
+AerolabEngine::sweep(const QVector<double> &target, const QVector<double> &cdas,
+                     const QVector<double> &crrs, double mass, double rho, double eta) const
+{
+    QVector<double> returning(cdas.count() * crrs.count(), 0.0);
+    if (count == 0 || target.count() != count) return returning;
+
+    // ve - target = b - crr * x - cda * y
+    const double kP = eta / (mass * g);
+    const double kW = rho / (2.0 * mass * g);
+    const double kA = 1.0 / g;
+
+    // the offset is fitted so we work with deviations from the mean
+    double mb = 0, mx = 0, my = 0;
+    for (int i=0; i<count; i++) {
+        mb += kP * power[i] - kA * accel[i] - target[i];
+        mx += dist[i];
+        my += kW * aero[i];
+    }
+    mb /= count;
+    mx /= count;
+    my /= count;
+
+    double Sbb = 0, Sbx = 0, Sby = 0, Sxx = 0, Sxy = 0, Syy = 0;
+    for (int i=0; i<count; i++) {
+        double b = kP * power[i] - kA * accel[i] - target[i] - mb;
+        double x = dist[i] - mx;
+        double y = kW * aero[i] - my;
+        Sbb += b * b;
+        Sbx += b * x;
+        Sby += b * y;
+        Sxx += x * x;
+        Sxy += x * y;
+        Syy += y * y;
+    }
+
+    double *r = returning.data();
+    for (int i=0; i<cdas.count(); i++) {
+        const double cda = cdas[i];
+        for (int j=0; j<crrs.count(); j++) {
+            const double crr = crrs[j];
+            double ss = Sbb - 2.0 * (crr * Sbx + cda * Sby)
+                        + crr * crr * Sxx + 2.0 * crr * cda * Sxy + cda * cda * Syy;
+            *r++ = sqrt((ss > 0 ? ss : 0) / count);
+        }
+    }
+    return returning;
+}
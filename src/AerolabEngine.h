@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_AerolabEngine_h
+#define _GC_AerolabEngine_h 1
+
+#include <QVector>
+
+class RideFile;
+
+//
+// Virtual elevation computations for Aerolab
+//
+// The slope at each sample is
+//
+//     s = eta*f/(m*g) - crr - cda*rho*hw*hw/(2*m*g) - a/g
+//
+// and the elevation change is s*v*dt. That is linear in eta, crr and
+// cda/rho, so we keep running totals of f*v*dt, v*dt, hw*hw*v*dt and
+// a*v*dt for the ride, which do not depend on any of the parameters.
+// The virtual elevation for any set of parameters is then a single
+// pass over four arrays, with no dependency between samples.
+//
+// For the same reason the sum of squared differences between the
+// virtual and recorded elevation is a quadratic in (cda, crr), so a
+// sweep over a grid of cda x crr is one pass to collect the sums and
+// then constant time for each combination.
+//
+class AerolabEngine
+{
+    public:
+        AerolabEngine();
+
+        // precompute the parameter independent terms
+        void setRide(RideFile *ride);
+        void clear();
+
+        // still have the terms for this ride? the owner must clear()
+        // when the ride is modified, the point count alone won't tell
+        bool isFor(const RideFile *ride) const;
+        const RideFile *rideFile() const { return ride; }
+        int points() const { return count; }
+
+        // as recorded in the ride
+        const QVector<double> &time() const { return minutes; }    // minutes
+        const QVector<double> &distance() const { return km; }     // km
+        const QVector<double> &altitude() const { return alt; }    // metres
+
+        // virtual elevation at each sample (metres), ve is resized to points()
+        void virtualElevation(QVector<double> &ve, double cda, double crr, double mass,
+                              double rho, double eta, double eoffset) const;
+
+        // RMS difference between the virtual elevation and target (metres, one per
+        // sample) for every combination of cda and crr, the elevation offset is
+        // fitted for each combination. Returned with crr varying fastest, i.e.
+        // result[i * crrs.count() + j] is for cdas[i] and crrs[j]
+        QVector<double> sweep(const QVector<double> &target,
+                              const QVector<double> &cdas, const QVector<double> &crrs,
+                              double mass, double rho, double eta) const;
+
+    private:
+        const RideFile *ride;
+        int count;
+
+        QVector<double> minutes, km, alt;
+
+        // running totals to each sample (inclusive)
+        QVector<double> power;      // f * v * dt (energy in)
+        QVector<double> dist;       // v * dt
+        QVector<double> aero;       // hw * hw * v * dt
+        QVector<double> accel;      // a * v * dt
+};
+
+#endif // _GC_AerolabEngine_h
@@ -599,6 +599,12 @@ AllPlot::AllPlot(AllPlotWindow *parent, Context *context, RideFile::SeriesType s
     axisWidget(QwtAxisId(QwtAxis::yRight, 1))->installEventFilter(this);
     axisWidget(QwtAxisId(QwtAxis::yRight, 2))->installEventFilter(this);
 
+    // the ride's arrays are worked out in the background, and again if it is edited
+    preparer = new ChartPreparer(this);
+    connect(preparer, SIGNAL(prepared(ChartJob*)), this, SLOT(setPrepared(ChartJob*)));
+    connect(context, SIGNAL(rideDirty(RideItem*)), preparer, SLOT(clear()));
+    connect(context, SIGNAL(rideClean(RideItem*)), preparer, SLOT(clear())); // saved or reverted
+
     configChanged(); // set colors
 }
 
@@ -861,12 +867,6 @@ AllPlot::setHighlightIntervals(bool state)
     }
 }
 
-struct DataPoint {
-    double time, hr, watts, np, ap, xp, speed, cad, alt, temp, wind, torque, lrbalance, kphd;
-    DataPoint(double t, double h, double w, double n, double l, double x, double s, double c, double a, double te, double wi, double tq, double lrb, double kphd) :
-        time(t), hr(h), watts(w), np(n), ap(l), xp(x), speed(s), cad(c), alt(a), temp(te), wind(wi), torque(tq), lrbalance(lrb), kphd(kphd) {}
-};
-
 bool AllPlot::shadeZones() const
 {
     return shade_zones;
@@ -963,183 +963,56 @@ AllPlot::recalc(AllPlotObject *objects)
     // we should only smooth the curves if objects->smoothed rate is greater than sample rate
     if (smooth > 0) {
 
-        double totalWatts = 0.0;
-        double totalNP = 0.0;
-        double totalXP = 0.0;
-        double totalAP = 0.0;
-        double totalHr = 0.0;
-        double totalSpeed = 0.0;
-        double totalAccel = 0.0;
-        double totalCad = 0.0;
-        double totalDist = 0.0;
-        double totalAlt = 0.0;
-        double totalTemp = 0.0;
-        double totalWind = 0.0;
-        double totalTorque = 0.0;
-        double totalBalance = 0.0;
-
-        QList<DataPoint> list;
-
-        objects->smoothWatts.resize(rideTimeSecs + 1); //(rideTimeSecs + 1);
-        objects->smoothNP.resize(rideTimeSecs + 1); //(rideTimeSecs + 1);
-        objects->smoothXP.resize(rideTimeSecs + 1); //(rideTimeSecs + 1);
-        objects->smoothAP.resize(rideTimeSecs + 1); //(rideTimeSecs + 1);
-        objects->smoothHr.resize(rideTimeSecs + 1);
-        objects->smoothSpeed.resize(rideTimeSecs + 1);
-        objects->smoothAccel.resize(rideTimeSecs + 1);
-        objects->smoothCad.resize(rideTimeSecs + 1);
-        objects->smoothTime.resize(rideTimeSecs + 1);
-        objects->smoothDistance.resize(rideTimeSecs + 1);
-        objects->smoothAltitude.resize(rideTimeSecs + 1);
-        objects->smoothTemp.resize(rideTimeSecs + 1);
-        objects->smoothWind.resize(rideTimeSecs + 1);
-        objects->smoothRelSpeed.resize(rideTimeSecs + 1);
-        objects->smoothTorque.resize(rideTimeSecs + 1);
-        objects->smoothBalanceL.resize(rideTimeSecs + 1);
-        objects->smoothBalanceR.resize(rideTimeSecs + 1);
-
-        for (int secs = 0; ((secs < smooth)
-                            && (secs < rideTimeSecs)); ++secs) {
-            objects->smoothWatts[secs] = 0.0;
-            objects->smoothNP[secs] = 0.0;
-            objects->smoothXP[secs] = 0.0;
-            objects->smoothAP[secs] = 0.0;
-            objects->smoothHr[secs]    = 0.0;
-            objects->smoothSpeed[secs] = 0.0;
-            objects->smoothAccel[secs] = 0.0;
-            objects->smoothCad[secs]   = 0.0;
+        // the smoother keeps prefix sums for each channel present and
+        // caches results by width, so this is cheap when dragging the slider
+        AllPlotSmoother &s = objects->smoother;
+        int n = rideTimeSecs + 1;
+
+        objects->smoothWatts = s.hasChannel(AllPlotSmoother::Watts) ? s.smoothed(AllPlotSmoother::Watts, smooth) : QVector<double>(n, 0.0);
+        objects->smoothNP = s.hasChannel(AllPlotSmoother::NP) ? s.smoothed(AllPlotSmoother::NP, smooth) : QVector<double>(n, 0.0);
+        objects->smoothXP = s.hasChannel(AllPlotSmoother::XP) ? s.smoothed(AllPlotSmoother::XP, smooth) : QVector<double>(n, 0.0);
+        objects->smoothAP = s.hasChannel(AllPlotSmoother::AP) ? s.smoothed(AllPlotSmoother::AP, smooth) : QVector<double>(n, 0.0);
+        objects->smoothHr = s.hasChannel(AllPlotSmoother::Hr) ? s.smoothed(AllPlotSmoother::Hr, smooth) : QVector<double>(n, 0.0);
+        objects->smoothSpeed = s.hasChannel(AllPlotSmoother::Speed) ? s.smoothed(AllPlotSmoother::Speed, smooth) : QVector<double>(n, 0.0);
+        objects->smoothAccel = s.hasChannel(AllPlotSmoother::Accel) ? s.smoothed(AllPlotSmoother::Accel, smooth) : QVector<double>(n, 0.0);
+        objects->smoothCad = s.hasChannel(AllPlotSmoother::Cad) ? s.smoothed(AllPlotSmoother::Cad, smooth) : QVector<double>(n, 0.0);
+        objects->smoothAltitude = s.hasChannel(AllPlotSmoother::Alt) ? s.smoothed(AllPlotSmoother::Alt, smooth) : QVector<double>(n, 0.0);
+        objects->smoothTemp = s.hasChannel(AllPlotSmoother::Temp) ? s.smoothed(AllPlotSmoother::Temp, smooth) : QVector<double>(n, 0.0);
+        objects->smoothWind = s.hasChannel(AllPlotSmoother::Wind) ? s.smoothed(AllPlotSmoother::Wind, smooth) : QVector<double>(n, 0.0);
+        objects->smoothTorque = s.hasChannel(AllPlotSmoother::Torque) ? s.smoothed(AllPlotSmoother::Torque, smooth) : QVector<double>(n, 0.0);
+        objects->smoothDistance = s.hasChannel(AllPlotSmoother::Distance) ? s.smoothed(AllPlotSmoother::Distance, smooth) : QVector<double>(n, 0.0);
+
+        objects->smoothTime.resize(n);
+        objects->smoothRelSpeed.resize(n);
+        objects->smoothBalanceL.resize(n);
+        objects->smoothBalanceR.resize(n);
+
+        QVector<double> balance = s.hasChannel(AllPlotSmoother::Balance) ? s.smoothed(AllPlotSmoother::Balance, smooth) : QVector<double>(n, 0.0);
+        bool relspeed = !objects->windArray.empty();
+
+        for (int secs = 0; secs < n; ++secs) {
+
             objects->smoothTime[secs]  = secs / 60.0;
-            objects->smoothDistance[secs]  = 0.0;
-            objects->smoothAltitude[secs]  = 0.0;
-            objects->smoothTemp[secs]  = 0.0;
-            objects->smoothWind[secs]  = 0.0;
-            objects->smoothRelSpeed[secs] = QwtIntervalSample();
-            objects->smoothTorque[secs]  = 0.0;
-            objects->smoothBalanceL[secs]  = 50;
-            objects->smoothBalanceR[secs]  = 50;
-        }
-
-        int i = 0;
-        for (int secs = smooth; secs <= rideTimeSecs; ++secs) {
-            while ((i < objects->timeArray.count()) && (objects->timeArray[i] <= secs)) {
-                DataPoint dp(objects->timeArray[i],
-                             (!objects->hrArray.empty() ? objects->hrArray[i] : 0),
-                             (!objects->wattsArray.empty() ? objects->wattsArray[i] : 0),
-                             (!objects->npArray.empty() ? objects->npArray[i] : 0),
-                             (!objects->apArray.empty() ? objects->apArray[i] : 0),
-                             (!objects->xpArray.empty() ? objects->xpArray[i] : 0),
-                             (!objects->speedArray.empty() ? objects->speedArray[i] : 0),
-                             (!objects->cadArray.empty() ? objects->cadArray[i] : 0),
-                             (!objects->altArray.empty() ? objects->altArray[i] : 0),
-                             (!objects->tempArray.empty() ? objects->tempArray[i] : 0),
-                             (!objects->windArray.empty() ? objects->windArray[i] : 0),
-                             (!objects->torqueArray.empty() ? objects->torqueArray[i] : 0),
-                             (!objects->balanceArray.empty() ? objects->balanceArray[i] : 0),
-                             (!objects->accelArray.empty() ? objects->accelArray[i] : 0));
-                if (!objects->wattsArray.empty())
-                    totalWatts += objects->wattsArray[i];
-                if (!objects->npArray.empty())
-                    totalNP += objects->npArray[i];
-                if (!objects->xpArray.empty())
-                    totalXP += objects->xpArray[i];
-                if (!objects->apArray.empty())
-                    totalAP += objects->apArray[i];
-                if (!objects->hrArray.empty())
-                    totalHr    += objects->hrArray[i];
-                if (!objects->accelArray.empty())
-                    totalAccel += objects->accelArray[i];
-                if (!objects->speedArray.empty())
-                    totalSpeed += objects->speedArray[i];
-                if (!objects->cadArray.empty())
-                    totalCad   += objects->cadArray[i];
-                if (!objects->altArray.empty())
-                    totalAlt   += objects->altArray[i];
-                if (!objects->tempArray.empty() ) {
-                    if (objects->tempArray[i] == RideFile::noTemp) {
-                        dp.temp = (i>0 && !list.empty()?list.back().temp:0.0);
-                        totalTemp   += dp.temp;
-                    }
-                    else {
-                        totalTemp   += objects->tempArray[i];
-                    }
-                }
-                if (!objects->windArray.empty())
-                    totalWind   += objects->windArray[i];
-                if (!objects->torqueArray.empty())
-                    totalTorque   += objects->torqueArray[i];
-                if (!objects->balanceArray.empty())
-                    totalBalance   += (objects->balanceArray[i]>0?objects->balanceArray[i]:50);
-
-                totalDist   = objects->distanceArray[i];
-                list.append(dp);
-                ++i;
-            }
-            while (!list.empty() && (list.front().time < secs - smooth)) {
-                DataPoint &dp = list.front();
-                totalWatts -= dp.watts;
-                totalNP -= dp.np;
-                totalAP -= dp.ap;
-                totalXP -= dp.xp;
-                totalHr    -= dp.hr;
-                totalSpeed -= dp.speed;
-                totalAccel -= dp.kphd;
-                totalCad   -= dp.cad;
-                totalAlt   -= dp.alt;
-                totalTemp   -= dp.temp;
-                totalWind   -= dp.wind;
-                totalTorque   -= dp.torque;
-                totalBalance   -= (dp.lrbalance>0?dp.lrbalance:50);
-                list.removeFirst();
-            }
-            // TODO: this is wrong.  We should do a weighted average over the
-            // seconds represented by each point...
-            if (list.empty()) {
-                objects->smoothWatts[secs] = 0.0;
-                objects->smoothNP[secs] = 0.0;
-                objects->smoothXP[secs] = 0.0;
-                objects->smoothAP[secs] = 0.0;
-                objects->smoothHr[secs]    = 0.0;
-                objects->smoothSpeed[secs] = 0.0;
-                objects->smoothAccel[secs] = 0.0;
-                objects->smoothCad[secs]   = 0.0;
-                objects->smoothAltitude[secs]   = objects->smoothAltitude[secs - 1];
-                objects->smoothTemp[secs]   = 0.0;
-                objects->smoothWind[secs] = 0.0;
-                objects->smoothRelSpeed[secs] =  QwtIntervalSample();
-                objects->smoothTorque[secs] = 0.0;
+
+            if (balance[secs] == 0) {
                 objects->smoothBalanceL[secs] = 50;
                 objects->smoothBalanceR[secs] = 50;
+            } else if (balance[secs] >= 50) {
+                objects->smoothBalanceL[secs] = balance[secs];
+                objects->smoothBalanceR[secs] = 50;
+            } else {
+                objects->smoothBalanceL[secs] = 50;
+                objects->smoothBalanceR[secs] = balance[secs];
             }
-            else {
-                objects->smoothWatts[secs]    = totalWatts / list.size();
-                objects->smoothNP[secs]    = totalNP / list.size();
-                objects->smoothXP[secs]    = totalXP / list.size();
-                objects->smoothAP[secs]    = totalAP / list.size();
-                objects->smoothHr[secs]       = totalHr / list.size();
-                objects->smoothSpeed[secs]    = totalSpeed / list.size();
-                objects->smoothAccel[secs]    = totalAccel / double(list.size());
-                objects->smoothCad[secs]      = totalCad / list.size();
-                objects->smoothAltitude[secs]      = totalAlt / list.size();
-                objects->smoothTemp[secs]      = totalTemp / list.size();
-                objects->smoothWind[secs]    = totalWind / list.size();
-                objects->smoothRelSpeed[secs] =  QwtIntervalSample( bydist ? totalDist : secs / 60.0, QwtInterval(qMin(totalWind / list.size(), totalSpeed / list.size()), qMax(totalWind / list.size(), totalSpeed / list.size()) ) );
-                objects->smoothTorque[secs]    = totalTorque / list.size();
-
-                double balance = totalBalance / list.size();
-                if (balance == 0) {
-                    objects->smoothBalanceL[secs]    = 50;
-                    objects->smoothBalanceR[secs]    = 50;
-                } else if (balance >= 50) {
-                    objects->smoothBalanceL[secs]    = balance;
-                    objects->smoothBalanceR[secs]    = 50;
-                }
-                else {
-                    objects->smoothBalanceL[secs]    = 50;
-                    objects->smoothBalanceR[secs]    = balance;
-                }
+
+            if (!relspeed || secs < smooth) {
+                objects->smoothRelSpeed[secs] = QwtIntervalSample();
+            } else {
+                double wind = objects->smoothWind[secs];
+                double speed = objects->smoothSpeed[secs];
+                objects->smoothRelSpeed[secs] = QwtIntervalSample(bydist ? objects->smoothDistance[secs] : secs / 60.0,
+                                                                  QwtInterval(qMin(wind, speed), qMax(wind, speed)));
             }
-            objects->smoothDistance[secs] = totalDist;
-            objects->smoothTime[secs]  = secs / 60.0;
         }
 
     } else {
@@ -2912,7 +2785,10 @@ void
 AllPlot::setDataFromRide(RideItem *_rideItem)
 {
     rideItem = _rideItem;
-    if (_rideItem == NULL) return;
+    if (_rideItem == NULL) {
+        preparer->cancel();
+        return;
+    }
 
     // we don't have a reference plot
     referencePlot = NULL;
@@ -2921,154 +2797,52 @@ AllPlot::setDataFromRide(RideItem *_rideItem)
     standard->wattsArray.clear();
     standard->curveTitle.setLabel(QwtText(QString(""), QwtText::PlainText)); // default to no title
 
-    setDataFromRideFile(rideItem->ride(), standard);
+    RideFile *ride = rideItem->ride();
+    if (ride && ride->dataPoints().size()) {
+
+        // the derived series can be shown and hidden without
+        // the data being reloaded, so we need all of them
+        ride->recalculateDerivedSeries();
+
+        // the arrays are worked out in the background, see setPrepared()
+        QString key = QString("%1/%2 %3").arg(rideItem->path).arg(rideItem->fileName).arg(context->athlete->useMetricUnits);
+        preparer->prepare(new AllPlotJob(ride, context->athlete->useMetricUnits, smooth, key));
+
+    } else {
+
+        preparer->cancel();
+        setDataFromRideFile(ride, standard);
+        emit dataPrepared();
+    }
+}
+
+void
+AllPlot::setPrepared(ChartJob *job)
+{
+    if (!rideItem || !rideItem->ride()) return;
+
+    setDataFromJob(static_cast<AllPlotJob*>(job), rideItem->ride(), standard);
 
     // remember the curves and colors
     isolation = false;
     curveColors->saveState();
+
+    emit dataPrepared();
 }
 
 void
 AllPlot::setDataFromRideFile(RideFile *ride, AllPlotObject *here)
 {
     if (ride && ride->dataPoints().size()) {
-        const RideFileDataPresent *dataPresent = ride->areDataPresent();
-        int npoints = ride->dataPoints().size();
-        here->wattsArray.resize(dataPresent->watts ? npoints : 0);
-        here->npArray.resize(dataPresent->np ? npoints : 0);
-        here->xpArray.resize(dataPresent->xp ? npoints : 0);
-        here->apArray.resize(dataPresent->apower ? npoints : 0);
-        here->hrArray.resize(dataPresent->hr ? npoints : 0);
-        here->speedArray.resize(dataPresent->kph ? npoints : 0);
-        here->accelArray.resize(dataPresent->kph ? npoints : 0);
-        here->cadArray.resize(dataPresent->cad ? npoints : 0);
-        here->altArray.resize(dataPresent->alt ? npoints : 0);
-        here->tempArray.resize(dataPresent->temp ? npoints : 0);
-        here->windArray.resize(dataPresent->headwind ? npoints : 0);
-        here->torqueArray.resize(dataPresent->nm ? npoints : 0);
-        here->balanceArray.resize(dataPresent->lrbalance ? npoints : 0);
-        here->timeArray.resize(npoints);
-        here->distanceArray.resize(npoints);
-
-        // attach appropriate curves
-        here->wCurve->detach();
-        here->mCurve->detach();
-        here->wattsCurve->detach();
-        here->npCurve->detach();
-        here->xpCurve->detach();
-        here->apCurve->detach();
-        here->hrCurve->detach();
-        here->speedCurve->detach();
-        here->accelCurve->detach();
-        here->cadCurve->detach();
-        here->altCurve->detach();
-        here->tempCurve->detach();
-        here->windCurve->detach();
-        here->torqueCurve->detach();
-        here->balanceLCurve->detach();
-        here->balanceRCurve->detach();
 
-        if (!here->altArray.empty()) here->altCurve->attach(this);
-        if (!here->wattsArray.empty()) here->wattsCurve->attach(this);
-        if (!here->npArray.empty()) here->npCurve->attach(this);
-        if (!here->xpArray.empty()) here->xpCurve->attach(this);
-        if (!here->apArray.empty()) here->apCurve->attach(this);
-        if (showW && ride && !ride->wprimeData()->ydata().empty()) {
-            here->wCurve->attach(this);
-            here->mCurve->attach(this);
-        }
-        if (!here->hrArray.empty()) here->hrCurve->attach(this);
-        if (!here->speedArray.empty()) here->speedCurve->attach(this);
-        if (!here->accelArray.empty()) here->accelCurve->attach(this);
-        if (!here->cadArray.empty()) here->cadCurve->attach(this);
-        if (!here->tempArray.empty()) here->tempCurve->attach(this);
-        if (!here->windArray.empty()) here->windCurve->attach(this);
-        if (!here->torqueArray.empty()) here->torqueCurve->attach(this);
-        if (!here->balanceArray.empty()) {
-            here->balanceLCurve->attach(this);
-            here->balanceRCurve->attach(this);
-        }
-
-        here->wCurve->setVisible(dataPresent->watts && showPowerState < 2 && showW);
-        here->mCurve->setVisible(dataPresent->watts && showPowerState < 2 && showW);
-        here->wattsCurve->setVisible(dataPresent->watts && showPowerState < 2);
-        here->npCurve->setVisible(dataPresent->np && showNP);
-        here->xpCurve->setVisible(dataPresent->xp && showXP);
-        here->apCurve->setVisible(dataPresent->apower && showAP);
-        here->hrCurve->setVisible(dataPresent->hr && showHr);
-        here->speedCurve->setVisible(dataPresent->kph && showSpeed);
-        here->accelCurve->setVisible(dataPresent->kph && showAccel);
-        here->cadCurve->setVisible(dataPresent->cad && showCad);
-        here->altCurve->setVisible(dataPresent->alt && showAlt);
-        here->tempCurve->setVisible(dataPresent->temp && showTemp);
-        here->windCurve->setVisible(dataPresent->headwind && showWind);
-        here->torqueCurve->setVisible(dataPresent->nm && showWind);
-        here->balanceLCurve->setVisible(dataPresent->lrbalance && showBalance);
-        here->balanceRCurve->setVisible(dataPresent->lrbalance && showBalance);
-
-        int arrayLength = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-
-            // we round the time to nearest 100th of a second
-            // before adding to the array, to avoid situation
-            // where 'high precision' time slice is an artefact
-            // of double precision or slight timing anomalies
-            // e.g. where realtime gives timestamps like
-            // 940.002 followed by 940.998 and were previouslt
-            // both rounded to 940s
-            //
-            // NOTE: this rounding mechanism is identical to that
-            //       used by the Ride Editor.
-            double secs = floor(point->secs);
-            double msecs = round((point->secs - secs) * 100) * 10;
-
-            here->timeArray[arrayLength]  = secs + msecs/1000;
-            if (!here->wattsArray.empty()) here->wattsArray[arrayLength] = max(0, point->watts);
-            if (!here->npArray.empty()) here->npArray[arrayLength] = max(0, point->np);
-            if (!here->xpArray.empty()) here->xpArray[arrayLength] = max(0, point->xp);
-            if (!here->apArray.empty()) here->apArray[arrayLength] = max(0, point->apower);
-
-            if (!here->hrArray.empty())
-                here->hrArray[arrayLength]    = max(0, point->hr);
-            if (!here->accelArray.empty())
-                here->accelArray[arrayLength] = point->kphd;
-
-            if (!here->speedArray.empty())
-                here->speedArray[arrayLength] = max(0,
-                                              (context->athlete->useMetricUnits
-                                               ? point->kph
-                                               : point->kph * MILES_PER_KM));
-            if (!here->cadArray.empty())
-                here->cadArray[arrayLength]   = max(0, point->cad);
-            if (!here->altArray.empty())
-                here->altArray[arrayLength]   = (context->athlete->useMetricUnits
-                                           ? point->alt
-                                           : point->alt * FEET_PER_METER);
-            if (!here->tempArray.empty())
-                here->tempArray[arrayLength]   = point->temp;
-
-            if (!here->windArray.empty())
-                here->windArray[arrayLength] = max(0,
-                                             (context->athlete->useMetricUnits
-                                              ? point->headwind
-                                              : point->headwind * MILES_PER_KM));
-
-            if (!here->balanceArray.empty())
-                here->balanceArray[arrayLength]   = point->lrbalance;
-
-            here->distanceArray[arrayLength] = max(0,
-                                             (context->athlete->useMetricUnits
-                                              ? point->km
-                                              : point->km * MILES_PER_KM));
-
-            if (!here->torqueArray.empty())
-                here->torqueArray[arrayLength] = max(0,
-                                              (context->athlete->useMetricUnits
-                                               ? point->nm
-                                               : point->nm * FEET_LB_PER_NM));
-            ++arrayLength;
-        }
-        recalc(here);
+        // the derived series can be shown and hidden without
+        // the data being reloaded, so we need all of them
+        ride->recalculateDerivedSeries();
+
+        // as setDataFromRide, but we wait for it
+        AllPlotJob job(ride, context->athlete->useMetricUnits, smooth, QString());
+        job.prepare();
+        setDataFromJob(&job, ride, here);
     }
     else {
         //setTitle("no data");
@@ -3106,6 +2880,94 @@ AllPlot::setDataFromRideFile(RideFile *ride, AllPlotObject *here)
         here->referenceLines.clear();
     }
 
+    // remember the curves and colors
+    isolation = false;
+    curveColors->saveState();
+}
+
+void
+AllPlot::setDataFromJob(AllPlotJob *job, RideFile *ride, AllPlotObject *here)
+{
+    // implicitly shared, so these are cheap
+    here->wattsArray = job->wattsArray;
+    here->npArray = job->npArray;
+    here->xpArray = job->xpArray;
+    here->apArray = job->apArray;
+    here->hrArray = job->hrArray;
+    here->speedArray = job->speedArray;
+    here->accelArray = job->accelArray;
+    here->cadArray = job->cadArray;
+    here->altArray = job->altArray;
+    here->tempArray = job->tempArray;
+    here->windArray = job->windArray;
+    here->torqueArray = job->torqueArray;
+    here->balanceArray = job->balanceArray;
+    here->timeArray = job->timeArray;
+    here->distanceArray = job->distanceArray;
+
+    // already has the prefix sums and the smoothing we're at
+    here->smoother = job->smoother;
+
+    const RideFileDataPresent *dataPresent = ride->areDataPresent();
+
+    // attach appropriate curves
+    here->wCurve->detach();
+    here->mCurve->detach();
+    here->wattsCurve->detach();
+    here->npCurve->detach();
+    here->xpCurve->detach();
+    here->apCurve->detach();
+    here->hrCurve->detach();
+    here->speedCurve->detach();
+    here->accelCurve->detach();
+    here->cadCurve->detach();
+    here->altCurve->detach();
+    here->tempCurve->detach();
+    here->windCurve->detach();
+    here->torqueCurve->detach();
+    here->balanceLCurve->detach();
+    here->balanceRCurve->detach();
+
+    if (!here->altArray.empty()) here->altCurve->attach(this);
+    if (!here->wattsArray.empty()) here->wattsCurve->attach(this);
+    if (!here->npArray.empty()) here->npCurve->attach(this);
+    if (!here->xpArray.empty()) here->xpCurve->attach(this);
+    if (!here->apArray.empty()) here->apCurve->attach(this);
+    if (showW && ride && !ride->wprimeData()->ydata().empty()) {
+        here->wCurve->attach(this);
+        here->mCurve->attach(this);
+    }
+    if (!here->hrArray.empty()) here->hrCurve->attach(this);
+    if (!here->speedArray.empty()) here->speedCurve->attach(this);
+    if (!here->accelArray.empty()) here->accelCurve->attach(this);
+    if (!here->cadArray.empty()) here->cadCurve->attach(this);
+    if (!here->tempArray.empty()) here->tempCurve->attach(this);
+    if (!here->windArray.empty()) here->windCurve->attach(this);
+    if (!here->torqueArray.empty()) here->torqueCurve->attach(this);
+    if (!here->balanceArray.empty()) {
+        here->balanceLCurve->attach(this);
+        here->balanceRCurve->attach(this);
+    }
+
+    here->wCurve->setVisible(dataPresent->watts && showPowerState < 2 && showW);
+    here->mCurve->setVisible(dataPresent->watts && showPowerState < 2 && showW);
+    here->wattsCurve->setVisible(dataPresent->watts && showPowerState < 2);
+    here->npCurve->setVisible(dataPresent->np && showNP);
+    here->xpCurve->setVisible(dataPresent->xp && showXP);
+    here->apCurve->setVisible(dataPresent->apower && showAP);
+    here->hrCurve->setVisible(dataPresent->hr && showHr);
+    here->speedCurve->setVisible(dataPresent->kph && showSpeed);
+    here->accelCurve->setVisible(dataPresent->kph && showAccel);
+    here->cadCurve->setVisible(dataPresent->cad && showCad);
+    here->altCurve->setVisible(dataPresent->alt && showAlt);
+    here->tempCurve->setVisible(dataPresent->temp && showTemp);
+    here->windCurve->setVisible(dataPresent->headwind && showWind);
+    here->torqueCurve->setVisible(dataPresent->nm && showWind);
+    here->balanceLCurve->setVisible(dataPresent->lrbalance && showBalance);
+    here->balanceRCurve->setVisible(dataPresent->lrbalance && showBalance);
+
+    recalc(here);
+
     // record the max x value
     if (here->timeArray.count() && here->distanceArray.count()) {
         int maxSECS = here->timeArray[here->timeArray.count()-1];
@@ -3113,10 +2975,127 @@ AllPlot::setDataFromRideFile(RideFile *ride, AllPlotObject *here)
         if (maxKM > here->maxKM) here->maxKM = maxKM;
         if (maxSECS > here->maxSECS) here->maxSECS = maxSECS;
     }
+}
 
-    // remember the curves and colors
-    isolation = false;
-    curveColors->saveState();
+AllPlotJob::AllPlotJob(RideFile *ride, bool useMetricUnits, int smooth, QString key) :
+    ChartJob(key), useMetricUnits(useMetricUnits), smooth(smooth), dataPresent(*ride->areDataPresent())
+{
+    points.reserve(ride->dataPoints().size());
+    foreach (const RideFilePoint *point, ride->dataPoints()) points << *point;
+}
+
+void
+AllPlotJob::prepare()
+{
+    int npoints = points.size();
+    wattsArray.resize(dataPresent.watts ? npoints : 0);
+    npArray.resize(dataPresent.np ? npoints : 0);
+    xpArray.resize(dataPresent.xp ? npoints : 0);
+    apArray.resize(dataPresent.apower ? npoints : 0);
+    hrArray.resize(dataPresent.hr ? npoints : 0);
+    speedArray.resize(dataPresent.kph ? npoints : 0);
+    accelArray.resize(dataPresent.kph ? npoints : 0);
+    cadArray.resize(dataPresent.cad ? npoints : 0);
+    altArray.resize(dataPresent.alt ? npoints : 0);
+    tempArray.resize(dataPresent.temp ? npoints : 0);
+    windArray.resize(dataPresent.headwind ? npoints : 0);
+    torqueArray.resize(dataPresent.nm ? npoints : 0);
+    balanceArray.resize(dataPresent.lrbalance ? npoints : 0);
+    timeArray.resize(npoints);
+    distanceArray.resize(npoints);
+
+    int arrayLength = 0;
+    foreach (const RideFilePoint &p, points) {
+        const RideFilePoint *point = &p;
+
+        // selected another ride already?
+        if ((arrayLength & 0xfff) == 0 && cancelled()) return;
+
+        // we round the time to nearest 100th of a second
+        // before adding to the array, to avoid situation
+        // where 'high precision' time slice is an artefact
+        // of double precision or slight timing anomalies
+        // e.g. where realtime gives timestamps like
+        // 940.002 followed by 940.998 and were previouslt
+        // both rounded to 940s
+        //
+        // NOTE: this rounding mechanism is identical to that
+        //       used by the Ride Editor.
+        double secs = floor(point->secs);
+        double msecs = round((point->secs - secs) * 100) * 10;
+
+        timeArray[arrayLength]  = secs + msecs/1000;
+        if (!wattsArray.empty()) wattsArray[arrayLength] = max(0, point->watts);
+        if (!npArray.empty()) npArray[arrayLength] = max(0, point->np);
+        if (!xpArray.empty()) xpArray[arrayLength] = max(0, point->xp);
+        if (!apArray.empty()) apArray[arrayLength] = max(0, point->apower);
+
+        if (!hrArray.empty())
+            hrArray[arrayLength]    = max(0, point->hr);
+        if (!accelArray.empty())
+            accelArray[arrayLength] = point->kphd;
+
+        if (!speedArray.empty())
+            speedArray[arrayLength] = max(0,
+                                          (useMetricUnits
+                                           ? point->kph
+                                           : point->kph * MILES_PER_KM));
+        if (!cadArray.empty())
+            cadArray[arrayLength]   = max(0, point->cad);
+        if (!altArray.empty())
+            altArray[arrayLength]   = (useMetricUnits
+                                       ? point->alt
+                                       : point->alt * FEET_PER_METER);
+        if (!tempArray.empty())
+            tempArray[arrayLength]   = point->temp;
+
+        if (!windArray.empty())
+            windArray[arrayLength] = max(0,
+                                         (useMetricUnits
+                                          ? point->headwind
+                                          : point->headwind * MILES_PER_KM));
+
+        if (!balanceArray.empty())
+            balanceArray[arrayLength]   = point->lrbalance;
+
+        distanceArray[arrayLength] = max(0,
+                                         (useMetricUnits
+                                          ? point->km
+                                          : point->km * MILES_PER_KM));
+
+        if (!torqueArray.empty())
+            torqueArray[arrayLength] = max(0,
+                                           (useMetricUnits
+                                            ? point->nm
+                                            : point->nm * FEET_LB_PER_NM));
+        ++arrayLength;
+    }
+
+    // reset the smoother with the new data
+    smoother.setTime(timeArray);
+    smoother.setChannel(AllPlotSmoother::Watts, wattsArray);
+    smoother.setChannel(AllPlotSmoother::NP, npArray);
+    smoother.setChannel(AllPlotSmoother::XP, xpArray);
+    smoother.setChannel(AllPlotSmoother::AP, apArray);
+    smoother.setChannel(AllPlotSmoother::Hr, hrArray);
+    smoother.setChannel(AllPlotSmoother::Speed, speedArray);
+    smoother.setChannel(AllPlotSmoother::Accel, accelArray);
+    smoother.setChannel(AllPlotSmoother::Cad, cadArray);
+    smoother.setChannel(AllPlotSmoother::Alt, altArray);
+    smoother.setChannel(AllPlotSmoother::Temp, tempArray);
+    smoother.setChannel(AllPlotSmoother::Wind, windArray);
+    smoother.setChannel(AllPlotSmoother::Torque, torqueArray);
+    smoother.setChannel(AllPlotSmoother::Balance, balanceArray);
+    smoother.setChannel(AllPlotSmoother::Distance, distanceArray);
+
+    // and smooth at the width we're at, recalc() only has to set the curves
+    if (smooth > 0 && timeArray.count() && timeArray.last() <= 7*24*60*60) {
+        for (int i=0; i<AllPlotSmoother::NumChannels; i++) {
+            if (cancelled()) return;
+            AllPlotSmoother::Channel channel = static_cast<AllPlotSmoother::Channel>(i);
+            if (smoother.hasChannel(channel)) smoother.smoothed(channel, smooth);
+        }
+    }
 }
 
 void
@@ -44,6 +44,8 @@
 
 
 #include "RideFile.h"
+#include "AllPlotSmoother.h"
+#include "ChartPrep.h"
 
 class QwtPlotCurve;
 class QwtPlotIntervalCurve;
@@ -54,6 +56,7 @@ class AllPlotBackground;
 class AllPlotZoneLabel;
 class AllPlotWindow;
 class AllPlot;
+class AllPlotJob;
 struct RideFilePoint;
 class IntervalItem;
 class IntervalPlotData;
@@ -348,6 +351,9 @@ class AllPlotObject : public QObject
     QVector<double> smoothBalanceR;
     QVector<QwtIntervalSample> smoothRelSpeed;
 
+    // computes the smoothed data above
+    AllPlotSmoother smoother;
+
     // highlighting intervals
     QwtPlotCurve *intervalHighlighterCurve,  // highlight selected intervals on the Plot
                  *intervalHoverCurve;
@@ -375,7 +381,9 @@ class AllPlot : public QwtPlot
 
         bool eventFilter(QObject *object, QEvent *e);
 
-        // set the curve data e.g. when a ride is selected
+        // set the curve data e.g. when a ride is selected, the ride's
+        // data is smoothed in the background and dataPrepared() emitted
+        // once the curves are set, which may be before we return
         void setDataFromRide(RideItem *_rideItem);
         void setDataFromRideFile(RideFile *ride, AllPlotObject *object); // when plotting lots of rides on fullPlot
         void setDataFromPlot(AllPlot *plot, int startidx, int stopidx);
@@ -438,6 +446,11 @@ class AllPlot : public QwtPlot
         void pointHover(QwtPlotCurve*, int);
         void intervalHover(RideFileInterval h);
 
+        void setPrepared(ChartJob *job); // the arrays for setDataFromRide
+
+    signals:
+        void dataPrepared();
+
     protected:
 
         friend class ::AllPlotBackground;
@@ -495,8 +508,31 @@ class AllPlot : public QwtPlot
         LTMToolTip *tooltip;
         LTMCanvasPicker *_canvasPicker; // allow point selection/hover
 
+        ChartPreparer *preparer;
+        void setDataFromJob(AllPlotJob *job, RideFile *ride, AllPlotObject *here);
+
         static void nextStep( int& step );
 };
 
+// the curve data for a ride, converted and smoothed in the background
+class AllPlotJob : public ChartJob
+{
+    public:
+        AllPlotJob(RideFile *ride, bool useMetricUnits, int smooth, QString key);
+        void prepare();
+
+        // as AllPlotObject
+        QVector<double> hrArray, wattsArray, npArray, xpArray, apArray,
+                        speedArray, accelArray, cadArray, timeArray, distanceArray,
+                        altArray, tempArray, windArray, torqueArray, balanceArray;
+        AllPlotSmoother smoother;
+
+    private:
+        bool useMetricUnits;
+        int smooth;
+        RideFileDataPresent dataPresent;
+        QVector<RideFilePoint> points;
+};
+
 #endif // _GC_AllPlot_h
 
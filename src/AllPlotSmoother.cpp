@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "AllPlotSmoother.h"
+#include "RideFile.h" // for RideFile::noTemp
+#include <math.h>
+
+// how many different smoothing widths to remember
+static const int MAXWIDTHS = 6;
+
+AllPlotSmoother::AllPlotSmoother() : secs(0)
+{
+}
+
+void
+AllPlotSmoother::clear()
+{
+    secs = 0;
+    time.clear();
+    for (int i=0; i<NumChannels; i++) {
+        raw[i].clear();
+        prefix[i].clear();
+    }
+    windows.clear();
+    cache.clear();
+    widths.clear();
+}
+
+void
+AllPlotSmoother::setTime(const QVector<double> &t)
+{
+    clear();
+    time = t;
+    if (time.count()) secs = (int) ceil(time[time.count()-1]);
+}
+
+void
+AllPlotSmoother::setChannel(Channel channel, const QVector<double> &data)
+{
+    // lose anything we computed for this channel before
+    QMutableMapIterator<QPair<int,int>, QVector<double> > it(cache);
+    while (it.hasNext()) {
+        it.next();
+        if (it.key().first == channel) it.remove();
+    }
+
+    raw[channel].clear();
+    prefix[channel].clear();
+
+    if (data.count() != time.count() || data.isEmpty()) return;
+
+    raw[channel] = data;
+
+    // distance is not averaged, we just take the
+    // last sample in the window so no prefix needed
+    if (channel == Distance) return;
+
+    // the missing value conventions are applied up front so the
+    // kernel doesn't need to know anything about the channel
+    if (channel == Temp) {
+        double *p = raw[channel].data(); // detach
+        double last = 0.0;
+        for (int i=0; i<raw[channel].count(); i++) {
+            if (p[i] == RideFile::noTemp) p[i] = last;
+            else last = p[i];
+        }
+    }
+    if (channel == Balance) {
+        double *p = raw[channel].data(); // detach
+        for (int i=0; i<raw[channel].count(); i++)
+            if (p[i] <= 0) p[i] = 50;
+    }
+
+    int n = raw[channel].count();
+    prefix[channel].resize(n+1);
+    const double *src = raw[channel].constData();
+    double *P = prefix[channel].data();
+    double sum = 0.0;
+    P[0] = 0.0;
+    for (int i=0; i<n; i++) {
+        sum += src[i];
+        P[i+1] = sum;
+    }
+}
+
+const AllPlotSmoother::Window &
+AllPlotSmoother::window(int width)
+{
+    QMap<int, Window>::const_iterator found = windows.constFind(width);
+    if (found != windows.constEnd()) return found.value();
+
+    // the window at second s contains all the samples with
+    // s - width <= time <= s, the time array is ascending so
+    // both boundaries only ever move forward.
+    Window w;
+    w.lo.resize(secs+1);
+    w.hi.resize(secs+1);
+
+    const double *t = time.constData();
+    int n = time.count();
+    int lo = 0, hi = 0;
+    for (int s = 0; s <= secs; s++) {
+        while (hi < n && t[hi] <= s) hi++;
+        while (lo < hi && t[lo] < s - width) lo++;
+        w.lo[s] = lo;
+        w.hi[s] = hi;
+    }
+    return windows.insert(width, w).value();
+}
+
+void
+AllPlotSmoother::touch(int width)
+{
+    widths.removeAll(width);
+    widths.append(width);
+
+    while (widths.count() > MAXWIDTHS) {
+        int old = widths.takeFirst();
+        windows.remove(old);
+        for (int i=0; i<NumChannels; i++) cache.remove(QPair<int,int>(i, old));
+    }
+}
+
+QVector<double>
+AllPlotSmoother::smoothed(Channel channel, int width)
+{
+    if (raw[channel].isEmpty() || width < 1) return QVector<double>();
+
+    touch(width);
+
+    QPair<int,int> key(channel, width);
+    QMap<QPair<int,int>, QVector<double> >::const_iterator found = cache.constFind(key);
+    if (found != cache.constEnd()) return found.value();
+
+    QVector<double> out(secs+1, 0.0);
+    compute(channel, width, out);
+    cache.insert(key, out);
+    return out;
+}
+
+void
+AllPlotSmoother::compute(Channel channel, int width, QVector<double> &out)
+{
+    const Window &w = window(width);
+    const int *lo = w.lo.constData();
+    const int *hi = w.hi.constData();
+    double *o = out.data();
+
+    if (channel == Distance) {
+        const double *d = raw[channel].constData();
+        for (int s = width; s <= secs; s++) o[s] = hi[s] ? d[hi[s]-1] : 0.0;
+        return;
+    }
+
+    const double *P = prefix[channel].constData();
+    if (channel == Alt) {
+        // gaps hold the last altitude rather than dropping to zero
+        for (int s = width; s <= secs; s++) {
+            int count = hi[s] - lo[s];
+            o[s] = count ? (P[hi[s]] - P[lo[s]]) / double(count) : o[s-1];
+        }
+    } else {
+        for (int s = width; s <= secs; s++) {
+            int count = hi[s] - lo[s];
+            o[s] = count ? (P[hi[s]] - P[lo[s]]) / double(count) : 0.0;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_AllPlotSmoother_h
+#define _GC_AllPlotSmoother_h 1
+
+#include <QVector>
+#include <QMap>
+#include <QPair>
+#include <QList>
+
+//
+// Rolling average smoother for the AllPlot curves
+//
+// The ride plot used to smooth every channel at once by pushing a
+// datapoint per sample onto a list and maintaining running totals
+// for all 14 channels regardless of whether they had any data.
+//
+// Instead we keep a prefix sum for each channel that has data and the
+// window boundaries (as sample indexes) for each second of the ride.
+// A smoothed value is then just (P[hi] - P[lo]) / (hi - lo), so a new
+// smoothing width is a single pass per channel with no allocations
+// in the inner loop.
+//
+// Results are cached by (channel, width) so dragging the smoothing
+// slider back and forth just hands back the (implicitly shared) vector
+// we computed last time. The cache is bounded to the last few widths
+// used since a long ride at 1s resolution is ~100k per channel.
+//
+class AllPlotSmoother
+{
+    public:
+
+        enum channel { Watts=0, NP, XP, AP, Hr, Speed, Accel, Cad,
+                       Alt, Temp, Wind, Torque, Balance, Distance,
+                       NumChannels };
+        typedef enum channel Channel;
+
+        AllPlotSmoother();
+
+        // set the sample times (must be ascending), this
+        // clears all channel data and the cache
+        void setTime(const QVector<double> &time);
+
+        // set the raw data for a channel, same length as time
+        // or empty if the ride does not contain that channel
+        void setChannel(Channel channel, const QVector<double> &data);
+
+        // is there any data for this channel ?
+        bool hasChannel(Channel channel) const { return !raw[channel].isEmpty(); }
+
+        // 1s resolution smoothed channel from 0 to rideTimeSecs() inclusive
+        // values before the window is full are zero, as they always were
+        QVector<double> smoothed(Channel channel, int width);
+
+        // last whole second in the ride
+        int rideTimeSecs() const { return secs; }
+
+        // wipe everything
+        void clear();
+
+    private:
+
+        // window boundaries for a given width, lo is the
+        // first sample in the window, hi is one past the last
+        struct Window {
+            QVector<int> lo, hi;
+        };
+        const Window &window(int width);
+
+        void compute(Channel channel, int width, QVector<double> &out);
+
+        // remove least recently used widths
+        void touch(int width);
+
+        int secs;
+        QVector<double> time;
+        QVector<double> raw[NumChannels];
+        QVector<double> prefix[NumChannels];
+
+        QMap<int, Window> windows;
+        QMap<QPair<int,int>, QVector<double> > cache;
+        QList<int> widths; // most recently used last
+};
+
+#endif // _GC_AllPlotSmoother_h
@@ -416,6 +416,7 @@ AllPlotWindow::AllPlotWindow(Context *context) :
 #endif
 
     fullPlot = new AllPlot(this, context);
+    connect(fullPlot, SIGNAL(dataPrepared()), this, SLOT(ridePrepared()));
     fullPlot->standard->grid->enableY(false);
     fullPlot->setFixedHeight(100);
     fullPlot->setCanvasBackground(GColor(CRIDEPLOTBACKGROUND));
@@ -1021,9 +1022,21 @@ AllPlotWindow::rideSelected()
     // before we set the plots below...
     setAllPlotWidgets(ride);
 
-    // setup the charts to reflect current ride selection
+    // we need to reset the stacks as the ride has changed
+    // but it may ignore if not in stacked mode.
+    setupSeriesStack = setupStack = false;
+    stale = false;
+
+    // setup the charts to reflect current ride selection, the
+    // rest is done in ridePrepared() once fullPlot has the data
     fullPlot->setDataFromRide(ride);
+}
 
+void
+AllPlotWindow::ridePrepared()
+{
+    RideItem *ride = current;
+    if (isCompare() || !ride || !ride->ride()) return;
 
     // Fixup supplied by Josef Gebel
     int startidx, stopidx;
@@ -1042,14 +1055,8 @@ AllPlotWindow::rideSelected()
     redrawFullPlot();
     redrawAllPlot();
 
-    // we need to reset the stacks as the ride has changed
-    // but it may ignore if not in stacked mode.
-    setupSeriesStack = setupStack = false;
-
     setupStackPlots();
     setupSeriesStackPlots();
-
-    stale = false;
 }
 
 void
@@ -1751,7 +1758,7 @@ AllPlotWindow::setShowNP(int value)
     bool checked = ( ( value == Qt::Checked ) && showNP->isEnabled()) ? true : false;
 
     // recalc only does it if it needs to
-    if (value && current && current->ride()) current->ride()->recalculateDerivedSeries();
+    if (value && current && current->ride()) current->ride()->recalculateDerivedSeries(RideFile::NP);
 
     allPlot->setShowNP(checked);
     foreach (AllPlot *plot, allPlots)
@@ -1774,7 +1781,7 @@ AllPlotWindow::setShowXP(int value)
     bool checked = ( ( value == Qt::Checked ) && showXP->isEnabled()) ? true : false;
 
     // recalc only does it if it needs to
-    if (value && current && current->ride()) current->ride()->recalculateDerivedSeries();
+    if (value && current && current->ride()) current->ride()->recalculateDerivedSeries(RideFile::xPower);
 
     allPlot->setShowXP(checked);
     foreach (AllPlot *plot, allPlots)
@@ -1797,7 +1804,7 @@ AllPlotWindow::setShowAP(int value)
     bool checked = ( ( value == Qt::Checked ) && showAP->isEnabled()) ? true : false;
 
     // recalc only does it if it needs to
-    if (value && current && current->ride()) current->ride()->recalculateDerivedSeries();
+    if (value && current && current->ride()) current->ride()->recalculateDerivedSeries(RideFile::aPower);
 
     allPlot->setShowAP(checked);
     foreach (AllPlot *plot, allPlots)
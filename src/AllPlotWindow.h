@@ -116,6 +116,7 @@ class AllPlotWindow : public GcChartWindow
 
         // trap GC signals
         void rideSelected();
+        void ridePrepared(); // fullPlot has the ride's data
         void rideDeleted(RideItem *ride);
         void intervalSelected();
         void zonesChanged();
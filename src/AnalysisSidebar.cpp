@@ -32,6 +32,8 @@
 #include "IntervalItem.h"
 #include "AddIntervalDialog.h"
 #include "BestIntervalDialog.h"
+#include "MetricAggregator.h"
+#include "RouteIndex.h"
 
 AnalysisSidebar::AnalysisSidebar(Context *context) : QWidget(context->mainWindow), context(context)
 {
@@ -322,17 +324,25 @@ AnalysisSidebar::showIntervalMenu(const QPoint &pos)
         QAction *actZoomInt = new QAction(tr("Zoom to interval"), context->athlete->intervalWidget);
         QAction *actFrontInt = new QAction(tr("Bring to Front"), context->athlete->intervalWidget);
         QAction *actBackInt = new QAction(tr("Send to back"), context->athlete->intervalWidget);
+        QAction *actFindSegment = new QAction(tr("Find in other rides..."), context->athlete->intervalWidget);
         connect(actEditInt, SIGNAL(triggered(void)), this, SLOT(editInterval(void)));
         connect(actDeleteInt, SIGNAL(triggered(void)), this, SLOT(deleteInterval(void)));
         connect(actZoomOut, SIGNAL(triggered(void)), this, SLOT(zoomOut(void)));
         connect(actZoomInt, SIGNAL(triggered(void)), this, SLOT(zoomInterval(void)));
         connect(actFrontInt, SIGNAL(triggered(void)), this, SLOT(frontInterval(void)));
         connect(actBackInt, SIGNAL(triggered(void)), this, SLOT(backInterval(void)));
+        connect(actFindSegment, SIGNAL(triggered(void)), this, SLOT(findSegment(void)));
 
         menu.addAction(actZoomOut);
         menu.addAction(actZoomInt);
         menu.addAction(actEditInt);
         menu.addAction(actDeleteInt);
+
+        // only if we know where it was
+        if (context->ride && context->ride->ride() && context->ride->ride()->areDataPresent()->lat) {
+            menu.addSeparator();
+            menu.addAction(actFindSegment);
+        }
         menu.exec(context->athlete->intervalWidget->mapToGlobal(pos));
     }
 }
@@ -577,6 +587,76 @@ AnalysisSidebar::zoomInterval() {
     context->notifyIntervalZoom(activeInterval);
 }
 
+static bool
+earlierMatch(const SummaryMetrics &a, const SummaryMetrics &b)
+{
+    return a.getRideDate() < b.getRideDate();
+}
+
+void
+AnalysisSidebar::findSegment()
+{
+    if (!context->ride || !context->ride->ride()) return;
+    RideFile *ride = context->ride->ride();
+
+    RouteSegment segment(ride, activeInterval->start, activeInterval->stop);
+    if (!segment.isValid()) {
+        QMessageBox::critical(this, tr("Find in other rides"), tr("The interval has no GPS data"));
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QList<RouteMatch> matches = context->athlete->metricDB->findSegment(segment);
+    QApplication::restoreOverrideCursor();
+
+    // the other times round in this ride become intervals too
+    QString name = activeInterval->text(0);
+    QList<RouteMatch> others;
+    int added = 0;
+    foreach(RouteMatch match, matches) {
+
+        if (match.fileName != context->ride->fileName) {
+            others << match;
+            continue;
+        }
+
+        // the one we started from
+        if (match.stop > activeInterval->start && match.start < activeInterval->stop) continue;
+
+        QTreeWidgetItem *repeat =
+            new IntervalItem(ride, name + QString(" (%1)").arg(added+2),
+                             match.start, match.stop,
+                             ride->timeToDistance(match.start),
+                             ride->timeToDistance(match.stop),
+                             context->athlete->allIntervals->childCount()+1);
+        repeat->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled);
+        context->athlete->allIntervals->addChild(repeat);
+        added++;
+    }
+    if (added) context->athlete->updateRideFileIntervals();
+
+    // and the rest are listed oldest first with their time and speed
+    QList<SummaryMetrics> series = segment.series(others);
+    qSort(series.begin(), series.end(), earlierMatch);
+
+    bool metric = context->athlete->useMetricUnits;
+    QString list;
+    foreach(SummaryMetrics match, series) {
+        double speed = match.getForSymbol("Segment Speed") * (metric ? 1.0 : MILES_PER_KM);
+        list += QString("%1  %2  %3 %4\n")
+                .arg(match.getRideDate().toString("dd MMM yyyy hh:mm"))
+                .arg(QTime(0,0,0).addSecs(match.getForSymbol("Segment Time")).toString("hh:mm:ss"))
+                .arg(speed, 0, 'f', 1)
+                .arg(metric ? tr("kph") : tr("mph"));
+    }
+
+    QMessageBox results(QMessageBox::Information, tr("Find in other rides"),
+                        tr("%1 other times in this ride, %2 in other rides.").arg(added).arg(series.count()),
+                        QMessageBox::Ok, this);
+    if (!list.isEmpty()) results.setDetailedText(list);
+    results.exec();
+}
+
 void
 AnalysisSidebar::frontInterval()
 {
@@ -68,6 +68,7 @@ class AnalysisSidebar : public QWidget
         void deleteInterval(); // from right click
         void renameInterval(); // from right click
         void zoomInterval(); // from right click
+        void findSegment(); // from right click
         void sortIntervals(); // from menu popup
         void renameIntervalSelected(void); // from menu popup
         void renameIntervalsSelected(void); // from menu popup -- rename a series
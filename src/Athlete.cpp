@@ -28,6 +28,7 @@
 #include "Units.h"
 #include "Zones.h"
 #include "MetricAggregator.h"
+#include "MetricTableModel.h"
 #include "WithingsDownload.h"
 #include "ZeoDownload.h"
 #include "CalendarDownload.h"
@@ -36,8 +37,12 @@
 #include "ICalendar.h"
 #include "CalDAV.h"
 #endif
+#ifdef GC_HAVE_SEARCH
 #ifdef GC_HAVE_LUCENE
 #include "Lucene.h"
+#else
+#include "MetadataIndex.h"
+#endif
 #include "NamedSearch.h"
 #endif
 #include "IntervalItem.h"
@@ -46,7 +51,7 @@
 #include "GcUpgrade.h" // upgrade wizard
 #include "GcCrashDialog.h" // recovering from a crash?
 
-Athlete::Athlete(Context *context, const QDir &home)
+Athlete::Athlete(Context *context, const QDir &home, bool headless)
 {
     // athlete name
     this->home = home;
@@ -55,12 +60,14 @@ Athlete::Athlete(Context *context, const QDir &home)
     cyclist = home.dirName();
     isclean = false;
 
-    // Recovering from a crash?
-    if(!appsettings->cvalue(cyclist, GC_SAFEEXIT, true).toBool()) {
-        GcCrashDialog *crashed = new GcCrashDialog(home);
-        crashed->exec();
+    // Recovering from a crash? (not our business when headless)
+    if (!headless) {
+        if(!appsettings->cvalue(cyclist, GC_SAFEEXIT, true).toBool()) {
+            GcCrashDialog *crashed = new GcCrashDialog(home);
+            crashed->exec();
+        }
+        appsettings->setCValue(cyclist, GC_SAFEEXIT, false); // will be set to true on exit
     }
-    appsettings->setCValue(cyclist, GC_SAFEEXIT, false); // will be set to true on exit
 
     // Before we initialise we need to run the upgrade wizard for this athlete
     GcUpgrade v3;
@@ -76,15 +83,23 @@ Athlete::Athlete(Context *context, const QDir &home)
     }
     useMetricUnits = (unit.toString() == GC_UNIT_METRIC);
 
+    // elevation gain hysteresis, the metrics are computed on
+    // threads that mustn't read the settings, we default to 3.0
+    elevationHysteresis = appsettings->value(NULL, GC_ELEVATION_HYSTERESIS).toDouble();
+    if (elevationHysteresis <= 0.1) elevationHysteresis = 3.00;
+
     // Power Zones
     zones_ = new Zones;
     QFile zonesFile(home.absolutePath() + "/power.zones");
     if (zonesFile.exists()) {
         if (!zones_->read(zonesFile)) {
-            QMessageBox::critical(context->mainWindow, tr("Zones File Error"),
+            if (headless) qDebug()<<"zones file error:"<<zones_->errorString();
+            else QMessageBox::critical(context->mainWindow, tr("Zones File Error"),
 				  zones_->errorString());
-        } else if (! zones_->warningString().isEmpty())
-            QMessageBox::warning(context->mainWindow, tr("Reading Zones File"), zones_->warningString());
+        } else if (! zones_->warningString().isEmpty()) {
+            if (headless) qDebug()<<"reading zones file:"<<zones_->warningString();
+            else QMessageBox::warning(context->mainWindow, tr("Reading Zones File"), zones_->warningString());
+        }
     }
 
     // Heartrate Zones
@@ -92,10 +107,13 @@ Athlete::Athlete(Context *context, const QDir &home)
     QFile hrzonesFile(home.absolutePath() + "/hr.zones");
     if (hrzonesFile.exists()) {
         if (!hrzones_->read(hrzonesFile)) {
-            QMessageBox::critical(context->mainWindow, tr("HR Zones File Error"),
+            if (headless) qDebug()<<"hr zones file error:"<<hrzones_->errorString();
+            else QMessageBox::critical(context->mainWindow, tr("HR Zones File Error"),
 				  hrzones_->errorString());
-        } else if (! hrzones_->warningString().isEmpty())
-            QMessageBox::warning(context->mainWindow, tr("Reading HR Zones File"), hrzones_->warningString());
+        } else if (! hrzones_->warningString().isEmpty()) {
+            if (headless) qDebug()<<"reading hr zones file:"<<hrzones_->warningString();
+            else QMessageBox::warning(context->mainWindow, tr("Reading HR Zones File"), hrzones_->warningString());
+        }
     }
 
     // Metadata
@@ -106,19 +124,39 @@ Athlete::Athlete(Context *context, const QDir &home)
     seasons = new Seasons(home);
 
     // Search / filter
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     namedSearches = new NamedSearches(this); // must be before navigator
+#ifdef GC_HAVE_LUCENE
     lucene = new Lucene(context, context); // before metricDB attempts to refresh
+#else
+    metadataIndex = new MetadataIndex(context, context); // before metricDB attempts to refresh
+#endif
 #endif
 
     // metrics DB
     metricDB = new MetricAggregator(context); // just to catch config updates!
+
+    // batch processing just needs the basics
+    if (headless) {
+        sqlModel = NULL;
+        withingsDownload = NULL;
+        zeoDownload = NULL;
+        calendarDownload = NULL;
+#ifdef GC_HAVE_ICAL
+        rideCalendar = NULL;
+        davCalendar = NULL;
+#endif
+        treeWidget = NULL;
+        allRides = allIntervals = NULL;
+        intervalWidget = NULL;
+        return;
+    }
+
     metricDB->refreshMetrics();
 
     // the model atop the metric DB
-    sqlModel = new QSqlTableModel(this, metricDB->db()->connection());
-    sqlModel->setTable("metrics");
-    sqlModel->setEditStrategy(QSqlTableModel::OnManualSubmit);
+    sqlModel = new MetricTableModel(this, metricDB->db()->connection());
+    sqlModel->select();
 
     // Downloaders
     withingsDownload = new WithingsDownload(context);
@@ -210,9 +248,13 @@ Athlete::~Athlete()
     delete sqlModel;
     delete metricDB;
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     delete namedSearches;
+#ifdef GC_HAVE_LUCENE
     delete lucene;
+#else
+    delete metadataIndex;
+#endif
 #endif
     delete seasons;
 
@@ -355,7 +397,7 @@ Athlete::removeCurrentRide()
 
     // remove any other derived/additional files; notes, cpi etc
     QStringList extras;
-    extras << "notes" << "cpi" << "cpx";
+    extras << "notes" << "cpi" << "cpx" << "cpd";
     foreach (QString extension, extras) {
 
         QString deleteMe = QFileInfo(strOldFileName).baseName() + "." + extension;
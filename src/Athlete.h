@@ -40,12 +40,13 @@ class CalDAV;
 class Seasons;
 class RideNavigator;
 class Lucene;
+class MetadataIndex;
 class NamedSearches;
 class RideFileCache;
 class RideItem;
 class IntervalItem;
 class IntervalTreeView;
-class QSqlTableModel;
+class MetricTableModel;
 
 class Context;
 class Context;
@@ -55,13 +56,16 @@ class Athlete : public QObject
     Q_OBJECT
 
     public:
-        Athlete(Context *context, const QDir &home);
+        // headless is for batch processing, there are no widgets, ride
+        // list or downloads and the caller refreshes the metrics
+        Athlete(Context *context, const QDir &home, bool headless = false);
         ~Athlete();
         void close();
 
         // basic athlete info
         QString cyclist; // the cyclist name
         bool useMetricUnits;
+        double elevationHysteresis; // metres, read here for the metric threads
         QDir home;
         const Zones *zones() const { return zones_; }
         const HrZones *hrZones() const { return hrzones_; }
@@ -70,7 +74,7 @@ class Athlete : public QObject
         void setCriticalPower(int cp);
         bool isclean;
         MetricAggregator *metricDB;
-        QSqlTableModel *sqlModel;
+        MetricTableModel *sqlModel;
         RideMetadata *rideMetadata_;
         Seasons *seasons;
         QList<RideFileCache*> cpxCache;
@@ -88,8 +92,12 @@ class Athlete : public QObject
         RideMetadata *rideMetadata() { return rideMetadata_; }
 
         // indexes / filters
+#ifdef GC_HAVE_SEARCH
 #ifdef GC_HAVE_LUCENE
         Lucene *lucene;
+#else
+        MetadataIndex *metadataIndex; // when we don't have CLucene
+#endif
         NamedSearches *namedSearches;
 #endif
         Context *context;
@@ -17,6 +17,7 @@
  */
 
 #include "BT40.h"
+#include "GcTrace.h"
 
 BT40::BT40(QObject *parent,  DeviceConfiguration *devConf) : QThread(parent)
 {
@@ -174,6 +175,7 @@ void BT40::run()
         }
 
         if (WFApi::getInstance()->hasData(sd)) {
+            GC_TRACE("BT40::telemetry", "train");
             pvars.lock();
             WFApi::getInstance()->getRealtimeData(sd, &rt);
 
@@ -18,6 +18,7 @@
 
 #include "RideMetric.h"
 #include "Context.h"
+#include "Athlete.h"
 #include "Settings.h"
 #include "LTMOutliers.h"
 #include "Units.h"
@@ -92,13 +93,14 @@ static bool workoutTimeAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-class TimeRiding : public RideMetric {
+class TimeRiding : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(TimeRiding)
     double secsMovingOrPedaling;
+    bool hasKph;
 
     public:
 
-    TimeRiding() : secsMovingOrPedaling(0.0)
+    TimeRiding() : secsMovingOrPedaling(0.0), hasKph(false)
     {
         setSymbol("time_riding");
         setInternalName("Time Riding");
@@ -108,18 +110,15 @@ class TimeRiding : public RideMetric {
         setMetricUnits(tr("seconds"));
         setImperialUnits(tr("seconds"));
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
-
+    void begin(const RideMetricPass &pass) {
         secsMovingOrPedaling = 0;
-        if (ride->areDataPresent()->kph) {
-            foreach (const RideFilePoint *point, ride->dataPoints()) {
-                if ((point->kph > 0.0) || (point->cad > 0.0))
-                    secsMovingOrPedaling += ride->recIntSecs();
-            }
-        }
+        hasKph = pass.ride->areDataPresent()->kph;
+    }
+    void sample(const RideMetricPass &pass) {
+        if (hasKph && ((pass.point->kph > 0.0) || (pass.point->cad > 0.0)))
+            secsMovingOrPedaling += pass.secs;
+    }
+    void end(const RideMetricPass &) {
         setValue(secsMovingOrPedaling);
     }
     void override(const QMap<QString,QString> &map) {
@@ -185,14 +184,16 @@ static bool totalDistanceAdded =
 //////////////////////////////////////////////////////////////////////////////
 
 
-class ElevationGain : public RideMetric {
+class ElevationGain : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(ElevationGain)
     double elegain;
     double prevalt;
+    double hysteresis;
+    bool first;
 
     public:
 
-    ElevationGain() : elegain(0.0), prevalt(0.0)
+    ElevationGain() : elegain(0.0), prevalt(0.0), hysteresis(3.0), first(true)
     {
         setSymbol("elevation_gain");
         setInternalName("Elevation Gain");
@@ -204,29 +205,36 @@ class ElevationGain : public RideMetric {
         setImperialUnits(tr("feet"));
         setConversion(FEET_PER_METER);
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
+    void begin(const RideMetricPass &pass) {
 
-        // hysteresis can be configured, we default to 3.0
-        double hysteresis = appsettings->value(NULL, GC_ELEVATION_HYSTERESIS).toDouble();
-        if (hysteresis <= 0.1) hysteresis = 3.00;
+        // hysteresis can be configured, we default to 3.0, the athlete
+        // reads the setting for us since we may be on a refresh thread,
+        // without a context we're on the gui thread so read it here
+        if (pass.context) {
+            hysteresis = pass.context->athlete->elevationHysteresis;
+        } else {
+            hysteresis = appsettings->value(NULL, GC_ELEVATION_HYSTERESIS).toDouble();
+            if (hysteresis <= 0.1) hysteresis = 3.00;
+        }
 
-        bool first = true;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (first) {
-                first = false;
-                prevalt = point->alt;
-            }
-            else if (point->alt > prevalt + hysteresis) {
-                elegain += point->alt - prevalt;
-                prevalt = point->alt;
-            }
-            else if (point->alt < prevalt - hysteresis) {
-                prevalt = point->alt;
-            }
+        elegain = 0;
+        first = true;
+    }
+    void sample(const RideMetricPass &pass) {
+        const RideFilePoint *point = pass.point;
+        if (first) {
+            first = false;
+            prevalt = point->alt;
         }
+        else if (point->alt > prevalt + hysteresis) {
+            elegain += point->alt - prevalt;
+            prevalt = point->alt;
+        }
+        else if (point->alt < prevalt - hysteresis) {
+            prevalt = point->alt;
+        }
+    }
+    void end(const RideMetricPass &) {
         setValue(elegain);
     }
     RideMetric *clone() const { return new ElevationGain(*this); }
@@ -237,7 +245,7 @@ static bool elevationGainAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-class TotalWork : public RideMetric {
+class TotalWork : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(TotalWork)
     double joules;
 
@@ -253,14 +261,14 @@ class TotalWork : public RideMetric {
         setMetricUnits(tr("kJ"));
         setImperialUnits(tr("kJ"));
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->watts >= 0.0)
-                joules += point->watts * ride->recIntSecs();
-        }
+    void begin(const RideMetricPass &) {
+        joules = 0;
+    }
+    void sample(const RideMetricPass &pass) {
+        if (pass.point->watts >= 0.0)
+            joules += pass.point->watts * pass.secs;
+    }
+    void end(const RideMetricPass &) {
         setValue(joules/1000);
     }
     RideMetric *clone() const { return new TotalWork(*this); }
@@ -377,7 +385,7 @@ static bool paceAdded = addPace();
 
 //////////////////////////////////////////////////////////////////////////////
 
-struct AvgPower : public RideMetric {
+struct AvgPower : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(AvgPower)
 
     double count, total;
@@ -395,17 +403,16 @@ struct AvgPower : public RideMetric {
         setImperialUnits(tr("watts"));
         setType(RideMetric::Average);
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
+    void begin(const RideMetricPass &) {
         total = count = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->watts >= 0.0) {
-                total += point->watts;
-                ++count;
-            }
+    }
+    void sample(const RideMetricPass &pass) {
+        if (pass.point->watts >= 0.0) {
+            total += pass.point->watts;
+            ++count;
         }
+    }
+    void end(const RideMetricPass &) {
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -417,7 +424,7 @@ static bool avgPowerAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-struct AAvgPower : public RideMetric {
+struct AAvgPower : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(AAvgPower)
 
     double count, total;
@@ -435,17 +442,19 @@ struct AAvgPower : public RideMetric {
         setImperialUnits(tr("watts"));
         setType(RideMetric::Average);
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
+    void begin(const RideMetricPass &pass) {
         total = count = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->apower >= 0.0) {
-                total += point->apower;
-                ++count;
-            }
+
+        // derived on demand
+        pass.ride->recalculateDerivedSeries(RideFile::aPower);
+    }
+    void sample(const RideMetricPass &pass) {
+        if (pass.point->apower >= 0.0) {
+            total += pass.point->apower;
+            ++count;
         }
+    }
+    void end(const RideMetricPass &) {
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -457,7 +466,7 @@ static bool aavgPowerAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-struct NonZeroPower : public RideMetric {
+struct NonZeroPower : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(NonZeroPower)
 
     double count, total;
@@ -475,17 +484,16 @@ struct NonZeroPower : public RideMetric {
         setImperialUnits(tr("watts"));
         setType(RideMetric::Average);
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
+    void begin(const RideMetricPass &) {
         total = count = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->watts > 0.0) {
-                total += point->watts;
-                ++count;
-            }
+    }
+    void sample(const RideMetricPass &pass) {
+        if (pass.point->watts > 0.0) {
+            total += pass.point->watts;
+            ++count;
         }
+    }
+    void end(const RideMetricPass &) {
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -497,7 +505,7 @@ static bool nonZeroPowerAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-struct AvgHeartRate : public RideMetric {
+struct AvgHeartRate : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(AvgHeartRate)
 
     double total, count;
@@ -515,17 +523,16 @@ struct AvgHeartRate : public RideMetric {
         setImperialUnits(tr("bpm"));
         setType(RideMetric::Average);
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
+    void begin(const RideMetricPass &) {
         total = count = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->hr > 0) {
-                total += point->hr;
-                ++count;
-            }
+    }
+    void sample(const RideMetricPass &pass) {
+        if (pass.point->hr > 0) {
+            total += pass.point->hr;
+            ++count;
         }
+    }
+    void end(const RideMetricPass &) {
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -537,7 +544,7 @@ static bool avgHeartRateAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-struct AvgCadence : public RideMetric {
+struct AvgCadence : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(AvgCadence)
 
     double total, count;
@@ -555,17 +562,16 @@ struct AvgCadence : public RideMetric {
         setImperialUnits(tr("rpm"));
         setType(RideMetric::Average);
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
+    void begin(const RideMetricPass &) {
         total = count = 0;
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->cad > 0) {
-                total += point->cad;
-                ++count;
-            }
+    }
+    void sample(const RideMetricPass &pass) {
+        if (pass.point->cad > 0) {
+            total += pass.point->cad;
+            ++count;
         }
+    }
+    void end(const RideMetricPass &) {
         setValue(count > 0 ? total / count : count);
         setCount(count);
     }
@@ -577,10 +583,11 @@ static bool avgCadenceAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-struct AvgTemp : public RideMetric {
+struct AvgTemp : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(AvgTemp)
 
     double total, count;
+    bool hasTemp;
 
     public:
 
@@ -598,19 +605,18 @@ struct AvgTemp : public RideMetric {
         setConversionSum(FAHRENHEIT_ADD_CENTIGRADE);
         setType(RideMetric::Average);
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
-
-        if (ride->areDataPresent()->temp) {
-            total = count = 0;
-            foreach (const RideFilePoint *point, ride->dataPoints()) {
-                if (point->temp != RideFile::noTemp) {
-                    total += point->temp;
-                    ++count;
-                }
-            }
+    void begin(const RideMetricPass &pass) {
+        total = count = 0;
+        hasTemp = pass.ride->areDataPresent()->temp;
+    }
+    void sample(const RideMetricPass &pass) {
+        if (hasTemp && pass.point->temp != RideFile::noTemp) {
+            total += pass.point->temp;
+            ++count;
+        }
+    }
+    void end(const RideMetricPass &) {
+        if (hasTemp) {
             setValue(count > 0 ? total / count : count);
             setCount(count);
         } else {
@@ -626,7 +632,7 @@ static bool avgTempAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-class MaxPower : public RideMetric {
+class MaxPower : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(MaxPower)
     double max;
     public:
@@ -641,14 +647,14 @@ class MaxPower : public RideMetric {
         setImperialUnits(tr("watts"));
         setType(RideMetric::Peak);
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->watts >= max)
-                max = point->watts;
-        }
+    void begin(const RideMetricPass &) {
+        max = 0.0;
+    }
+    void sample(const RideMetricPass &pass) {
+        if (pass.point->watts >= max)
+            max = pass.point->watts;
+    }
+    void end(const RideMetricPass &) {
         setValue(max);
     }
     RideMetric *clone() const { return new MaxPower(*this); }
@@ -659,7 +665,7 @@ static bool maxPowerAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-class MaxHr : public RideMetric {
+class MaxHr : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(MaxHr)
     double max;
     public:
@@ -674,14 +680,14 @@ class MaxHr : public RideMetric {
         setImperialUnits(tr("bpm"));
         setType(RideMetric::Peak);
     }
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
-        foreach (const RideFilePoint *point, ride->dataPoints()) {
-            if (point->hr >= max)
-                max = point->hr;
-        }
+    void begin(const RideMetricPass &) {
+        max = 0.0;
+    }
+    void sample(const RideMetricPass &pass) {
+        if (pass.point->hr >= max)
+            max = pass.point->hr;
+    }
+    void end(const RideMetricPass &) {
         setValue(max);
     }
     RideMetric *clone() const { return new MaxHr(*this); }
@@ -692,11 +698,13 @@ static bool maxHrAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-class MaxSpeed : public RideMetric {
+class MaxSpeed : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(MaxSpeed)
+    double max;
+    bool hasKph;
     public:
 
-    MaxSpeed()
+    MaxSpeed() : max(0.0), hasKph(false)
     {
         setSymbol("max_speed");
         setInternalName("Max Speed");
@@ -710,17 +718,14 @@ class MaxSpeed : public RideMetric {
         setConversion(MILES_PER_KM);
     }
 
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
-        double max = 0.0;
-
-        if (ride->areDataPresent()->kph) {
-            foreach (const RideFilePoint *point, ride->dataPoints())
-                if (point->kph > max) max = point->kph;
-        }
-
+    void begin(const RideMetricPass &pass) {
+        max = 0.0;
+        hasKph = pass.ride->areDataPresent()->kph;
+    }
+    void sample(const RideMetricPass &pass) {
+        if (hasKph && pass.point->kph > max) max = pass.point->kph;
+    }
+    void end(const RideMetricPass &) {
         setValue(max);
     }
 
@@ -738,11 +743,12 @@ static bool maxSpeedAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-class MaxCadence : public RideMetric {
+class MaxCadence : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(MaxCadence)
+    double max;
     public:
 
-    MaxCadence()
+    MaxCadence() : max(0.0)
     {
         setSymbol("max_cadence");
         setInternalName("Max Cadence");
@@ -754,14 +760,13 @@ class MaxCadence : public RideMetric {
         setType(RideMetric::Peak);
     }
 
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
-        double max = 0.0;
-        foreach (const RideFilePoint *point, ride->dataPoints())
-            if (point->cad > max) max = point->cad;
-
+    void begin(const RideMetricPass &) {
+        max = 0.0;
+    }
+    void sample(const RideMetricPass &pass) {
+        if (pass.point->cad > max) max = pass.point->cad;
+    }
+    void end(const RideMetricPass &) {
         setValue(max);
     }
 
@@ -779,11 +784,13 @@ static bool maxCadenceAdded =
 
 //////////////////////////////////////////////////////////////////////////////
 
-class MaxTemp : public RideMetric {
+class MaxTemp : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(MaxTemp)
+    double max;
+    bool hasTemp;
     public:
 
-    MaxTemp()
+    MaxTemp() : max(0.0), hasTemp(false)
     {
         setSymbol("max_temp");
         setInternalName("Max Temp");
@@ -798,20 +805,15 @@ class MaxTemp : public RideMetric {
         setConversionSum(FAHRENHEIT_ADD_CENTIGRADE);
     }
 
-    void compute(const RideFile *ride, const Zones *, int,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *) {
-
-        if (ride->areDataPresent()->temp) {
-            double max = 0.0;
-            foreach (const RideFilePoint *point, ride->dataPoints())
-                if (point->temp != RideFile::noTemp && point->temp > max) max = point->temp;
-
-            setValue(max);
-        } else {
-            setValue(RideFile::noTemp);
-        }
+    void begin(const RideMetricPass &pass) {
+        max = 0.0;
+        hasTemp = pass.ride->areDataPresent()->temp;
+    }
+    void sample(const RideMetricPass &pass) {
+        if (hasTemp && pass.point->temp != RideFile::noTemp && pass.point->temp > max) max = pass.point->temp;
+    }
+    void end(const RideMetricPass &) {
+        setValue(hasTemp ? max : RideFile::noTemp);
     }
 
     void aggregateWith(const RideMetric &other) {
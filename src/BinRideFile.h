@@ -25,6 +25,7 @@
 struct BinFileReader : public RideFileReader {
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const; 
     bool hasWrite() const { return false; }
+    bool isReentrant() const { return false; } // the record type names are shared statics
 };
 
 #endif // _BinRideFile_h
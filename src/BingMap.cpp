@@ -20,6 +20,7 @@
 
 #include "RideItem.h"
 #include "RideFile.h"
+#include "RouteGeometry.h"
 #include "IntervalItem.h"
 #include "Context.h"
 #include "Athlete.h"
@@ -161,6 +162,43 @@ void BingMap::createHtml()
 
     "}\n"
 
+    // decode a line from RouteGeometry::encode()
+    "function decodePath(encoded) {\n"
+    "    var path = new Array();\n"
+    "    var index = 0, lat = 0, lon = 0;\n"
+    "    while (index < encoded.length) {\n"
+    "        var b, shift = 0, result = 0;\n"
+    "        do {\n"
+    "            b = encoded.charCodeAt(index++) - 63;\n"
+    "            result |= (b & 0x1f) << shift;\n"
+    "            shift += 5;\n"
+    "        } while (b >= 0x20);\n"
+    "        lat += (result & 1) ? ~(result >> 1) : (result >> 1);\n"
+    "        shift = 0;\n"
+    "        result = 0;\n"
+    "        do {\n"
+    "            b = encoded.charCodeAt(index++) - 63;\n"
+    "            result |= (b & 0x1f) << shift;\n"
+    "            shift += 5;\n"
+    "        } while (b >= 0x20);\n"
+    "        lon += (result & 1) ? ~(result >> 1) : (result >> 1);\n"
+    "        path.push(new Microsoft.Maps.Location(lat / 1e5, lon / 1e5));\n"
+    "    }\n"
+    "    return path;\n"
+    "}\n"
+
+    // a stretch of the route coloured by power
+    "function drawShaded(encoded, red, green, blue) {\n"
+    "    var polyOptions = {\n"
+    "        strokeColor: new Microsoft.Maps.Color(200, red, green, blue),\n"
+    "        strokeThickness: 3,\n"
+    "        strokeDashArray: '5 0',\n"
+    "        zIndex: 1\n"
+    "    };\n"
+    "    var polyline = new Microsoft.Maps.Polyline(decodePath(encoded), polyOptions);\n"
+    "    map.entities.push(polyline);\n"
+    "}\n"
+
     "function drawIntervals() { \n"
     // intervals will be drawn with these options
     "    var polyOptions = {\n"
@@ -261,54 +299,18 @@ QColor BingMap::GetColor(int watts)
 void
 BingMap::drawShadedRoute()
 {
-    int intervalTime = 60;  // 60 seconds
-    double rtime=0; // running total for accumulated data
-    int count=0;  // how many samples ?
-    int rwatts=0; // running total of watts
-    double prevtime=0; // time for previous point
-
+    // a line for each minute coloured by its average power, simplified
+    // and encoded, and all sent in one go
     QString code;
-
-    foreach(RideFilePoint *rfp, myRideItem->ride()->dataPoints()) {
-
-        if (count == 0) {
-            code = QString("{\nvar route = new Array();\n");
-        } else {
-            if (rfp->lat || rfp->lon)
-                code += QString("route.push(new Microsoft.Maps.Location(%1,%2));\n").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
-        }
-
-        // running total of time
-        rtime += rfp->secs - prevtime;
-        rwatts += rfp->watts;
-        prevtime = rfp->secs;
-        count++;
-
-        // end of segment
-        if (rtime >= intervalTime) {
-
-            int avgWatts = rwatts / count;
-            QColor color = GetColor(avgWatts);
-            // thats this segment done, so finish off and
-            // add tooltip junk
-            count = rwatts = rtime = 0;
-
-            // color the polyline
-            code += QString("    var polyOptions = {\n"
-                            "        strokeColor: new Microsoft.Maps.Color(200, %1, %2, %3),\n"
-                            "        strokeThickness: 3,\n"
-                            "        strokeDashArray: '5 0',\n"
-                            "        zIndex: 1\n"
-                            "    };\n"
-                            "    var polyline = new Microsoft.Maps.Polyline(route, polyOptions);\n"
-                            "    polyline.setOptions(polyOptions);\n"
-                            "    map.entities.push(polyline);\n"
-                            "}\n").arg(color.red())
-                                  .arg(color.green())
-                                  .arg(color.blue());
-            view->page()->mainFrame()->evaluateJavaScript(code);
-        }
+    foreach(RouteGeometry::Stretch stretch, RouteGeometry::stretches(myRideItem->ride(), 60, RouteGeometry::MAPTOLERANCE)) {
+        QString encoded = RouteGeometry::encode(myRideItem->ride(), stretch.points);
+        QColor color = GetColor(stretch.watts);
+        code += QString("drawShaded('%1',%2,%3,%4);\n").arg(encoded.replace("\\", "\\\\"))
+                                                       .arg(color.red())
+                                                       .arg(color.green())
+                                                       .arg(color.blue());
     }
+    view->page()->mainFrame()->evaluateJavaScript(code);
 }
 
 //
@@ -546,16 +548,22 @@ BWebBridge::getLatLons(int i)
 
                         // so this one is the interval we need.. lets
                         // snaffle up the points in this section
-                        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-                            if (p1->secs+rideItem->ride()->recIntSecs() > current->start
+                        const RideFile *ride = rideItem->ride();
+                        int from = -1, to = -1;
+                        for (int k=0; k<ride->dataPoints().count(); k++) {
+                            RideFilePoint *p1 = ride->dataPoints()[k];
+                            if (p1->secs+ride->recIntSecs() > current->start
                                 && p1->secs< current->stop) {
-
-                                if (p1->lat || p1->lon) {
-                                    latlons << p1->lat;
-                                    latlons << p1->lon;
-                                }
+                                if (from < 0) from = k;
+                                to = k;
                             }
                         }
+                        if (from < 0) return latlons;
+
+                        foreach (int k, RouteGeometry::simplify(ride, RouteGeometry::MAPTOLERANCE, from, to)) {
+                            latlons << ride->dataPoints()[k]->lat;
+                            latlons << ride->dataPoints()[k]->lon;
+                        }
                         return latlons;
                     }
                 }
@@ -564,11 +572,9 @@ BWebBridge::getLatLons(int i)
     } else {
 
         // get latlons for entire route
-        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-            if (p1->lat || p1->lon) {
-                latlons << p1->lat;
-                latlons << p1->lon;
-            }
+        foreach (int k, RouteGeometry::simplify(rideItem->ride(), RouteGeometry::MAPTOLERANCE)) {
+            latlons << rideItem->ride()->dataPoints()[k]->lat;
+            latlons << rideItem->ride()->dataPoints()[k]->lon;
         }
     }
     return latlons;
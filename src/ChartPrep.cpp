@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ChartPrep.h"
+#include "GcTrace.h"
+
+#include <QCoreApplication>
+
+// leave a core for the gui, charts only need a few
+static const int MAXTHREADS = 4;
+
+//
+// The preparer, one for each chart
+//
+ChartPreparer::ChartPreparer(QObject *parent, int cacheSize) : QObject(parent), pending(NULL), cacheSize(cacheSize)
+{
+}
+
+ChartPreparer::~ChartPreparer()
+{
+    cancel();
+    qDeleteAll(cache);
+}
+
+void
+ChartPreparer::prepare(ChartJob *job)
+{
+    // we don't want that any more
+    cancel();
+
+    // did it already?
+    for (int i=0; i<cache.count(); i++) {
+        if (cache[i]->key == job->key) {
+            delete job;
+            ChartJob *found = cache.takeAt(i);
+            cache.prepend(found);
+            emit prepared(found);
+            return;
+        }
+    }
+
+    job->owner = this;
+    pending = job;
+    ChartPrep::instance()->submit(job);
+}
+
+void
+ChartPreparer::cancel()
+{
+    if (pending) {
+        pending->owner = NULL;
+        ChartPrep::instance()->cancel(pending);
+        pending = NULL;
+    }
+}
+
+void
+ChartPreparer::clear()
+{
+    cancel();
+    qDeleteAll(cache);
+    cache.clear();
+}
+
+void
+ChartPreparer::done(ChartJob *job)
+{
+    if (job == pending) pending = NULL;
+
+    cache.prepend(job);
+    while (cache.count() > cacheSize) delete cache.takeLast();
+
+    emit prepared(job);
+}
+
+//
+// The pool, shared by all the preparers
+//
+ChartPrep *
+ChartPrep::instance()
+{
+    // lives on the gui thread, and goes when the application does
+    static ChartPrep *pool = NULL;
+    if (pool == NULL) pool = new ChartPrep;
+    return pool;
+}
+
+ChartPrep::ChartPrep() : QObject(QCoreApplication::instance()), stopping(false)
+{
+    connect(this, SIGNAL(finished()), this, SLOT(deliver()), Qt::QueuedConnection);
+
+    int count = qBound(1, QThread::idealThreadCount()-1, MAXTHREADS);
+    for (int i=0; i<count; i++) {
+        ChartPrepThread *thread = new ChartPrepThread(this);
+        threads << thread;
+        thread->start(QThread::LowPriority);
+    }
+}
+
+ChartPrep::~ChartPrep()
+{
+    lock.lock();
+    stopping = true;
+    qDeleteAll(queue);
+    queue.clear();
+    available.wakeAll();
+    lock.unlock();
+
+    foreach(ChartPrepThread *thread, threads) {
+        thread->wait();
+        delete thread;
+    }
+    qDeleteAll(done);
+}
+
+void
+ChartPrep::submit(ChartJob *job)
+{
+    QMutexLocker locker(&lock);
+    queue << job;
+    available.wakeOne();
+}
+
+void
+ChartPrep::cancel(ChartJob *job)
+{
+    QMutexLocker locker(&lock);
+    job->cancel = true;
+
+    // if it is running we delete it when it finishes
+    if (queue.removeOne(job)) delete job;
+}
+
+ChartJob *
+ChartPrep::next()
+{
+    QMutexLocker locker(&lock);
+    while (queue.isEmpty() && !stopping) available.wait(&lock);
+    if (stopping) return NULL;
+    return queue.takeFirst();
+}
+
+void
+ChartPrep::completed(ChartJob *job)
+{
+    lock.lock();
+    done << job;
+    lock.unlock();
+
+    emit finished();
+}
+
+void
+ChartPrep::deliver()
+{
+    lock.lock();
+    QList<ChartJob*> jobs = done;
+    done.clear();
+    lock.unlock();
+
+    foreach(ChartJob *job, jobs) {
+        if (job->cancel || job->owner == NULL) delete job;
+        else job->owner->done(job);
+    }
+}
+
+void
+ChartPrepThread::run()
+{
+    while (ChartJob *job = pool->next()) {
+        if (!job->cancelled()) {
+            GC_TRACE("ChartJob::prepare", "chart");
+            GC_TRACE_DETAIL(job->key);
+            job->prepare();
+        }
+        pool->completed(job);
+    }
+}
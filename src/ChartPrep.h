@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_ChartPrep_h
+#define _GC_ChartPrep_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QString>
+
+class ChartPreparer;
+class ChartPrepThread;
+
+// Preparing the data for a chart when a ride is selected, binning,
+// deduplicating, fitting and so on, doesn't need to happen on the gui
+// thread. A chart puts that work in a ChartJob and hands it to its
+// ChartPreparer, which runs it on a pool of threads shared by all the
+// charts and signals prepared() back on the gui thread, where the chart
+// only has to set its curves and replot.
+//
+// Each chart has one job in progress at most, asking for another one
+// cancels it, so scrolling through the rides doesn't leave a queue of
+// work for rides that are no longer selected. Jobs that are done are
+// kept, a few per chart, so going back to a ride is immediate. They are
+// keyed by the ride and the settings they were prepared for.
+//
+// A job runs on another thread so it must copy whatever it needs from
+// the ride when it is constructed, on the gui thread, and not touch the
+// RideItem or RideFile from prepare().
+//
+class ChartJob
+{
+    public:
+        ChartJob(QString key) : key(key), cancel(false), owner(NULL) {}
+        virtual ~ChartJob() {}
+
+        // on a pool thread, long jobs should give up if cancelled()
+        virtual void prepare() = 0;
+        bool cancelled() const { return cancel; }
+
+        QString key;
+
+    private:
+        friend class ChartPrep;
+        friend class ChartPreparer;
+
+        volatile bool cancel;
+        ChartPreparer *owner;   // gui thread only
+};
+
+class ChartPreparer : public QObject
+{
+    Q_OBJECT
+
+    public:
+        ChartPreparer(QObject *parent = 0, int cacheSize = 8);
+        ~ChartPreparer();
+
+        // we take the job, if we already prepared one with the same
+        // key prepared() is emitted before we return
+        void prepare(ChartJob *job);
+
+    public slots:
+        void cancel();  // the one in progress, if any
+        void clear();   // forget what we prepared, e.g. when the ride is edited
+
+    signals:
+        // we keep the job, it may be deleted once control returns
+        // to the event loop so take what you need from it
+        void prepared(ChartJob *job);
+
+    private:
+        friend class ChartPrep;
+        void done(ChartJob *job);
+
+        ChartJob *pending;
+        QList<ChartJob*> cache; // most recent first
+        int cacheSize;
+};
+
+class ChartPrep : public QObject
+{
+    Q_OBJECT
+
+    public:
+        static ChartPrep *instance();
+        ~ChartPrep(); // stops the threads
+
+        void submit(ChartJob *job);
+        void cancel(ChartJob *job); // deleted straight away if it hasn't started
+
+    signals:
+        void finished(); // from the pool threads
+
+    private slots:
+        void deliver(); // the finished jobs to their preparers
+
+    private:
+        ChartPrep();
+
+        friend class ChartPrepThread;
+        ChartJob *next(); // waits for a job, NULL when we are stopping
+        void completed(ChartJob *job);
+
+        QMutex lock;
+        QWaitCondition available;
+        QList<ChartJob*> queue, done;
+        QList<ChartPrepThread*> threads;
+        bool stopping;
+};
+
+class ChartPrepThread : public QThread
+{
+    public:
+        ChartPrepThread(ChartPrep *pool) : pool(pool) {}
+        void run();
+
+    private:
+        ChartPrep *pool;
+};
+
+#endif // _GC_ChartPrep_h
@@ -675,12 +675,6 @@ ComparePane::dropEvent(QDropEvent *event)
                     add.data->appendPoint(p->secs - offset, p->cad, p->hr, p->km - offsetKM, p->kph, p->nm,
                                           p->watts, p->alt, p->lon, p->lat, p->headwind,
                                           p->slope, p->temp, p->lrbalance, 0);
-
-                    // get derived data calculated
-                    RideFilePoint *l = add.data->dataPoints().last();
-                    l->np = p->np;
-                    l->xp = p->xp;
-                    l->apower = p->apower;
                 }
             }
             add.data->recalculateDerivedSeries();
@@ -23,6 +23,7 @@
 // 2. Some C-style casts used for expediency
 
 #include "Computrainer.h"
+#include "GcTrace.h"
 
 const static uint8_t ergo_command[56] = {
 //                        Ergo            various
@@ -555,6 +556,7 @@ void Computrainer::run()
         if (isDeviceOpen == true) {
 
             if (readMessage() > 0) {
+                GC_TRACE("Computrainer::telemetry", "train");
 
                 //----------------------------------------------------------------
                 // UPDATE BASIC TELEMETRY (HR, CAD, SPD et al)
@@ -20,6 +20,7 @@
 #include "Zones.h"
 #include "Colors.h"
 #include "CpintPlot.h"
+#include "GcTrace.h"
 #include <unistd.h>
 #include <QDebug>
 #include <qwt_series_data.h>
@@ -698,6 +699,8 @@ CpintPlot::plot_allCurve(CpintPlot *thisPlot,
 void
 CpintPlot::calculate(RideItem *rideItem)
 {
+    GC_TRACE("CpintPlot::calculate", "chart");
+
     clear_CP_Curves();
 
     // Season Compare Mode
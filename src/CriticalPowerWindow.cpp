@@ -139,7 +139,7 @@ CriticalPowerWindow::CriticalPowerWindow(const QDir &home, Context *context, boo
 
     setControls(settingsTabs);
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     // filter / searchbox
     searchBox = new SearchFilterBox(this, context);
     connect(searchBox, SIGNAL(searchClear()), cpintPlot, SLOT(clearFilter()));
@@ -674,7 +674,7 @@ CriticalPowerWindow::showIntervalCurve(IntervalItem *current, int index)
        }
     }
     // for xpower and acceleration et al
-    f.recalculateDerivedSeries();
+    f.recalculateDerivedSeries(series());
 
     // compute the mean max, this is BLAZINGLY fast, thanks to Mark Rages'
     // mean-max computer. Does a 11hr ride in 150ms
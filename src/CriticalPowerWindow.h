@@ -22,7 +22,7 @@
 #include "MainWindow.h" // for isfiltered and filters
 #include "Season.h"
 #include "RideFile.h"
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
 #include "SearchFilterBox.h"
 #endif
 
@@ -43,7 +43,7 @@ class CriticalPowerWindow : public GcChartWindow
 
     // properties can be saved/restored/set by the layout manager
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     Q_PROPERTY(QString filter READ filter WRITE setFilter USER true)
 #endif
     Q_PROPERTY(int mode READ mode WRITE setMode USER true)
@@ -95,7 +95,7 @@ class CriticalPowerWindow : public GcChartWindow
         int cpModel() const { return modelCombo->currentIndex(); }
         void setCPModel(int x) { modelCombo->setCurrentIndex(x); }
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         // filter
         bool isFiltered() const { return (searchBox->isFiltered() || context->ishomefiltered || context->isfiltered); }
         QString filter() const { return searchBox->filter(); }
@@ -223,7 +223,7 @@ class CriticalPowerWindow : public GcChartWindow
         QList<Season> seasonsList;
         RideItem *currentRide;
         QList<RideFile::SeriesType> seriesList;
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         SearchFilterBox *searchBox;
 #endif
         QList<QwtPlotCurve*> intervalCurves;
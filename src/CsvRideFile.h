@@ -26,6 +26,7 @@ struct CsvFileReader : public RideFileReader {
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const; 
     bool writeRideFile(Context *context, const RideFile *ride, QFile &file) const;
     bool hasWrite() const { return true; }
+    bool isReentrant() const { return false; } // the temperature units are a static
 };
 
 #endif // _CsvRideFile_h
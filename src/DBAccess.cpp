@@ -20,6 +20,7 @@
 #include "MainWindow.h"
 #include "Athlete.h"
 #include "DBAccess.h"
+#include "GcTrace.h"
 #include <QtSql>
 #include <QtGui>
 #include "RideFile.h"
@@ -80,8 +81,11 @@
 // 59  24  Jan 2014 Mark Liversedge    Added Maximum W' exp which is same as W'bal bur expressed as used not left
 // 60  05  Feb 2014 Mark Liversedge    Added Critical Power as a metric -- retreives from settings for now
 // 61  15  Feb 2014 Mark Liversedge    Fixed W' Work (for recintsecs not 1s!).
+// 62  19  Oct 2026 agent              Added intervals table with metrics for every ride interval
+// 63  19  Oct 2026 agent              Added tracks and routecells tables for segment matching
+// 64  19  Oct 2026 agent              Interval metrics know which data series are present
 
-int DBSchemaVersion = 61;
+int DBSchemaVersion = 64;
 
 DBAccess::DBAccess(Context* context) : context(context), db(NULL)
 {
@@ -288,6 +292,134 @@ bool DBAccess::dropMeasuresTable()
     return rc;
 }
 
+bool DBAccess::createIntervalsTable()
+{
+    QSqlQuery query(db->database(sessionid));
+    bool rc;
+    bool createTables = true;
+
+    // does the table exist?
+    rc = query.exec("SELECT name FROM sqlite_master WHERE type='table' ORDER BY name;");
+    if (rc) {
+        while (query.next()) {
+
+            QString table = query.value(0).toString();
+            if (table == "intervals") {
+                createTables = false;
+                break;
+            }
+        }
+    }
+
+    // we need to create it!
+    if (rc && createTables) {
+
+        // a row for every interval in every ride, they are replaced along
+        // with the ride's row in metrics so the timestamp and fingerprint
+        // are the ride's, and are here so we can check them on their own
+        QString createIntervalsTable = "create table intervals (filename varchar,"
+                                       "seq integer,"
+                                       "name varchar,"
+                                       "start double,"
+                                       "stop double,"
+                                       "identifier varchar,"
+                                       "timestamp integer,"
+                                       "ride_date date,"
+                                       "fingerprint integer";
+
+        // Add columns for all the metric factory metrics
+        const RideMetricFactory &factory = RideMetricFactory::instance();
+        for (int i=0; i<factory.metricCount(); i++)
+            createIntervalsTable += QString(", X%1 double").arg(factory.metricName(i));
+
+        createIntervalsTable += ", primary key (filename, seq) )";
+
+        rc = query.exec(createIntervalsTable);
+        //if (!rc) qDebug()<<"create table failed!"  << query.lastError();
+
+        // wipe current version row
+        query.exec("DELETE FROM version where table_name = \"intervals\"");
+
+        // no metadata, so no crc
+        query.prepare("INSERT INTO version (table_name, schema_version, creation_date, metadata_crc ) values (?,?,?,?)");
+        query.addBindValue("intervals");
+	    query.addBindValue(DBSchemaVersion);
+	    query.addBindValue(QDateTime::currentDateTime().toTime_t());
+	    query.addBindValue(0);
+        rc = query.exec();
+    }
+    return rc;
+}
+
+bool DBAccess::dropIntervalsTable()
+{
+    QSqlQuery query("DROP TABLE intervals", db->database(sessionid));
+    bool rc = query.exec();
+    return rc;
+}
+
+bool DBAccess::createTracksTable()
+{
+    QSqlQuery query(db->database(sessionid));
+    bool rc;
+    bool createTables = true;
+
+    // does the table exist?
+    rc = query.exec("SELECT name FROM sqlite_master WHERE type='table' ORDER BY name;");
+    if (rc) {
+        while (query.next()) {
+
+            QString table = query.value(0).toString();
+            if (table == "tracks") {
+                createTables = false;
+                break;
+            }
+        }
+    }
+
+    // we need to create it!
+    if (rc && createTables) {
+
+        // the resampled GPS track for each ride, like the intervals they
+        // are replaced along with the ride's row in metrics
+        rc = query.exec("create table tracks (filename varchar primary key,"
+                        "timestamp integer,"
+                        "ride_date date,"
+                        "fingerprint integer,"
+                        "track blob )");
+
+        // and the cells each ride passed through, it is the index on
+        // cell that lets us find the rides along a segment quickly
+        if (rc) rc = query.exec("create table routecells (cell integer, filename varchar)");
+        if (rc) rc = query.exec("create index routecells_cell on routecells (cell)");
+        if (rc) rc = query.exec("create index routecells_filename on routecells (filename)");
+        //if (!rc) qDebug()<<"create table failed!"  << query.lastError();
+
+        // wipe current version row
+        query.exec("DELETE FROM version where table_name = \"tracks\"");
+
+        // no metadata, so no crc
+        query.prepare("INSERT INTO version (table_name, schema_version, creation_date, metadata_crc ) values (?,?,?,?)");
+        query.addBindValue("tracks");
+	    query.addBindValue(DBSchemaVersion);
+	    query.addBindValue(QDateTime::currentDateTime().toTime_t());
+	    query.addBindValue(0);
+        rc = query.exec();
+    }
+    return rc;
+}
+
+bool DBAccess::dropTracksTable()
+{
+    QSqlQuery query("DROP TABLE tracks", db->database(sessionid));
+    bool rc = query.exec();
+
+    // its index goes with it
+    QSqlQuery cells("DROP TABLE routecells", db->database(sessionid));
+    cells.exec();
+    return rc;
+}
+
 bool DBAccess::createDatabase()
 {
     // check schema version and if missing recreate database
@@ -299,6 +431,12 @@ bool DBAccess::createDatabase()
     // Athlete measures
     createMeasuresTable();
 
+    // Ride intervals
+    createIntervalsTable();
+
+    // Ride GPS tracks
+    createTracksTable();
+
     return true;
 }
 
@@ -332,10 +470,14 @@ void DBAccess::checkDBVersion()
         // wipe away whatever (if anything is there)
         dropMetricTable();
         dropMeasuresTable();
+        dropIntervalsTable();
+        dropTracksTable();
 
         // create afresh
         createMetricsTable();
         createMeasuresTable();
+        createIntervalsTable();
+        createTracksTable();
 
         return;
     }
@@ -344,6 +486,8 @@ void DBAccess::checkDBVersion()
     // tne current version / crc
     bool dropMetric = false;
     bool dropMeasures = false;
+    bool dropIntervals = true; // until we see its version row
+    bool dropTracks = true;
 
     while (query.next()) {
 
@@ -361,9 +505,25 @@ void DBAccess::checkDBVersion()
 
             dropMeasures = true;
         }
+
+        if (table_name == "intervals" && currentversion == DBSchemaVersion) {
+
+            dropIntervals = false;
+        }
+
+        if (table_name == "tracks" && currentversion == DBSchemaVersion) {
+
+            dropTracks = false;
+        }
     }
     query.finish();
 
+    // intervals and tracks are only ever written with their ride, so if
+    // any of the tables go they all go and every ride gets computed again
+    if (dropMetric || dropIntervals || dropTracks) {
+        dropMetric = dropIntervals = dropTracks = true;
+    }
+
 
     // "metrics" table, is it up-to-date?
     if (dropMetric) {
@@ -371,6 +531,18 @@ void DBAccess::checkDBVersion()
         createMetricsTable();
     }
 
+    // "intervals" table, is it up-to-date?
+    if (dropIntervals) {
+        dropIntervalsTable();
+        createIntervalsTable();
+    }
+
+    // "tracks" table, is it up-to-date?
+    if (dropTracks) {
+        dropTracksTable();
+        createTracksTable();
+    }
+
     // "measures" table, is it up-to-date? - export - recreate - import ....
     // gets wiped away for now, will fix as part of v3.1
     if (dropMeasures) {
@@ -402,6 +574,9 @@ int DBAccess::getDBVersion()
  *----------------------------------------------------------------------*/
 bool DBAccess::importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor color, unsigned long fingerprint, bool modify)
 {
+    GC_TRACE("DBAccess::importRide", "db");
+    GC_TRACE_DETAIL(summaryMetrics->getFileName());
+
 	QSqlQuery query(db->database(sessionid));
     QDateTime timestamp = QDateTime::currentDateTime();
 
@@ -489,7 +664,198 @@ DBAccess::deleteRide(QString name)
 
     query.prepare("DELETE FROM metrics WHERE filename = ?;");
     query.addBindValue(name);
-    return query.exec();
+    bool rc = query.exec();
+
+    query.prepare("DELETE FROM intervals WHERE filename = ?;");
+    query.addBindValue(name);
+    if (!query.exec()) rc = false;
+
+    query.prepare("DELETE FROM tracks WHERE filename = ?;");
+    query.addBindValue(name);
+    if (!query.exec()) rc = false;
+
+    query.prepare("DELETE FROM routecells WHERE filename = ?;");
+    query.addBindValue(name);
+    if (!query.exec()) rc = false;
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------
+ * CRUD routines for Intervals table
+ *----------------------------------------------------------------------*/
+bool DBAccess::importIntervals(SummaryMetrics *summaryMetrics, QList<SummaryMetrics> &intervals, unsigned long fingerprint)
+{
+    GC_TRACE("DBAccess::importIntervals", "db");
+    GC_TRACE_DETAIL(summaryMetrics->getFileName());
+
+	QSqlQuery query(db->database(sessionid));
+    QDateTime timestamp = QDateTime::currentDateTime();
+
+    // zap the current rows, the ride may have fewer intervals now
+    query.prepare("DELETE FROM intervals WHERE filename = ?;");
+    query.addBindValue(summaryMetrics->getFileName());
+    query.exec();
+
+    // construct an insert statement
+    QString insertStatement = "insert into intervals ( filename, seq, name, start, stop, identifier, timestamp, ride_date, fingerprint ";
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    for (int i=0; i<factory.metricCount(); i++)
+        insertStatement += QString(", X%1 ").arg(factory.metricName(i));
+
+    insertStatement += " ) values (?,?,?,?,?,?,?,?,?";
+    for (int i=0; i<factory.metricCount(); i++)
+        insertStatement += ",?";
+    insertStatement += ")";
+
+    // prepared once, executed for each interval
+	query.prepare(insertStatement);
+
+    bool rc = true;
+    for (int n=0; n<intervals.count(); n++) {
+
+        SummaryMetrics &interval = intervals[n];
+
+	    query.addBindValue(summaryMetrics->getFileName());
+	    query.addBindValue(n);
+	    query.addBindValue(interval.getText("Interval Name", ""));
+	    query.addBindValue(interval.getForSymbol("Interval Start"));
+	    query.addBindValue(interval.getForSymbol("Interval Stop"));
+	    query.addBindValue(summaryMetrics->getId());
+	    query.addBindValue(timestamp.toTime_t());
+        query.addBindValue(summaryMetrics->getRideDate());
+        query.addBindValue((int)fingerprint);
+
+        for (int i=0; i<factory.metricCount(); i++) {
+	        query.addBindValue(interval.getForSymbol(factory.metricName(i)));
+        }
+
+        // go do it!
+	    if (!query.exec()) rc = false;
+    }
+
+	//if(!rc) qDebug() << query.lastError();
+
+	return rc;
+}
+
+/*----------------------------------------------------------------------
+ * CRUD routines for Tracks table
+ *----------------------------------------------------------------------*/
+bool DBAccess::importTrack(SummaryMetrics *summaryMetrics, const RouteTrack &track, unsigned long fingerprint)
+{
+    GC_TRACE("DBAccess::importTrack", "db");
+    GC_TRACE_DETAIL(summaryMetrics->getFileName());
+
+	QSqlQuery query(db->database(sessionid));
+
+    // zap the current rows, the ride may have been cropped or lost its GPS
+    query.prepare("DELETE FROM tracks WHERE filename = ?;");
+    query.addBindValue(summaryMetrics->getFileName());
+    query.exec();
+    query.prepare("DELETE FROM routecells WHERE filename = ?;");
+    query.addBindValue(summaryMetrics->getFileName());
+    query.exec();
+
+    // nothing to find
+    if (track.isEmpty()) return true;
+
+    query.prepare("insert into tracks ( filename, timestamp, ride_date, fingerprint, track ) values (?,?,?,?,?)");
+    query.addBindValue(summaryMetrics->getFileName());
+    query.addBindValue(QDateTime::currentDateTime().toTime_t());
+    query.addBindValue(summaryMetrics->getRideDate());
+    query.addBindValue((int)fingerprint);
+    query.addBindValue(track.serialize());
+    bool rc = query.exec();
+
+    // prepared once, executed for each cell
+    query.prepare("insert into routecells ( cell, filename ) values (?,?)");
+    foreach(qint64 cell, track.cells()) {
+        query.addBindValue(cell);
+        query.addBindValue(summaryMetrics->getFileName());
+        if (!query.exec()) rc = false;
+    }
+
+	//if(!rc) qDebug() << query.lastError();
+
+	return rc;
+}
+
+QList<RouteTrack> DBAccess::getTracksThrough(QList<qint64> from, QList<qint64> to)
+{
+    QList<RouteTrack> tracks;
+    if (from.isEmpty() || to.isEmpty()) return tracks;
+
+    // they're only numbers, so no need to bind them
+    QStringList fromCells, toCells;
+    foreach(qint64 cell, from) fromCells << QString("%1").arg(cell);
+    foreach(qint64 cell, to) toCells << QString("%1").arg(cell);
+
+    QString selectStatement = QString("SELECT filename, ride_date, track FROM tracks WHERE filename IN "
+                                      "(SELECT filename FROM routecells WHERE cell IN (%1) "
+                                      " INTERSECT "
+                                      " SELECT filename FROM routecells WHERE cell IN (%2)) "
+                                      "ORDER BY ride_date;").arg(fromCells.join(",")).arg(toCells.join(","));
+
+    QSqlQuery query(db->database(sessionid));
+    query.exec(selectStatement);
+
+    while(query.next()) {
+        RouteTrack track = RouteTrack::deserialize(query.value(2).toByteArray());
+        track.fileName = query.value(0).toString();
+        track.rideDate = query.value(1).toDateTime();
+        tracks << track;
+    }
+    return tracks;
+}
+
+QList<SummaryMetrics> DBAccess::getAllIntervalsFor(QDateTime start, QDateTime end, QString name)
+{
+    QList<SummaryMetrics> intervals;
+
+    // as for getAllMetricsFor
+    if (start == QDateTime()) start = QDateTime::currentDateTime().addYears(-10);
+    if (end == QDateTime()) end = QDateTime::currentDateTime().addYears(+10);
+
+    // construct the select statement
+    QString selectStatement = "SELECT filename, identifier, ride_date, seq, name, start, stop";
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    for (int i=0; i<factory.metricCount(); i++)
+        selectStatement += QString(", X%1 ").arg(factory.metricName(i));
+    selectStatement += " FROM intervals where DATE(ride_date) >=DATE(:start) AND DATE(ride_date) <=DATE(:end) ";
+    if (name != "") selectStatement += " AND name LIKE :name ";
+    selectStatement += " ORDER BY ride_date, seq;";
+
+    // execute the select statement
+    QSqlQuery query(db->database(sessionid));
+    query.prepare(selectStatement);
+    query.bindValue(":start", start.date());
+    query.bindValue(":end", end.date());
+    if (name != "") query.bindValue(":name", name);
+    query.exec();
+
+    while(query.next())
+    {
+        SummaryMetrics summaryMetrics;
+
+        // the ride it is in
+        summaryMetrics.setFileName(query.value(0).toString());
+        summaryMetrics.setId(query.value(1).toString());
+        summaryMetrics.setRideDate(query.value(2).toDateTime());
+
+        // and where in the ride
+        summaryMetrics.setForSymbol("Interval Number", query.value(3).toInt());
+        summaryMetrics.setText("Interval Name", query.value(4).toString());
+        summaryMetrics.setForSymbol("Interval Start", query.value(5).toDouble());
+        summaryMetrics.setForSymbol("Interval Stop", query.value(6).toDouble());
+
+        // the values
+        for (int i=0; i<factory.metricCount(); i++)
+            summaryMetrics.setForSymbol(factory.metricName(i), query.value(i+7).toDouble());
+
+        intervals << summaryMetrics;
+    }
+    return intervals;
 }
 
 QList<QDateTime> DBAccess::getAllDates()
@@ -525,8 +891,9 @@ DBAccess::getRide(QString filename, SummaryMetrics &summaryMetrics, QColor&color
     selectStatement += " FROM metrics where filename = :name;";
 
     // execute the select statement
-    QSqlQuery query(selectStatement, db->database(sessionid));
-    query.bindValue(":start", filename);
+    QSqlQuery query(db->database(sessionid));
+    query.prepare(selectStatement);
+    query.bindValue(":name", filename);
     query.exec();
 
     while(query.next())
@@ -549,7 +916,7 @@ DBAccess::getRide(QString filename, SummaryMetrics &summaryMetrics, QColor&color
                 QString underscored = field.name;
                 summaryMetrics.setForSymbol(underscored.replace("_"," "), query.value(i+4).toDouble());
                 i++;
-            } else if (!context->specialFields.isMetric(field.name) && field.type < 3) {
+            } else if (!context->specialFields.isMetric(field.name) && (field.type < 3 || field.type == 7)) {
                 QString underscored = field.name;
                 summaryMetrics.setText(underscored.replace("_"," "), query.value(i+4).toString());
                 i++;
@@ -34,6 +34,7 @@
 #include "RideFile.h"
 #include "SpecialFields.h"
 #include "RideMetadata.h"
+#include "RouteIndex.h"
 
 extern int DBSchemaVersion;
 
@@ -63,6 +64,12 @@ class DBAccess
 	    bool importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor color, unsigned long, bool);
         bool deleteRide(QString);
 
+        // Create Interval Metrics, deleteRide removes them too
+        bool importIntervals(SummaryMetrics *summaryMetrics, QList<SummaryMetrics> &intervals, unsigned long);
+
+        // Create GPS track and the cells it passes through, deleteRide removes them too
+        bool importTrack(SummaryMetrics *summaryMetrics, const RouteTrack &track, unsigned long);
+
         // Create/Delete Measures
         bool importMeasure(SummaryMetrics *summaryMetrics);
 
@@ -73,6 +80,15 @@ class DBAccess
         }
         QList<QString> getDistinctValues(FieldDefinition field);
 
+        // intervals in the rides, the name is matched with LIKE e.g. "5 min%"
+        QList<SummaryMetrics> getAllIntervalsFor(QDateTime start, QDateTime end, QString name = "");
+        QList<SummaryMetrics> getAllIntervalsFor(DateRange dr, QString name = "") {
+            return getAllIntervalsFor(QDateTime(dr.from,QTime(0,0,0)), QDateTime(dr.to, QTime(23,59,59)), name);
+        }
+
+        // tracks of the rides that went through one of the from cells and one of the to cells
+        QList<RouteTrack> getTracksThrough(QList<qint64> from, QList<qint64> to);
+
         bool getRide(QString filename, SummaryMetrics &metrics, QColor&color);
         QList<SummaryMetrics> getAllMeasuresFor(QDateTime start, QDateTime end);
         QList<SummaryMetrics> getAllMeasuresFor(DateRange dr) { 
@@ -102,6 +118,10 @@ class DBAccess
         bool dropMetricTable();
         bool createMeasuresTable();
         bool dropMeasuresTable();
+        bool createIntervalsTable();
+        bool dropIntervalsTable();
+        bool createTracksTable();
+        bool dropTracksTable();
 	    void initDatabase(QDir home);
 };
 #endif
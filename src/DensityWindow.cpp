@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "DensityWindow.h"
+#include "Athlete.h"
+#include "MetricAggregator.h"
+#include "RideFileCacheRefresher.h"
+#include "Colors.h"
+
+#include <QFormLayout>
+#include <qnumeric.h>
+
+#include <qwt_plot_spectrogram.h>
+#include <qwt_matrix_raster_data.h>
+#include <qwt_color_map.h>
+#include <qwt_scale_widget.h>
+
+// the spectrogram and the colour bar each need their own
+static QwtLinearColorMap *colorMap()
+{
+    QwtLinearColorMap *map = new QwtLinearColorMap(Qt::darkBlue, Qt::red);
+    map->addColorStop(0.1, Qt::cyan);
+    map->addColorStop(0.3, Qt::green);
+    map->addColorStop(0.6, Qt::yellow);
+    return map;
+}
+
+DensityWindow::DensityWindow(Context *context) :
+    GcChartWindow(context), context(context), stale(true), source(NULL)
+{
+    QWidget *c = new QWidget;
+    c->setContentsMargins(0,0,0,0);
+    QFormLayout *cl = new QFormLayout(c);
+    cl->setFieldGrowthPolicy(QFormLayout::ExpandingFieldsGrow);
+    cl->setSpacing(5);
+    setControls(c);
+
+    pairCombo = new QComboBox(this);
+    for (int i=0; i<RideDensityCache::NumPairs; i++) {
+        RideDensityCache::Pair p = static_cast<RideDensityCache::Pair>(i);
+        pairCombo->addItem(tr("%1 vs %2").arg(RideDensityCache::xName(p)).arg(RideDensityCache::yName(p)));
+    }
+    cl->addRow(new QLabel(tr("Data")), pairCombo);
+
+    // plot
+    QVBoxLayout *vlayout = new QVBoxLayout;
+    vlayout->setSpacing(10);
+
+    plot = new QwtPlot(this);
+    spectrogram = new QwtPlotSpectrogram();
+    spectrogram->setColorMap(colorMap());
+    spectrogram->attach(plot);
+
+    plot->enableAxis(QwtPlot::yRight);
+    plot->axisWidget(QwtPlot::yRight)->setColorBarEnabled(true);
+    plot->setAxisTitle(QwtPlot::yRight, tr("Minutes"));
+    vlayout->addWidget(plot);
+
+    missingLabel = new QLabel(this);
+    missingLabel->hide();
+    vlayout->addWidget(missingLabel);
+
+    setChartLayout(vlayout);
+
+    connect(this, SIGNAL(dateRangeChanged(DateRange)), this, SLOT(dateRangeChanged(DateRange)));
+    connect(pairCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(pairChanged()));
+    connect(context, SIGNAL(filterChanged()), this, SLOT(filterChanged()));
+    connect(context, SIGNAL(homeFilterChanged()), this, SLOT(filterChanged()));
+    connect(context, SIGNAL(configChanged()), this, SLOT(configChanged()));
+
+    // rides left out as their .cpd wasn't ready can be added now
+    connect(context->athlete->metricDB->cacheRefresher(), SIGNAL(finished()), this, SLOT(cacheFinished()));
+
+    configChanged();
+}
+
+DensityWindow::~DensityWindow()
+{
+    delete source;
+}
+
+void
+DensityWindow::configChanged()
+{
+    plot->setCanvasBackground(GColor(CPLOTBACKGROUND));
+
+    QPalette palette;
+    palette.setBrush(QPalette::Window, QBrush(GColor(CPLOTBACKGROUND)));
+    palette.setColor(QPalette::WindowText, GColor(CPLOTMARKER));
+    palette.setColor(QPalette::Text, GColor(CPLOTMARKER));
+    plot->setPalette(palette);
+    missingLabel->setPalette(palette);
+
+    plot->axisWidget(QwtPlot::xBottom)->setPalette(palette);
+    plot->axisWidget(QwtPlot::yLeft)->setPalette(palette);
+    plot->axisWidget(QwtPlot::yRight)->setPalette(palette);
+
+    plot->replot();
+}
+
+void
+DensityWindow::dateRangeChanged(DateRange dateRange)
+{
+    // has it changed?
+    if (dateRange.from != cfrom || dateRange.to != cto) {
+        cfrom = dateRange.from;
+        cto = dateRange.to;
+        stale = true;
+    }
+    refresh();
+}
+
+void
+DensityWindow::filterChanged()
+{
+    stale = true;
+    refresh();
+}
+
+void
+DensityWindow::cacheFinished()
+{
+    if (source && source->missing()) {
+        stale = true;
+        refresh();
+    }
+}
+
+void
+DensityWindow::pairChanged()
+{
+    redraw();
+}
+
+void
+DensityWindow::refresh()
+{
+    // don't do it if we're invisible or nothing has
+    // changed since last time ..
+    if (!amVisible() || !stale) return;
+
+    delete source;
+    source = new RideDensityCache(context, cfrom, cto);
+    stale = false;
+
+    redraw();
+}
+
+void
+DensityWindow::redraw()
+{
+    if (!source) return;
+
+    RideDensityCache::Pair p = static_cast<RideDensityCache::Pair>(pair());
+    if (p < 0 || p >= RideDensityCache::NumPairs) return;
+
+    int xbins = RideDensityCache::xBins(p);
+    int ybins = RideDensityCache::yBins(p);
+
+    // in minutes, the empty cells aren't drawn at all
+    const QVector<double> &cells = source->density(p);
+    QVector<double> values(cells.count());
+    double max = 0;
+    for (int i=0; i<cells.count(); i++) {
+        if (cells[i] > 0) {
+            values[i] = cells[i] / 60.0;
+            if (values[i] > max) max = values[i];
+        } else {
+            values[i] = qQNaN();
+        }
+    }
+    if (max <= 0) max = 1;
+
+    QwtInterval x(RideDensityCache::xMin(p), RideDensityCache::xMin(p) + xbins * RideDensityCache::xBinSize(p));
+    QwtInterval y(RideDensityCache::yMin(p), RideDensityCache::yMin(p) + ybins * RideDensityCache::yBinSize(p));
+    QwtInterval z(0, max);
+
+    QwtMatrixRasterData *data = new QwtMatrixRasterData();
+    data->setValueMatrix(values, xbins);
+    data->setInterval(Qt::XAxis, x);
+    data->setInterval(Qt::YAxis, y);
+    data->setInterval(Qt::ZAxis, z);
+    spectrogram->setData(data);
+
+    plot->setAxisScale(QwtPlot::xBottom, x.minValue(), x.maxValue());
+    plot->setAxisScale(QwtPlot::yLeft, y.minValue(), y.maxValue());
+    plot->setAxisScale(QwtPlot::yRight, z.minValue(), z.maxValue());
+    plot->axisWidget(QwtPlot::yRight)->setColorMap(z, colorMap());
+    plot->setAxisTitle(QwtPlot::xBottom, RideDensityCache::xName(p));
+    plot->setAxisTitle(QwtPlot::yLeft, RideDensityCache::yName(p));
+
+    // say if some of the rides aren't in it yet
+    if (source->missing()) {
+        missingLabel->setText(tr("%1 rides are not cached yet, they will be added when the refresh is done.")
+                              .arg(source->missing()));
+        missingLabel->show();
+    } else {
+        missingLabel->hide();
+    }
+
+    plot->replot();
+}
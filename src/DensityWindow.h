@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_DensityWindow_h
+#define _GC_DensityWindow_h 1
+#include "GoldenCheetah.h"
+
+#include <QtGui>
+#include <QComboBox>
+#include <QLabel>
+
+#include "Context.h"
+#include "Season.h"
+#include "RideDensityCache.h"
+
+#include <qwt_plot.h>
+
+class QwtPlotSpectrogram;
+
+// Time spent at each combination of two channels, e.g. watts and
+// cadence, across the date range as a density plot. It is drawn from
+// the .cpd files so the rides are never opened, those the refresher
+// hasn't got to yet are left out and it is redrawn when it finishes.
+class DensityWindow : public GcChartWindow
+{
+    Q_OBJECT
+    G_OBJECT
+
+    Q_PROPERTY(int pair READ pair WRITE setPair USER true)
+
+    public:
+
+        DensityWindow(Context *context);
+        ~DensityWindow();
+
+#ifdef GC_HAVE_SEARCH
+        bool isFiltered() const { return context->ishomefiltered || context->isfiltered; }
+#endif
+
+        int pair() const { return pairCombo->currentIndex(); }
+        void setPair(int x) { pairCombo->setCurrentIndex(x); }
+
+    public slots:
+
+        void dateRangeChanged(DateRange);
+        void filterChanged();
+        void cacheFinished();
+        void pairChanged();
+        void configChanged();
+
+    private:
+
+        void refresh(); // aggregate the .cpd files for the date range
+        void redraw(); // the pair we're showing from what we have
+
+        Context *context;
+        bool stale;
+        QDate cfrom, cto;
+
+        RideDensityCache *source;
+
+        QComboBox *pairCombo;
+        QwtPlot *plot;
+        QwtPlotSpectrogram *spectrogram;
+        QLabel *missingLabel;
+};
+
+#endif // _GC_DensityWindow_h
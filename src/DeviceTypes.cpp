@@ -67,6 +67,11 @@ DeviceTypes::DeviceTypes()
         tr("Testing device used for development only. If an ERG file is selected it will "
         "replay back, with a little randomness thrown in."),
         "" },
+      { DEV_SIMULATOR, DEV_TCP,    (char *) "Simulator", false,   false,
+        tr("Virtual trainer used for development and testing only. Set the port to a ride "
+        "file to replay it, or leave it blank to generate a rider. Options such as "
+        "speed=4,noise=5,mass=85 go in the profile."),
+        "" },
 #endif
       { 0, 0, NULL, 0, 0, "", "" }
     };
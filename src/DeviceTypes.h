@@ -36,6 +36,7 @@
 #define DEV_FORTIUS    0x0800   // Tacx Fortius
 #define DEV_KICKR      0x1000   // Wahoo Kickr
 #define DEV_BT40       0x2000   // Wahoo Kickr
+#define DEV_SIMULATOR  0x4000   // Virtual trainer for testing
 
 #define DEV_QUARQ      0x01     // ants use id:hostname:port
 #define DEV_SERIAL     0x02     // use filename COMx or /dev/cuxxxx
@@ -53,7 +53,7 @@ class DiaryWindow : public GcWindow
         int view() const { return 0; /* viewMode->currentIndex(); */ }
         void setView(int /* x */ ) { /* viewMode->setCurrentIndex(x); */ }
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         bool isFiltered() const { return (context->ishomefiltered || context->isfiltered); }
 #endif
 
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ErgControl.h"
+#include "ErgFile.h"
+#include "RealtimeController.h"
+#include "GcTrace.h"
+
+#include <math.h>
+
+// closed loop correction, the trim moves 10% of the error a second
+// and is never more than 15% of the load
+static const double TRIMGAIN = 0.1;
+static const double MAXTRIM = 0.15;
+static const qint64 STALE = 2000000000LL; // ignore power older than 2s
+
+// resend even if nothing changed, as the old load timer did
+static const qint64 RESEND = 1000000000LL;
+
+ErgControl::ErgControl(Context *context, QObject *parent) : QThread(parent), context(context), workout(NULL), hz(DefaultRate), closedLoop(false),
+    running(false), paused(false), ergo(true), done(false), position(0),
+    measuredWatts(0), measuredKph(0), measuredAt(0), target(0), trim(0), currentLap(0),
+    sent(0), sentAt(0)
+{
+}
+
+ErgControl::~ErgControl()
+{
+    stopWorkout();
+    if (workout) delete workout;
+}
+
+void
+ErgControl::setDevices(QList<RealtimeController*> devices)
+{
+    QMutexLocker locker(&pvars);
+    this->devices = devices;
+}
+
+void
+ErgControl::setWorkout(ErgFile *ergFile)
+{
+    // our own copy, so the gui can adjust and plot the workout
+    // without moving the points we are between under our feet
+    ErgFile *copy = NULL;
+    if (ergFile) {
+        copy = new ErgFile(context);
+        copy->format = ergFile->format;
+        copy->Duration = ergFile->Duration;
+        copy->Points = ergFile->Points;
+        copy->Laps = ergFile->Laps;
+        copy->valid = ergFile->valid && ergFile->Points.count() > 1;
+        copy->compile();
+    }
+
+    QMutexLocker locker(&pvars);
+    if (workout) delete workout;
+    workout = copy;
+}
+
+void
+ErgControl::setRate(int hz)
+{
+    QMutexLocker locker(&pvars);
+    this->hz = qBound(int(MinRate), hz, int(MaxRate));
+}
+
+void
+ErgControl::setClosedLoop(bool closedLoop)
+{
+    QMutexLocker locker(&pvars);
+    this->closedLoop = closedLoop;
+}
+
+void
+ErgControl::startWorkout(bool ergo)
+{
+    stopWorkout();
+
+    pvars.lock();
+    this->ergo = ergo;
+    running = true;
+    paused = done = false;
+    position = target = trim = 0;
+    measuredWatts = measuredKph = 0;
+    measuredAt = 0;
+    currentLap = 0;
+    sent = 0;
+    sentAt = 0;
+    clock.start();
+    pvars.unlock();
+
+    start(QThread::TimeCriticalPriority);
+}
+
+void
+ErgControl::pauseWorkout()
+{
+    QMutexLocker locker(&pvars);
+    paused = true;
+}
+
+void
+ErgControl::resumeWorkout()
+{
+    QMutexLocker locker(&pvars);
+    paused = false;
+}
+
+void
+ErgControl::stopWorkout()
+{
+    pvars.lock();
+    running = false;
+    pvars.unlock();
+
+    wait();
+}
+
+void
+ErgControl::seek(long msecs)
+{
+    QMutexLocker locker(&pvars);
+    if (ergo) position = qMax(0L, msecs);
+}
+
+void
+ErgControl::seekDistance(double km)
+{
+    QMutexLocker locker(&pvars);
+    if (!ergo) position = qMax(0.0, km * 1000.0);
+}
+
+void
+ErgControl::setMeasured(double watts, double kph)
+{
+    QMutexLocker locker(&pvars);
+    measuredWatts = watts;
+    measuredKph = kph;
+    measuredAt = clock.nsecsElapsed();
+}
+
+long
+ErgControl::msecs()
+{
+    QMutexLocker locker(&pvars);
+    return ergo ? position : 0;
+}
+
+double
+ErgControl::distance()
+{
+    QMutexLocker locker(&pvars);
+    return ergo ? 0 : position / 1000.0;
+}
+
+double
+ErgControl::load()
+{
+    QMutexLocker locker(&pvars);
+    return ergo ? target : 0;
+}
+
+double
+ErgControl::slope()
+{
+    QMutexLocker locker(&pvars);
+    return ergo ? 0 : target;
+}
+
+int
+ErgControl::lap()
+{
+    QMutexLocker locker(&pvars);
+    return currentLap;
+}
+
+bool
+ErgControl::finished()
+{
+    QMutexLocker locker(&pvars);
+    return done;
+}
+
+// called with pvars locked
+void
+ErgControl::tick(double secs)
+{
+    if (!workout || done) return;
+
+    // where are we now ?
+    int lapnum = currentLap;
+    if (ergo) {
+        position += secs * 1000.0;
+        target = workout->wattsAt(position, lapnum);
+    } else {
+        position += measuredKph * secs / 3.6;
+        target = workout->gradientAt(position, lapnum);
+    }
+    currentLap = lapnum;
+
+    // we got to the end!
+    if (target == -100) {
+        done = true;
+        target = 0;
+        return;
+    }
+
+    // slowly correct for a trainer that doesn't quite hold the load
+    if (ergo && closedLoop && target > 0 && measuredWatts > 0 && measuredAt && clock.nsecsElapsed() - measuredAt < STALE) {
+        trim += (target - measuredWatts) * TRIMGAIN * secs;
+        trim = qBound(-target * MAXTRIM, trim, target * MAXTRIM);
+    } else if (!ergo || !closedLoop) {
+        trim = 0;
+    }
+}
+
+void
+ErgControl::run()
+{
+    qint64 last = clock.nsecsElapsed();
+    qint64 next = last;
+
+    forever {
+
+        pvars.lock();
+        if (!running) {
+            pvars.unlock();
+            break;
+        }
+
+        qint64 now = clock.nsecsElapsed();
+        double secs = (now - last) / 1000000000.0;
+        last = now;
+
+        // the clock only runs when we are riding
+        if (!paused) tick(secs);
+
+        // what to send, if anything
+        bool send = false;
+        double value = ergo ? target + trim : target;
+        if (!paused && !done && workout) {
+            if (!sentAt || fabs(value - sent) >= (ergo ? 1.0 : 0.05) || now - sentAt >= RESEND) {
+                send = true;
+                sent = value;
+                sentAt = now;
+            }
+        }
+        QList<RealtimeController*> targets = devices;
+        bool erg = ergo;
+        qint64 period = 1000000000LL / hz;
+        pvars.unlock();
+
+        // devices lock their own state
+        if (send) {
+            GC_TRACE("ErgControl::send", "train");
+            foreach(RealtimeController *device, targets) {
+                if (erg) device->setLoad(value);
+                else device->setGradient(value);
+            }
+        }
+
+        // sleep to the next tick, not for a period, so we don't drift
+        next += period;
+        now = clock.nsecsElapsed();
+        if (next < now) next = now; // we fell behind, don't try to catch up
+        usleep((next - now) / 1000);
+    }
+}
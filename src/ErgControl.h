@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_ErgControl_h
+#define _GC_ErgControl_h 1
+#include "GoldenCheetah.h"
+
+#include <QThread>
+#include <QMutex>
+#include <QList>
+#include <QElapsedTimer>
+
+class Context;
+class ErgFile;
+class RealtimeController;
+
+// Runs the workout in train mode. It works out where we are in the
+// workout from a monotonic clock and sets the load or gradient on all
+// the devices at a steady rate, independently of the gui thread, so a
+// slow repaint or video decode can't delay a change in resistance.
+//
+// In erg mode the position is time, otherwise it is distance, which
+// is integrated from the measured speed the gui passes in with
+// setMeasured(). With closed loop enabled, the load sent in erg mode
+// is trimmed slowly so the measured power matches the workout.
+//
+// The gui polls msecs(), distance(), lap() and finished() to update
+// the displays, notify laps and stop at the end of the workout.
+//
+class ErgControl : public QThread
+{
+    Q_OBJECT
+
+    public:
+        ErgControl(Context *context, QObject *parent = 0);
+        ~ErgControl();
+
+        // the devices to control and a copy of the workout, call
+        // setWorkout again after the workout has been adjusted
+        void setDevices(QList<RealtimeController*> devices);
+        void setWorkout(ErgFile *ergFile);
+
+        // from the preferences, the rate the load is sent at in Hz
+        static const int MinRate = 1;
+        static const int MaxRate = 10;
+        static const int DefaultRate = 4;
+        void setRate(int hz);
+        void setClosedLoop(bool closedLoop);
+
+        void startWorkout(bool ergo);
+        void pauseWorkout();
+        void resumeWorkout();
+        void stopWorkout();
+
+        // jumping about
+        void seek(long msecs);
+        void seekDistance(double km);
+
+        // latest telemetry, for distance and closed loop
+        void setMeasured(double watts, double kph);
+
+        // where we are
+        long msecs();
+        double distance();  // km
+        double load();      // watts from the workout, before any trim
+        double slope();
+        int lap();
+        bool finished();
+
+    protected:
+        void run();
+
+    private:
+        void tick(double secs); // advance and work out the load
+
+        Context *context;
+        QElapsedTimer clock;    // monotonic
+        QMutex pvars;   // everything below is shared with the gui thread
+
+        ErgFile *workout;
+        QList<RealtimeController*> devices;
+
+        int hz;
+        bool closedLoop;
+
+        bool running, paused, ergo, done;
+        double position;        // msecs or meters
+        double measuredWatts, measuredKph;
+        qint64 measuredAt;      // nsecs on our clock
+
+        double target, trim;    // what the workout says and the correction
+        int currentLap;
+
+        // what we last sent to the devices
+        double sent;
+        qint64 sentAt;
+};
+
+#endif // _GC_ErgControl_h
@@ -20,6 +20,7 @@
 #include "Athlete.h"
 
 #include <stdint.h>
+#include <algorithm>
 #include "Units.h"
 
 // Supported file types
@@ -253,6 +254,7 @@ void ErgFile::parseTacx()
         Duration = Points.last().x;      // last is the end point in msecs
         leftPoint = 0;
         rightPoint = 1;
+        compile();
 
         // calculate climbing etc
         calculateMetrics();
@@ -492,6 +494,7 @@ void ErgFile::parseComputrainer(QString p)
 
         leftPoint = 0;
         rightPoint = 1;
+        compile();
 
         calculateMetrics();
 
@@ -511,6 +514,60 @@ ErgFile::isValid()
     return valid;
 }
 
+void
+ErgFile::compile()
+{
+    int n = Points.count();
+    pointX.resize(n);
+    pointY.resize(n);
+    pointVal.resize(n);
+    for (int i=0; i<n; i++) {
+        const ErgFilePoint &p = Points.at(i);
+        pointX[i] = p.x;
+        pointY[i] = p.y;
+        pointVal[i] = p.val;
+    }
+
+    lapX.resize(Laps.count());
+    for (int i=0; i<Laps.count(); i++) lapX[i] = Laps.at(i).x;
+    std::sort(lapX.begin(), lapX.end());
+
+    leftPoint = 0;
+    rightPoint = n > 1 ? 1 : 0;
+}
+
+int
+ErgFile::segment(double x)
+{
+    int n = pointX.count();
+    int i = leftPoint;
+
+    // nearly always the same segment or the next one
+    if (i >= 0 && i+1 < n) {
+        if (x >= pointX[i] && (x < pointX[i+1] || i+2 == n)) return i;
+        if (i+2 < n && x >= pointX[i+1] && (x < pointX[i+2] || i+3 == n)) {
+            leftPoint = i+1;
+            rightPoint = i+2;
+            return leftPoint;
+        }
+    }
+
+    // after a seek, or just starting
+    i = std::upper_bound(pointX.constBegin(), pointX.constEnd(), x) - pointX.constBegin() - 1;
+    i = qBound(0, i, n-2);
+    leftPoint = i;
+    rightPoint = i+1;
+    return i;
+}
+
+int
+ErgFile::lapAt(long x)
+{
+    // laps are numbered from 1, 0 before the first
+    if (Laps.count() != lapX.count()) compile();
+    return std::upper_bound(lapX.constBegin(), lapX.constEnd(), double(x)) - lapX.constBegin();
+}
+
 int
 ErgFile::wattsAt(long x, int &lapnum)
 {
@@ -521,50 +578,36 @@ ErgFile::wattsAt(long x, int &lapnum)
     // is it in bounds?
     if (x < 0 || x > Duration) return -100;   // out of bounds!!!
 
-    // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        int lap=0;
-        for (int i=0; i<Laps.count(); i++) {
-            if (x>=Laps.at(i).x) lap += 1;
-        }
-        lapnum = lap;
+    if (Points.count() != pointX.count()) compile();
+    if (pointX.count() < 2) return -100;
 
-    } else lapnum = 0;
+    // do we need to return the Lap marker?
+    lapnum = lapAt(x);
 
     // find right section of the file
-    while (x < Points.at(leftPoint).x || x > Points.at(rightPoint).x) {
-        if (x < Points.at(leftPoint).x) {
-            leftPoint--;
-            rightPoint--;
-        } else if (x > Points.at(rightPoint).x) {
-            leftPoint++;
-            rightPoint++;
-        }
-    }
+    int i = segment(x);
 
     // two different points in time but the same watts
     // at both, it doesn't really matter which value
     // we use
-    if (Points.at(leftPoint).val == Points.at(rightPoint).val)
-        return Points.at(rightPoint).val;
+    if (pointVal[i] == pointVal[i+1]) return pointVal[i+1];
 
     // the erg file will list the point in time twice
     // to show a jump from one wattage to another
     // at this point in ime (i.e x=100 watts=100 followed
     // by x=100 watts=200)
-    if (Points.at(leftPoint).x == Points.at(rightPoint).x)
-        return Points.at(rightPoint).val;
+    if (pointX[i] == pointX[i+1]) return pointVal[i+1];
 
     // so this point in time between two points and
     // we are ramping from one point and another
     // the steps in the calculation have been explicitly
     // listed for code clarity
-    double deltaW = Points.at(rightPoint).val - Points.at(leftPoint).val;
-    double deltaT = Points.at(rightPoint).x - Points.at(leftPoint).x;
-    double offT = x - Points.at(leftPoint).x;
+    double deltaW = pointVal[i+1] - pointVal[i];
+    double deltaT = pointX[i+1] - pointX[i];
+    double offT = x - pointX[i];
     double factor = offT / deltaT;
 
-    double nowW = Points.at(leftPoint).val + (deltaW * factor);
+    double nowW = pointVal[i] + (deltaW * factor);
 
     return nowW;
 }
@@ -579,27 +622,28 @@ ErgFile::gradientAt(long x, int &lapnum)
     // is it in bounds?
     if (x < 0 || x > Duration) return -100;   // out of bounds!!! (-10 through +15 are valid return vals)
 
-    // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        int lap=0;
-        for (int i=0; i<Laps.count(); i++) {
-            if (x>=Laps.at(i).x) lap += 1;
-        }
-        lapnum = lap;
+    if (Points.count() != pointX.count()) compile();
+    if (pointX.count() < 2) return -100;
 
-    } else lapnum = 0;
+    // do we need to return the Lap marker?
+    lapnum = lapAt(x);
 
     // find right section of the file
-    while (x < Points.at(leftPoint).x || x > Points.at(rightPoint).x) {
-        if (x < Points.at(leftPoint).x) {
-            leftPoint--;
-            rightPoint--;
-        } else if (x > Points.at(rightPoint).x) {
-            leftPoint++;
-            rightPoint++;
-        }
-    }
-    return Points.at(leftPoint).val;
+    return pointVal[segment(x)];
+}
+
+double
+ErgFile::altitudeAt(long x)
+{
+    if (!isValid() || x < 0 || x > Duration) return 0;
+
+    if (Points.count() != pointX.count()) compile();
+    if (pointX.count() < 2) return pointY.count() ? pointY[0] : 0;
+
+    int i = segment(x);
+    double deltaX = pointX[i+1] - pointX[i];
+    if (deltaX <= 0) return pointY[i+1];
+    return pointY[i] + (pointY[i+1] - pointY[i]) * (x - pointX[i]) / deltaX;
 }
 
 int ErgFile::nextLap(long x)
@@ -607,11 +651,10 @@ int ErgFile::nextLap(long x)
     if (!isValid()) return -1; // not a valid ergfile
 
     // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        for (int i=0; i<Laps.count(); i++) {
-            if (x<Laps.at(i).x) return Laps.at(i).x;
-        }
-    }
+    if (Laps.count() != lapX.count()) compile();
+    const double *next = std::upper_bound(lapX.constBegin(), lapX.constEnd(), double(x));
+    if (next != lapX.constEnd()) return *next;
+
     return -1; // nope, no marker ahead of there
 }
 
@@ -30,6 +30,7 @@
 #include <QFile>
 #include <QTextStream>
 #include <QRegExp>
+#include <QVector>
 #include "Zones.h"      // For zones ... see below vvvv
 
 // which section of the file are we in?
@@ -82,8 +83,12 @@ class ErgFile
         int format;             // ERG, CRS or MRC currently supported
         int wattsAt(long, int&);      // return the watts value for the passed msec
         double gradientAt(long, int&);      // return the gradient value for the passed meter
+        double altitudeAt(long);      // return the altitude for the passed meter (CRS)
+        int lapAt(long);        // return the lap number at msec or meter
         int nextLap(long);      // return the msecs value for the next Lap marker
 
+        void compile();         // index Points and Laps, call after changing them
+
         QString Version,        // version number / identifer
                 Units,          // units used
                 Filename,       // filename from inside file
@@ -116,6 +121,14 @@ class ErgFile
     private:
         int &mode;
         int nomode;
+
+        // index of the segment x is in, pointX[i] <= x < pointX[i+1]
+        int segment(double x);
+
+        // Points and Laps as sorted contiguous arrays, so lookups are
+        // a binary search, or O(1) when moving on from where we were
+        QVector<double> pointX, pointY, pointVal;
+        QVector<double> lapX;
 };
 
 #endif
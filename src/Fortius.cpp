@@ -17,6 +17,7 @@
  */
 
 #include "Fortius.h"
+#include "GcTrace.h"
 
 //
 // Outbound control message has the format:
@@ -373,6 +374,8 @@ void Fortius::run()
         if (isDeviceOpen == true) {
 
             int actualLength = readMessage();
+            GC_TRACE("Fortius::telemetry", "train");
+            GC_TRACE_COUNTER("fortius bytes", actualLength);
             if (actualLength >= 24) {
 
                 //----------------------------------------------------------------
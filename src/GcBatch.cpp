@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "GcBatch.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "MetricAggregator.h"
+#include "RideFileCache.h"
+#include "RideFile.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+#include <stdio.h>
+
+// the mean maximal series we export, in column order
+static const struct {
+    RideFile::SeriesType series;
+    const char *name;
+} meanmaxSeries[] = {
+    { RideFile::watts, "watts" },
+    { RideFile::hr, "hr" },
+    { RideFile::cad, "cad" },
+    { RideFile::nm, "nm" },
+    { RideFile::kph, "kph" },
+    { RideFile::kphd, "kphd" },
+    { RideFile::xPower, "xPower" },
+    { RideFile::NP, "NP" },
+    { RideFile::vam, "vam" },
+    { RideFile::wattsKg, "wattsKg" },
+    { RideFile::aPower, "aPower" },
+    { RideFile::none, NULL }
+};
+
+void
+GcBatch::usage()
+{
+    fprintf(stderr, "usage: GoldenCheetah --batch [directory] athlete [options]\n\n");
+    fprintf(stderr, "--force             recompute all metrics, not just those out of date\n");
+    fprintf(stderr, "--threads=n         threads to compute metrics on (default all cores)\n");
+    fprintf(stderr, "--metrics=file      export ride metrics as CSV\n");
+    fprintf(stderr, "--meanmax=file      export mean maximals for all rides as CSV\n\n");
+}
+
+int
+GcBatch::run(QDir home, QStringList args)
+{
+    bool force = false;
+    int threads = QThread::idealThreadCount();
+    QString metrics, meanmax;
+
+    // pull out the switches, first arg is the program name
+    QStringList names;
+    for (int i=1; i<args.count(); i++) {
+        QString arg = args.at(i);
+
+        if (arg == "--force") force = true;
+        else if (arg.startsWith("--threads=")) threads = arg.mid(10).toInt();
+        else if (arg.startsWith("--metrics=")) metrics = arg.mid(10);
+        else if (arg.startsWith("--meanmax=")) meanmax = arg.mid(10);
+        else if (arg.startsWith("--")) {
+            fprintf(stderr, "unknown option %s\n\n", arg.toLocal8Bit().constData());
+            usage();
+            return 2;
+        } else names << arg;
+    }
+
+    // [directory] athlete, as for the GUI
+    if (names.count() == 2 && QFileInfo(names.at(0)).isDir()) {
+        home.cd(names.at(0));
+        names.removeFirst();
+    }
+    if (names.count() != 1 || threads < 1) {
+        usage();
+        return 2;
+    }
+    if (!home.cd(names.at(0))) {
+        fprintf(stderr, "no athlete %s in %s\n", names.at(0).toLocal8Bit().constData(),
+                                                 home.absolutePath().toLocal8Bit().constData());
+        return 1;
+    }
+
+    GcBatch batch(home);
+    if (!batch.open()) return 1;
+
+    int ret = 0;
+    batch.refresh(force, threads);
+    if (metrics != "" && !batch.exportMetrics(metrics)) ret = 1;
+    if (meanmax != "" && !batch.exportMeanMax(meanmax)) ret = 1;
+
+    fprintf(stdout, "total: %d ms\n", batch.total);
+    fflush(stdout);
+    return ret;
+}
+
+GcBatch::GcBatch(QDir home) : home(home), context(NULL), total(0)
+{
+    timer.start();
+}
+
+GcBatch::~GcBatch()
+{
+    if (context) {
+        delete context->athlete;
+        delete context;
+    }
+}
+
+void
+GcBatch::stage(QString name)
+{
+    int ms = timer.restart();
+    total += ms;
+    fprintf(stdout, "%s: %d ms\n", name.toLocal8Bit().constData(), ms);
+    fflush(stdout);
+}
+
+bool
+GcBatch::open()
+{
+    context = new Context(NULL);
+    new Athlete(context, home, true); // sets context->athlete
+    stage("open");
+    return true;
+}
+
+void
+GcBatch::refresh(bool force, int threads)
+{
+    MetricAggregator *metricDB = context->athlete->metricDB;
+    metricDB->setThreads(threads);
+
+    // the cpx files are refreshed at the same time
+    if (force) metricDB->refreshMetrics(QDateTime(QDate(1900,1,1), QTime(0,0,0)));
+    else metricDB->refreshMetrics();
+    stage("refresh");
+}
+
+bool
+GcBatch::exportMetrics(QString filename)
+{
+    bool ok = context->athlete->metricDB->writeAsCSV(filename);
+    if (!ok) fprintf(stderr, "cannot export metrics to %s\n", filename.toLocal8Bit().constData());
+    stage("export metrics");
+    return ok;
+}
+
+bool
+GcBatch::exportMeanMax(QString filename)
+{
+    QFile file(filename);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        fprintf(stderr, "cannot export mean maximals to %s\n", filename.toLocal8Bit().constData());
+        return false;
+    }
+
+    // all rides, the cpx files are up to date after the refresh
+    RideFileCache bests(context, QDate(1900,1,1), QDate::currentDate().addYears(1));
+
+    int longest = 0;
+    QTextStream out(&file);
+    out << "secs";
+    for (int i=0; meanmaxSeries[i].name; i++) {
+        out << "," << meanmaxSeries[i].name;
+        if (bests.meanMaxArray(meanmaxSeries[i].series).count() > longest)
+            longest = bests.meanMaxArray(meanmaxSeries[i].series).count();
+    }
+    out << "\n";
+
+    // index is the duration in seconds, 0 is not used
+    for (int secs=1; secs<longest; secs++) {
+        out << secs;
+        for (int i=0; meanmaxSeries[i].name; i++) {
+            QVector<double> &values = bests.meanMaxArray(meanmaxSeries[i].series);
+            out << ",";
+            if (secs < values.count() && values[secs] > 0) out << values[secs];
+        }
+        out << "\n";
+    }
+    file.close();
+
+    stage("export meanmax");
+    return true;
+}
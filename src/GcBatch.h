@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef Gc_GcBatch_h
+#define Gc_GcBatch_h
+#include "GoldenCheetah.h"
+
+#include <QDir>
+#include <QTime>
+#include <QString>
+#include <QStringList>
+#include <QApplication>
+
+class Context;
+
+// Headless batch processing of an athlete, run from main() when
+// --batch is passed on the command line. There is no MainWindow,
+// the athlete is opened without any widgets and the metrics and
+// caches are refreshed using the same code as the GUI.
+//
+// GoldenCheetah --batch [directory] athlete [options]
+//
+//     --force            recompute all the metrics, not just out of date
+//     --threads=n        threads to compute metrics on (default all cores)
+//     --metrics=file     export the ride metrics as CSV
+//     --meanmax=file     export the mean maximals for all rides as CSV
+//
+// The time taken for each stage is written to stdout.
+class GcBatch
+{
+    Q_DECLARE_TR_FUNCTIONS(GcBatch)
+
+    public:
+        // returns the exit code for main()
+        static int run(QDir home, QStringList args);
+        static void usage();
+
+    private:
+        GcBatch(QDir home);
+        ~GcBatch();
+
+        bool open();
+        void refresh(bool force, int threads);
+        bool exportMetrics(QString filename);
+        bool exportMeanMax(QString filename);
+
+        // timings
+        void stage(QString name);
+
+        QDir home;
+        Context *context;
+        QTime timer;
+        int total;
+};
+
+#endif
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "GcBenchmark.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "RideFile.h"
+#include "RideMetric.h"
+#include "RideFileCache.h"
+#include "WPrime.h"
+#include "AllPlotSmoother.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+#include <math.h>
+#include <stdio.h>
+
+static const char *stageNames[GcBenchmark::NumStages] = {
+    "parse", "metrics", "cpx", "wprime", "smooth", "jsonwrite"
+};
+
+// a fixed sequence so every run benchmarks the same rides
+static inline double noise(quint32 &seed)
+{
+    seed = seed * 1664525 + 1013904223;
+    return (seed >> 8) / double(1<<24) * 2.0 - 1.0;
+}
+
+static inline double ms(QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1000000.0;
+}
+
+void
+GcBenchmark::usage()
+{
+    fprintf(stderr, "usage: GoldenCheetah --benchmark [directory] athlete [options]\n\n");
+    fprintf(stderr, "--rides=dir         also parse every ride file in dir (e.g. test/rides)\n");
+    fprintf(stderr, "--hours=1,4,48      durations of the synthetic rides (default 1,4,12,24,48)\n");
+    fprintf(stderr, "--iterations=n      warm runs of each stage (default 5)\n");
+    fprintf(stderr, "--output=file       write the CSV results to file instead of stdout\n\n");
+}
+
+int
+GcBenchmark::run(QDir home, QStringList args)
+{
+    QString rides, output;
+    QString hours = "1,4,12,24,48";
+    int iterations = 5;
+
+    // pull out the switches, first arg is the program name
+    QStringList names;
+    for (int i=1; i<args.count(); i++) {
+        QString arg = args.at(i);
+
+        if (arg.startsWith("--rides=")) rides = arg.mid(8);
+        else if (arg.startsWith("--hours=")) hours = arg.mid(8);
+        else if (arg.startsWith("--iterations=")) iterations = arg.mid(13).toInt();
+        else if (arg.startsWith("--output=")) output = arg.mid(9);
+        else if (arg.startsWith("--")) {
+            fprintf(stderr, "unknown option %s\n\n", arg.toLocal8Bit().constData());
+            usage();
+            return 2;
+        } else names << arg;
+    }
+
+    // [directory] athlete, as for the GUI
+    if (names.count() == 2 && QFileInfo(names.at(0)).isDir()) {
+        home.cd(names.at(0));
+        names.removeFirst();
+    }
+    if (names.count() != 1 || iterations < 1) {
+        usage();
+        return 2;
+    }
+    if (!home.cd(names.at(0))) {
+        fprintf(stderr, "no athlete %s in %s\n", names.at(0).toLocal8Bit().constData(),
+                                                 home.absolutePath().toLocal8Bit().constData());
+        return 1;
+    }
+
+    QFile file;
+    if (output != "") {
+        file.setFileName(output);
+        if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+            fprintf(stderr, "cannot write %s\n", output.toLocal8Bit().constData());
+            return 1;
+        }
+    } else {
+        file.open(stdout, QFile::WriteOnly);
+    }
+    QTextStream out(&file);
+
+    Context *context = new Context(NULL);
+    new Athlete(context, home, true); // sets context->athlete
+
+    GcBenchmark bench(context, iterations, out);
+    out << "ride,points,stage,iterations,cold,min,median,mean\n";
+
+    int ret = 0;
+
+    // the sample rides, every format we can read
+    if (rides != "") {
+        QDir dir(rides);
+        QStringList suffixes;
+        foreach(QString suffix, RideFileFactory::instance().suffixes()) suffixes << ("*." + suffix);
+
+        foreach(QString name, dir.entryList(suffixes, QDir::Files, QDir::Name)) {
+            if (!bench.benchmarkFile(name, dir.absoluteFilePath(name))) {
+                fprintf(stderr, "cannot open %s\n", name.toLocal8Bit().constData());
+                ret = 1;
+            }
+        }
+    }
+
+    // synthetic rides, written as json so the parse is comparable
+    foreach(QString duration, hours.split(",", QString::SkipEmptyParts)) {
+        for (int hz=1; hz<=4; hz *= 4) {
+            RideFile *ride = bench.synthetic(duration.toInt(), hz);
+
+            QString name = QString("synthetic_%1h_%2hz.json").arg(duration.toInt()).arg(hz);
+            QString path = QDir::tempPath() + "/" + QString("gcbench_%1_%2")
+                                                    .arg(QCoreApplication::applicationPid()).arg(name);
+            QFile json(path);
+            bool written = RideFileFactory::instance().writeRideFile(context, ride, json, "json");
+            delete ride;
+
+            if (!written || !bench.benchmarkFile(name, path)) {
+                fprintf(stderr, "cannot benchmark %s\n", name.toLocal8Bit().constData());
+                ret = 1;
+            }
+            QFile::remove(path);
+        }
+    }
+
+    out.flush();
+    file.close();
+
+    delete context->athlete;
+    delete context;
+    return ret;
+}
+
+GcBenchmark::GcBenchmark(Context *context, int iterations, QTextStream &out) :
+    context(context), iterations(iterations), out(out)
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    for (int i = 0; i < factory.metricCount(); ++i) metrics << factory.metricName(i);
+
+    scratch = QDir::tempPath() + "/" + QString("gcbench_%1_write.json").arg(QCoreApplication::applicationPid());
+}
+
+bool
+GcBenchmark::benchmarkFile(QString name, QString path)
+{
+    QVector<double> times;
+    RideFile *ride = NULL;
+
+    // first is cold, keep the last one for the other stages
+    for (int i=0; i<=iterations; i++) {
+        if (ride) delete ride;
+
+        QFile file(path);
+        QStringList errors;
+        QElapsedTimer timer;
+        timer.start();
+        ride = RideFileFactory::instance().openRideFile(context, file, errors);
+        times << ms(timer);
+
+        if (!ride) return false;
+    }
+
+    report(name, ride->dataPoints().count(), Parse, times);
+    benchmarkRide(name, ride);
+    delete ride;
+    return true;
+}
+
+void
+GcBenchmark::benchmarkRide(QString name, RideFile *ride)
+{
+    ride->getWeight(); // from the DB, not part of any stage
+
+    for (int stage=Metrics; stage<NumStages; stage++) {
+        QVector<double> times;
+        for (int i=0; i<=iterations; i++) times << once(static_cast<Stage>(stage), ride);
+        report(name, ride->dataPoints().count(), static_cast<Stage>(stage), times);
+    }
+    QFile::remove(scratch);
+}
+
+double
+GcBenchmark::once(Stage stage, RideFile *ride)
+{
+    QElapsedTimer timer;
+    double took = 0;
+
+    switch (stage) {
+
+    case Metrics:
+        {
+            timer.start();
+            QHash<QString,RideMetricPtr> computed = RideMetric::computeMetrics(context, ride,
+                                                    context->athlete->zones(), context->athlete->hrZones(), metrics);
+            took = ms(timer);
+        }
+        break;
+
+    case Cache:
+        {
+            timer.start();
+            RideFileCache cache(ride); // computes the lot
+            took = ms(timer);
+        }
+        break;
+
+    case WPrimeSeries:
+        {
+            WPrime wprime;
+            timer.start();
+            wprime.setRide(ride);
+            took = ms(timer);
+        }
+        break;
+
+    case Smooth:
+        {
+            // as AllPlot does for the channels we have
+            int n = ride->dataPoints().count();
+            QVector<double> time(n), watts(n), hr(n), speed(n), cad(n), alt(n), torque(n), distance(n);
+            for (int i=0; i<n; i++) {
+                const RideFilePoint *p = ride->dataPoints()[i];
+                time[i] = p->secs;
+                watts[i] = p->watts;
+                hr[i] = p->hr;
+                speed[i] = p->kph;
+                cad[i] = p->cad;
+                alt[i] = p->alt;
+                torque[i] = p->nm;
+                distance[i] = p->km;
+            }
+
+            timer.start();
+            AllPlotSmoother smoother;
+            smoother.setTime(time);
+            if (ride->areDataPresent()->watts) smoother.setChannel(AllPlotSmoother::Watts, watts);
+            if (ride->areDataPresent()->hr) smoother.setChannel(AllPlotSmoother::Hr, hr);
+            if (ride->areDataPresent()->kph) smoother.setChannel(AllPlotSmoother::Speed, speed);
+            if (ride->areDataPresent()->cad) smoother.setChannel(AllPlotSmoother::Cad, cad);
+            if (ride->areDataPresent()->alt) smoother.setChannel(AllPlotSmoother::Alt, alt);
+            if (ride->areDataPresent()->nm) smoother.setChannel(AllPlotSmoother::Torque, torque);
+            if (ride->areDataPresent()->km) smoother.setChannel(AllPlotSmoother::Distance, distance);
+            for (int c=0; c<AllPlotSmoother::NumChannels; c++) {
+                AllPlotSmoother::Channel channel = static_cast<AllPlotSmoother::Channel>(c);
+                if (smoother.hasChannel(channel)) smoother.smoothed(channel, 30);
+            }
+            took = ms(timer);
+        }
+        break;
+
+    case WriteJson:
+        {
+            QFile file(scratch);
+            timer.start();
+            RideFileFactory::instance().writeRideFile(context, ride, file, "json");
+            took = ms(timer);
+        }
+        break;
+
+    default:
+        break;
+    }
+    return took;
+}
+
+RideFile *
+GcBenchmark::synthetic(int hours, int hz)
+{
+    RideFile *ride = new RideFile(QDateTime(QDate(2014,1,1), QTime(8,0,0)), 1.0 / hz);
+    ride->context = context;
+    ride->setDeviceType("Synthetic");
+
+    quint32 seed = 42;
+    double km = 0;
+    int points = hours * 3600 * hz;
+    for (int i=0; i<points; i++) {
+        double secs = double(i) / hz;
+
+        // steady riding with a minute long effort every 20 minutes
+        double watts = 180 + 120 * sin(2 * M_PI * secs / 600) + 40 * noise(seed);
+        if (fmod(secs, 1200) < 60) watts += 250;
+        if (watts < 0) watts = 0;
+
+        double cad = watts > 0 ? 85 + 10 * noise(seed) : 0;
+        double hr = 110 + 0.15 * watts + 5 * noise(seed);
+        double kph = 28 + 8 * sin(2 * M_PI * secs / 900) + 2 * noise(seed);
+        double alt = 200 + 150 * sin(2 * M_PI * secs / 3600);
+        double nm = cad > 0 ? watts * 60.0 / (2 * M_PI * cad) : 0;
+        km += kph / 3600.0 / hz;
+
+        ride->appendPoint(secs, cad, hr, km, kph, nm, watts, alt,
+                          -0.1 + km * 0.0005, 51.5 + 0.01 * sin(km / 10.0),
+                          0.0, 0.0, 18.0, 50.0, 0);
+    }
+    ride->recalculateDerivedSeries();
+    return ride;
+}
+
+void
+GcBenchmark::report(QString name, int points, Stage stage, QVector<double> times)
+{
+    // first is cold, the rest are warm
+    double cold = times[0];
+    QVector<double> warm = times.mid(1);
+    qSort(warm);
+
+    double mean = 0;
+    foreach(double t, warm) mean += t;
+    mean /= warm.count();
+
+    int mid = warm.count() / 2;
+    double median = warm.count() % 2 ? warm[mid] : (warm[mid-1] + warm[mid]) / 2.0;
+
+    out << name << "," << points << "," << stageNames[stage] << "," << warm.count() << ","
+        << QString::number(cold, 'f', 3) << ","
+        << QString::number(warm.first(), 'f', 3) << ","
+        << QString::number(median, 'f', 3) << ","
+        << QString::number(mean, 'f', 3) << "\n";
+    out.flush();
+}
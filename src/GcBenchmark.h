@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef Gc_GcBenchmark_h
+#define Gc_GcBenchmark_h
+#include "GoldenCheetah.h"
+
+#include <QDir>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QTextStream>
+#include <QApplication>
+
+class Context;
+class RideFile;
+
+// Benchmarks for the ride processing code, run from main() when
+// --benchmark is passed on the command line. The athlete is opened
+// headless (see GcBatch) so the zones and metadata config are used.
+//
+// GoldenCheetah --benchmark [directory] athlete [options]
+//
+//     --rides=dir        also parse every ride file in dir (e.g. test/rides)
+//     --hours=1,4,48     durations of the synthetic rides (default 1,4,12,24,48)
+//     --iterations=n     warm runs of each stage (default 5)
+//     --output=file      write the results here instead of stdout
+//
+// Synthetic rides are generated at 1Hz and 4Hz from a fixed seed so
+// every run sees the same data. Each stage is run once cold (first
+// use, caches empty) and then n times warm. The results are CSV, one
+// line per ride and stage, with times in milliseconds:
+//
+//     ride,points,stage,iterations,cold,min,median,mean
+//
+class GcBenchmark
+{
+    Q_DECLARE_TR_FUNCTIONS(GcBenchmark)
+
+    public:
+        // returns the exit code for main()
+        static int run(QDir home, QStringList args);
+        static void usage();
+
+        enum stage { Parse=0, Metrics, Cache, WPrimeSeries, Smooth, WriteJson, NumStages };
+        typedef enum stage Stage;
+
+    private:
+        GcBenchmark(Context *context, int iterations, QTextStream &out);
+
+        // parse a file and then benchmark the ride
+        bool benchmarkFile(QString name, QString path);
+
+        // all the stages after parse
+        void benchmarkRide(QString name, RideFile *ride);
+
+        // time one run of a stage in ms
+        double once(Stage stage, RideFile *ride);
+
+        RideFile *synthetic(int hours, int hz);
+        void report(QString name, int points, Stage stage, QVector<double> times);
+
+        Context *context;
+        int iterations;
+        QTextStream &out;
+        QStringList metrics;
+        QString scratch; // for json writes
+};
+
+#endif
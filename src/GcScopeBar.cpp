@@ -51,7 +51,7 @@ GcScopeBar::GcScopeBar(Context *context) : QWidget(context->mainWindow), context
     layout->addWidget(searchLabel);
     searchLabel->hide();
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     connect(context, SIGNAL(filterChanged()), this, SLOT(setHighlighted()));
 #endif
     connect(context, SIGNAL(compareIntervalsStateChanged(bool)), this, SLOT(setCompare()));
@@ -120,7 +120,7 @@ GcScopeBar::GcScopeBar(Context *context) : QWidget(context->mainWindow), context
 void
 GcScopeBar::setHighlighted()
 {
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     if (context->isfiltered) {
         searchLabel->setHighlighted(true);
         searchLabel->show();
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "GcTrace.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+#include <QDebug>
+
+// don't let a long session eat all the memory
+static const int MAXEVENTS = 1000000;
+
+struct GcTraceEvent {
+    const char *name, *category;
+    char phase;         // 'X' complete or 'C' counter
+    int tid;
+    qint64 ts, dur;     // microseconds
+    double value;       // counters
+    QString detail;
+};
+
+volatile bool GcTrace::recording = false;
+
+static QMutex lock;
+static QElapsedTimer timer;
+static QString file;
+static QVector<GcTraceEvent> events;
+static QHash<Qt::HANDLE, int> tids;
+static int dropped = 0;
+
+// small numbers are easier to read than thread handles
+static int threadId()
+{
+    Qt::HANDLE handle = QThread::currentThreadId();
+    QHash<Qt::HANDLE, int>::const_iterator it = tids.constFind(handle);
+    if (it != tids.constEnd()) return it.value();
+
+    int tid = tids.count();
+    tids.insert(handle, tid);
+    return tid;
+}
+
+static QString escaped(QString string)
+{
+    QString returning;
+    foreach(QChar c, string) {
+        if (c == '"' || c == '\\') returning += QString("\\") + c;
+        else if (c < QChar(' ')) returning += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+        else returning += c;
+    }
+    return returning;
+}
+
+void
+GcTrace::start(QString filename)
+{
+    QMutexLocker locker(&lock);
+
+    file = filename;
+    events.clear();
+    tids.clear();
+    dropped = 0;
+
+    // the main thread is always thread 0
+    if (QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread())
+        threadId();
+
+    timer.start();
+    recording = true;
+}
+
+QString
+GcTrace::filename()
+{
+    QMutexLocker locker(&lock);
+    return file;
+}
+
+qint64
+GcTrace::now()
+{
+    return timer.nsecsElapsed() / 1000;
+}
+
+void
+GcTrace::complete(const char *name, const char *category, qint64 start, qint64 end, const QString &detail)
+{
+    QMutexLocker locker(&lock);
+    if (!recording) return;
+    if (events.count() >= MAXEVENTS) { dropped++; return; }
+
+    GcTraceEvent add;
+    add.name = name;
+    add.category = category;
+    add.phase = 'X';
+    add.tid = threadId();
+    add.ts = start;
+    add.dur = end - start;
+    add.value = 0;
+    add.detail = detail;
+    events << add;
+}
+
+void
+GcTrace::counter(const char *name, double value)
+{
+    qint64 ts = now();
+
+    QMutexLocker locker(&lock);
+    if (!recording) return;
+    if (events.count() >= MAXEVENTS) { dropped++; return; }
+
+    GcTraceEvent add;
+    add.name = name;
+    add.category = "counter";
+    add.phase = 'C';
+    add.tid = threadId();
+    add.ts = ts;
+    add.dur = 0;
+    add.value = value;
+    events << add;
+}
+
+bool
+GcTrace::stop()
+{
+    QMutexLocker locker(&lock);
+    if (!recording) return true;
+    recording = false;
+
+    QFile out(file);
+    if (!out.open(QFile::WriteOnly | QFile::Truncate)) {
+        qDebug()<<"cannot write trace file"<<file;
+        events.clear();
+        return false;
+    }
+
+    qint64 pid = QCoreApplication::applicationPid();
+    QTextStream stream(&out);
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    // name the threads
+    QHashIterator<Qt::HANDLE, int> t(tids);
+    bool first = true;
+    while (t.hasNext()) {
+        t.next();
+        if (!first) stream << ",\n";
+        first = false;
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << t.value()
+               << ",\"args\":{\"name\":\"" << (t.value() ? QString("thread %1").arg(t.value()) : QString("main")) << "\"}}";
+    }
+
+    foreach(const GcTraceEvent &e, events) {
+        if (!first) stream << ",\n";
+        first = false;
+
+        stream << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"" << e.phase
+               << "\",\"pid\":" << pid << ",\"tid\":" << e.tid << ",\"ts\":" << e.ts;
+
+        if (e.phase == 'X') {
+            stream << ",\"dur\":" << e.dur;
+            if (!e.detail.isEmpty()) stream << ",\"args\":{\"detail\":\"" << escaped(e.detail) << "\"}";
+        } else {
+            stream << ",\"args\":{\"value\":" << e.value << "}";
+        }
+        stream << "}";
+    }
+    stream << "\n]}\n";
+    out.close();
+
+    if (dropped) qDebug()<<"trace dropped"<<dropped<<"events";
+    events.clear();
+    return true;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef Gc_GcTrace_h
+#define Gc_GcTrace_h
+#include "GoldenCheetah.h"
+
+#include <QString>
+
+// Performance tracing
+//
+// Spans are timed with a scoped object and recorded with the thread
+// they ran on, counters record a value at a point in time. When we stop
+// the events are written in the Chrome trace event format, so they can
+// be loaded into chrome://tracing or any viewer that reads that format.
+//
+// When not recording a span is a test of a bool and nothing else, so
+// they can be left in the hot paths:
+//
+//     GC_TRACE("computeMetrics", "metrics");
+//     GC_TRACE_DETAIL(ride->getTag("Filename", ""));   // optional, same scope
+//     GC_TRACE_COUNTER("stale rides", stale.count());
+//
+// Recording is started with --trace[=file] on the command line or from
+// the help menu.
+//
+class GcTrace
+{
+    public:
+        static void start(QString filename);
+        static bool stop(); // writes the file, false if it couldn't
+        static QString filename();
+        static bool isRecording() { return recording; }
+
+        // used by the macros below
+        static volatile bool recording;
+        static qint64 now(); // microseconds since start
+        static void complete(const char *name, const char *category, qint64 start, qint64 end, const QString &detail);
+        static void counter(const char *name, double value);
+};
+
+class GcTraceSpan
+{
+    public:
+        GcTraceSpan(const char *name, const char *category) : name(name), category(category),
+                                                              start(GcTrace::recording ? GcTrace::now() : -1) {}
+        ~GcTraceSpan() {
+            if (start >= 0 && GcTrace::recording) GcTrace::complete(name, category, start, GcTrace::now(), detail);
+        }
+        void setDetail(const QString &detail) { if (start >= 0) this->detail = detail; }
+
+    private:
+        const char *name, *category;
+        qint64 start;
+        QString detail;
+};
+
+#define GC_TRACE(name, category) GcTraceSpan gcTraceSpan(name, category)
+#define GC_TRACE_DETAIL(detail) do { if (GcTrace::recording) gcTraceSpan.setDetail(detail); } while (0)
+#define GC_TRACE_COUNTER(name, value) do { if (GcTrace::recording) GcTrace::counter(name, value); } while (0)
+
+#endif
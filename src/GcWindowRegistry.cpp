@@ -24,6 +24,7 @@
 #include "AerolabWindow.h"
 #include "AllPlotWindow.h"
 #include "CriticalPowerWindow.h"
+#include "DensityWindow.h"
 #ifdef GC_HAVE_ICAL
 #include "DiaryWindow.h"
 #endif
@@ -67,7 +68,7 @@ GcWindowRegistry* GcWindows;
 void
 GcWindowRegistry::initialize()
 {
-  static GcWindowRegistry GcWindowsInit[30] = {
+  static GcWindowRegistry GcWindowsInit[31] = {
     // name                     GcWinID
     { VIEW_HOME|VIEW_DIARY, tr("Long Term Metrics"),GcWindowTypes::LTM },
     { VIEW_HOME, tr("Performance Manager"),GcWindowTypes::PerformanceManager },
@@ -82,6 +83,7 @@ GcWindowRegistry::initialize()
     { VIEW_ANALYSIS, tr("Critical Mean Maximals"),GcWindowTypes::CriticalPower },
     { VIEW_ANALYSIS, tr("Histogram"),GcWindowTypes::Histogram },
     { VIEW_HOME|VIEW_DIARY, tr("Distribution"),GcWindowTypes::Distribution },
+    { VIEW_HOME|VIEW_DIARY, tr("Density"),GcWindowTypes::Density },
     { VIEW_ANALYSIS, tr("Pedal Force vs Velocity"),GcWindowTypes::PfPv },
     { VIEW_ANALYSIS, tr("Heartrate vs Power"),GcWindowTypes::HrPw },
     { VIEW_ANALYSIS, tr("Google Map"),GcWindowTypes::GoogleMap },
@@ -145,6 +147,7 @@ GcWindowRegistry::newGcWindow(GcWinID id, Context *context)
     case GcWindowTypes::GoogleMap: returning = new GoogleMapControl(context); break;
     case GcWindowTypes::Histogram: returning = new HistogramWindow(context); break;
     case GcWindowTypes::Distribution: returning = new HistogramWindow(context, true); break;
+    case GcWindowTypes::Density: returning = new DensityWindow(context); break;
     case GcWindowTypes::LTM: returning = new LTMWindow(context); break;
 #ifdef GC_HAVE_QWTPLOT3D
     case GcWindowTypes::Model: returning = new ModelWindow(context, context->athlete->home); break;
@@ -22,6 +22,7 @@
 #include "MainWindow.h"
 #include "RideItem.h"
 #include "RideFile.h"
+#include "RouteGeometry.h"
 #include "IntervalItem.h"
 #include "Context.h"
 #include "Athlete.h"
@@ -177,6 +178,44 @@ void GoogleMapControl::createHtml()
     "    }\n"
     "}\n"
 
+    // decode a line from RouteGeometry::encode()
+    "function decodePath(encoded) {\n"
+    "    var path = new Array();\n"
+    "    var index = 0, lat = 0, lon = 0;\n"
+    "    while (index < encoded.length) {\n"
+    "        var b, shift = 0, result = 0;\n"
+    "        do {\n"
+    "            b = encoded.charCodeAt(index++) - 63;\n"
+    "            result |= (b & 0x1f) << shift;\n"
+    "            shift += 5;\n"
+    "        } while (b >= 0x20);\n"
+    "        lat += (result & 1) ? ~(result >> 1) : (result >> 1);\n"
+    "        shift = 0;\n"
+    "        result = 0;\n"
+    "        do {\n"
+    "            b = encoded.charCodeAt(index++) - 63;\n"
+    "            result |= (b & 0x1f) << shift;\n"
+    "            shift += 5;\n"
+    "        } while (b >= 0x20);\n"
+    "        lon += (result & 1) ? ~(result >> 1) : (result >> 1);\n"
+    "        path.push(new google.maps.LatLng(lat / 1e5, lon / 1e5));\n"
+    "    }\n"
+    "    return path;\n"
+    "}\n"
+
+    // a stretch of the route coloured by power
+    "function drawShaded(encoded, color) {\n"
+    "    var polyOptions = {\n"
+    "        path: decodePath(encoded),\n"
+    "        strokeColor: color,\n"
+    "        strokeWeight: 3,\n"
+    "        strokeOpacity: 0.5,\n" // for out and backs, we need both
+    "        zIndex: 0\n"
+    "    };\n"
+    "    var polyline = new google.maps.Polyline(polyOptions);\n"
+    "    polyline.setMap(map);\n"
+    "}\n"
+
     "function drawIntervals() { \n"
     // intervals will be drawn with these options
     "    var polyOptions = {\n"
@@ -283,53 +322,14 @@ QColor GoogleMapControl::GetColor(int watts)
 void
 GoogleMapControl::drawShadedRoute()
 {
-    int intervalTime = 60;  // 60 seconds
-    double rtime=0; // running total for accumulated data
-    int count=0;  // how many samples ?
-    int rwatts=0; // running total of watts
-    double prevtime=0; // time for previous point
-
+    // a line for each minute coloured by its average power, simplified
+    // and encoded, and all sent in one go
     QString code;
-
-    foreach(RideFilePoint *rfp, myRideItem->ride()->dataPoints()) {
-
-        if (count == 0) {
-            code = QString("{\nvar polyline = new google.maps.Polyline();\n"
-                   "   polyline.setMap(map);\n"
-                   "   path = polyline.getPath();\n");
-        } else {
-            if (rfp->lat || rfp->lon)
-                code += QString("path.push(new google.maps.LatLng(%1,%2));\n").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
-        }
-
-        // running total of time
-        rtime += rfp->secs - prevtime;
-        rwatts += rfp->watts;
-        prevtime = rfp->secs;
-        count++;
-
-        // end of segment
-        if (rtime >= intervalTime) {
-
-            int avgWatts = rwatts / count;
-            QColor color = GetColor(avgWatts);
-            // thats this segment done, so finish off and
-            // add tooltip junk
-            count = rwatts = rtime = 0;
-
-            // color the polyline
-            code += QString("var polyOptions = {\n"
-                            "    strokeColor: '%1',\n"
-                            "    strokeWeight: 3,\n"
-                            "    strokeOpacity: 0.5,\n" // for out and backs, we need both
-                            "    zIndex: 0,\n"
-                            "}\n"
-                            "polyline.setOptions(polyOptions);\n"
-                            "}\n").arg(color.name());
-
-            view->page()->mainFrame()->evaluateJavaScript(code);
-        }
+    foreach(RouteGeometry::Stretch stretch, RouteGeometry::stretches(myRideItem->ride(), 60, RouteGeometry::MAPTOLERANCE)) {
+        QString encoded = RouteGeometry::encode(myRideItem->ride(), stretch.points);
+        code += QString("drawShaded('%1','%2');\n").arg(encoded.replace("\\", "\\\\")).arg(GetColor(stretch.watts).name());
     }
+    view->page()->mainFrame()->evaluateJavaScript(code);
 }
 
 //
@@ -568,16 +568,22 @@ WebBridge::getLatLons(int i)
 
                         // so this one is the interval we need.. lets
                         // snaffle up the points in this section
-                        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-                            if (p1->secs+rideItem->ride()->recIntSecs() > current->start
+                        const RideFile *ride = rideItem->ride();
+                        int from = -1, to = -1;
+                        for (int k=0; k<ride->dataPoints().count(); k++) {
+                            RideFilePoint *p1 = ride->dataPoints()[k];
+                            if (p1->secs+ride->recIntSecs() > current->start
                                 && p1->secs< current->stop) {
-
-                                if (p1->lat || p1->lon) {
-                                    latlons << p1->lat;
-                                    latlons << p1->lon;
-                                }
+                                if (from < 0) from = k;
+                                to = k;
                             }
                         }
+                        if (from < 0) return latlons;
+
+                        foreach (int k, RouteGeometry::simplify(ride, RouteGeometry::MAPTOLERANCE, from, to)) {
+                            latlons << ride->dataPoints()[k]->lat;
+                            latlons << ride->dataPoints()[k]->lon;
+                        }
                         return latlons;
                     }
                 }
@@ -586,11 +592,9 @@ WebBridge::getLatLons(int i)
     } else {
 
         // get latlons for entire route
-        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-            if (p1->lat || p1->lon) {
-                latlons << p1->lat;
-                latlons << p1->lon;
-            }
+        foreach (int k, RouteGeometry::simplify(rideItem->ride(), RouteGeometry::MAPTOLERANCE)) {
+            latlons << rideItem->ride()->dataPoints()[k]->lat;
+            latlons << rideItem->ride()->dataPoints()[k]->lon;
         }
     }
     return latlons;
@@ -87,7 +87,7 @@ HistogramWindow::HistogramWindow(Context *context, bool rangemode) : GcChartWind
 
     setChartLayout(vlayout);
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     // search filter box
     isfiltered = false;
     searchBox = new SearchFilterBox(this, context);
@@ -944,7 +944,7 @@ HistogramWindow::updateChart()
 
                 // plotting a data series, so refresh the ridefilecache
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
                 source = new RideFileCache(context, use.from, use.to, isfiltered, files, rangemode);
 #else
                 source = new RideFileCache(context, use.from, use.to);
@@ -990,7 +990,7 @@ HistogramWindow::updateChart()
                 powerHist->setSeries(RideFile::none);
                 powerHist->setDelta(getDelta());
                 powerHist->setDigits(getDigits());
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
                 powerHist->setData(results, totalMetric(), distMetric(), isfiltered, files, &powerHist->standard);
 #else
                 powerHist->setData(results, totalMetric(), distMetric(), false, QStringList(), &powerHist->standard);
@@ -1030,7 +1030,7 @@ HistogramWindow::updateChart()
     } // if stale
 }
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
 void 
 HistogramWindow::clearFilter()
 {
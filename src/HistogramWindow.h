@@ -40,7 +40,7 @@
 #include "Season.h"
 #include "SeasonParser.h"
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
 #include "SearchFilterBox.h"
 #endif
 
@@ -69,7 +69,7 @@ class HistogramWindow : public GcChartWindow
     Q_PROPERTY(bool shade READ shade WRITE setShade USER true)
     Q_PROPERTY(bool zoned READ zoned WRITE setZoned USER true)
     Q_PROPERTY(bool cpZoned READ cpZoned WRITE setCPZoned USER true)
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     Q_PROPERTY(QString filter READ filter WRITE setFilter USER true)
 #endif
     Q_PROPERTY(QDate fromDate READ fromDate WRITE setFromDate USER true)
@@ -109,7 +109,7 @@ class HistogramWindow : public GcChartWindow
         void setCPZoned(bool x) { return showInCPZones->setChecked(x); }
         bool zoned() const { return showInZones->isChecked(); }
         void setZoned(bool x) { return showInZones->setChecked(x); }
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         bool isFiltered() const { if (rangemode) return (isfiltered || context->ishomefiltered || context->isfiltered);
                                   else return false; }
         QString filter() const { return searchBox->filter(); }
@@ -155,7 +155,7 @@ class HistogramWindow : public GcChartWindow
         void rideAddorRemove(RideItem*);
         void intervalSelected();
         void zonesChanged();
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         void clearFilter();
         void setFilter(QStringList files);
 #endif
@@ -222,7 +222,7 @@ class HistogramWindow : public GcChartWindow
         QDate cfrom, cto;
         RideFileCache *source;
         bool interval;
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         SearchFilterBox *searchBox;
         bool isfiltered;
         QStringList files;
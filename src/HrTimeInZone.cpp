@@ -23,7 +23,7 @@
 #include <math.h>
 #include <QApplication>
 
-class HrZoneTime : public RideMetric {
+class HrZoneTime : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(HrZoneTime)
     int level;
     double seconds;
@@ -42,20 +42,17 @@ public:
         setConversion(1.0);
     }
     void setLevel(int level) { this->level=level-1; } // zones start from zero not 1
-    void compute(const RideFile *ride, const Zones *, int, const HrZones *hrZone, int hrZoneRange,
-                 const QHash<QString,RideMetric*> &, const Context *)
-    {
+    void begin(const RideMetricPass &) {
         seconds = 0;
-        // get zone ranges
-        if (hrZone && hrZoneRange >= 0) {
-            // iterate and compute
-            foreach(const RideFilePoint *point, ride->dataPoints()) {
-                if (hrZone->whichZone(hrZoneRange, point->hr) == level)
-                    seconds += ride->recIntSecs();
-            }
-        }
+    }
+    void sample(const RideMetricPass &pass) {
+        // pass.hrZone is -1 if there are no zones for this ride
+        if (pass.hrZone == level) seconds += pass.secs;
+    }
+    void end(const RideMetricPass &) {
         setValue(seconds);
     }
+    bool wantsHrZone() const { return true; }
 
     bool canAggregate() { return false; }
     void aggregateWith(const RideMetric &) {}
@@ -36,30 +36,39 @@
 
 #include "JsonRideFile.h"
 
-// Set during parser processing, using same
-// naming conventions as yacc/lex -p
-static RideFile *JsonRide;
-
-// term state data is held in these variables
-static RideFilePoint JsonPoint;
-static RideFileInterval JsonInterval;
-static RideFileCalibration JsonCalibration;
-static QString JsonString,
-               JsonTagKey, JsonTagValue,
-               JsonOverName, JsonOverKey, JsonOverValue;
-static double JsonNumber;
-static QStringList JsonRideFileerrors;
-static QMap <QString, QString> JsonOverrides;
+// The parser and lexer are reentrant so rides can be read on more than
+// one thread at a time, the state for each parse is held in one of these
+// and passed to the parser, which passes the scanner on to the lexer
+struct JsonContext {
+
+    void *scanner; // the lexer's
+
+    // Set during parser processing, using same
+    // naming conventions as yacc/lex -p
+    RideFile *JsonRide;
+
+    // term state data is held in these variables
+    RideFilePoint JsonPoint;
+    RideFileInterval JsonInterval;
+    RideFileCalibration JsonCalibration;
+    QString JsonString,
+            JsonTagKey, JsonTagValue,
+            JsonOverName, JsonOverKey, JsonOverValue;
+    double JsonNumber;
+    QStringList JsonRideFileerrors;
+    QMap <QString, QString> JsonOverrides;
+};
 
 // Lex scanner
-extern int JsonRideFilelex(); // the lexer aka yylex()
-extern void JsonRideFile_setString(QString);
-extern int JsonRideFilelex_destroy(void); // the cleaner for lexer
+extern int JsonRideFilelex(void *lvalp, void *scanner); // the lexer aka yylex()
+extern int JsonRideFilelex_init(void **scanner);
+extern void JsonRideFile_setString(QString, void *scanner);
+extern int JsonRideFilelex_destroy(void *scanner); // the cleaner for lexer
 
 // yacc parser
-extern char *JsonRideFiletext; // set by the lexer aka yytext
-void JsonRideFileerror(const char *error) // used by parser aka yyerror()
-{ JsonRideFileerrors << error; }
+extern char *JsonRideFileget_text(void *scanner); // set by the lexer aka yytext
+void JsonRideFileerror(struct JsonContext *jc, const char *error) // used by parser aka yyerror()
+{ jc->JsonRideFileerrors << error; }
 
 //
 // Utility functions
@@ -103,8 +112,15 @@ static QString unprotect(const QString string)
     return s;
 }
 
+// the grammar reaches the scanner through its context
+#define scanner jc->scanner
+
 %}
 
+%pure-parser
+%parse-param { struct JsonContext *jc }
+%lex-param { void *scanner }
+
 %token JS_STRING JS_INTEGER JS_FLOAT
 %token RIDE STARTTIME RECINTSECS DEVICETYPE IDENTIFIER
 %token OVERRIDES
@@ -147,13 +163,13 @@ rideelement: starttime
  * First class variables
  */
 starttime: STARTTIME ':' string         {
-                                          QDateTime aslocal = QDateTime::fromString(JsonString, DATETIME_FORMAT);
+                                          QDateTime aslocal = QDateTime::fromString(jc->JsonString, DATETIME_FORMAT);
                                           QDateTime asUTC = QDateTime(aslocal.date(), aslocal.time(), Qt::UTC);
-                                          JsonRide->setStartTime(asUTC.toLocalTime());
+                                          jc->JsonRide->setStartTime(asUTC.toLocalTime());
                                         }
-recordint: RECINTSECS ':' number        { JsonRide->setRecIntSecs(JsonNumber); }
-devicetype: DEVICETYPE ':' string       { JsonRide->setDeviceType(JsonString); }
-identifier: IDENTIFIER ':' string       { JsonRide->setId(JsonString); }
+recordint: RECINTSECS ':' number        { jc->JsonRide->setRecIntSecs(jc->JsonNumber); }
+devicetype: DEVICETYPE ':' string       { jc->JsonRide->setDeviceType(jc->JsonString); }
+identifier: IDENTIFIER ':' string       { jc->JsonRide->setId(jc->JsonString); }
 
 /*
  * Metric Overrides
@@ -161,40 +177,40 @@ identifier: IDENTIFIER ':' string       { JsonRide->setId(JsonString); }
 overrides: OVERRIDES ':' '[' overrides_list ']' ;
 overrides_list: override | overrides_list ',' override ;
 
-override: '{' override_name ':' override_values '}' { JsonRide->metricOverrides.insert(JsonOverName, JsonOverrides);
-                                                      JsonOverrides.clear();
+override: '{' override_name ':' override_values '}' { jc->JsonRide->metricOverrides.insert(jc->JsonOverName, jc->JsonOverrides);
+                                                      jc->JsonOverrides.clear();
                                                     }
-override_name: string                   { JsonOverName = JsonString; }
+override_name: string                   { jc->JsonOverName = jc->JsonString; }
 
 override_values: '{' override_value_list '}';
 override_value_list: override_value | override_value_list ',' override_value ;
-override_value: override_key ':' override_value { JsonOverrides.insert(JsonOverKey, JsonOverValue); }
-override_key : string                   { JsonOverKey = JsonString; }
-override_value : string                 { JsonOverValue = JsonString; }
+override_value: override_key ':' override_value { jc->JsonOverrides.insert(jc->JsonOverKey, jc->JsonOverValue); }
+override_key : string                   { jc->JsonOverKey = jc->JsonString; }
+override_value : string                 { jc->JsonOverValue = jc->JsonString; }
 
 /*
  * Ride metadata tags
  */
 tags: TAGS ':' '{' tags_list '}'
 tags_list: tag | tags_list ',' tag ;
-tag: tag_key ':' tag_value              { JsonRide->setTag(JsonTagKey, JsonTagValue); }
+tag: tag_key ':' tag_value              { jc->JsonRide->setTag(jc->JsonTagKey, jc->JsonTagValue); }
 
-tag_key : string                        { JsonTagKey = JsonString; }
-tag_value : string                      { JsonTagValue = JsonString; }
+tag_key : string                        { jc->JsonTagKey = jc->JsonString; }
+tag_value : string                      { jc->JsonTagValue = jc->JsonString; }
 
 /*
  * Intervals
  */
 intervals: INTERVALS ':' '[' interval_list ']' ;
 interval_list: interval | interval_list ',' interval ;
-interval: '{' NAME ':' string ','       { JsonInterval.name = JsonString; }
-              START ':' number ','      { JsonInterval.start = JsonNumber; }
-              STOP ':' number           { JsonInterval.stop = JsonNumber; }
+interval: '{' NAME ':' string ','       { jc->JsonInterval.name = jc->JsonString; }
+              START ':' number ','      { jc->JsonInterval.start = jc->JsonNumber; }
+              STOP ':' number           { jc->JsonInterval.stop = jc->JsonNumber; }
           '}'
-                                        { JsonRide->addInterval(JsonInterval.start,
-                                                                JsonInterval.stop,
-                                                                JsonInterval.name);
-                                          JsonInterval = RideFileInterval();
+                                        { jc->JsonRide->addInterval(jc->JsonInterval.start,
+                                                                    jc->JsonInterval.stop,
+                                                                    jc->JsonInterval.name);
+                                          jc->JsonInterval = RideFileInterval();
                                         }
 
 /*
@@ -202,14 +218,14 @@ interval: '{' NAME ':' string ','       { JsonInterval.name = JsonString; }
  */
 calibrations: CALIBRATIONS ':' '[' calibration_list ']' ;
 calibration_list: calibration | calibration_list ',' calibration ;
-calibration: '{' NAME ':' string ','    { JsonCalibration.name = JsonString; }
-                 START ':' number ','   { JsonCalibration.start = JsonNumber; }
-                 VALUE ':' number       { JsonCalibration.value = JsonNumber; }
+calibration: '{' NAME ':' string ','    { jc->JsonCalibration.name = jc->JsonString; }
+                 START ':' number ','   { jc->JsonCalibration.start = jc->JsonNumber; }
+                 VALUE ':' number       { jc->JsonCalibration.value = jc->JsonNumber; }
              '}'
-                                        { JsonRide->addCalibration(JsonCalibration.start,
-                                                                   JsonCalibration.value,
-                                                                   JsonCalibration.name);
-                                          JsonCalibration = RideFileCalibration();
+                                        { jc->JsonRide->addCalibration(jc->JsonCalibration.start,
+                                                                       jc->JsonCalibration.value,
+                                                                       jc->JsonCalibration.name);
+                                          jc->JsonCalibration = RideFileCalibration();
                                         }
 
 
@@ -218,11 +234,11 @@ calibration: '{' NAME ':' string ','    { JsonCalibration.name = JsonString; }
  */
 references: REFERENCES ':' '[' reference_list ']'
                                         {
-                                          JsonPoint = RideFilePoint();
+                                          jc->JsonPoint = RideFilePoint();
                                         }
 reference_list: reference | reference_list ',' reference;
-reference: '{' series '}'               { JsonRide->appendReference(JsonPoint);
-                                          JsonPoint = RideFilePoint();
+reference: '{' series '}'               { jc->JsonRide->appendReference(jc->JsonPoint);
+                                          jc->JsonPoint = RideFilePoint();
                                         }
 
 /*
@@ -230,44 +246,46 @@ reference: '{' series '}'               { JsonRide->appendReference(JsonPoint);
  */
 samples: SAMPLES ':' '[' sample_list ']' ;
 sample_list: sample | sample_list ',' sample ;
-sample: '{' series_list '}'             { JsonRide->appendPoint(JsonPoint.secs, JsonPoint.cad,
-                                                    JsonPoint.hr, JsonPoint.km, JsonPoint.kph,
-                                                    JsonPoint.nm, JsonPoint.watts, JsonPoint.alt,
-                                                    JsonPoint.lon, JsonPoint.lat,
-                                                    JsonPoint.headwind,
-                                                    JsonPoint.slope, JsonPoint.temp, JsonPoint.lrbalance,
-                                                    JsonPoint.interval);
-                                          JsonPoint = RideFilePoint();
+sample: '{' series_list '}'             { jc->JsonRide->appendPoint(jc->JsonPoint.secs, jc->JsonPoint.cad,
+                                                        jc->JsonPoint.hr, jc->JsonPoint.km, jc->JsonPoint.kph,
+                                                        jc->JsonPoint.nm, jc->JsonPoint.watts, jc->JsonPoint.alt,
+                                                        jc->JsonPoint.lon, jc->JsonPoint.lat,
+                                                        jc->JsonPoint.headwind,
+                                                        jc->JsonPoint.slope, jc->JsonPoint.temp, jc->JsonPoint.lrbalance,
+                                                        jc->JsonPoint.interval);
+                                          jc->JsonPoint = RideFilePoint();
                                         }
 
 series_list: series | series_list ',' series ;
-series: SECS ':' number                 { JsonPoint.secs = JsonNumber; }
-        | KM ':' number                 { JsonPoint.km = JsonNumber; }
-        | WATTS ':' number              { JsonPoint.watts = JsonNumber; }
-        | NM ':' number                 { JsonPoint.nm = JsonNumber; }
-        | CAD ':' number                { JsonPoint.cad = JsonNumber; }
-        | KPH ':' number                { JsonPoint.kph = JsonNumber; }
-        | HR ':' number                 { JsonPoint.hr = JsonNumber; }
-        | ALTITUDE ':' number           { JsonPoint.alt = JsonNumber; }
-        | LAT ':' number                { JsonPoint.lat = JsonNumber; }
-        | LON ':' number                { JsonPoint.lon = JsonNumber; }
-        | HEADWIND ':' number           { JsonPoint.headwind = JsonNumber; }
-        | SLOPE ':' number              { JsonPoint.slope = JsonNumber; }
-        | TEMP ':' number               { JsonPoint.temp = JsonNumber; }
-        | LRBALANCE ':' number          { JsonPoint.lrbalance = JsonNumber; }
+series: SECS ':' number                 { jc->JsonPoint.secs = jc->JsonNumber; }
+        | KM ':' number                 { jc->JsonPoint.km = jc->JsonNumber; }
+        | WATTS ':' number              { jc->JsonPoint.watts = jc->JsonNumber; }
+        | NM ':' number                 { jc->JsonPoint.nm = jc->JsonNumber; }
+        | CAD ':' number                { jc->JsonPoint.cad = jc->JsonNumber; }
+        | KPH ':' number                { jc->JsonPoint.kph = jc->JsonNumber; }
+        | HR ':' number                 { jc->JsonPoint.hr = jc->JsonNumber; }
+        | ALTITUDE ':' number           { jc->JsonPoint.alt = jc->JsonNumber; }
+        | LAT ':' number                { jc->JsonPoint.lat = jc->JsonNumber; }
+        | LON ':' number                { jc->JsonPoint.lon = jc->JsonNumber; }
+        | HEADWIND ':' number           { jc->JsonPoint.headwind = jc->JsonNumber; }
+        | SLOPE ':' number              { jc->JsonPoint.slope = jc->JsonNumber; }
+        | TEMP ':' number               { jc->JsonPoint.temp = jc->JsonNumber; }
+        | LRBALANCE ':' number          { jc->JsonPoint.lrbalance = jc->JsonNumber; }
         ;
 
 /*
  * Primitives
  */
-number: JS_INTEGER                         { JsonNumber = QString(JsonRideFiletext).toInt(); }
-        | JS_FLOAT                         { JsonNumber = QString(JsonRideFiletext).toDouble(); }
+number: JS_INTEGER                         { jc->JsonNumber = QString(JsonRideFileget_text(scanner)).toInt(); }
+        | JS_FLOAT                         { jc->JsonNumber = QString(JsonRideFileget_text(scanner)).toDouble(); }
         ;
 
-string: JS_STRING                          { JsonString = unprotect(JsonRideFiletext); }
+string: JS_STRING                          { jc->JsonString = unprotect(JsonRideFileget_text(scanner)); }
         ;
 %%
 
+// only the grammar above uses the context's scanner
+#undef scanner
 
 static int jsonFileReaderRegistered =
     RideFileFactory::instance().registerReader(
@@ -293,12 +311,14 @@ JsonFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*
         return NULL; 
     }
 
-    // inform the parser/lexer we have a new file
-    JsonRideFile_setString(contents);
+    // setup, the state for this parse
+    struct JsonContext jc;
+    jc.JsonRide = new RideFile;
+    jc.JsonNumber = 0;
+    JsonRideFilelex_init(&jc.scanner);
 
-    // setup
-    JsonRide = new RideFile;
-    JsonRideFileerrors.clear();
+    // inform the parser/lexer we have a new file
+    JsonRideFile_setString(contents, jc.scanner);
 
     // set to non-zero if you want to
     // to debug the yyparse() state machine
@@ -306,17 +326,17 @@ JsonFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*
     //yydebug = 0;
 
     // parse it
-    JsonRideFileparse();
+    JsonRideFileparse(&jc);
 
     // clean up
-    JsonRideFilelex_destroy();
+    JsonRideFilelex_destroy(jc.scanner);
 
     // Only get errors so fail if we have any
     if (errors.count()) {
-        errors << JsonRideFileerrors;
-        delete JsonRide;
+        errors << jc.JsonRideFileerrors;
+        delete jc.JsonRide;
         return NULL;
-    } else return JsonRide;
+    } else return jc.JsonRide;
 }
 
 // Writes valid .json (validated at www.jsonlint.com)
@@ -17,6 +17,7 @@
  */
 
 #include "Kickr.h"
+#include "GcTrace.h"
 
 Kickr::Kickr(QObject *parent,  DeviceConfiguration *devConf) : QThread(parent)
 {
@@ -177,6 +178,7 @@ void Kickr::run()
 
             // get telemetry
             if (WFApi::getInstance()->hasData(sd)) {
+                GC_TRACE("Kickr::telemetry", "train");
                 pvars.lock();
                 WFApi::getInstance()->getRealtimeData(sd, &rt);
 
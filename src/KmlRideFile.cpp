@@ -18,6 +18,7 @@
 
 
 #include "KmlRideFile.h"
+#include "RouteGeometry.h"
 #include <QDebug>
 
 #include <time.h>
@@ -214,10 +215,16 @@ KmlFileReader::writeRideFile(Context *, const RideFile * ride, QFile &file) cons
                              .arg(ride->startTime().toString()).toStdString(), track);
     folder->add_feature(placemark);
 
+    // the samples that still change the route, the others are on
+    // the lines between them and just make the file bigger
+    QVector<RideFilePoint*> route;
+    foreach (int index, RouteGeometry::simplify(ride, RouteGeometry::EXPORTTOLERANCE))
+        route << ride->dataPoints()[index];
+
     //
     // Basic Data -- Lat/Lon/Alt and Timestamp
     //
-    foreach (RideFilePoint *datapoint, ride->dataPoints()) {
+    foreach (RideFilePoint *datapoint, route) {
 
         // lots of arsing around with dates 
         QDateTime timestamp(ride->startTime().addSecs(datapoint->secs));
@@ -227,7 +234,7 @@ KmlFileReader::writeRideFile(Context *, const RideFile * ride, QFile &file) cons
     }
 
     // <when> loop through the entire ride
-    foreach (RideFilePoint *datapoint, ride->dataPoints()) {
+    foreach (RideFilePoint *datapoint, route) {
         if (datapoint->lat && datapoint->lon) track->add_gx_coord(kmlbase::Vec3(datapoint->lon, datapoint->lat, datapoint->alt));
     }
 
@@ -245,7 +252,7 @@ KmlFileReader::writeRideFile(Context *, const RideFile * ride, QFile &file) cons
         schema->add_gx_simplearraydata(power);
 
         // now create a GxSimpleArrayData
-        foreach (RideFilePoint *datapoint, ride->dataPoints()) {
+        foreach (RideFilePoint *datapoint, route) {
             if (datapoint->lat && datapoint->lon) power->add_gx_value(QString("%1").arg(datapoint->watts).toStdString());
         }
     }
@@ -255,7 +262,7 @@ KmlFileReader::writeRideFile(Context *, const RideFile * ride, QFile &file) cons
         schema->add_gx_simplearraydata(cadence);
 
         // now create a GxSimpleArrayData
-        foreach (RideFilePoint *datapoint, ride->dataPoints()) {
+        foreach (RideFilePoint *datapoint, route) {
             if (datapoint->lat && datapoint->lon) cadence->add_gx_value(QString("%1").arg(datapoint->cad).toStdString());
         }
     }
@@ -265,7 +272,7 @@ KmlFileReader::writeRideFile(Context *, const RideFile * ride, QFile &file) cons
         schema->add_gx_simplearraydata(heartrate);
 
         // now create a GxSimpleArrayData
-        foreach (RideFilePoint *datapoint, ride->dataPoints()) {
+        foreach (RideFilePoint *datapoint, route) {
             if (datapoint->lat && datapoint->lon) heartrate->add_gx_value(QString("%1").arg(datapoint->hr).toStdString());
         }
     }
@@ -275,7 +282,7 @@ KmlFileReader::writeRideFile(Context *, const RideFile * ride, QFile &file) cons
         schema->add_gx_simplearraydata(torque);
 
         // now create a GxSimpleArrayData
-        foreach (RideFilePoint *datapoint, ride->dataPoints()) {
+        foreach (RideFilePoint *datapoint, route) {
             if (datapoint->lat && datapoint->lon) torque->add_gx_value(QString("%1").arg(datapoint->nm).toStdString());
         }
     }
@@ -285,7 +292,7 @@ KmlFileReader::writeRideFile(Context *, const RideFile * ride, QFile &file) cons
         schema->add_gx_simplearraydata(headwind);
 
         // now create a GxSimpleArrayData
-        foreach (RideFilePoint *datapoint, ride->dataPoints()) {
+        foreach (RideFilePoint *datapoint, route) {
             if (datapoint->lat && datapoint->lon) headwind->add_gx_value(QString("%1").arg(datapoint->headwind).toStdString());
         }
     }
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "LTMAggregate.h"
+#include "GcTrace.h"
+
+#include <math.h>
+
+LTMAggregate::LTMAggregate(const MetricSlice &rides, const QVector<int> &groups, int last)
+    : rides(rides), groups(groups), last(last)
+{
+    // anything off the chart is left out
+    this->groups.resize(rides.count());
+    for (int i=0; i<rides.count(); i++)
+        if (this->groups[i] > last) this->groups[i] = -1;
+}
+
+// the value of a ride, bounded to stop QWT going berserk, and converted
+static inline double valueFor(const double *column, int i, double scale, double offset)
+{
+    double value = column ? column[i] : 0;
+    if (isnan(value) || isinf(value)) value = 0;
+    return value * scale + offset;
+}
+
+void
+LTMAggregate::reduce(QList<Series*> series) const
+{
+    GC_TRACE("LTMAggregate::reduce", "chart");
+    GC_TRACE_COUNTER("series", series.count());
+
+    int count = rides.count();
+    int size = last + 1;
+
+    // to weight the averages
+    const double *secs = rides.values("workout_time");
+
+    // the accumulators are reused for each series
+    QVector<double> total(size), weight(size), plain(size);
+    QVector<int> rideCount(size);
+
+    for (int s=0; s<series.count(); s++) {
+        Series *p = series[s];
+
+        // read in place, the store's column for this metric
+        const double *column = rides.values(p->symbol);
+        const int *group = groups.constData();
+        double scale = p->scale, offset = p->offset;
+
+        total.fill(0);
+        weight.fill(0);
+        plain.fill(0);
+        rideCount.fill(0);
+
+        // the kernels
+        switch (p->kernel) {
+        case Sum:
+            for (int i=0; i<count; i++) {
+                int g = group[i];
+                if (g < 0) continue;
+                double value = valueFor(column, i, scale, offset);
+                if (value == 0 && !p->zeroes) continue;
+                total[g] += value;
+                rideCount[g]++;
+            }
+            break;
+
+        case Mean:
+            // weighted by duration, otherwise high value but short
+            // rides will skew the overall average
+            for (int i=0; i<count; i++) {
+                int g = group[i];
+                if (g < 0) continue;
+                double value = valueFor(column, i, scale, offset);
+                if (value == 0 && !p->zeroes) continue;
+                double seconds = secs ? secs[i] : 0;
+                total[g] += value * seconds;
+                weight[g] += seconds;
+                plain[g] += value;
+                rideCount[g]++;
+            }
+            for (int g=0; g<size; g++) {
+                if (weight[g] > 0) total[g] /= weight[g];
+                else if (rideCount[g]) total[g] = plain[g] / rideCount[g];
+            }
+            break;
+
+        case Max:
+            for (int i=0; i<count; i++) {
+                int g = group[i];
+                if (g < 0) continue;
+                double value = valueFor(column, i, scale, offset);
+                if (value == 0 && !p->zeroes) continue;
+                if (rideCount[g]++ == 0 || value > total[g]) total[g] = value;
+            }
+            break;
+
+        case Min:
+            for (int i=0; i<count; i++) {
+                int g = group[i];
+                if (g < 0) continue;
+                double value = valueFor(column, i, scale, offset);
+                if (value == 0 && !p->zeroes) continue;
+                if (rideCount[g]++ == 0 || value < total[g]) total[g] = value;
+            }
+            break;
+        }
+
+        // one for start from zero plus two for 0 value added at head and tail
+        p->x.resize(size + 2);
+        p->y.resize(size + 2);
+        p->n = -1;
+
+        int previous = -1;
+        for (int g=0; g<size; g++) {
+            if (rideCount[g] == 0) continue;
+
+            // bars are zero for the empty groups in between
+            if (p->zeroes && previous >= 0) {
+                for (int gap=previous+1; gap<g; gap++) {
+                    p->n++;
+                    p->x[p->n] = gap;
+                    p->y[p->n] = 0;
+                }
+            }
+            p->n++;
+            p->x[p->n] = g;
+            p->y[p->n] = total[g];
+            previous = g;
+        }
+    }
+}
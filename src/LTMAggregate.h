@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_LTMAggregate_h
+#define _GC_LTMAggregate_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QList>
+#include <QString>
+
+#include "MetricStore.h"
+
+// Groups the rides on a season chart into days, weeks, months or years
+// and reduces them to a value per group for each curve.
+//
+// The group each ride is in is worked out once when the chart is drawn
+// rather than again for each curve. The values for each curve are taken
+// from the metric store's column for it and reduced in a tight loop with
+// no per ride decisions about the type of metric.
+//
+class LTMAggregate
+{
+    public:
+        // as RideMetric::MetricType, Mean is weighted by duration
+        enum kernel { Sum, Mean, Max, Min };
+        typedef enum kernel Kernel;
+
+        // groups[i] is the group for ride i of the slice, from zero at
+        // the start of the chart to last, or -1 to leave it out
+        LTMAggregate(const MetricSlice &rides, const QVector<int> &groups, int last);
+
+        // a curve to reduce, the value for each ride is converted as
+        // value * scale + offset, e.g. to imperial units and seconds
+        // to hours, zero values are ignored unless we want zeroes and
+        // then empty groups after the first are zero too, for bars
+        struct Series {
+            QString symbol;
+            Kernel kernel;
+            double scale, offset;
+            bool zeroes;
+
+            // the groups with values, as createCurveData
+            QVector<double> x, y;
+            int n; // last used, -1 if none
+        };
+
+        // fill in the x, y and n for each of the series
+        void reduce(QList<Series*> series) const;
+
+    private:
+        MetricSlice rides;
+        QVector<int> groups;
+        int last;
+};
+
+#endif // _GC_LTMAggregate_h
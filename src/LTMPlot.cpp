@@ -19,6 +19,8 @@
 #include "Athlete.h"
 #include "Context.h"
 #include "LTMPlot.h"
+#include "LTMAggregate.h"
+#include "GcTrace.h"
 #include "LTMTool.h"
 #include "LTMTrend.h"
 #include "LTMTrend2.h"
@@ -116,6 +118,7 @@ LTMPlot::LTMPlot(LTMWindow *parent, Context *context, bool first) :
 
     settings = NULL;
     cogganPMC = skibaPMC = NULL; // cache when replotting a PMC
+    preparedFor = NULL;
 
     configUpdate(); // set basic colors
 
@@ -177,6 +180,8 @@ LTMPlot::resetPMC()
 void
 LTMPlot::setData(LTMSettings *set)
 {
+    GC_TRACE("LTMPlot::setData", "chart");
+
     QTime timer;
     timer.start();
 
@@ -197,18 +202,18 @@ LTMPlot::setData(LTMSettings *set)
 
         // end
         if (settings->end == QDateTime() ||
-            settings->end > (*settings->data).last().getRideDate().addDays(365)) {
+            settings->end > settings->data->rideDate(settings->data->count()-1).addDays(365)) {
             if (settings->end < QDateTime::currentDateTime()) {
                 settings->end = QDateTime::currentDateTime();
             } else {
-                settings->end = (*settings->data).last().getRideDate();
+                settings->end = settings->data->rideDate(settings->data->count()-1);
             }
         }
 
         // start
         if (settings->start == QDateTime() ||
-            settings->start < (*settings->data).first().getRideDate().addDays(-365)) {
-            settings->start = (*settings->data).first().getRideDate();
+            settings->start < settings->data->rideDate(0).addDays(-365)) {
+            settings->start = settings->data->rideDate(0);
         }
     }
 
@@ -284,6 +289,9 @@ LTMPlot::setData(LTMSettings *set)
         return;
     }
 
+    // reduce the metric curves together
+    prepareCurveData(context, settings);
+
     //qDebug()<<"Wiped previous.."<<timer.elapsed();
 
     // count the bars since we format them side by side and need
@@ -1222,9 +1230,10 @@ LTMPlot::setCompareData(LTMSettings *set)
         // For each metric in chart, translate units and name if default uname
         //XXX BROKEN XXX LTMTool::translateMetrics(context, settings);
 
-        // set the settings data source to the compare date range 
-        // QList<SummaryMetrics> metrics, measures;
-        settings->data = &cd.metrics;
+        // set the settings data source to the compare date range,
+        // the metrics are from its athlete's metric store
+        compared = LTMRides(cd.sourceContext->athlete->metricDB->getMetricSlice(settings->start, settings->end));
+        settings->data = &compared;
         settings->measures = &cd.measures;
 
         // we need to do this for each date range as they are dependant
@@ -1241,18 +1250,18 @@ LTMPlot::setCompareData(LTMSettings *set)
 
             // end
             if (settings->end == QDateTime() ||
-                settings->end > (*settings->data).last().getRideDate().addDays(365)) {
+                settings->end > settings->data->rideDate(settings->data->count()-1).addDays(365)) {
                 if (settings->end < QDateTime::currentDateTime()) {
                     settings->end = QDateTime::currentDateTime();
                 } else {
-                    settings->end = (*settings->data).last().getRideDate();
+                    settings->end = settings->data->rideDate(settings->data->count()-1);
                 }
             }
 
             // start
             if (settings->start == QDateTime() ||
-                settings->start < (*settings->data).first().getRideDate().addDays(-365)) {
-                settings->start = (*settings->data).first().getRideDate();
+                settings->start < settings->data->rideDate(0).addDays(-365)) {
+                settings->start = settings->data->rideDate(0);
             }
         }
 
@@ -1280,6 +1289,8 @@ LTMPlot::setCompareData(LTMSettings *set)
         setAxisVisible(QwtAxis::xBottom, true);
         setAxisVisible(QwtAxis::xTop, false);
 
+        // reduce the metric curves together for this date range
+        prepareCurveData(cd.sourceContext, settings);
 
         //qDebug()<<"Wiped previous.."<<timer.elapsed();
 
@@ -2174,12 +2185,16 @@ LTMPlot::createTODCurveData(Context *context, LTMSettings *settings, MetricDetai
 
     for (int i=0; i<(24); i++) x[i]=i;
 
-    foreach (SummaryMetrics rideMetrics, *(settings->data)) {
+    // straight from the metric store's column
+    const LTMRides &rides = *(settings->data);
+    const double *values = rides.values(metricDetail.symbol);
+
+    for (int i=0; i<rides.count(); i++) {
 
         // filter out unwanted rides
-        if (context->isfiltered && !context->filters.contains(rideMetrics.getFileName())) continue;
+        if (context->isfiltered && !context->filters.contains(rides.fileName(i))) continue;
 
-        double value = rideMetrics.getForSymbol(metricDetail.symbol);
+        double value = values ? values[rides.row(i)] : 0;
 
         // check values are bounded to stop QWT going berserk
         if (isnan(value) || isinf(value)) value = 0;
@@ -2197,7 +2212,7 @@ LTMPlot::createTODCurveData(Context *context, LTMSettings *settings, MetricDetai
                 metricDetail.metric->units(true) == tr("seconds")) value /= 3600;
         }
 
-        int array = rideMetrics.getRideDate().time().hour();
+        int array = rides.rideDate(i).time().hour();
         int type = metricDetail.metric ? metricDetail.metric->type() : RideMetric::Average;
 
         if (metricDetail.uunits == "Ramp" ||
@@ -2225,6 +2240,14 @@ LTMPlot::createTODCurveData(Context *context, LTMSettings *settings, MetricDetai
     }
 }
 
+// the settings that change the values we get for a metric curve
+static QString preparedKey(MetricDetail metricDetail)
+{
+    return QString("%1|%2|%3").arg(metricDetail.symbol)
+                              .arg(metricDetail.uunits)
+                              .arg(metricDetail.curveStyle == QwtPlotCurve::Steps);
+}
+
 void
 LTMPlot::createCurveData(Context *context, LTMSettings *settings, MetricDetail metricDetail, QVector<double>&x,QVector<double>&y,int&n)
 {
@@ -2237,12 +2260,25 @@ LTMPlot::createCurveData(Context *context, LTMSettings *settings, MetricDetail m
     x.resize(maxdays+3); // one for start from zero plus two for 0 value added at head and tail
     y.resize(maxdays+3); // one for start from zero plus two for 0 value added at head and tail
 
-    // Get metric data, either from metricDB for RideFile metrics
-    // or from StressCalculator for PM type metrics
-    QList<SummaryMetrics> PMCdata;
+    // metrics are reduced together by prepareCurveData
     if (metricDetail.type == METRIC_DB || metricDetail.type == METRIC_META) {
-        data = settings->data;
-    } else if (metricDetail.type == METRIC_MEASURE) {
+        if (preparedFor != settings->data) prepareCurveData(context, settings);
+
+        QHash<QString, LTMAggregate::Series>::const_iterator it = prepared.find(preparedKey(metricDetail));
+        if (it != prepared.end()) {
+            x = it.value().x;
+            y = it.value().y;
+            n = it.value().n;
+        } else {
+            n = -1;
+        }
+        return;
+    }
+
+    // Get data from StressCalculator for PM type metrics
+    // or the measures and bests
+    QList<SummaryMetrics> PMCdata;
+    if (metricDetail.type == METRIC_MEASURE) {
         data = settings->measures;
     } else if (metricDetail.type == METRIC_PM) {
         createPMCCurveData(context, settings, metricDetail, PMCdata);
@@ -2346,6 +2382,80 @@ LTMPlot::createCurveData(Context *context, LTMSettings *settings, MetricDetail m
     }
 }
 
+void
+LTMPlot::prepareCurveData(Context *context, LTMSettings *settings)
+{
+    prepared.clear();
+    preparedFor = NULL;
+
+    if (settings->groupBy == LTM_TOD || settings->data == NULL) return;
+
+    // the group for each ride, worked out once rather than for each curve,
+    // by row of the slice so the metrics can be read from its columns
+    int start = groupForDate(settings->start.date(), settings->groupBy);
+    int last = groupForDate(settings->end.date(), settings->groupBy) - start;
+
+    const LTMRides &rides = *settings->data;
+    QVector<int> groups(rides.slice.count(), -1);
+    for (int i=0; i<rides.count(); i++) {
+        if (context->isfiltered && !context->filters.contains(rides.fileName(i))) continue;
+        groups[rides.row(i)] = groupForDate(rides.rideDate(i).date(), settings->groupBy) - start;
+    }
+
+    // a series for each metric curve, as createCurveData would
+    foreach (MetricDetail metricDetail, settings->metrics) {
+        if (metricDetail.type != METRIC_DB && metricDetail.type != METRIC_META) continue;
+
+        QString key = preparedKey(metricDetail);
+        if (prepared.contains(key)) continue;
+
+        LTMAggregate::Series add;
+        add.symbol = metricDetail.symbol;
+        add.scale = 1;
+        add.offset = 0;
+        add.zeroes = metricDetail.curveStyle == QwtPlotCurve::Steps;
+        add.n = -1;
+
+        // Special computed metrics (LTS/STS) have a null metric pointer
+        if (metricDetail.metric) {
+            // convert from stored metric value to imperial
+            if (context->athlete->useMetricUnits == false) {
+                add.scale = metricDetail.metric->conversion();
+                add.offset = metricDetail.metric->conversionSum();
+            }
+
+            // convert seconds to hours
+            if (metricDetail.metric->units(true) == "seconds" ||
+                metricDetail.metric->units(true) == tr("seconds")) {
+                add.scale /= 3600;
+                add.offset /= 3600;
+            }
+        }
+
+        // sum totals, average averages and choose best for Peaks
+        int type = metricDetail.metric ? metricDetail.metric->type() : RideMetric::Average;
+        if (metricDetail.uunits == "Ramp" ||
+            metricDetail.uunits == tr("Ramp")) type = RideMetric::Total;
+
+        switch (type) {
+        case RideMetric::Total: add.kernel = LTMAggregate::Sum; break;
+        default:
+        case RideMetric::Average: add.kernel = LTMAggregate::Mean; break;
+        case RideMetric::Low: add.kernel = LTMAggregate::Min; break;
+        case RideMetric::Peak: add.kernel = LTMAggregate::Max; break;
+        }
+        prepared.insert(key, add);
+    }
+    if (prepared.isEmpty()) return;
+
+    QList<LTMAggregate::Series*> series;
+    QHash<QString, LTMAggregate::Series>::iterator it;
+    for (it = prepared.begin(); it != prepared.end(); ++it) series << &it.value();
+
+    LTMAggregate(rides.slice, groups, last).reduce(series);
+    preparedFor = settings->data;
+}
+
 void
 LTMPlot::createPMCCurveData(Context *context, LTMSettings *settings, MetricDetail metricDetail,
                             QList<SummaryMetrics> &customData)
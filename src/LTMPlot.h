@@ -31,6 +31,7 @@
 #include "LTMTool.h"
 #include "LTMSettings.h"
 #include "LTMCanvasPicker.h"
+#include "LTMAggregate.h"
 #include "MetricAggregator.h"
 
 #include "Context.h"
@@ -108,6 +109,7 @@ class LTMPlot : public QwtPlot
         int groupForDate(QDate , int);
         void createCurveData(Context *,LTMSettings *, MetricDetail, QVector<double>&, QVector<double>&, int&);
         void createTODCurveData(Context *,LTMSettings *, MetricDetail, QVector<double>&, QVector<double>&, int&);
+        void prepareCurveData(Context *, LTMSettings *);
         void aggregateCurves(QVector<double> &a, QVector<double>&w); // aggregate a with w, updates a
         QwtAxisId chooseYAxis(QString);
         void refreshZoneLabels(QwtAxisId);
@@ -117,6 +119,14 @@ class LTMPlot : public QwtPlot
         // so it isn't recalculated for each data series!
         StressCalculator *cogganPMC, *skibaPMC;
 
+        // the metric curves, reduced together for the data we were
+        // last given rather than a ride at a time for each curve
+        QHash<QString, LTMAggregate::Series> prepared;
+        LTMRides *preparedFor;
+
+        // the rides for the compare date range we're on
+        LTMRides compared;
+
         QList<QwtAxisId> supportedAxes;
         bool first;
         int MAXX;
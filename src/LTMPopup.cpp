@@ -236,11 +236,13 @@ LTMPopup::setData(LTMSettings &settings, QDate start, QDate end)
          rides->setHorizontalHeaderItem(column++,h);
     }
 
-    foreach(SummaryMetrics x, (*settings.data)) {
-        QDateTime rideDate = x.getRideDate();
+    // only the rides in the group are copied out of the metric store
+    for (int i=0; settings.data && i<settings.data->count(); i++) {
+        QDateTime rideDate = settings.data->rideDate(i);
         if (rideDate.date() >= start && rideDate.date() <= end) {
 
             // we'll select it for summary aggregation
+            SummaryMetrics x = settings.data->ride(i);
             selected << x;
 
             // date/time
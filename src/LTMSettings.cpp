@@ -28,6 +28,28 @@
 #include <qwt_plot_curve.h>
 
 
+/*----------------------------------------------------------------------
+ * RIDES ON A CHART
+ *--------------------------------------------------------------------*/
+LTMRides::LTMRides(MetricSlice slice) : slice(slice)
+{
+    index.resize(slice.count());
+    for (int i=0; i<index.count(); i++) index[i] = i;
+}
+
+void
+LTMRides::filter(const QStringList &files)
+{
+    if (!slice.isValid()) return;
+
+    QSet<QString> wanted = files.toSet();
+    const QString *fileNames = slice.fileNames();
+
+    QVector<int> filtered;
+    foreach(int i, index) if (wanted.contains(fileNames[i])) filtered << i;
+    index = filtered;
+}
+
 /*----------------------------------------------------------------------
  * EDIT CHART DIALOG
  *--------------------------------------------------------------------*/
@@ -34,6 +34,7 @@
 #include <qwt_symbol.h>
 
 #include "RideFile.h" // for SeriesType
+#include "MetricStore.h" // for MetricSlice
 
 class LTMTool;
 class LTMSettings;
@@ -123,6 +124,36 @@ class MetricDetail {
 QDataStream &operator<<(QDataStream &out, const LTMSettings &settings);
 QDataStream &operator>>(QDataStream &in, LTMSettings &settings);
 
+// The rides on a season chart, a slice of the metric store and which
+// of them are left after the chart's filters. The metrics are read from
+// the store's columns, there is no copy of each ride.
+class LTMRides {
+
+    public:
+        LTMRides() {}
+        LTMRides(MetricSlice slice);
+
+        // keep just the rides in files
+        void filter(const QStringList &files);
+
+        // none when the store has changed since we were sliced
+        int count() const { return slice.isValid() ? index.count() : 0; }
+
+        // the i'th ride, as a row of the slice for reading its columns
+        int row(int i) const { return index[i]; }
+        QDateTime rideDate(int i) const { return slice.dates()[index[i]]; }
+        QString fileName(int i) const { return slice.fileNames()[index[i]]; }
+        SummaryMetrics ride(int i) const { return slice.ride(index[i]); }
+
+        // by row, or NULL if we don't have the symbol
+        const double *values(QString symbol) const { return slice.values(symbol); }
+
+        MetricSlice slice;
+
+    private:
+        QVector<int> index;
+};
+
 // used to maintain details about the metrics being plotted
 class LTMSettings {
 
@@ -131,7 +162,8 @@ class LTMSettings {
         LTMSettings() {
             // we need to register the stream operators
             qRegisterMetaTypeStreamOperators<LTMSettings>("LTMSettings");
-            data = measures = bests = NULL;
+            data = NULL;
+            measures = bests = NULL;
             ltmTool = NULL;
         }
 
@@ -151,7 +183,7 @@ class LTMSettings {
         int stackWidth;
 
         QList<MetricDetail> metrics;
-        QList<SummaryMetrics> *data;
+        LTMRides *data;
         QList<SummaryMetrics> *measures;
         QList<SummaryMetrics> *bests;
 
@@ -38,8 +38,12 @@
 // named searchs
 #include "NamedSearch.h"
 #include "DataFilter.h"
+#ifdef GC_HAVE_SEARCH
 #ifdef GC_HAVE_LUCENE
 #include "Lucene.h"
+#else
+#include "MetadataIndex.h"
+#endif
 #endif
 
 // metadata support
@@ -47,6 +51,7 @@
 #include "SpecialFields.h"
 
 #include "MetricAggregator.h"
+#include "RideFileCacheRefresher.h"
 #include "SummaryMetrics.h"
 
 LTMSidebar::LTMSidebar(Context *context) : QWidget(context->mainWindow), context(context), active(false),
@@ -104,7 +109,7 @@ LTMSidebar::LTMSidebar(Context *context) : QWidget(context->mainWindow), context
     eventsWidget->addWidget(eventTree);
 
     // filters
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     filtersWidget = new GcSplitterItem(tr("Filters"), iconFromPNG(":images/toolbar/filter3.png"), this);
     QAction *moreFilterAct = new QAction(iconFromPNG(":images/sidebar/extra.png"), tr("Menu"), this);
     filtersWidget->addAction(moreFilterAct);
@@ -145,7 +150,7 @@ LTMSidebar::LTMSidebar(Context *context) : QWidget(context->mainWindow), context
     splitter = new GcSplitter(Qt::Vertical);
     splitter->addWidget(seasonsWidget); // goes alongside events
     splitter->addWidget(eventsWidget); // goes alongside date ranges
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     splitter->addWidget(filtersWidget);
 #endif
 
@@ -167,6 +172,13 @@ LTMSidebar::LTMSidebar(Context *context) : QWidget(context->mainWindow), context
 
     mainLayout->addWidget(splitter);
 
+    // the CP and time in zone charts use the ride caches, so show how
+    // far the background refresh has got until it's done
+    cacheProgressBar = new QProgressBar(this);
+    cacheProgressBar->setFormat(tr("Updating ride caches %v of %m"));
+    cacheProgressBar->hide();
+    mainLayout->addWidget(cacheProgressBar);
+
     splitter->prepare(context->athlete->cyclist, "LTM");
 
     // our date ranges
@@ -174,13 +186,13 @@ LTMSidebar::LTMSidebar(Context *context) : QWidget(context->mainWindow), context
     connect(dateRangeTree,SIGNAL(customContextMenuRequested(const QPoint &)), this, SLOT(dateRangePopup(const QPoint &)));
     connect(dateRangeTree,SIGNAL(itemChanged(QTreeWidgetItem *,int)), this, SLOT(dateRangeChanged(QTreeWidgetItem*, int)));
     connect(dateRangeTree,SIGNAL(itemMoved(QTreeWidgetItem *,int, int)), this, SLOT(dateRangeMoved(QTreeWidgetItem*, int, int)));
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     connect(filterTree,SIGNAL(itemSelectionChanged()), this, SLOT(filterTreeWidgetSelectionChanged()));
 #endif
     connect(eventTree,SIGNAL(customContextMenuRequested(const QPoint &)), this, SLOT(eventPopup(const QPoint &)));
 
     // GC signal
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     connect(context->athlete->metricDB, SIGNAL(dataChanged()), this, SLOT(autoFilterRefresh()));
 #endif
     connect(context, SIGNAL(configChanged()), this, SLOT(configChanged()));
@@ -189,6 +201,11 @@ LTMSidebar::LTMSidebar(Context *context) : QWidget(context->mainWindow), context
 
     connect(this, SIGNAL(dateRangeChanged(DateRange)), this, SLOT(setSummary(DateRange)));
 
+    RideFileCacheRefresher *refresher = context->athlete->metricDB->cacheRefresher();
+    connect(refresher, SIGNAL(progress(int,int)), this, SLOT(cacheProgress(int,int)));
+    connect(refresher, SIGNAL(finished()), this, SLOT(cacheFinished()));
+    if (refresher->isRunning()) cacheProgress(refresher->done(), refresher->total());
+
     // let everyone know what date range we are starting with
     dateRangeTreeWidgetSelectionChanged();
 
@@ -457,7 +474,7 @@ LTMSidebar::eventPopup()
 void
 LTMSidebar::manageFilters()
 {
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     EditNamedSearches *editor = new EditNamedSearches(this, context);
     editor->move(QCursor::pos()+QPoint(10,-200));
     editor->show();
@@ -467,7 +484,7 @@ LTMSidebar::manageFilters()
 void
 LTMSidebar::setAutoFilterMenu()
 {
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     QStringList on = appsettings->cvalue(context->athlete->cyclist, GC_LTM_AUTOFILTERS, tr("Workout Code|Sport")).toString().split("|");
     autoFilterMenu->clear();
     autoFilterState.clear();
@@ -574,7 +591,7 @@ LTMSidebar::autoFilterChanged()
 void 
 LTMSidebar::filterTreeWidgetSelectionChanged()
 {
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     int selected = filterTree->selectedItems().count();
 
     if (selected) {
@@ -601,9 +618,14 @@ LTMSidebar::filterTreeWidgetSelectionChanged()
 
             case NamedSearch::search :
                 {
+#ifdef GC_HAVE_LUCENE
                     // use clucence
                     Lucene s(this, context);
                     results = s.search(ns.text);
+#else
+                    // use the built in index
+                    results = context->athlete->metadataIndex->search(ns.text);
+#endif
                 }
 
             }
@@ -757,7 +779,7 @@ LTMSidebar::autoFilterSelectionChanged()
 void
 LTMSidebar::resetFilters()
 {
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     if (active == true) return;
 
     active = true;
@@ -782,7 +804,7 @@ LTMSidebar::resetFilters()
 void
 LTMSidebar::filterPopup()
 {
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     // is one selected for deletion?
     int selected = filterTree->selectedItems().count();
 
@@ -813,7 +835,7 @@ LTMSidebar::filterPopup()
 void
 LTMSidebar::deleteFilter()
 {
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     if (filterTree->selectedItems().count() <= 0) return;
 
     active = true; // no need to reset tree when items deleted from model!
@@ -1019,6 +1041,20 @@ LTMSidebar::editEvent()
     active = false;
 }
 
+void
+LTMSidebar::cacheProgress(int done, int total)
+{
+    cacheProgressBar->setRange(0, total);
+    cacheProgressBar->setValue(done);
+    cacheProgressBar->setVisible(done < total);
+}
+
+void
+LTMSidebar::cacheFinished()
+{
+    cacheProgressBar->hide();
+}
+
 void
 LTMSidebar::setSummary(DateRange dateRange)
 {
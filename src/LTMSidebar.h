@@ -29,7 +29,7 @@
 #include "RideMetric.h"
 #include "LTMSettings.h"
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
 #include "SearchFilterBox.h"
 #endif
 
@@ -93,6 +93,10 @@ class LTMSidebar : public QWidget
         // gui components
         void setSummary(DateRange);
 
+        // the ride caches being brought up to date in the background
+        void cacheProgress(int done, int total);
+        void cacheFinished();
+
     private:
 
         Context *context;
@@ -117,6 +121,7 @@ class LTMSidebar : public QWidget
         QList<bool> autoFilterState;
 
         QWebView *summary;
+        QProgressBar *cacheProgressBar;
 
         GcSplitter *splitter;
         GcSubSplitter *filterSplitter;
@@ -54,7 +54,7 @@ LTMTool::LTMTool(Context *context, LTMSettings *settings) : QWidget(context->mai
     QFormLayout *basicsettingsLayout = new QFormLayout(basicsettings);
     basicsettingsLayout->setFieldGrowthPolicy(QFormLayout::ExpandingFieldsGrow);
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     searchBox = new SearchFilterBox(this, context);
     connect(searchBox, SIGNAL(searchClear()), this, SLOT(clearFilter()));
     connect(searchBox, SIGNAL(searchResults(QStringList)), this, SLOT(setFilter(QStringList)));
@@ -25,7 +25,7 @@
 #include "RideMetric.h"
 #include "LTMSettings.h"
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
 #include "SearchFilterBox.h"
 #endif
 
@@ -73,7 +73,7 @@ class LTMTool : public QWidget
 
         LTMSettings *settings;
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         SearchFilterBox *searchBox;
 #endif
 
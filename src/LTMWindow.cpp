@@ -526,8 +526,7 @@ LTMWindow::refresh()
 
     // refresh for changes to ridefiles / zones
     if (amVisible() == true && context->athlete->metricDB != NULL) {
-        results.clear(); // clear any old data
-        results = context->athlete->metricDB->getAllMetricsFor(settings.start, settings.end);
+        results = LTMRides(context->athlete->metricDB->getMetricSlice(settings.start, settings.end));
         measures.clear(); // clear any old data
         measures = context->athlete->metricDB->getAllMeasuresFor(settings.start, settings.end);
         bestsresults.clear();
@@ -609,8 +608,7 @@ LTMWindow::filterChanged()
         settings.start = settings.start.addDays(-1*(dow-1));
 
     // we need to get data again and apply filter
-    results.clear(); // clear any old data
-    results = context->athlete->metricDB->getAllMetricsFor(settings.start, settings.end);
+    results = LTMRides(context->athlete->metricDB->getMetricSlice(settings.start, settings.end));
     measures.clear(); // clear any old data
     measures = context->athlete->metricDB->getAllMeasuresFor(settings.start, settings.end);
     bestsresults.clear();
@@ -620,12 +618,7 @@ LTMWindow::filterChanged()
     if (ltmTool->isFiltered()) {
 
         // metrics filtering
-        QList<SummaryMetrics> filteredresults;
-        foreach (SummaryMetrics x, results) {
-            if (ltmTool->filters().contains(x.getFileName()))
-                filteredresults << x;
-        }
-        results = filteredresults;
+        results.filter(ltmTool->filters());
 
         // metrics filtering
         QList<SummaryMetrics> filteredbestsresults;
@@ -643,12 +636,7 @@ LTMWindow::filterChanged()
     if (context->ishomefiltered) {
 
         // metrics filtering
-        QList<SummaryMetrics> filteredresults;
-        foreach (SummaryMetrics x, results) {
-            if (context->homeFilters.contains(x.getFileName()))
-                filteredresults << x;
-        }
-        results = filteredresults;
+        results.filter(context->homeFilters);
 
         // metrics filtering
         QList<SummaryMetrics> filteredbestsresults;
@@ -834,11 +822,11 @@ LTMWindow::refreshDataTable()
 
         // end
         if (settings.end == QDateTime() || settings.end.date() > QDate::currentDate().addYears(40))
-                settings.end = (*settings.data).last().getRideDate();
+                settings.end = settings.data->rideDate(settings.data->count()-1);
 
         // start
         if (settings.start == QDateTime() || settings.start.date() < QDate::currentDate().addYears(-40))
-            settings.start = (*settings.data).first().getRideDate();
+            settings.start = settings.data->rideDate(0);
     }
 
     // need to redo this
@@ -884,7 +872,8 @@ LTMWindow::refreshDataTable()
 
     foreach (MetricDetail metricDetail, settings.metrics) {
 
-        QList<SummaryMetrics> *data = NULL; // source data (metrics, bests etc)
+        LTMRides *rides = NULL; // source data, metrics from the store
+        QList<SummaryMetrics> *data = NULL; // or bests etc
         GroupedData a; // aggregated data
 
         // resize the curve array to maximum possible size
@@ -895,7 +884,7 @@ LTMWindow::refreshDataTable()
         // set source for data
         QList<SummaryMetrics> PMCdata;
         if (metricDetail.type == METRIC_DB || metricDetail.type == METRIC_META) {
-            data = settings.data;
+            rides = settings.data;
         } else if (metricDetail.type == METRIC_MEASURE) {
             data = settings.measures;
         } else if (metricDetail.type == METRIC_PM) {
@@ -905,6 +894,9 @@ LTMWindow::refreshDataTable()
         } else if (metricDetail.type == METRIC_BEST) {
             data = settings.bests;
         }
+        int count = rides ? rides->count() : (data ? data->count() : 0);
+        const double *values = rides ? rides->values(metricDetail.symbol) : NULL;
+        const double *workout = rides ? rides->values("workout_time") : NULL;
 
         // initialise before looping through the data for this metric
         int n=-1;
@@ -912,24 +904,26 @@ LTMWindow::refreshDataTable()
         unsigned long secondsPerGroupBy=0;
         bool wantZero = true;
 
-        foreach (SummaryMetrics rideMetrics, *data) { 
+        for (int i=0; i<count; i++) {
 
             // filter out unwanted rides but not for PMC type metrics
             // because that needs to be done in the stress calculator
             if (metricDetail.type != METRIC_PM && context->isfiltered && 
-                !context->filters.contains(rideMetrics.getFileName())) continue;
+                !context->filters.contains(rides ? rides->fileName(i) : (*data)[i].getFileName())) continue;
 
             // day we are on
-            int currentDay = groupForDate(rideMetrics.getRideDate().date());
+            int currentDay = groupForDate(rides ? rides->rideDate(i).date() : (*data)[i].getRideDate().date());
 
             // value for day -- measures are stored differently
             double value;
-            if (metricDetail.type == METRIC_MEASURE)
-                value = rideMetrics.getText(metricDetail.symbol, "0.0").toDouble();
+            if (rides)
+                value = values ? values[rides->row(i)] : 0;
+            else if (metricDetail.type == METRIC_MEASURE)
+                value = (*data)[i].getText(metricDetail.symbol, "0.0").toDouble();
             else if (metricDetail.type == METRIC_BEST)
-                value = rideMetrics.getForSymbol(metricDetail.bestSymbol);
+                value = (*data)[i].getForSymbol(metricDetail.bestSymbol);
             else
-                value = rideMetrics.getForSymbol(metricDetail.symbol);
+                value = (*data)[i].getForSymbol(metricDetail.symbol);
 
             // check values are bounded to stop QWT going berserk
             if (isnan(value) || isinf(value)) value = 0;
@@ -948,7 +942,7 @@ LTMWindow::refreshDataTable()
             }
 
             if (value || wantZero) {
-                unsigned long seconds = rideMetrics.getForSymbol("workout_time");
+                unsigned long seconds = rides ? (workout ? workout[rides->row(i)] : 0) : (*data)[i].getForSymbol("workout_time");
                 if (metricDetail.type == METRIC_BEST || metricDetail.type == METRIC_MEASURE) seconds = 1;
                 if (n < a.x.size() && currentDay > lastDay) {
                     if (lastDay && wantZero) {
@@ -100,7 +100,7 @@ class LTMWindow : public GcChartWindow
     Q_PROPERTY(int stackWidth READ stackW WRITE setStackW USER true)
     Q_PROPERTY(bool legend READ legend WRITE setLegend USER true)
     Q_PROPERTY(bool events READ events WRITE setEvents USER true)
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     Q_PROPERTY(QString filter READ filter WRITE setFilter USER true)
 #endif
     Q_PROPERTY(QDate fromDate READ fromDate WRITE setFromDate USER true)
@@ -119,7 +119,7 @@ class LTMWindow : public GcChartWindow
 
         // reveal / filters
         bool hasReveal() { return true; }
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         bool isFiltered() const { return (ltmTool->isFiltered() || context->ishomefiltered || context->isfiltered); }
 #endif
 
@@ -168,7 +168,7 @@ class LTMWindow : public GcChartWindow
         int prevN() { return ltmTool->dateSetting->prevN(); }
         void setPrevN(int x) { ltmTool->dateSetting->setPrevN(x); }
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         QString filter() const { return ltmTool->searchBox->filter(); }
         void setFilter(QString x) { ltmTool->searchBox->setFilter(x); }
 #endif
@@ -237,7 +237,7 @@ class LTMWindow : public GcChartWindow
         bool compareDirty;
 
         LTMSettings settings; // all the plot settings
-        QList<SummaryMetrics> results;
+        LTMRides results;
         QList<SummaryMetrics> measures;
         QList<SummaryMetrics> bestsresults;
 
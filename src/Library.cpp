@@ -22,12 +22,15 @@
 #include "Settings.h"
 #include "LibraryParser.h"
 #include "TrainDB.h"
+#include "GcTrace.h"
+#include "Zones.h"
 #include <QVBoxLayout>
 #include <QHeaderView>
 #include <QLabel>
 #include <QApplication>
-#include <QDirIterator>
 #include <QFileInfo>
+#include <QCryptographicHash>
+#include <QSet>
 
 // helpers
 #ifdef Q_OS_MAC
@@ -422,6 +425,15 @@ LibrarySearchDialog::search()
 
     if (searching) {
 
+        // the directories it searched, for the index
+        if (searcher) {
+            QHashIterator<QString, qint64> i(searcher->directories());
+            while (i.hasNext()) {
+                i.next();
+                directoriesFound.insert(i.key(), i.value());
+            }
+        }
+
         // do next search path...
         if (++pathIndex >= searchPathTable->invisibleRootItem()->childCount()) {
 
@@ -439,24 +451,28 @@ LibrarySearchDialog::search()
 
             QTreeWidgetItem *item = searchPathTable->invisibleRootItem()->child(pathIndex);
             QString path = item->text(0);
-            searcher = new LibrarySearch(path, findMedia->isChecked(), findWorkouts->isChecked());
+            searcher = new LibrarySearch(path, findMedia->isChecked(), findWorkouts->isChecked(), index);
         }
 
     } else {
 
         setSearching(true);
         workoutCountN = videoCountN = pathIndex = 0;
+        workoutsFound.clear();
+        videosFound.clear();
+        directoriesFound.clear();
+        index = trainDB->scanIndex();
         workoutCount->setText(QString("%1").arg(workoutCountN));
         mediaCount->setText(QString("%1").arg(videoCountN));
         QTreeWidgetItem *item = searchPathTable->invisibleRootItem()->child(pathIndex);
         QString path = item->text(0);
-        searcher = new LibrarySearch(path, findMedia->isChecked(), findWorkouts->isChecked());
+        searcher = new LibrarySearch(path, findMedia->isChecked(), findWorkouts->isChecked(), index);
     }
 
     connect(searcher, SIGNAL(done()), this, SLOT(search()));
     connect(searcher, SIGNAL(searching(QString)), this, SLOT(pathsearching(QString)));
-    connect(searcher, SIGNAL(foundVideo(QString)), this, SLOT(foundVideo(QString)));
-    connect(searcher, SIGNAL(foundWorkout(QString)), this, SLOT(foundWorkout(QString)));
+    connect(searcher, SIGNAL(foundVideos(QStringList)), this, SLOT(foundVideos(QStringList)));
+    connect(searcher, SIGNAL(foundWorkouts(QStringList)), this, SLOT(foundWorkouts(QStringList)));
 
     searcher->start();
 }
@@ -468,17 +484,19 @@ LibrarySearchDialog::pathsearching(QString text)
 }
 
 void
-LibrarySearchDialog::foundWorkout(QString name)
+LibrarySearchDialog::foundWorkouts(QStringList names)
 {
-    workoutCount->setText(QString("%1").arg(++workoutCountN));
-    workoutsFound << name;
+    workoutCountN += names.count();
+    workoutCount->setText(QString("%1").arg(workoutCountN));
+    workoutsFound << names;
 }
 
 void
-LibrarySearchDialog::foundVideo(QString name)
+LibrarySearchDialog::foundVideos(QStringList names)
 {
-    mediaCount->setText(QString("%1").arg(++videoCountN));
-    videosFound << name;
+    videoCountN += names.count();
+    mediaCount->setText(QString("%1").arg(videoCountN));
+    videosFound << names;
 }
 
 void
@@ -542,27 +560,67 @@ LibrarySearchDialog::removeReference()
     }
 }
 
-void
-LibrarySearchDialog::updateDB()
+// commit every so often, so an import that gets interrupted
+// carries on from where it got to next time around
+static const int BATCH = 100;
+
+// a quick fingerprint of the content, small files are hashed
+// whole, big ones just the size and the first and last 64k
+static QString
+contentHash(QString path, qint64 size)
 {
-    // wipe away all user data before updating
-    trainDB->rebuildDB();
+    static const qint64 CHUNK = 65536;
 
-    trainDB->startLUW();
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly)) return "";
 
-    // workouts
-    foreach(QString ergFile, workoutsFound) {
-        int mode;
-        ErgFile file(ergFile, mode, context);
-        if (file.isValid()) {
-            trainDB->importWorkout(ergFile, &file);
-        }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray::number(size));
+    if (size <= 2 * CHUNK) {
+        hash.addData(file.readAll());
+    } else {
+        hash.addData(file.read(CHUNK));
+        file.seek(size - CHUNK);
+        hash.addData(file.read(CHUNK));
     }
+    return QString(hash.result().toHex());
+}
 
-    // videos
-    foreach(QString video, videosFound) {
-        trainDB->importVideo(video);
-    }
+// the CP the workouts are scaled to when they're parsed, as ErgFile
+static double
+currentCP(Context *context)
+{
+    const Zones *zones = context->athlete->zones();
+    if (!zones) return 0;
+    int range = zones->whichRange(QDateTime::currentDateTime().date());
+    return range >= 0 ? zones->getCP(range) : 0;
+}
+
+static TrainDBScanEntry
+scanEntry(const QFileInfo &info, QString hash, int type, double cp = 0)
+{
+    TrainDBScanEntry entry;
+    entry.size = info.size();
+    entry.mtime = info.lastModified().toMSecsSinceEpoch();
+    entry.hash = hash;
+    entry.type = type;
+    entry.cp = cp;
+    return entry;
+}
+
+static bool
+unchanged(const TrainDBScanEntry &was, const QFileInfo &info)
+{
+    return was.size == info.size() && was.mtime == info.lastModified().toMSecsSinceEpoch();
+}
+
+void
+LibrarySearchDialog::updateDB()
+{
+    GC_TRACE("LibrarySearchDialog::updateDB", "train");
+
+    // no second helping whilst we are busy
+    searchButton->setEnabled(false);
 
     // Now check and re-add references, if there are any
     // these are files which were drag-n-dropped into the 
@@ -576,18 +634,140 @@ LibrarySearchDialog::updateDB()
             if (!QFile(r).exists()) continue;
 
             // is a video?
-            if (helper.isMedia(r)) trainDB->importVideo(r);
+            if (helper.isMedia(r)) videosFound << r;
 
             // is a workout?
-            if (ErgFile::isWorkout(r)) {
-                int mode;
-                ErgFile file(r, mode, context);
-                if (file.isValid()) {
-                    trainDB->importWorkout(r, &file);
-                }
+            if (ErgFile::isWorkout(r)) workoutsFound << r;
+        }
+    }
+    workoutsFound.removeDuplicates();
+    videosFound.removeDuplicates();
+
+    // it may have moved on if an import was interrupted
+    index = trainDB->scanIndex();
+
+    // the targets and TSS we have are for the CP they were parsed
+    // with, so they are all parsed again when it changes
+    double cp = currentCP(context);
+
+    // workouts we already have, by content
+    QHash<QString, QString> known;
+    QHashIterator<QString, TrainDBScanEntry> i(index);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().type == SCAN_WORKOUT && i.value().hash != "" && i.value().cp == cp)
+            known.insert(i.value().hash, i.key());
+    }
+
+    QSet<QString> workouts, videos;             // what is still there
+    QStringList parse;                          // and needs parsing
+    QHash<QString, TrainDBScanEntry> parsing;   // their index entries
+    int updates = 0;
+
+    trainDB->startLUW();
+
+    // workouts that haven't changed are left alone and ones we already
+    // have somewhere else are copied, only new content gets parsed
+    foreach(QString path, workoutsFound) {
+
+        QFileInfo info(path);
+        if (!info.exists()) continue;
+        workouts.insert(path);
+
+        TrainDBScanEntry was = index.value(path);
+        bool indexed = index.contains(path) && (was.type == SCAN_INVALID || (was.type == SCAN_WORKOUT && was.cp == cp));
+        if (indexed && unchanged(was, info)) continue;
+
+        QString hash = contentHash(path, info.size());
+        TrainDBScanEntry entry = scanEntry(info, hash, SCAN_WORKOUT, cp);
+
+        if (indexed && hash != "" && was.hash == hash) {
+
+            // touched, but the same content
+            entry.type = was.type;
+
+        } else if (hash == "" || !known.contains(hash) || known.value(hash) == path ||
+                   !trainDB->copyWorkout(known.value(hash), path)) {
+
+            // new to us
+            parse << path;
+            parsing.insert(path, entry);
+            continue;
+        }
+        trainDB->updateScanIndex(path, entry);
+        if (++updates % BATCH == 0) trainDB->commitLUW();
+    }
+
+    // parse the rest on a pool of threads, the database
+    // can only be updated from here so we collect them
+    if (parse.count()) {
+        LibraryImporter importer(context, parse, QThread::idealThreadCount());
+
+        for (int n=0; n<parse.count(); n++) {
+
+            LibraryImportResult *result;
+            while ((result = importer.collect(100)) == NULL) QApplication::processEvents();
+            pathLabel->setText(tr("Importing workout %1 of %2").arg(n+1).arg(parse.count()));
+
+            TrainDBScanEntry entry = parsing.value(result->path);
+            if (result->ergFile) {
+                trainDB->importWorkout(result->path, result->ergFile);
+            } else {
+                // remember it, so we don't try again until it changes
+                trainDB->deleteWorkout(result->path);
+                entry.type = SCAN_INVALID;
             }
+            trainDB->updateScanIndex(result->path, entry);
+            delete result;
+
+            if (++updates % BATCH == 0) trainDB->commitLUW();
         }
     }
+
+    // videos
+    foreach(QString video, videosFound) {
+
+        QFileInfo info(video);
+        if (!info.exists()) continue;
+        videos.insert(video);
+
+        if (index.contains(video) && index.value(video).type == SCAN_VIDEO && unchanged(index.value(video), info)) continue;
+
+        trainDB->importVideo(video);
+        trainDB->updateScanIndex(video, scanEntry(info, "", SCAN_VIDEO));
+        if (++updates % BATCH == 0) trainDB->commitLUW();
+    }
+
+    // anything we didn't find has gone, or we weren't looking for it
+    foreach(QString path, trainDB->workoutPaths())
+        if (!workouts.contains(path)) trainDB->deleteWorkout(path);
+    foreach(QString path, trainDB->videoPaths())
+        if (!videos.contains(path)) trainDB->deleteVideo(path);
+
+    i.toFront();
+    while (i.hasNext()) {
+        i.next();
+        bool found = i.value().type == SCAN_DIRECTORY ? directoriesFound.contains(i.key())
+                                                      : workouts.contains(i.key()) || videos.contains(i.key());
+        if (!found) trainDB->deleteScanIndex(i.key());
+    }
+
+    // directories go last, since an unchanged directory isn't searched
+    // again and its contents have to be in the index by then
+    QString searchedFor = LibrarySearch::searchedFor(findMedia->isChecked(), findWorkouts->isChecked());
+    QHashIterator<QString, qint64> d(directoriesFound);
+    while (d.hasNext()) {
+        d.next();
+
+        TrainDBScanEntry entry;
+        entry.size = 0;
+        entry.mtime = d.value();
+        entry.hash = searchedFor;
+        entry.type = SCAN_DIRECTORY;
+        entry.cp = 0;
+        trainDB->updateScanIndex(d.key(), entry);
+    }
+
     trainDB->endLUW();
 }
 
@@ -595,31 +775,45 @@ LibrarySearchDialog::updateDB()
 // SEARCH -- traverse a directory looking for files and signal to notify of progress etc
 //
 
-LibrarySearch::LibrarySearch(QString path, bool findMedia, bool findWorkout)
-              : path(path), findMedia(findMedia), findWorkout(findWorkout)
+LibrarySearch::LibrarySearch(QString path, bool findMedia, bool findWorkout, QHash<QString, TrainDBScanEntry> index)
+              : path(path), findMedia(findMedia), findWorkout(findWorkout), index(index)
 {
     aborted = false;
 }
 
+QString
+LibrarySearch::searchedFor(bool findMedia, bool findWorkout)
+{
+    return QString("%1%2").arg(findMedia ? "v" : "").arg(findWorkout ? "w" : "");
+}
+
 void
 LibrarySearch::run()
 {
+    GC_TRACE("LibrarySearch::run", "train");
+
     MediaHelper helper;
 
-    // file tree walking
-    QDirIterator directory_walker(path, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
-    while(directory_walker.hasNext()){
+    // what was in each directory last time
+    QMultiHash<QString, QString> children;
+    QHashIterator<QString, TrainDBScanEntry> i(index);
+    while (i.hasNext()) {
+        i.next();
 
-        directory_walker.next();
+        int slash = i.key().lastIndexOf('/');
+        if (slash < 0) continue;
 
-        // whizz through every file in the directory
-        // if it has the right extension then we are happy
-        QString name = directory_walker.filePath();
+        QString parent = i.key().left(slash);
+        if (parent == "" || parent.endsWith(':')) parent += '/'; // at the root
+        children.insert(parent, i.key());
+    }
 
-        // skip . files
-        if (QFileInfo(name).fileName().startsWith(".")) continue;
+    // walk the tree, following symlinks but not round in circles
+    QStringList pending;
+    QSet<QString> visited;
+    pending << QDir::cleanPath(path);
 
-        if (QFileInfo(name).isDir()) emit searching(name);
+    while (!pending.isEmpty()) {
 
         // we've been told to stop!
         if (aborted) {
@@ -627,12 +821,57 @@ LibrarySearch::run()
             return;
         }
 
-        // is a video?
-        if (findMedia && helper.isMedia(name)) emit foundVideo(name);
-        // is a workout?
-        if (findWorkout && ErgFile::isWorkout(name)) emit foundWorkout(name);
-    }
+        QString dir = pending.takeLast();
+        QFileInfo info(dir);
+        if (!info.isDir()) continue;
+
+        QString canonical = info.canonicalFilePath();
+        if (visited.contains(canonical)) continue;
+        visited.insert(canonical);
+
+        emit searching(dir);
+
+        qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+        searched.insert(dir, mtime);
+
+        QStringList videos, workouts;
+        QHash<QString, TrainDBScanEntry>::const_iterator was = index.constFind(dir);
 
+        if (was != index.constEnd() && was.value().type == SCAN_DIRECTORY && was.value().mtime == mtime &&
+            (!findMedia || was.value().hash.contains("v")) && (!findWorkout || was.value().hash.contains("w"))) {
+
+            // nothing added, removed or renamed in here since
+            // last time, so we don't need to list it
+            foreach(QString child, children.values(dir)) {
+                switch (index.value(child).type) {
+                case SCAN_DIRECTORY: pending << child; break;
+                case SCAN_VIDEO: if (findMedia) videos << child; break;
+                default: if (findWorkout) workouts << child; break;
+                }
+            }
+
+        } else {
+
+            // whizz through every file in the directory, . files are
+            // hidden and skipped, if it has the right extension then
+            // we are happy
+            foreach(QFileInfo entry, QDir(dir).entryInfoList(QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot, QDir::NoSort)) {
+
+                QString name = entry.absoluteFilePath();
+                if (entry.isDir()) {
+                    pending << name;
+                } else {
+                    // is a video?
+                    if (findMedia && helper.isMedia(name)) videos << name;
+                    // is a workout?
+                    if (findWorkout && ErgFile::isWorkout(name)) workouts << name;
+                }
+            }
+        }
+
+        if (videos.count()) emit foundVideos(videos);
+        if (workouts.count()) emit foundWorkouts(workouts);
+    }
 
     emit done();
 };
@@ -643,6 +882,91 @@ LibrarySearch::abort()
     aborted = true;
 }
 
+/*----------------------------------------------------------------------
+ * Parsing workouts on a pool of threads for updateDB
+ *----------------------------------------------------------------------*/
+LibraryImportResult::~LibraryImportResult()
+{
+    if (ergFile) delete ergFile;
+}
+
+LibraryImporter::LibraryImporter(Context *context, QStringList paths, int threads) :
+    context(context), paths(paths), next(0), ahead(0), aborted(false)
+{
+    if (paths.isEmpty()) return;
+
+    if (threads > paths.count()) threads = paths.count();
+    if (threads < 1) threads = 1;
+    ahead = threads * 2;
+
+    for (int i=0; i<threads; i++) {
+        LibraryImportThread *worker = new LibraryImportThread(this);
+        workers << worker;
+        worker->start();
+    }
+}
+
+LibraryImporter::~LibraryImporter()
+{
+    lock.lock();
+    aborted = true;
+    space.wakeAll();
+    lock.unlock();
+
+    foreach(LibraryImportThread *worker, workers) {
+        worker->wait();
+        delete worker;
+    }
+
+    // anything they did that nobody collected
+    foreach(LibraryImportResult *result, ready) delete result;
+}
+
+LibraryImportResult *
+LibraryImporter::collect(unsigned long timeout)
+{
+    QMutexLocker locker(&lock);
+
+    if (ready.isEmpty()) {
+        available.wait(&lock, timeout);
+        if (ready.isEmpty()) return NULL;
+    }
+
+    space.wakeAll();
+    return ready.takeFirst();
+}
+
+void
+LibraryImportThread::run()
+{
+    LibraryImporter *r = importer;
+
+    forever {
+
+        // next workout, but don't get too far ahead of the collector
+        r->lock.lock();
+        while (!r->aborted && r->ready.count() >= r->ahead) r->space.wait(&r->lock);
+        if (r->aborted || r->next >= r->paths.count()) {
+            r->lock.unlock();
+            return;
+        }
+        int index = r->next++;
+        r->lock.unlock();
+
+        LibraryImportResult *result = new LibraryImportResult(r->paths.at(index));
+        result->ergFile = new ErgFile(result->path, result->mode, r->context);
+        if (!result->ergFile->isValid()) {
+            delete result->ergFile;
+            result->ergFile = NULL;
+        }
+
+        r->lock.lock();
+        r->ready << result;
+        r->available.wakeAll();
+        r->lock.unlock();
+    }
+}
+
 //
 // LIBRARY IMPORT DIALOG...
 //
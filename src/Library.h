@@ -30,6 +30,13 @@
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
 #include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+
+#include "TrainDB.h"
+
+class ErgFile;
 
 class Library : QObject
 {
@@ -61,8 +68,8 @@ class LibrarySearchDialog : public QDialog
         void cancel();
 
         void pathsearching(QString);
-        void foundWorkout(QString);
-        void foundVideo(QString);
+        void foundWorkouts(QStringList);
+        void foundVideos(QStringList);
 
         void addDirectory();
         void removeDirectory();
@@ -77,6 +84,8 @@ class LibrarySearchDialog : public QDialog
         int pathIndex, workoutCountN, videoCountN;
 
         QStringList workoutsFound, videosFound;
+        QHash<QString, qint64> directoriesFound; // and their mtime
+        QHash<QString, TrainDBScanEntry> index;  // what we found last time
 
         // let us know we are searching
         void setSearching(bool amsearching) {
@@ -103,14 +112,23 @@ class LibrarySearchDialog : public QDialog
                     *searchButton;
 };
 
+// Walks a search path looking for workouts and videos. Directories
+// that haven't changed since they were last indexed aren't listed
+// again, we take what was in them from the index instead.
 class LibrarySearch : public QThread
 {
     Q_OBJECT
 
     public:
-        LibrarySearch(QString path, bool findMedia, bool findWorkout);
+        LibrarySearch(QString path, bool findMedia, bool findWorkout, QHash<QString, TrainDBScanEntry> index);
         void run();
 
+        // the directories we searched and their mtime, once done
+        QHash<QString, qint64> directories() { return searched; }
+
+        // what the index records was searched for in a directory
+        static QString searchedFor(bool findMedia, bool findWorkout);
+
     public slots:
         void abort();
 
@@ -118,13 +136,61 @@ class LibrarySearch : public QThread
     signals:
         void searching(QString);
         void done();
-        void foundVideo(QString);
-        void foundWorkout(QString);
+        void foundVideos(QStringList);   // one directory at a time
+        void foundWorkouts(QStringList);
 
     private:
         volatile bool aborted;
         QString path;
         bool findMedia, findWorkout;
+        QHash<QString, TrainDBScanEntry> index;
+        QHash<QString, qint64> searched;
+};
+
+// Parses workouts on a pool of threads for LibrarySearchDialog::updateDB,
+// results are collected in whatever order they finish
+struct LibraryImportResult {
+    LibraryImportResult(QString path) : path(path), mode(0), ergFile(NULL) {}
+    ~LibraryImportResult();
+
+    QString path;
+    int mode;           // the ErgFile refers to it, so it lives here
+    ErgFile *ergFile;   // NULL if it isn't a valid workout
+};
+
+class LibraryImporter;
+class LibraryImportThread : public QThread
+{
+    public:
+        LibraryImportThread(LibraryImporter *importer) : importer(importer) {}
+        void run();
+
+    private:
+        LibraryImporter *importer;
+};
+
+class LibraryImporter
+{
+    public:
+        LibraryImporter(Context *context, QStringList paths, int threads);
+        ~LibraryImporter(); // stops the threads and frees anything not collected
+
+        // the next result for the caller to delete, NULL if there
+        // isn't one after waiting for timeout milliseconds
+        LibraryImportResult *collect(unsigned long timeout);
+
+    private:
+        friend class LibraryImportThread;
+
+        Context *context;
+        QStringList paths;
+
+        QList<LibraryImportThread*> workers;
+        QMutex lock;
+        QWaitCondition available, space;
+        QList<LibraryImportResult*> ready;
+        int next, ahead;
+        bool aborted;
 };
 
 class WorkoutImportDialog : public QDialog
@@ -19,6 +19,7 @@
 #include "Lucene.h"
 #include "Context.h"
 #include "Athlete.h"
+#include "DBAccess.h"
 
 // stdc strings
 using namespace std;
@@ -30,7 +31,8 @@ using namespace lucene::queryParser;
 using namespace lucene::search;
 using namespace lucene::store;
 
-Lucene::Lucene(QObject *parent, Context *context) : QObject(parent), context(context)
+Lucene::Lucene(QObject *parent, Context *context) : QObject(parent), context(context),
+    created(false), batching(false), optimiser(NULL)
 {
     // create the directory if needed
     context->athlete->home.mkdir("index");
@@ -53,6 +55,9 @@ Lucene::Lucene(QObject *parent, Context *context) : QObject(parent), context(con
             // lets flush to disk and reopen
             create->close();
             delete create;
+
+            // any rides already in the metrics DB need adding
+            created = true;
         }
 
     } catch (CLuceneError &e) {
@@ -63,82 +68,222 @@ Lucene::Lucene(QObject *parent, Context *context) : QObject(parent), context(con
 
 Lucene::~Lucene()
 {
+    endBatch();
+    waitForOptimiser();
+    delete optimiser;
 }
 
-bool Lucene::importRide(SummaryMetrics *, RideFile *ride, QColor , unsigned long, bool)
+void Lucene::waitForOptimiser()
+{
+    if (optimiser && optimiser->isRunning()) optimiser->wait();
+}
+
+QStringList Lucene::textFields()
+{
+    QStringList returning;
+    foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
+        if (!context->specialFields.isMetric(field.name) && (field.type < 3 || field.type == 7))
+            returning << field.name;
+    }
+    return returning;
+}
+
+Document *Lucene::makeDocument(QString filename, const QList<std::wstring> &names, const QStringList &values)
 {
     // create a document
-    Document doc;
+    Document *doc = new Document;
 
     // add Filename special field (unique)
-    std::wstring cname = ride->getTag("Filename","").toStdWString();
+    std::wstring cname = filename.toStdWString();
     Field *fadd = new Field(_T("Filename"), cname.c_str(), Field::STORE_YES | Field::INDEX_UNTOKENIZED);
-    doc.add( *fadd );
+    doc->add( *fadd );
 
     QString alltexts;
 
     // And all the metadata texts individually
-    foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
-
-        if (!context->specialFields.isMetric(field.name) && (field.type < 3 || field.type == 7)) {
+    for (int i=0; i<names.count() && i<values.count(); i++) {
 
-            std::wstring name = context->specialFields.makeTechName(field.name).toStdWString();
-            std::wstring value = ride->getTag(field.name,"").toStdWString();
+        std::wstring value = values.at(i).toStdWString();
 
-            alltexts += ride->getTag(field.name,"") + " ";
-            Field *add = new Field(name.c_str(), value.c_str(), Field::STORE_YES | Field::INDEX_TOKENIZED);
-            doc.add( *add );
-        }
+        alltexts += values.at(i) + " ";
+        Field *add = new Field(names.at(i).c_str(), value.c_str(), Field::STORE_YES | Field::INDEX_TOKENIZED);
+        doc->add( *add );
     }
 
     // add a catchall text which is concat of all text fields
     std::wstring value = alltexts.toStdWString();
     Field *cadd = new Field(_T("contents"), value.c_str(), Field::STORE_YES | Field::INDEX_TOKENIZED);
-    doc.add( *cadd );
-    
-    // delete if already in the index
-    deleteRide(ride->getTag("Filename", ""));
+    doc->add( *cadd );
 
-    // now add to index
-    try { 
-
-        // now lets open using a mnodifier since the API is much simpler
-        IndexWriter *writer = new IndexWriter(dir.canonicalPath().toLocal8Bit().data(), &analyzer, false); // for updates
-        writer->addDocument(&doc); 
-        writer->close();
-        delete writer;
+    return doc;
+}
 
-    } catch (CLuceneError &e) {
-        qDebug()<<"add document clucene error!"<<e.what();
+bool Lucene::importRide(SummaryMetrics *, RideFile *ride, QColor , unsigned long, bool)
+{
+    QList<std::wstring> names;
+    QStringList values;
+    foreach(QString field, textFields()) {
+        names << context->specialFields.makeTechName(field).toStdWString();
+        values << ride->getTag(field, "");
     }
+    QString filename = ride->getTag("Filename", "");
 
-    doc.clear();
+    // replaces any already in the index
+    deleteRide(filename);
+    pendingDocs.insert(filename, makeDocument(filename, names, values));
 
+    // don't hold too many documents in memory
+    if (!batching || pendingDocs.count() >= 500) flush();
     return true;
 }
 
 bool Lucene::deleteRide(QString name)
 {
-    std::wstring cname = name.toStdWString();
+    // lose any we haven't written yet
+    Document *pending = pendingDocs.take(name);
+    if (pending) {
+        pending->clear();
+        delete pending;
+    }
 
-    try {
+    if (!pendingDeletes.contains(name)) pendingDeletes << name;
 
-        IndexReader *reader = IndexReader::open(dir.canonicalPath().toLocal8Bit().data());
-        Term del = Term(_T("Filename"), cname.c_str());
-        reader->deleteDocuments(&del);
-        reader->close();
-        delete reader;
+    if (!batching) flush();
+    return true;
+}
 
-    } catch (CLuceneError &e) {
-        qDebug()<<"deleteDocuments clucene error!"<<e.what();
+void Lucene::flush()
+{
+    if (pendingDeletes.isEmpty() && pendingDocs.isEmpty()) return;
+
+    waitForOptimiser();
+    QMutexLocker locker(&writeLock);
+
+    // the 0.9 API can only delete by term using a reader, so we
+    // make one pass to delete with a reader and one to add with a
+    // writer, rather than opening both for every single ride
+    if (!pendingDeletes.isEmpty()) {
+        try {
+
+            IndexReader *reader = IndexReader::open(dir.canonicalPath().toLocal8Bit().data());
+            foreach(QString name, pendingDeletes) {
+                std::wstring cname = name.toStdWString();
+                Term del(_T("Filename"), cname.c_str());
+                reader->deleteDocuments(&del);
+            }
+            reader->close();
+            delete reader;
+
+        } catch (CLuceneError &e) {
+            qDebug()<<"deleteDocuments clucene error!"<<e.what();
+        }
+        pendingDeletes.clear();
     }
-    return true;
+
+    if (!pendingDocs.isEmpty()) {
+        try {
+
+            IndexWriter *writer = new IndexWriter(dir.canonicalPath().toLocal8Bit().data(), &analyzer, false); // for updates
+
+            // buffer lots of documents and merge less often, we
+            // optimise once the batch is complete anyway
+            writer->setMaxBufferedDocs(1000);
+            writer->setMergeFactor(100);
+
+            foreach(Document *doc, pendingDocs) writer->addDocument(doc);
+            writer->close();
+            delete writer;
+
+        } catch (CLuceneError &e) {
+            qDebug()<<"add document clucene error!"<<e.what();
+        }
+
+        foreach(Document *doc, pendingDocs) {
+            doc->clear();
+            delete doc;
+        }
+        pendingDocs.clear();
+    }
+}
+
+void Lucene::beginBatch()
+{
+    batching = true;
+}
+
+void Lucene::endBatch()
+{
+    if (!batching) return;
+
+    batching = false;
+    flush();
+
+#ifndef WIN32 // windows crashes here....
+    // merge segments in the background
+    if (!optimiser) optimiser = new LuceneOptimiser(dir.canonicalPath(), &analyzer, &writeLock);
+    optimiser->start(QThread::LowPriority);
+#endif
+}
+
+void Lucene::reindex(DBAccess *db)
+{
+    QStringList fields = textFields();
+    QList<std::wstring> names;
+
+    // get the metadata texts from the metrics table, filename first
+    QString select = "SELECT filename";
+    foreach(QString field, fields) {
+        select += QString(", Z%1").arg(context->specialFields.makeTechName(field));
+        names << context->specialFields.makeTechName(field).toStdWString();
+    }
+    select += " FROM metrics;";
+
+    QList<QStringList> rides;
+    QSqlQuery query(db->connection());
+    bool rc = query.exec(select);
+    while (rc && query.next()) {
+        QStringList values;
+        for (int i=0; i<=fields.count(); i++) values << query.value(i).toString();
+        rides << values;
+    }
+    query.finish();
+
+    // build the documents in parallel
+    QList<LuceneDocumentBuilder*> builders;
+    int threads = qMax(1, QThread::idealThreadCount());
+    int chunk = rides.count() / threads + 1;
+    for (int begin=0; begin < rides.count(); begin += chunk) {
+        LuceneDocumentBuilder *builder = new LuceneDocumentBuilder(names, rides, begin, qMin(begin+chunk, rides.count()));
+        builders << builder;
+        builder->start();
+    }
+
+    // and feed them to a single writer, the index was only
+    // just created so there is nothing to delete first
+    beginBatch();
+    foreach(LuceneDocumentBuilder *builder, builders) {
+
+        builder->wait();
+
+        foreach(Document *doc, builder->documents)
+            pendingDocs.insert(QString::fromWCharArray(doc->get(_T("Filename"))), doc);
+
+        delete builder;
+    }
+    endBatch();
+
+    created = false;
 }
 
 void Lucene::optimise()
 {
+    // merges happen in the background after a batch
+    if (optimiser && optimiser->isRunning()) return;
+
     try {
 
+        QMutexLocker locker(&writeLock);
+
         IndexWriter *writer = new IndexWriter(dir.canonicalPath().toLocal8Bit().data(), &analyzer, false); // for updates
         writer->optimize();
         writer->close();
@@ -149,6 +294,30 @@ void Lucene::optimise()
     }
 }
 
+void LuceneOptimiser::run()
+{
+    QMutexLocker locker(writeLock);
+
+    try {
+
+        IndexWriter *writer = new IndexWriter(path.toLocal8Bit().data(), analyzer, false); // for updates
+        writer->optimize();
+        writer->close();
+        delete writer;
+
+    } catch(CLuceneError &e) {
+        qDebug()<<"optimise clucene error!"<<e.what();
+    }
+}
+
+void LuceneDocumentBuilder::run()
+{
+    for (int i=begin; i<end; i++) {
+        const QStringList &ride = rides.at(i);
+        documents << Lucene::makeDocument(ride.value(0), names, ride.mid(1));
+    }
+}
+
 QList<QString> Lucene::search(QString query)
 {
     filenames.clear();
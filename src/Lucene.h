@@ -22,6 +22,9 @@
 #include <QObject>
 #include <QString>
 #include <QDir>
+#include <QThread>
+#include <QMutex>
+#include <QMap>
 
 #include "Context.h"
 #include "RideMetadata.h"
@@ -38,6 +41,9 @@ using namespace lucene::queryParser;
 using namespace lucene::search;
 using namespace lucene::store;
 
+class DBAccess;
+class LuceneOptimiser;
+
 class Lucene : public QObject
 {
     Q_OBJECT
@@ -51,6 +57,24 @@ public:
     bool deleteRide(QString);
     void optimise(); // for optimising the index once updated
 
+    // Batch updates -- between begin and end, deletes and updates are
+    // queued and applied with a single reader and a single writer rather
+    // than opening both for every ride. When the batch ends the optimise
+    // is run in the background rather than blocking the refresh.
+    void beginBatch();
+    void endBatch();
+
+    // the index was created from scratch, so needs a full reindex
+    bool needsReindex() const { return created; }
+
+    // rebuild the index from the metadata already held in the metrics
+    // table, so we don't need to open any ride files to do it
+    void reindex(DBAccess *db);
+
+    // the metadata fields we index, and a document built from them
+    static Document *makeDocument(QString filename, const QList<std::wstring> &names, const QStringList &values);
+    QStringList textFields();
+
     QStringList &files() { return filenames; }
 
 protected:
@@ -72,6 +96,49 @@ private:
     // Query results
     Hits *hits; // null when no results
     QStringList filenames;
+
+    // Batch updates
+    bool created;
+    bool batching;
+    QStringList pendingDeletes;          // by Filename term
+    QMap<QString, Document*> pendingDocs; // replacements to add
+    LuceneOptimiser *optimiser;
+    QMutex writeLock;        // only one writer at a time
+    void waitForOptimiser();
+    void flush();             // apply pending deletes and adds
+};
+
+// runs the index optimise in the background
+class LuceneOptimiser : public QThread
+{
+    public:
+        LuceneOptimiser(QString path, Analyzer *analyzer, QMutex *writeLock) :
+            path(path), analyzer(analyzer), writeLock(writeLock) {}
+        void run();
+
+    private:
+        QString path;
+        Analyzer *analyzer;
+        QMutex *writeLock;
+};
+
+// builds documents for a slice of rides, we run a few of these
+// in parallel when reindexing the entire ride collection, they all
+// share the names and rides so only ever read them
+class LuceneDocumentBuilder : public QThread
+{
+    public:
+        LuceneDocumentBuilder(const QList<std::wstring> &names, const QList<QStringList> &rides, int begin, int end) :
+            names(names), rides(rides), begin(begin), end(end) {}
+        void run();
+
+        // filename is the first value in each ride
+        const QList<std::wstring> &names;
+        const QList<QStringList> &rides;
+        int begin, end;
+
+        // the results
+        QList<Document*> documents;
 };
 
 #endif
@@ -30,6 +30,7 @@
 
 // DATA STRUCTURES
 #include "MainWindow.h"
+#include "GcTrace.h"
 #include "Context.h"
 #include "Athlete.h"
 
@@ -88,8 +89,7 @@
 #endif
 
 // SEARCH / FILTER
-#ifdef GC_HAVE_LUCENE
-#include "Lucene.h"
+#ifdef GC_HAVE_SEARCH
 #include "NamedSearch.h"
 #include "SearchFilterBox.h"
 #endif
@@ -351,7 +351,7 @@ MainWindow::MainWindow(const QDir &home)
     head->addWidget(new Spacer(this));
     head->addWidget(viewsel);
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     searchBox = new SearchFilterBox(this,context,false);
 #if QT_VERSION > 0x50000
     QStyle *toolStyle = QStyleFactory::create("fusion");
@@ -473,7 +473,7 @@ MainWindow::MainWindow(const QDir &home)
     head->addWidget(lowbar);
     head->addWidget(styleSelector);
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     // add a search box on far right, but with a little space too
     searchBox = new SearchFilterBox(this,context,false);
     searchBox->setStyle(toolStyle);
@@ -705,6 +705,9 @@ MainWindow::MainWindow(const QDir &home)
     QMenu *helpMenu = menuBar()->addMenu(tr("&Help"));
     helpMenu->addAction(tr("&User Guide"), this, SLOT(helpView()));
     helpMenu->addAction(tr("&Log a bug or feature request"), this, SLOT(logBug()));
+    traceAction = helpMenu->addAction(tr("Record Performance Trace"), this, SLOT(toggleTrace(bool)));
+    traceAction->setCheckable(true);
+    traceAction->setChecked(GcTrace::isRecording());
     helpMenu->addSeparator();
     helpMenu->addAction(tr("&About GoldenCheetah"), this, SLOT(aboutDialog()));
 
@@ -1042,6 +1045,22 @@ MainWindow::logBug()
     QDesktopServices::openUrl(QUrl("http://www.goldencheetah.org/bug-tracker.html"));
 }
 
+void
+MainWindow::toggleTrace(bool on)
+{
+    if (on) {
+        GcTrace::start(gcroot + "/goldencheetah-trace.json");
+    } else {
+        QString filename = GcTrace::filename();
+        if (GcTrace::stop()) {
+            QMessageBox::information(this, tr("Performance Trace"),
+                                     tr("The trace was written to %1, open it with chrome://tracing").arg(filename));
+        } else {
+            QMessageBox::warning(this, tr("Performance Trace"), tr("Cannot write the trace to %1").arg(filename));
+        }
+    }
+}
+
 void
 MainWindow::helpView()
 {
@@ -1452,7 +1471,7 @@ MainWindow::removeTab(Tab *tab)
 
     if (tabList.count() == 2) showTabbar(false); // don't need it for one!
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     // save the named searches
     tab->context->athlete->namedSearches->write();
 #endif
@@ -1578,7 +1597,7 @@ MainWindow::saveState(Context *context)
 #ifndef Q_OS_MAC // not on a Mac
     context->showToolbar = showhideToolbar->isChecked();
 #endif
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     context->searchText = searchBox->text();
 #endif
     context->viewIndex = scopebar->selected();  
@@ -1599,7 +1618,7 @@ MainWindow::restoreState(Context *context)
     scopebar->setSelected(context->viewIndex);
     scopebar->setContext(context);
     scopebar->setHighlighted(); // to reflect context
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     searchBox->setContext(context);
     searchBox->setText(context->searchText);
 #endif
@@ -1833,6 +1852,8 @@ Athlete::configChanged()
     QVariant unit = appsettings->cvalue(cyclist, GC_UNIT);
     useMetricUnits = (unit.toString() == GC_UNIT_METRIC);
 
+    elevationHysteresis = appsettings->value(NULL, GC_ELEVATION_HYSTERESIS).toDouble();
+    if (elevationHysteresis <= 0.1) elevationHysteresis = 3.00;
 }
 
 /*----------------------------------------------------------------------
@@ -89,6 +89,7 @@ class MainWindow : public QMainWindow
         void aboutDialog();
         void helpView();
         void logBug();
+        void toggleTrace(bool);
         void actionClicked(int);
 
         // open and closing windows and tabs
@@ -198,7 +199,7 @@ class MainWindow : public QMainWindow
         QTFullScreen *fullScreen;
 #endif
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         SearchFilterBox *searchBox;
 #endif
 
@@ -235,6 +236,7 @@ class MainWindow : public QMainWindow
         QAction *showhideLowbar;
         QAction *showhideToolbar;
         QAction *showhideTabbar;
+        QAction *traceAction;
 
         QAction *tweetAction;
         QAction *shareAction;
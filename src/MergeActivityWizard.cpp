@@ -17,6 +17,7 @@
  */
 
 #include "MergeActivityWizard.h"
+#include "MergeAlign.h"
 #include "Context.h"
 #include "MainWindow.h"
 
@@ -171,7 +172,7 @@ MergeUpload::importFile(QList<QString> files)
 
 
 // Synchronise start of files
-MergeSync::MergeSync(MergeActivityWizard *parent) : QWizardPage(parent), wizard(parent)
+MergeSync::MergeSync(MergeActivityWizard *parent) : QWizardPage(parent), wizard(parent), aligner(NULL)
 {
     setTitle(tr("Synchronise"));
     setSubTitle(tr("Start of rides"));
@@ -237,240 +238,68 @@ MergeSync::MergeSync(MergeActivityWizard *parent) : QWizardPage(parent), wizard(
     connect(delayAutoButton, SIGNAL(clicked()), this, SLOT(findBestDelay()));
 }
 
+MergeSync::~MergeSync()
+{
+    // don't pull the rides out from under it
+    if (aligner) {
+        aligner->wait();
+        delete aligner;
+    }
+}
+
 void
 MergeSync::initializePage()
 {
     bg2->setRide(wizard->ride2);
     smallPlot2->setData(wizard->ride2);
 
-    // Search channels to synchronise
-    watts = wizard->ride1->ride()->isDataPresent(RideFile::watts) &&
-                 wizard->ride2->isDataPresent(RideFile::watts);
-
-    cad = wizard->ride1->ride()->isDataPresent(RideFile::cad) &&
-               wizard->ride2->isDataPresent(RideFile::cad);
-
-    kph =  wizard->ride1->ride()->isDataPresent(RideFile::kph) &&
-                wizard->ride2->isDataPresent(RideFile::kph);
-
-    alt =  wizard->ride1->ride()->isDataPresent(RideFile::alt) &&
-                wizard->ride2->isDataPresent(RideFile::alt);
-
-    hr = wizard->ride1->ride()->isDataPresent(RideFile::hr) &&
-              wizard->ride2->isDataPresent(RideFile::hr);
-
-    seriesCount = 5; //watts, cad, kph, alt, hr;
-    samplesCount = 5;
-    samplesLength = 300;
-
     findBestDelay();
 }
 
-QVector<DataPoint*>
-MergeSync::getSamplesForRide(RideFile *ride1)
-{
-    QVector<DataPoint*> sample;
-    if (!ride1->isDataPresent(RideFile::secs))
-        return sample;
-
-    int index = 0;
-
-    double minTime = ride1->getMinPoint(RideFile::secs).toDouble();
-    double maxTime = ride1->getMaxPoint(RideFile::secs).toDouble();
-
-    DataPoint *previousPoint = new DataPoint(ride1->getPointValue(index, RideFile::secs),  ride1->getPointValue(index, RideFile::watts),  ride1->getPointValue(index, RideFile::cad),  ride1->getPointValue(index, RideFile::kph), ride1->getPointValue(index, RideFile::alt), ride1->getPointValue(index++, RideFile::hr));
-    DataPoint *currentPoint = new DataPoint(ride1->getPointValue(index, RideFile::secs),  ride1->getPointValue(index, RideFile::watts),  ride1->getPointValue(index, RideFile::cad),  ride1->getPointValue(index, RideFile::kph), ride1->getPointValue(index, RideFile::alt), ride1->getPointValue(index++, RideFile::hr));
-    DataPoint *nextPoint = new DataPoint(ride1->getPointValue(index, RideFile::secs),  ride1->getPointValue(index, RideFile::watts),  ride1->getPointValue(index, RideFile::cad),  ride1->getPointValue(index, RideFile::kph), ride1->getPointValue(index, RideFile::alt), ride1->getPointValue(index++, RideFile::hr));
-
-    for (int secs = minTime+1; secs < maxTime; ++secs) {
-        double hr = 0.0, watts = 0.0, alt = 0.0, cad = 0.0, kph = 0.0;
-        while (currentPoint->time <= secs) {
-            // current point
-            if (currentPoint->time>secs-1) {
-                double pond = (currentPoint->time-secs+1);
-                hr+=pond*currentPoint->hr;
-                watts+=pond*currentPoint->watts;
-                alt+=pond*currentPoint->alt;
-                cad+=pond*currentPoint->cad;
-                kph+=pond*currentPoint->kph;
-            }
-            previousPoint = currentPoint;
-            currentPoint = nextPoint;
-
-            //watts, cad, kph, alt, hr;
-            //if (secs < maxTime-ride1->recIntSecs())
-            if (index <= ride1->timeIndex(maxTime))
-                nextPoint = new DataPoint(ride1->getPointValue(index, RideFile::secs),  ride1->getPointValue(index, RideFile::watts),  ride1->getPointValue(index, RideFile::cad),  ride1->getPointValue(index, RideFile::kph), ride1->getPointValue(index, RideFile::alt), ride1->getPointValue(index++, RideFile::hr));
-        }
-        // next point
-        // pause ?
-        if (currentPoint->time>secs+300) {
-            secs = currentPoint->time;
-            continue;
-        }
-        // next point contribution
-        if (currentPoint->time>secs && previousPoint->time<secs) {
-            double pond = (secs-previousPoint->time);
-            hr+=pond*currentPoint->hr;
-            watts+=pond*currentPoint->watts;
-            alt+=pond*currentPoint->alt;
-            cad+=pond*currentPoint->cad;
-            kph+=pond*currentPoint->kph;
-        }
-
-        DataPoint *pt = new DataPoint(secs, watts, cad, kph, alt, hr);
-        sample.append(pt);
-    }
-    return sample;
-}
-
-void
-MergeSync::analyse(QVector<DataPoint*> points1, QVector<DataPoint*> points2, int analysesCount)
+bool
+MergeSync::isComplete() const
 {
-    for (int j=0;j<points2.count();j++) {
-        for (int sample=0;sample<samplesCount;sample++) {
-            DataPoint pt = diffForSeries(points1, points2, sample*samplesLength, samplesLength);
-            for (int series=0;series<seriesCount;series++) {
-                double r=1;
-                //watts, cad, kph, alt, hr;
-                if (series==0 && watts)
-                    r = pt.watts;
-                else if (series==1 && cad)
-                    r = pt.cad;
-                else if (series==2 && kph)
-                    r = pt.kph;
-                else if (series==3 && alt)
-                    r = pt.alt;
-                else if (series==4 && hr)
-                    r = pt.hr;
-
-                if (minR.count()<series+1) {
-                    minR.append(QList<double>());
-                }
-                if (minR[series].count()<sample+1+analysesCount*samplesCount) {
-                    minR[series].append(1);
-                }
-                if (delay.count()<series+1) {
-                    delay.append(QList<int>());
-                }
-                if (delay[series].count()<sample+1+analysesCount*samplesCount) {
-                    delay[series].append(1);
-                }
-
-                if ( r<minR[series][analysesCount*samplesCount+sample]) {
-                    minR[series][analysesCount*samplesCount+sample] = r;
-                    delay[series][analysesCount*samplesCount+sample] = (analysesCount?-1:1)*(j-sample*samplesLength);
-                }
-            }
-        }
-        points2.remove(0);
-    }
+    return aligner == NULL;
 }
 
 void
 MergeSync::findBestDelay()
 {
-    findDelays(wizard->ride1->ride(), wizard->ride2);
-    //printDelays();
-    int delay = bestDelay();
-    //printDelays();
-    setDelay(delay);
-}
+    if (aligner) return; // still working on it
 
-void
-MergeSync::findDelays(RideFile *ride1, RideFile *ride2)
-{
-    QVector<DataPoint*> sample1 = getSamplesForRide(ride1);
-    QVector<DataPoint*> sample2 = getSamplesForRide(ride2);
+    // resamples both rides then correlates them in the background
+    aligner = new MergeAlign(wizard->ride1->ride(), wizard->ride2);
+    connect(aligner, SIGNAL(finished()), this, SLOT(bestDelayFound()));
+
+    warning->setText(tr("Matching rides..."));
+    emit completeChanged();
 
-    analyse(sample1, sample2, 0);
-    analyse(sample2, sample1, 1);
+    aligner->start();
 }
 
 void
-MergeSync::printDelays()
+MergeSync::bestDelayFound()
 {
-    for (int series=0;series<seriesCount;series++) {
-        QString seriesName = "";
-        if (series==0)
-            seriesName = "watts";
-        else if (series==1)
-            seriesName = "cad";
-        else if (series==2)
-            seriesName = "kph";
-        else if (series==3)
-            seriesName = "alt";
-        else if (series==4)
-            seriesName = "hr";
-        fprintf(stderr, "  series %d %s\n", series, seriesName.toLatin1().constData());
-
-        for (int i=0;i<delay[series].count();i++) {
-            fprintf(stderr, "   delay for %d.%d: %d - %f\n", i, series, delay[series].at(i), minR[series].at(i));
-        }
-    }
-}
+    if (!aligner) return;
 
-int
-MergeSync::bestDelay()
-{
-    double minDiff=-1;
-    for (int series=0;series<seriesCount;series++) {
-        for (int i=0;i<delay[series].count();i++) {
-            if (minR[series][i]<minDiff || minDiff==-1) {
-                minDiff = minR[series][i];
-                i=-1;
-            }
-            else if (minR[series][i]>minDiff*3 || minR[series][i]>samplesLength/10000.0) {
-                delay[series].removeAt(i);
-                minR[series].removeAt(i);
-                i--;
-            }
-        }
-    }
+    // poor matches are usually by chance, e.g. both stopped at the same time
+    int delay = 0;
+    if (aligner->confidence() >= 0.3 && !aligner->matched().isEmpty()) {
+        QStringList names;
+        foreach(RideFile::SeriesType series, aligner->matched()) names << RideFile::seriesName(series);
 
-    int bestSeries = -1;
-    int bestSeriesValue = 1; //minimum 2 results in series to confirm
-
-    // No priority for a series
-    // Delay from series with more good results (more than 1)
-    // Only if value are in 10sec frame
-    int result = 0;
-    for (int series=0;series<seriesCount;series++) {
-        if (delay[series].count()>bestSeriesValue) {
-            double avg = delay[series].at(0);
-            int minDelay = delay[series].at(0);
-            int maxDelay = delay[series].at(0);
-            for (int i=1;i<delay[series].count();i++) {
-                avg += delay[series].at(i);
-                minDelay=qMin(minDelay,delay[series].at(i));
-                maxDelay=qMax(maxDelay,delay[series].at(i));
-            }
-            // Max difference 10 secs
-            if (maxDelay-minDelay<=10) {
-                result = round(avg/delay[series].count());
-                bestSeries = series;
-                bestSeriesValue = delay[series].count();
-            }
-        }
+        delay = aligner->delay();
+        warning->setText(QString(tr("Delay on matching %1 series (%2% confidence)."))
+                         .arg(names.join(", ")).arg(round(aligner->confidence() * 100)));
+    } else {
+        warning->setText(tr("Unable to match datas"));
     }
 
+    aligner->deleteLater();
+    aligner = NULL;
+    emit completeChanged();
 
-    if (bestSeries != -1) {
-        QString seriesName = "";
-        if (bestSeries==0)
-            seriesName = tr("watts");
-        else if (bestSeries==1)
-            seriesName = tr("cad");
-        else if (bestSeries==2)
-            seriesName = tr("kph");
-        else if (bestSeries==3)
-            seriesName = tr("alt");
-        else if (bestSeries==4)
-            seriesName = tr("hr");
-        warning->setText(QString("Delay on matching %1 series.").arg(seriesName));
-    } else
-        warning->setText(QString("Unable to match datas"));
-    return result;
+    setDelay(delay);
 }
 
 void
@@ -523,57 +352,6 @@ MergeSync::setDelayFromSlider()
     setDelay(delaySlider->value());
 }
 
-DataPoint
-MergeSync::diffForSeries(QVector<DataPoint*> a1, QVector<DataPoint*> a2, int start, int length)
-{
-    DataPoint result(1,1,1,1,1,1);
-    if (a1.count()-start < length  || a2.count()<length)
-        return result;
-
-    //watts, cad, kph, alt, hr;
-    double totalWatts = 0, totalCad = 0, totalKph = 0, totalAlt = 0, totalHr = 0;
-    double diffWatts = 0, diffCad = 0, diffKph = 0, diffAlt = 0, diffHr = 0;
-    double offsetAlt = 0;
-    double variabilityAlt = 0;
-
-    for (int i=0;i<length;i++)
-    {
-        if (hr) {
-            diffHr+=qAbs(a1[i+start]->hr-a2[i]->hr);
-            totalHr+=a1[i+start]->hr;
-        }
-        if (watts) {
-            diffWatts+=qAbs(a1[i+start]->watts-a2[i]->watts);
-            totalWatts+=a1[i+start]->watts;
-        }
-        if (cad) {
-            diffCad+=qAbs(a1[i+start]->cad-a2[i]->cad);
-            totalCad+=a1[i+start]->cad;
-        }
-        if (kph) {
-            diffKph+=qAbs(a1[i+start]->kph-a2[i]->kph);
-            totalKph+=a1[i+start]->kph;
-        }
-        if (alt) {
-            if (i==0)
-                offsetAlt = a1[i+start]->alt-a2[i]->alt;
-            else
-                variabilityAlt += qAbs(a1[i+start]->alt-a1[i+start-1]->alt);
-            diffAlt+=qAbs(a1[i+start]->alt-a2[i]->alt-offsetAlt);
-            totalAlt+=qAbs(a1[i+start]->alt);
-        }
-    }
-
-    result.alt = (totalAlt>0&variabilityAlt>samplesLength/4?diffAlt/totalAlt:1.0);
-    result.kph = (totalKph>0?diffKph/totalKph:1.0);
-    result.cad = (totalCad>0?diffCad/totalCad:1.0);
-    result.watts = (totalWatts>0?diffWatts/totalWatts:1.0);
-    result.hr = (totalHr>0?diffHr/totalHr:1.0);
-
-    //fprintf(stderr, "   pt alt:%f kph:%f cad:%f watts:%f hr:%f \n", result.alt, result.kph, result.cad, result.watts, result.hr);
-    return result;
-}
-
 // parameters
 MergeParameters::MergeParameters(MergeActivityWizard *parent) : QWizardPage(parent), wizard(parent)
 {
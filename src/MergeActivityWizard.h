@@ -49,13 +49,7 @@ class MergeParameters;
 class MergeSelect;
 class MergeConfirm;
 class MergeSyncBackground;
-
-struct DataPoint {
-    double time, watts, cad, kph, alt, hr;
-    //watts, cad, kph, alt, hr;
-    DataPoint(double t, double w, double c, double k, double a, double h ) :
-        time(t), watts(w), cad(c), kph(k), alt(a), hr(h) {}
-};
+class MergeAlign;
 
 class MergeActivityWizard : public QWizard
 {
@@ -158,8 +152,10 @@ class MergeSync : public QWizardPage
 
     public:
         MergeSync(MergeActivityWizard *);
+        ~MergeSync();
 
         void initializePage();
+        bool isComplete() const; // not whilst we are still matching
 
         QLabel *warning;
 
@@ -176,26 +172,15 @@ class MergeSync : public QWizardPage
         QLineEdit *delayEdit;
         QSlider *delaySlider;
 
-        int seriesCount, samplesCount, samplesLength;
-
-        bool watts, cad, kph, alt, hr;
-
-        QList<QList<int> > delay;
-        QList<QList<double> > minR;
-
+        MergeAlign *aligner; // running in the background
 
-        QVector<DataPoint*> getSamplesForRide(RideFile *ride1);
-        void analyse(QVector<DataPoint*> points1, QVector<DataPoint*> points2, int analysesCount);
-        void findDelays(RideFile *ride1, RideFile *ride2);
-        int bestDelay();
-        void printDelays();
-        DataPoint diffForSeries(QVector<DataPoint*> a1, QVector<DataPoint*> a2, int start, int length);
         void removeDelayFromRide( RideFile *ride, int delay );
 
         void setDelay(int delay);
 
     private slots:
         void findBestDelay();
+        void bestDelayFound();
         void setDelayFromLineEdit();
         void setDelayFromSlider();
 };
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MergeAlign.h"
+#include "GcTrace.h"
+
+#include <complex>
+#include <math.h>
+
+// a longer gap than this is a pause, not something to interpolate across
+static const double GAP = 10.0;
+
+// we need to overlap by at least 5 minutes, or half the shorter ride
+// if that is less, otherwise a few samples at either end will correlate
+// by chance
+static const int MINOVERLAP = 300;
+
+// a channel agrees if its own best delay is this close
+static const int AGREE = 10;
+
+typedef std::complex<double> Complex;
+
+// in place radix-2 fft, the size must be a power of two
+static void fft(QVector<Complex> &x, bool inverse)
+{
+    int n = x.count();
+    Complex *p = x.data();
+
+    // bit reversed order
+    for (int i=1, j=0; i<n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(p[i], p[j]);
+    }
+
+    // twiddles computed once, rather than accumulated, for accuracy
+    QVector<Complex> twiddle(n/2);
+    for (int k=0; k<n/2; k++) twiddle[k] = std::polar(1.0, (inverse ? 2 : -2) * M_PI * k / n);
+
+    for (int len=2; len<=n; len <<= 1) {
+        int half = len/2, step = n/len;
+        for (int i=0; i<n; i += len) {
+            for (int j=0; j<half; j++) {
+                Complex u = p[i+j];
+                Complex v = p[i+j+half] * twiddle[j*step];
+                p[i+j] = u + v;
+                p[i+j+half] = u - v;
+            }
+        }
+    }
+
+    if (inverse) for (int i=0; i<n; i++) p[i] /= double(n);
+}
+
+static double valueFor(const RideFilePoint *p, int channel)
+{
+    switch (channel) {
+    case 0 : return p->watts;
+    case 1 : return p->cad;
+    case 2 : return p->kph;
+    case 3 : return p->alt;
+    default:
+    case 4 : return p->hr;
+    }
+}
+
+RideFile::SeriesType
+MergeAlign::seriesFor(int channel)
+{
+    switch (channel) {
+    case WATTS : return RideFile::watts;
+    case CAD : return RideFile::cad;
+    case KPH : return RideFile::kph;
+    case ALT : return RideFile::alt;
+    default:
+    case HR : return RideFile::hr;
+    }
+}
+
+bool
+MergeAlign::presentIn(const RideFileDataPresent &present, int channel)
+{
+    switch (channel) {
+    case WATTS : return present.watts;
+    case CAD : return present.cad;
+    case KPH : return present.kph;
+    case ALT : return present.alt;
+    default:
+    case HR : return present.hr;
+    }
+}
+
+MergeAlign::MergeAlign(RideFile *ride1, RideFile *ride2, QObject *parent)
+    : QThread(parent), start1(0), start2(0), best(0), score(0)
+{
+    setSamples(ride1->dataPoints(), *ride1->areDataPresent(), ride2->dataPoints(), *ride2->areDataPresent());
+}
+
+MergeAlign::MergeAlign(const QVector<RideFilePoint*> &points1, const RideFileDataPresent &present1,
+                       const QVector<RideFilePoint*> &points2, const RideFileDataPresent &present2,
+                       QObject *parent)
+    : QThread(parent), start1(0), start2(0), best(0), score(0)
+{
+    setSamples(points1, present1, points2, present2);
+}
+
+void
+MergeAlign::setSamples(const QVector<RideFilePoint*> &points1, const RideFileDataPresent &present1,
+                       const QVector<RideFilePoint*> &points2, const RideFileDataPresent &present2)
+{
+    for (int i=0; i<CHANNELS; i++)
+        present[i] = presentIn(present1, i) && presentIn(present2, i);
+
+    // resampling is quick, and the rides aren't ours to read from another thread
+    resample(points1, samples1, start1);
+    resample(points2, samples2, start2);
+}
+
+void
+MergeAlign::resample(const QVector<RideFilePoint*> &points, QVector<double> *samples, int &start)
+{
+    if (points.count() < 2) return;
+
+    start = ceil(points.first()->secs);
+    int n = floor(points.last()->secs) - start + 1;
+    if (n < 2) return;
+
+    for (int i=0; i<CHANNELS; i++) samples[i].resize(n);
+
+    int index = 0;
+    for (int t=0; t<n; t++) {
+        double secs = start + t;
+
+        // the points either side
+        while (index+2 < points.count() && points[index+1]->secs < secs) index++;
+        const RideFilePoint *p = points[index];
+        const RideFilePoint *q = points[index+1];
+
+        double dt = q->secs - p->secs;
+        if (dt > GAP) {
+            // stopped, but we're still at the same altitude
+            for (int i=0; i<CHANNELS; i++) samples[i][t] = (i == ALT) ? p->alt : 0;
+            continue;
+        }
+
+        double w = dt > 0 ? qBound(0.0, (secs - p->secs) / dt, 1.0) : 0;
+        for (int i=0; i<CHANNELS; i++) {
+            double from = valueFor(p, i);
+            samples[i][t] = from + (valueFor(q, i) - from) * w;
+        }
+    }
+}
+
+QVector<double>
+MergeAlign::correlate(const QVector<double> &a, const QVector<double> &b)
+{
+    int na = a.count(), nb = b.count();
+
+    // centred, so the sums below don't lose precision on altitude
+    double ma = 0, mb = 0;
+    for (int i=0; i<na; i++) ma += a[i];
+    for (int i=0; i<nb; i++) mb += b[i];
+    ma /= na;
+    mb /= nb;
+
+    // prefix sums, for the mean and variance of the overlap at each lag
+    QVector<double> sa(na+1, 0), saa(na+1, 0), sb(nb+1, 0), sbb(nb+1, 0);
+    for (int i=0; i<na; i++) {
+        double v = a[i] - ma;
+        sa[i+1] = sa[i] + v;
+        saa[i+1] = saa[i] + v*v;
+    }
+    for (int i=0; i<nb; i++) {
+        double v = b[i] - mb;
+        sb[i+1] = sb[i] + v;
+        sbb[i+1] = sbb[i] + v*v;
+    }
+    if (saa[na] < 1e-6 || sbb[nb] < 1e-6) return QVector<double>(); // flat, e.g. no cadence sensor
+
+    // sum of a[i] * b[i+lag] for every lag at once, padded so it doesn't wrap
+    int n = 1;
+    while (n < na + nb) n <<= 1;
+    QVector<Complex> fa(n, 0), fb(n, 0);
+    for (int i=0; i<na; i++) fa[i] = a[i] - ma;
+    for (int i=0; i<nb; i++) fb[i] = b[i] - mb;
+    fft(fa, false);
+    fft(fb, false);
+    for (int i=0; i<n; i++) fa[i] = std::conj(fa[i]) * fb[i];
+    fft(fa, true);
+
+    QVector<double> returning(na + nb - 1, 0);
+    for (int lag = -(na-1); lag < nb; lag++) {
+        int lo = qMax(0, -lag);
+        int hi = qMin(na, nb - lag);
+        int count = hi - lo;
+
+        double suma = sa[hi] - sa[lo];
+        double sumb = sb[hi+lag] - sb[lo+lag];
+        double va = (saa[hi] - saa[lo]) - suma * suma / count;
+        double vb = (sbb[hi+lag] - sbb[lo+lag]) - sumb * sumb / count;
+        if (va < 1e-6 || vb < 1e-6) continue; // flat, nothing to match
+
+        double cov = fa[(lag + n) % n].real() - suma * sumb / count;
+        returning[lag + na - 1] = cov / sqrt(va * vb);
+    }
+    return returning;
+}
+
+void
+MergeAlign::run()
+{
+    GC_TRACE("MergeAlign::run", "merge");
+
+    int na = samples1[0].count();
+    int nb = samples2[0].count();
+    if (na < 2 || nb < 2) return;
+
+    int shorter = qMin(na, nb);
+    int overlap = qMin(MINOVERLAP, shorter / 2);
+
+    // lags with enough overlap
+    int from = overlap - na;    // lo = -lag, hi = nb - lag
+    int to = nb - overlap;
+
+    QVector<double> combined(na + nb - 1, 0);
+    QList<int> channels;
+    QList<int> bests;
+
+    for (int i=0; i<CHANNELS; i++) {
+        if (!present[i]) continue;
+
+        QVector<double> curve = correlate(samples1[i], samples2[i]);
+        if (curve.isEmpty()) continue;
+
+        int at = from;
+        for (int lag=from; lag<=to; lag++) {
+            combined[lag + na - 1] += curve[lag + na - 1];
+            if (curve[lag + na - 1] > curve[at + na - 1]) at = lag;
+        }
+        channels << i;
+        bests << at;
+    }
+    if (channels.isEmpty() || from > to) return;
+
+    int at = from;
+    for (int lag=from; lag<=to; lag++)
+        if (combined[lag + na - 1] > combined[at + na - 1]) at = lag;
+
+    best = at + start2 - start1;
+    score = qBound(0.0, combined[at + na - 1] / channels.count(), 1.0);
+
+    for (int i=0; i<channels.count(); i++)
+        if (qAbs(bests[i] - at) <= AGREE) agreed << seriesFor(channels[i]);
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_MergeAlign_h
+#define _GC_MergeAlign_h 1
+#include "GoldenCheetah.h"
+
+#include <QThread>
+#include <QVector>
+#include <QList>
+
+#include "RideFile.h"
+
+// Finds the delay between two recordings of the same ride, e.g. from
+// a head unit and a power meter, for the merge wizard.
+//
+// Both rides are resampled to 1 second, in contiguous arrays, when we
+// are constructed. Then, in the thread, each channel present in both
+// is cross correlated at every possible delay with FFTs and normalised
+// over the samples that overlap at that delay. The channels are
+// averaged and the delay with the highest correlation wins, the
+// correlation there is the confidence, from 0 to 1.
+//
+// The delay is in the sense the merge uses; a sample at secs in the
+// first ride is matched with secs + delay in the second.
+//
+class MergeAlign : public QThread
+{
+    Q_OBJECT
+
+    public:
+        MergeAlign(RideFile *ride1, RideFile *ride2, QObject *parent = 0);
+
+        // the same from the samples and what is present in each
+        MergeAlign(const QVector<RideFilePoint*> &points1, const RideFileDataPresent &present1,
+                   const QVector<RideFilePoint*> &points2, const RideFileDataPresent &present2,
+                   QObject *parent = 0);
+
+        // once finished
+        int delay() const { return best; }
+        double confidence() const { return score; }
+        QList<RideFile::SeriesType> matched() const { return agreed; } // channels with the same delay
+
+    protected:
+        void run();
+
+    private:
+        enum { WATTS, CAD, KPH, ALT, HR, CHANNELS };
+        static RideFile::SeriesType seriesFor(int channel);
+        static bool presentIn(const RideFileDataPresent &present, int channel);
+
+        void setSamples(const QVector<RideFilePoint*> &points1, const RideFileDataPresent &present1,
+                        const QVector<RideFilePoint*> &points2, const RideFileDataPresent &present2);
+
+        // 1s samples from the first whole second of the ride
+        void resample(const QVector<RideFilePoint*> &points, QVector<double> *samples, int &start);
+
+        // correlation for every lag of b against a, from -(na-1) to nb-1
+        QVector<double> correlate(const QVector<double> &a, const QVector<double> &b);
+
+        QVector<double> samples1[CHANNELS], samples2[CHANNELS];
+        int start1, start2;
+        bool present[CHANNELS];
+
+        int best;
+        double score;
+        QList<RideFile::SeriesType> agreed;
+};
+
+#endif // _GC_MergeAlign_h
@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MetadataIndex.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "DBAccess.h"
+#include "RideFile.h"
+#include "RideMetadata.h"
+#include "SummaryMetrics.h"
+
+#include <QFile>
+#include <QSet>
+#include <QDataStream>
+#include <QRegExp>
+#include <algorithm>
+
+// file format
+static const quint32 MetadataIndexMagic = 0x67636d69; // 'gcmi'
+static const quint32 MetadataIndexVersion = 1;
+
+// same as the Lucene StandardAnalyzer
+static const char *stopwords[] = {
+    "a", "an", "and", "are", "as", "at", "be", "but", "by", "for", "if", "in",
+    "into", "is", "it", "no", "not", "of", "on", "or", "such", "that", "the",
+    "their", "then", "there", "these", "they", "this", "to", "was", "will",
+    "with", NULL
+};
+
+MetadataIndex::MetadataIndex(QObject *parent, Context *context) : QObject(parent), context(context),
+    deletedCount(0), created(false), dirty(false)
+{
+    filename = context->athlete->home.absolutePath() + "/metadata.idx";
+    fields = textFields();
+    foreach(QString field, fields) technames << context->specialFields.makeTechName(field);
+    read();
+}
+
+MetadataIndex::~MetadataIndex()
+{
+    write();
+}
+
+QStringList
+MetadataIndex::textFields()
+{
+    QStringList returning;
+    foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
+        if (!context->specialFields.isMetric(field.name) && (field.type < 3 || field.type == 7))
+            returning << field.name;
+    }
+    return returning;
+}
+
+/*----------------------------------------------------------------------
+ * Maintaining the index
+ *----------------------------------------------------------------------*/
+
+bool
+MetadataIndex::importRide(SummaryMetrics *, RideFile *ride, QColor, unsigned long, bool)
+{
+    QStringList values;
+    foreach(QString field, fields) values << ride->getTag(field, "");
+    add(ride->getTag("Filename", ""), values);
+    return true;
+}
+
+bool
+MetadataIndex::deleteRide(QString name)
+{
+    int doc = docByName.value(name, -1);
+    if (doc < 0) return false;
+
+    docs[doc].deleted = true;
+    docByName.remove(name);
+    deletedCount++;
+    dirty = true;
+
+    // postings for deleted rides are skipped when searching
+    // but once there are lots of them we tidy up
+    if (deletedCount > 100 && deletedCount > docs.count() / 2) rebuild();
+
+    return true;
+}
+
+void
+MetadataIndex::add(QString name, QStringList values)
+{
+    deleteRide(name);
+
+    Document add;
+    add.filename = name;
+    add.values = values;
+    add.deleted = false;
+
+    docs << add;
+    docByName.insert(name, docs.count()-1);
+    post(docs.count()-1);
+    dirty = true;
+}
+
+void
+MetadataIndex::post(int doc)
+{
+    // docs are always posted in ascending order so the
+    // posting lists stay sorted by doc, field and position
+    const Document &d = docs[doc];
+    for (int field=0; field < d.values.count(); field++) {
+        QStringList tokens = tokenise(d.values[field]);
+        for (int position=0; position < tokens.count(); position++) {
+            Posting p;
+            p.doc = doc;
+            p.field = field;
+            p.position = position;
+            postings[tokens[position]].append(p);
+        }
+    }
+}
+
+void
+MetadataIndex::rebuild()
+{
+    QVector<Document> live;
+    foreach(const Document &d, docs) if (!d.deleted) live << d;
+
+    docs = live;
+    docByName.clear();
+    postings.clear();
+    deletedCount = 0;
+
+    for (int i=0; i<docs.count(); i++) {
+        docByName.insert(docs[i].filename, i);
+        post(i);
+    }
+}
+
+void
+MetadataIndex::reindex(DBAccess *db)
+{
+    // get the metadata texts from the metrics table, filename first
+    QString select = "SELECT filename";
+    foreach(QString techname, technames) select += QString(", Z%1").arg(techname);
+    select += " FROM metrics;";
+
+    docs.clear();
+    QSqlQuery query(db->connection());
+    bool rc = query.exec(select);
+    while (rc && query.next()) {
+        Document add;
+        add.filename = query.value(0).toString();
+        add.deleted = false;
+        for (int i=0; i<fields.count(); i++) add.values << query.value(i+1).toString();
+        docs << add;
+    }
+    query.finish();
+
+    rebuild();
+    created = false;
+    dirty = true;
+}
+
+/*----------------------------------------------------------------------
+ * Persistence
+ *----------------------------------------------------------------------*/
+
+void
+MetadataIndex::read()
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        created = true;
+        return;
+    }
+
+    QDataStream in(&file);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != MetadataIndexMagic || version != MetadataIndexVersion) {
+        created = true;
+        return;
+    }
+
+    // the fields may have changed since we wrote the
+    // file so we map them across by name
+    QStringList stored;
+    in >> stored;
+    QVector<int> map(fields.count());
+    for (int i=0; i<fields.count(); i++) map[i] = stored.indexOf(fields[i]);
+
+    quint32 count;
+    in >> count;
+    for (quint32 i=0; i<count && in.status() == QDataStream::Ok; i++) {
+        QString name;
+        QStringList values;
+        in >> name >> values;
+
+        Document add;
+        add.filename = name;
+        add.deleted = false;
+        for (int j=0; j<fields.count(); j++) add.values << (map[j] >= 0 ? values.value(map[j]) : QString());
+        docs << add;
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        docs.clear();
+        created = true;
+    }
+    rebuild();
+}
+
+void
+MetadataIndex::write()
+{
+    if (!dirty) return;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+
+    QDataStream out(&file);
+    out << MetadataIndexMagic << MetadataIndexVersion;
+    out << fields;
+    out << quint32(docByName.count());
+    foreach(const Document &d, docs) {
+        if (d.deleted) continue;
+        out << d.filename << d.values;
+    }
+    file.close();
+    dirty = false;
+}
+
+/*----------------------------------------------------------------------
+ * Searching
+ *----------------------------------------------------------------------*/
+
+QStringList
+MetadataIndex::tokenise(QString text)
+{
+    static QSet<QString> stop;
+    if (stop.isEmpty()) for (int i=0; stopwords[i]; i++) stop.insert(stopwords[i]);
+
+    QStringList tokens;
+    QString current;
+    for (int i=0; i <= text.length(); i++) {
+        if (i < text.length() && text[i].isLetterOrNumber()) {
+            current += text[i].toLower();
+        } else if (!current.isEmpty()) {
+            if (!stop.contains(current)) tokens << current;
+            current.clear();
+        }
+    }
+    return tokens;
+}
+
+QVector<int>
+MetadataIndex::term(QString token, int field, bool prefix)
+{
+    QVector<int> returning;
+
+    QMap<QString, QVector<Posting> >::const_iterator it = postings.lowerBound(token);
+    for (; it != postings.constEnd(); ++it) {
+
+        if (prefix ? !it.key().startsWith(token) : it.key() != token) break;
+
+        int last = -1;
+        foreach(const Posting &p, it.value()) {
+            if (p.doc == last || docs[p.doc].deleted) continue;
+            if (field >= 0 && p.field != field) continue;
+            returning << p.doc;
+            last = p.doc;
+        }
+    }
+
+    // prefix matches from several terms need merging
+    if (prefix) {
+        std::sort(returning.begin(), returning.end());
+        returning.erase(std::unique(returning.begin(), returning.end()), returning.end());
+    }
+    return returning;
+}
+
+QVector<int>
+MetadataIndex::phrase(QStringList tokens, int field)
+{
+    QVector<int> returning;
+    if (tokens.isEmpty()) return returning;
+    if (tokens.count() == 1) return term(tokens[0], field, false);
+
+    // where each of the later tokens appear
+    QVector<QSet<qint64> > at(tokens.count());
+    for (int i=1; i<tokens.count(); i++) {
+        foreach(const Posting &p, postings.value(tokens[i]))
+            at[i].insert((qint64(p.doc) << 32) | (qint64(p.field) << 20) | p.position);
+    }
+
+    int last = -1;
+    foreach(const Posting &p, postings.value(tokens[0])) {
+        if (p.doc == last || docs[p.doc].deleted) continue;
+        if (field >= 0 && p.field != field) continue;
+
+        bool match = true;
+        for (int i=1; match && i<tokens.count(); i++)
+            match = at[i].contains((qint64(p.doc) << 32) | (qint64(p.field) << 20) | (p.position + i));
+
+        if (match) {
+            returning << p.doc;
+            last = p.doc;
+        }
+    }
+    return returning;
+}
+
+QList<QString>
+MetadataIndex::search(QString query)
+{
+    enum { should, must, mustnot };
+    filenames.clear();
+
+    QList<QVector<int> > clauses;
+    QList<int> occurs;
+
+    int occur = should;
+    bool andnext = false;
+    int i = 0;
+    while (i < query.length()) {
+
+        // whitespace and grouping
+        if (query[i].isSpace() || query[i] == '(' || query[i] == ')') { i++; continue; }
+
+        if (query[i] == '+') { occur = must; i++; continue; }
+        if (query[i] == '-') { occur = mustnot; i++; continue; }
+
+        // field:
+        int field = -1;
+        int colon = query.indexOf(':', i);
+        int space = query.indexOf(QRegExp("[\\s\"]"), i);
+        if (colon > i && (space < 0 || colon < space)) {
+            QString name = query.mid(i, colon-i);
+            for (int f=0; f<technames.count(); f++)
+                if (technames[f].compare(name, Qt::CaseInsensitive) == 0 ||
+                    fields[f].compare(name, Qt::CaseInsensitive) == 0) field = f;
+            i = colon + 1;
+        }
+
+        QVector<int> matched;
+        if (i < query.length() && query[i] == '"') {
+
+            // "a phrase"
+            int close = query.indexOf('"', i+1);
+            if (close < 0) close = query.length();
+            matched = phrase(tokenise(query.mid(i+1, close-i-1)), field);
+            i = close + 1;
+
+        } else {
+
+            int end = i;
+            while (end < query.length() && !query[end].isSpace() && query[end] != ')') end++;
+            QString word = query.mid(i, end-i);
+            i = end;
+
+            // operators
+            if (word == "AND") {
+                if (!occurs.isEmpty() && occurs.last() == should) occurs.last() = must;
+                andnext = true;
+                continue;
+            }
+            if (word == "OR") continue;
+            if (word == "NOT") { occur = mustnot; continue; }
+
+            bool prefix = word.endsWith("*");
+            if (prefix) word.chop(1);
+
+            QStringList tokens = tokenise(word);
+            if (tokens.isEmpty()) { occur = should; andnext = false; continue; } // just stop words
+            if (prefix && tokens.count() == 1) matched = term(tokens[0], field, true);
+            else matched = phrase(tokens, field);
+        }
+
+        if (andnext && occur == should) occur = must;
+        clauses << matched;
+        occurs << occur;
+        occur = should;
+        andnext = false;
+    }
+
+    // combine the clauses
+    QVector<int> result;
+    bool required = occurs.contains(must);
+    bool first = true;
+    for (int c=0; c<clauses.count(); c++) {
+
+        QVector<int> merged;
+        if (required && occurs[c] == must) {
+            if (first) merged = clauses[c];
+            else std::set_intersection(result.begin(), result.end(), clauses[c].begin(), clauses[c].end(),
+                                       std::back_inserter(merged));
+            first = false;
+        } else if (!required && occurs[c] == should) {
+            std::set_union(result.begin(), result.end(), clauses[c].begin(), clauses[c].end(),
+                           std::back_inserter(merged));
+        } else continue;
+        result = merged;
+    }
+    for (int c=0; c<clauses.count(); c++) {
+        if (occurs[c] != mustnot) continue;
+        QVector<int> merged;
+        std::set_difference(result.begin(), result.end(), clauses[c].begin(), clauses[c].end(),
+                            std::back_inserter(merged));
+        result = merged;
+    }
+
+    foreach(int doc, result) filenames << docs[doc].filename;
+
+    emit results(filenames);
+
+    return filenames;
+}
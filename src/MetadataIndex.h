@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_MetadataIndex_h
+#define _GC_MetadataIndex_h
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QHash>
+#include <QColor>
+#include <QDir>
+
+#include "Context.h"
+
+class SummaryMetrics;
+class RideFile;
+class DBAccess;
+
+//
+// A simple inverted index over the ride metadata text fields
+//
+// Used for free text search when we are built without CLucene, it
+// offers the same interface as the Lucene class so it is driven from
+// the same places in MetricAggregator and SearchFilterBox.
+//
+// Texts are tokenised (lowercase, split on anything that isn't a
+// letter or digit, english stop words dropped) and we keep a posting
+// for every token with the ride, field and position. Terms are held in
+// a sorted map so prefix queries are a range scan.
+//
+// The query syntax is a subset of the Lucene query parser:
+//
+//     word  word*  "a phrase"  field:word  +word  -word  AND OR NOT
+//
+// with terms OR'd together by default, as with Lucene.
+//
+// The stored texts are written to 'metadata.idx' alongside the metrics
+// DB and the postings are rebuilt from them when we start.
+//
+class MetadataIndex : public QObject
+{
+    Q_OBJECT
+
+    public:
+        MetadataIndex(QObject *parent, Context *context);
+        ~MetadataIndex();
+
+        // Create/Delete - same hooks as DBAccess
+        bool importRide(SummaryMetrics *summaryMetrics, RideFile *ride, QColor color, unsigned long, bool);
+        bool deleteRide(QString);
+
+        // there was no index file so needs a full reindex
+        bool needsReindex() const { return created; }
+
+        // rebuild from the metadata already held in the metrics table
+        void reindex(DBAccess *db);
+
+        // save to disk if anything changed
+        void write();
+
+        QStringList &files() { return filenames; }
+
+    public slots:
+        // search
+        QList<QString> search(QString query); // run query and return files matching
+
+    signals:
+        void results(QStringList);
+
+    private:
+        Context *context;
+        QString filename; // where we persist
+
+        struct Posting {
+            int doc, field, position;
+        };
+        struct Document {
+            QString filename;
+            QStringList values; // one per field
+            bool deleted;
+        };
+
+        // the fields we index, same as Lucene
+        QStringList fields;
+        QStringList technames;
+        QStringList textFields();
+
+        // the index
+        QVector<Document> docs;
+        QHash<QString, int> docByName;
+        QMap<QString, QVector<Posting> > postings;
+        int deletedCount;
+
+        bool created, dirty;
+        QStringList filenames; // last results
+
+        void read();
+        void add(QString filename, QStringList values);
+        void rebuild(); // drop deleted documents and repost
+        void post(int doc);
+
+        // query evaluation
+        static QStringList tokenise(QString text);
+        QVector<int> term(QString token, int field, bool prefix);
+        QVector<int> phrase(QStringList tokens, int field);
+};
+
+#endif
@@ -23,8 +23,12 @@
 #include "DBAccess.h"
 #include "RideFile.h"
 #include "RideFileCache.h"
+#include "RideDensityCache.h"
+#include "RideFileCacheRefresher.h"
 #ifdef GC_HAVE_LUCENE
 #include "Lucene.h"
+#else
+#include "MetadataIndex.h"
 #endif
 #include "Zones.h"
 #include "HrZones.h"
@@ -32,14 +36,20 @@
 #include "RideItem.h"
 #include "RideMetric.h"
 #include "TimeUtils.h"
+#include "GcTrace.h"
 #include <math.h>
 #include <QtXml/QtXml>
 #include <QProgressDialog>
 
 MetricAggregator::MetricAggregator(Context *context) : QObject(context), context(context), first(true)
 {
+    threads = QThread::idealThreadCount();
+    if (threads < 1) threads = 1;
+
     colorEngine = new ColorEngine(context);
     dbaccess = new DBAccess(context);
+    metricstore = new MetricStore(dbaccess);
+    cacherefresher = new RideFileCacheRefresher(this, context);
     connect(context, SIGNAL(configChanged()), this, SLOT(update()));
     connect(context, SIGNAL(rideClean(RideItem*)), this, SLOT(update(void)));
     connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(addRide(RideItem*)));
@@ -48,7 +58,9 @@ MetricAggregator::MetricAggregator(Context *context) : QObject(context), context
 
 MetricAggregator::~MetricAggregator()
 {
+    delete cacherefresher; // stops its threads
     delete colorEngine;
+    delete metricstore;
     delete dbaccess;
 }
 
@@ -89,6 +101,12 @@ void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
     // only if we have established a connection to the database
     if (dbaccess == NULL || context->athlete->isclean==true) return;
 
+    GC_TRACE("MetricAggregator::refreshMetrics", "metrics");
+
+    // the cpx files are checked again when we're done, the zones
+    // may have changed so whatever it was doing might be wrong
+    cacherefresher->abort();
+
     // first check db structure is still up to date
     // this is because metadata.xml may add new fields
     dbaccess->checkDBVersion();
@@ -113,13 +131,26 @@ void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
     // begin LUW -- byproduct of turning off sync (nosync)
     dbaccess->connection().transaction();
 
+#ifdef GC_HAVE_LUCENE
+    // a new index gets everything we already know about
+    if (context->athlete->lucene->needsReindex()) context->athlete->lucene->reindex(dbaccess);
+
+    // and all the updates below go through a single writer
+    context->athlete->lucene->beginBatch();
+#else
+    if (context->athlete->metadataIndex->needsReindex()) context->athlete->metadataIndex->reindex(dbaccess);
+#endif
+
     // Delete statistics for non-existant ride files
     QHash<QString, status>::iterator d;
     for (d = dbStatus.begin(); d != dbStatus.end(); ++d) {
         if (QFile(context->athlete->home.absolutePath() + "/" + d.key()).exists() == false) {
             dbaccess->deleteRide(d.key());
+            metricstore->deleteRide(d.key());
 #ifdef GC_HAVE_LUCENE
             context->athlete->lucene->deleteRide(d.key());
+#else
+            context->athlete->metadataIndex->deleteRide(d.key());
 #endif
         }
     }
@@ -127,6 +158,25 @@ void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
     unsigned long zoneFingerPrint = static_cast<unsigned long>(context->athlete->zones()->getFingerprint())
                                   + static_cast<unsigned long>(context->athlete->hrZones()->getFingerprint()); // checksum of *all* zone data (HR and Power)
 
+    // which rides are missing or out of date? their metrics
+    // are computed on a pool of threads and collected below
+    QStringList stale;
+    foreach (QString name, filenames) {
+        status current = dbStatus.value(name);
+        if (current.timestamp < QFileInfo(context->athlete->home.absolutePath() + "/" + name).lastModified().toTime_t() ||
+            zoneFingerPrint != current.fingerprint ||
+            (!forceAfterThisDate.isNull() && name >= forceAfterThisDate.toString("yyyy_MM_dd_hh_mm_ss"))) {
+            stale << name;
+        }
+    }
+    GC_TRACE_COUNTER("stale rides", stale.count());
+
+    // quicker to load the store again than to keep it up to date
+    // ride by ride when most of them are changing
+    if (stale.count() > 50) metricstore->clear();
+
+    MetricRefresher refresher(this, context, stale, threads);
+
     // update statistics for ride files which are out of date
     // showing a progress bar as we go
     QTime elapsed;
@@ -134,7 +184,7 @@ void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
     QString title = tr("Updating Statistics\nStarted");
     QProgressDialog *bar = NULL;
 
-    int processed=0;
+    int processed=0, next=0;
     QApplication::processEvents(); // get that dialog up!
 
     // log of progress
@@ -146,20 +196,18 @@ void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
 
     while (i.hasNext()) {
         QString name = i.next();
-        QFile file(context->athlete->home.absolutePath() + "/" + name);
 
         // if it s missing or out of date then update it!
-        status current = dbStatus.value(name);
-        unsigned long dbTimeStamp = current.timestamp;
-        unsigned long fingerprint = current.fingerprint;
+        unsigned long dbTimeStamp = dbStatus.value(name).timestamp;
 
         RideFile *ride = NULL;
 
         processed++;
 
         // create the dialog if we need to show progress for long running uodate
+        // there isn't one when running headless
         long elapsedtime = elapsed.elapsed();
-        if ((first || elapsedtime > 6000) && bar == NULL) {
+        if (context->mainWindow && (first || elapsedtime > 6000) && bar == NULL) {
             bar = new QProgressDialog(title, tr("Abort"), 0, filenames.count()); // not owned by mainwindow
             bar->setWindowFlags(bar->windowFlags() | Qt::FramelessWindowHint);
             bar->setWindowModality(Qt::WindowModal);
@@ -168,7 +216,7 @@ void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
         }
 
         // update the dialog always after 6 seconds
-        if (first || elapsedtime > 6000) {
+        if (bar && (first || elapsedtime > 6000)) {
 
             // update progress bar
             QString elapsedString = QString("%1:%2:%3").arg(elapsedtime/3600000,2)
@@ -180,40 +228,28 @@ void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
         }
         QApplication::processEvents();
 
-        if (dbTimeStamp < QFileInfo(file).lastModified().toTime_t() ||
-            zoneFingerPrint != fingerprint ||
-            (!forceAfterThisDate.isNull() && name >= forceAfterThisDate.toString("yyyy_MM_dd_hh_mm_ss"))) {
-            QStringList errors;
-
-            // log
-            out << "Opening ride: " << name << "\r\n";
-
-            // read file and process it if we didn't already...
-            if (ride == NULL) ride = RideFileFactory::instance().openRideFile(context, file, errors);
+        if (next < stale.count() && stale[next] == name) {
 
-            out << "File open completed: " << name << "\r\n";
+            // collect from the threads, keeping the dialog alive whilst we wait
+            MetricRefreshResult result;
+            while (!refresher.collect(result, 100)) QApplication::processEvents();
+            next++;
 
-            if (ride != NULL) {
+            ride = result.ride;
+            out << "Collected ride: " << name << "\r\n";
 
-                out << "Getting weight: " << name << "\r\n";
-                ride->getWeight();
+            if (ride != NULL && result.computed) {
                 out << "Updating statistics: " << name << "\r\n";
-                importRide(context->athlete->home, ride, name, zoneFingerPrint, (dbTimeStamp > 0));
-
+                storeRide(result.metrics, result.intervals, result.track, ride, zoneFingerPrint, (dbTimeStamp > 0));
             }
         }
 
-        // update cache (will check timestamps itself)
-        // if ride wasn't opened it will do it itself
-        // we only want to check so passing check=true
-        // because we don't actually want the results now
-        RideFileCache updater(context, context->athlete->home.absolutePath() + "/" + name, ride, true);
-
         // free memory - if needed
         if (ride) delete ride;
 
         if (bar && bar->wasCanceled()) {
             out << "METRIC REFRESH CANCELLED\r\n";
+            refresher.abort();
             break;
         }
     }
@@ -226,13 +262,21 @@ void MetricAggregator::refreshMetrics(QDateTime forceAfterThisDate)
     dbaccess->connection().commit();
 
 #ifdef GC_HAVE_LUCENE
-#ifndef WIN32 // windows crashes here....
-    out << "OPTIMISE: " << QDateTime::currentDateTime().toString() + "\r\n";
-    context->athlete->lucene->optimise();
-#endif
+    // closes the writer and optimises in the background
+    out << "END INDEX BATCH: " << QDateTime::currentDateTime().toString() + "\r\n";
+    context->athlete->lucene->endBatch();
+#else
+    out << "SAVE INDEX: " << QDateTime::currentDateTime().toString() + "\r\n";
+    context->athlete->metadataIndex->write();
 #endif
     context->athlete->isclean = true;
 
+    // update the cpx files in the background, when running headless
+    // the caller expects them to be up to date when we return
+    out << "CPX REFRESH STARTS: " << QDateTime::currentDateTime().toString() + "\r\n";
+    cacherefresher->refresh();
+    if (!context->mainWindow) cacherefresher->wait();
+
     // stop logging
     out << "SIGNAL DATA CHANGED: " << QDateTime::currentDateTime().toString() + "\r\n";
     dataChanged(); // notify models/views
@@ -253,20 +297,36 @@ void MetricAggregator::addRide(RideItem*ride)
     if (ride && ride->ride()) {
         importRide(context->athlete->home, ride->ride(), ride->fileName, context->athlete->zones()->getFingerprint(), true);
         RideFileCache updater(context, context->athlete->home.absolutePath() + "/" + ride->fileName, ride->ride(), true); // update cpx etc
+        RideDensityCache density(context, context->athlete->home.absolutePath() + "/" + ride->fileName, ride->ride()); // and the cpd
         dataChanged(); // notify models/views
     }
 }
 
+void MetricAggregator::setThreads(int threads)
+{
+    this->threads = threads > 0 ? threads : 1;
+    cacherefresher->setThreads(this->threads);
+}
+
 void MetricAggregator::update() {
     context->athlete->isclean = false;
     refreshMetrics();
 }
 
-bool MetricAggregator::importRide(QDir path, RideFile *ride, QString fileName, unsigned long fingerprint, bool modify)
+bool MetricAggregator::importRide(QDir, RideFile *ride, QString fileName, unsigned long fingerprint, bool modify)
 {
     SummaryMetrics summaryMetric;
-    QFile file(path.absolutePath() + "/" + fileName);
+    if (!computeRide(ride, fileName, summaryMetric)) return false; // not a ridefile!
 
+    QList<SummaryMetrics> intervals;
+    computeIntervals(ride, intervals);
+
+    storeRide(summaryMetric, intervals, RouteTrack(ride), ride, fingerprint, modify);
+    return true;
+}
+
+bool MetricAggregator::computeRide(RideFile *ride, QString fileName, SummaryMetrics &summaryMetric)
+{
     QRegExp rx = RideFileFactory::instance().rideFileRegExp();
     if (!rx.exactMatch(fileName)) {
         return false; // not a ridefile!
@@ -295,15 +355,74 @@ bool MetricAggregator::importRide(QDir path, RideFile *ride, QString fileName, u
         summaryMetric.setForSymbol(factory.metricName(i), computed.value(factory.metricName(i))->value(true));
     }
 
+    return true;
+}
+
+// metrics for each of the ride's intervals, like the interval summary
+// but all of them, so they can be charted and filtered across seasons.
+// the ride's weight must already be known when we are on a refresh thread
+void MetricAggregator::computeIntervals(RideFile *ride, QList<SummaryMetrics> &intervals)
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    QStringList metrics;
+
+    for (int i = 0; i < factory.metricCount(); ++i)
+        metrics << factory.metricName(i);
+
+    foreach (RideFileInterval interval, ride->intervals()) {
+
+        // the interval on its own, with the ride's tags for
+        // metrics that care about the sport and the weight
+        RideFile f(ride->startTime(), ride->recIntSecs());
+        f.context = context;
+        f.setDeviceType(ride->deviceType());
+        QMapIterator<QString,QString> tag(ride->tags());
+        while (tag.hasNext()) {
+            tag.next();
+            f.setTag(tag.key(), tag.value());
+        }
+        f.setTag("Weight", QString("%1").arg(ride->getWeight()));
+
+        int start = ride->timeIndex(interval.start);
+        int end = ride->timeIndex(interval.stop);
+        // as the interval summary, this form notes which data is present
+        for (int i = start; i >= 0 && i <= end && i < ride->dataPoints().count(); ++i) {
+            const RideFilePoint *p = ride->dataPoints()[i];
+            f.appendPoint(p->secs, p->cad, p->hr, p->km, p->kph, p->nm,
+                          p->watts, p->alt, p->lon, p->lat, p->headwind, p->slope, p->temp, p->lrbalance, 0);
+        }
+
+        SummaryMetrics summaryMetric;
+        summaryMetric.setText("Interval Name", interval.name);
+        summaryMetric.setForSymbol("Interval Start", interval.start);
+        summaryMetric.setForSymbol("Interval Stop", interval.stop);
+
+        // an empty interval is kept, with no metrics, so the numbering
+        // matches the ride's
+        if (f.dataPoints().count()) {
+            QHash<QString, RideMetricPtr> computed = RideMetric::computeMetrics(context, &f, context->athlete->zones(), context->athlete->hrZones(), metrics);
+            for(int i = 0; i < factory.metricCount(); ++i)
+                summaryMetric.setForSymbol(factory.metricName(i), computed.value(factory.metricName(i))->value(true));
+        }
+        intervals << summaryMetric;
+    }
+}
+
+void MetricAggregator::storeRide(SummaryMetrics &summaryMetric, QList<SummaryMetrics> &intervals, const RouteTrack &track,
+                                 RideFile *ride, unsigned long fingerprint, bool modify)
+{
     // what color will this ride be?
     QColor color = colorEngine->colorFor(ride->getTag(context->athlete->rideMetadata()->getColorField(), ""));
 
     dbaccess->importRide(&summaryMetric, ride, color, fingerprint, modify);
+    metricstore->importRide(summaryMetric.getFileName());
+    dbaccess->importIntervals(&summaryMetric, intervals, fingerprint);
+    dbaccess->importTrack(&summaryMetric, track, fingerprint);
 #ifdef GC_HAVE_LUCENE
     context->athlete->lucene->importRide(&summaryMetric, ride, color, fingerprint, modify);
+#else
+    context->athlete->metadataIndex->importRide(&summaryMetric, ride, color, fingerprint, modify);
 #endif
-
-    return true;
 }
 
 void
@@ -315,18 +434,18 @@ MetricAggregator::importMeasure(SummaryMetrics *sm)
 /*----------------------------------------------------------------------
  * Query functions are wrappers around DBAccess functions
  *----------------------------------------------------------------------*/
-void
+bool
 MetricAggregator::writeAsCSV(QString filename)
 {
     // write all metrics as a CSV file
     QList<SummaryMetrics> all = getAllMetricsFor(QDateTime(), QDateTime());
 
     // write headings
-    if (!all.count()) return; // no dice
+    if (!all.count()) return false; // no dice
 
     // open file.. truncate if exists already
     QFile file(filename);
-    file.open(QFile::WriteOnly);
+    if (!file.open(QFile::WriteOnly)) return false;
     file.resize(0);
     QTextStream out(&file);
 
@@ -353,6 +472,7 @@ MetricAggregator::writeAsCSV(QString filename)
         out<<"\n";
     }
     file.close();
+    return true;
 }
 
 QList<SummaryMetrics>
@@ -374,14 +494,81 @@ MetricAggregator::getAllMetricsFor(QDateTime start, QDateTime end)
         return empty;
     }
 
-    // apparently using transactions for queries
-    // can improve performance!
+    // only goes to the DB the first time
+    return metricstore->getAllMetricsFor(start, end);
+}
+
+MetricSlice
+MetricAggregator::getMetricSlice(DateRange dr)
+{
+    return getMetricSlice(QDateTime(dr.from, QTime(0,0,0)), QDateTime(dr.to, QTime(23,59,59)));
+}
+
+MetricSlice
+MetricAggregator::getMetricSlice(QDateTime start, QDateTime end)
+{
+    if (context->athlete->isclean == false) refreshMetrics(); // get them up-to-date
+
+    // only if we have established a connection to the database
+    if (dbaccess == NULL) {
+        qDebug()<<"lost db connection?";
+        return MetricSlice();
+    }
+
+    // only goes to the DB the first time
+    return metricstore->slice(start, end);
+}
+
+QList<SummaryMetrics>
+MetricAggregator::getAllIntervalsFor(DateRange dr, QString name)
+{
+    return getAllIntervalsFor(QDateTime(dr.from, QTime(0,0,0)), QDateTime(dr.to, QTime(23,59,59)), name);
+}
+
+QList<SummaryMetrics>
+MetricAggregator::getAllIntervalsFor(QDateTime start, QDateTime end, QString name)
+{
+    if (context->athlete->isclean == false) refreshMetrics(); // get them up-to-date
+
+    QList<SummaryMetrics> empty;
+
+    // only if we have established a connection to the database
+    if (dbaccess == NULL) {
+        qDebug()<<"lost db connection?";
+        return empty;
+    }
+
     dbaccess->connection().transaction();
-    QList<SummaryMetrics> results = dbaccess->getAllMetricsFor(start, end);
+    QList<SummaryMetrics> results = dbaccess->getAllIntervalsFor(start, end, name);
     dbaccess->connection().commit();
     return results;
 }
 
+QList<RouteMatch>
+MetricAggregator::findSegment(const RouteSegment &segment)
+{
+    if (context->athlete->isclean == false) refreshMetrics(); // get them up-to-date
+
+    QList<RouteMatch> returning;
+
+    // only if we have established a connection to the database
+    if (dbaccess == NULL) {
+        qDebug()<<"lost db connection?";
+        return returning;
+    }
+
+    GC_TRACE("MetricAggregator::findSegment", "metrics");
+
+    // only the rides that went past both ends are read
+    dbaccess->connection().transaction();
+    QList<RouteTrack> tracks = dbaccess->getTracksThrough(segment.startCells(), segment.stopCells());
+    dbaccess->connection().commit();
+    GC_TRACE_COUNTER("candidate tracks", tracks.count());
+
+    foreach(RouteTrack track, tracks) returning << segment.match(track);
+    return returning;
+}
+
 SummaryMetrics
 MetricAggregator::getAllMetricsFor(QString filename)
 {
@@ -437,3 +624,106 @@ MetricAggregator::getRideMetrics(QString filename)
     }
     return dbaccess->getRideMetrics(filename);
 }
+
+/*----------------------------------------------------------------------
+ * Computing metrics on a pool of threads for refreshMetrics
+ *----------------------------------------------------------------------*/
+MetricRefresher::MetricRefresher(MetricAggregator *aggregator, Context *context, QStringList names, int threads) :
+    aggregator(aggregator), context(context), names(names), next(0), collected(0), ahead(0), aborted(false)
+{
+    if (names.isEmpty()) return;
+
+    // the threads can't use the DB so fetch the weight measures now
+    measures = aggregator->getAllMeasuresFor(QDateTime::fromString("Jan 1 00:00:00 1900"), QDateTime::currentDateTime().addYears(1));
+
+    if (threads > names.count()) threads = names.count();
+    ahead = threads * 2;
+
+    for (int i=0; i<threads; i++) {
+        MetricRefreshThread *worker = new MetricRefreshThread(this);
+        workers << worker;
+        worker->start();
+    }
+}
+
+MetricRefresher::~MetricRefresher()
+{
+    abort();
+    foreach(MetricRefreshThread *worker, workers) {
+        worker->wait();
+        delete worker;
+    }
+
+    // anything they did that nobody collected
+    foreach(MetricRefreshResult result, ready) if (result.ride) delete result.ride;
+}
+
+void
+MetricRefresher::abort()
+{
+    QMutexLocker locker(&lock);
+    aborted = true;
+    space.wakeAll();
+}
+
+bool
+MetricRefresher::collect(MetricRefreshResult &result, unsigned long timeout)
+{
+    QMutexLocker locker(&lock);
+
+    if (!ready.contains(collected)) {
+        available.wait(&lock, timeout);
+        if (!ready.contains(collected)) return false;
+    }
+
+    result = ready.take(collected++);
+    space.wakeAll();
+    return true;
+}
+
+void
+MetricRefreshThread::run()
+{
+    MetricRefresher *r = refresher;
+
+    forever {
+
+        // next ride, but don't get too far ahead of the collector
+        r->lock.lock();
+        while (!r->aborted && r->ready.count() >= r->ahead) r->space.wait(&r->lock);
+        if (r->aborted || r->next >= r->names.count()) {
+            r->lock.unlock();
+            return;
+        }
+        int index = r->next++;
+        r->lock.unlock();
+
+        QString name = r->names.at(index);
+        QFile file(r->context->athlete->home.absolutePath() + "/" + name);
+
+        MetricRefreshResult result;
+        result.computed = false;
+
+        // the factory only reads one file at a time
+        QStringList errors;
+        result.ride = RideFileFactory::instance().openRideFile(r->context, file, errors);
+        if (result.ride) result.ride->getWeight(r->measures);
+
+        // the bit worth doing in parallel
+        if (result.ride) {
+            result.computed = r->aggregator->computeRide(result.ride, name, result.metrics);
+            if (result.computed) {
+                r->aggregator->computeIntervals(result.ride, result.intervals);
+                result.track = RouteTrack(result.ride);
+            }
+
+            // it will be deleted by the collector
+            result.ride->moveToThread(QCoreApplication::instance()->thread());
+        }
+
+        r->lock.lock();
+        r->ready.insert(index, result);
+        r->available.wakeAll();
+        r->lock.unlock();
+    }
+}
@@ -30,8 +30,17 @@
 #include "SummaryMetrics.h"
 #include "Context.h"
 #include "DBAccess.h"
+#include "MetricStore.h"
+#include "RouteIndex.h"
 #include "Colors.h"
 
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+class MetricRefresher;
+class RideFileCacheRefresher;
+
 class MetricAggregator : public QObject
 {
     Q_OBJECT
@@ -47,15 +56,35 @@ class MetricAggregator : public QObject
         void refreshMetrics(QDateTime forceAfterThisDate);
         void getFirstLast(QDate &, QDate &);
         DBAccess *db() { return dbaccess; }
+        MetricStore *store() { return metricstore; }
         SummaryMetrics getAllMetricsFor(QString filename); // for a single ride
         QList<SummaryMetrics> getAllMetricsFor(QDateTime start, QDateTime end);
         QList<SummaryMetrics> getAllMetricsFor(DateRange);
+
+        // the same rides, but the store's own columns, no copies
+        MetricSlice getMetricSlice(QDateTime start, QDateTime end);
+        MetricSlice getMetricSlice(DateRange);
         QList<SummaryMetrics> getAllMeasuresFor(QDateTime start, QDateTime end);
         QList<SummaryMetrics> getAllMeasuresFor(DateRange);
+
+        // the intervals in the rides, name is matched with LIKE e.g. "5 min%"
+        // the "Interval Name" text and "Interval Start", "Interval Stop"
+        // and "Interval Number" values say which one it is
+        QList<SummaryMetrics> getAllIntervalsFor(QDateTime start, QDateTime end, QString name = "");
+        QList<SummaryMetrics> getAllIntervalsFor(DateRange, QString name = "");
+
+        // every time we rode along the segment, in date order
+        QList<RouteMatch> findSegment(const RouteSegment &segment);
         SummaryMetrics getRideMetrics(QString filename);
-        void writeAsCSV(QString filename); // export all...
+        bool writeAsCSV(QString filename); // export all...
         QStringList allActivityFilenames();
 
+        // how many threads to compute metrics on when refreshing
+        void setThreads(int threads);
+
+        // keeps the cpx files up to date after a refresh
+        RideFileCacheRefresher *cacheRefresher() { return cacherefresher; }
+
     signals:
         void dataChanged(); // when metricDB table changed
 
@@ -65,14 +94,78 @@ class MetricAggregator : public QObject
         void importMeasure(SummaryMetrics *sm);
 
     private:
+        friend class MetricRefreshThread;
+
         Context *context;
         DBAccess *dbaccess;
+        MetricStore *metricstore;
+        RideFileCacheRefresher *cacherefresher;
         bool first;
+        int threads;
 
 	    typedef QHash<QString,RideMetric*> MetricMap;
 	    bool importRide(QDir path, RideFile *ride, QString fileName, unsigned long, bool modify);
+
+        // importRide in two halves, the first is safe to call from
+        // the refresh threads but the second must be on our thread
+        bool computeRide(RideFile *ride, QString fileName, SummaryMetrics &summaryMetric);
+        void computeIntervals(RideFile *ride, QList<SummaryMetrics> &intervals);
+        void storeRide(SummaryMetrics &summaryMetric, QList<SummaryMetrics> &intervals, const RouteTrack &track,
+                       RideFile *ride, unsigned long fingerprint, bool modify);
 	    MetricMap metrics;
         ColorEngine *colorEngine;
 };
 
+// Opens rides and computes their metrics on a pool of threads for
+// MetricAggregator::refreshMetrics, which collects the results in
+// order and writes them to the DB, since the connection cannot be
+// shared across threads. The threads only get a few rides ahead of
+// the collector so we don't hold too many rides in memory.
+struct MetricRefreshResult {
+    RideFile *ride;     // NULL if it couldn't be opened
+    bool computed;      // metrics are valid
+    SummaryMetrics metrics;
+    QList<SummaryMetrics> intervals;
+    RouteTrack track;
+};
+
+class MetricRefreshThread : public QThread
+{
+    public:
+        MetricRefreshThread(MetricRefresher *refresher) : refresher(refresher) {}
+        void run();
+
+    private:
+        MetricRefresher *refresher;
+};
+
+class MetricRefresher
+{
+    public:
+        MetricRefresher(MetricAggregator *aggregator, Context *context, QStringList names, int threads);
+        ~MetricRefresher(); // stops the threads and frees anything not collected
+
+        // the next result in order, returns false if it isn't ready
+        // after waiting for timeout milliseconds
+        bool collect(MetricRefreshResult &result, unsigned long timeout);
+
+        // stop early, threads finish the ride they are working on
+        void abort();
+
+    private:
+        friend class MetricRefreshThread;
+
+        MetricAggregator *aggregator;
+        Context *context;
+        QStringList names;
+        QList<SummaryMetrics> measures; // for ride weight
+
+        QList<MetricRefreshThread*> workers;
+        QMutex lock;
+        QWaitCondition available, space;
+        QMap<int, MetricRefreshResult> ready;
+        int next, collected, ahead;
+        bool aborted;
+};
+
 #endif /* METRICAGGREGATOR_H_ */
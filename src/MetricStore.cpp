@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MetricStore.h"
+#include "DBAccess.h"
+#include "GcTrace.h"
+
+#include <QColor>
+
+//
+// Slices
+//
+MetricSlice::MetricSlice(const MetricStore *store, int from, int to) :
+    store(store), from(from), to(to), changes(store->changes())
+{
+}
+
+bool
+MetricSlice::isValid() const
+{
+    return store && store->changes() == changes;
+}
+
+const double *
+MetricSlice::values(QString symbol) const
+{
+    if (!isValid()) return NULL;
+    const double *column = store->column(symbol);
+    return column ? column + from : NULL;
+}
+
+const QDateTime *
+MetricSlice::dates() const
+{
+    return isValid() ? store->rideDates().constData() + from : NULL;
+}
+
+const QString *
+MetricSlice::fileNames() const
+{
+    return isValid() ? store->rideFileNames().constData() + from : NULL;
+}
+
+const QString *
+MetricSlice::texts(QString name) const
+{
+    if (!isValid()) return NULL;
+    const QString *column = store->textColumn(name);
+    return column ? column + from : NULL;
+}
+
+SummaryMetrics
+MetricSlice::ride(int i) const
+{
+    if (!isValid() || i < 0 || i >= count()) return SummaryMetrics();
+    return store->ride(from + i);
+}
+
+//
+// The store
+//
+void
+MetricStore::load()
+{
+    if (loaded) return;
+
+    GC_TRACE("MetricStore::load", "metrics");
+
+    // all of it, in date order, apparently using
+    // transactions for queries can improve performance!
+    db->connection().transaction();
+    QList<SummaryMetrics> all = db->getAllMetricsFor(QDateTime(QDate(1900,1,1), QTime(0,0,0)),
+                                                      QDateTime(QDate(3000,1,1), QTime(0,0,0)));
+    db->connection().commit();
+    dates.reserve(all.count());
+    fileNames.reserve(all.count());
+    ids.reserve(all.count());
+    for (int i=0; i<all.count(); i++) append(all[i]);
+
+    GC_TRACE_COUNTER("rides", dates.count());
+    loaded = true;
+}
+
+void
+MetricStore::clear()
+{
+    changed++;
+    loaded = false;
+    dates.clear();
+    fileNames.clear();
+    ids.clear();
+    numbers.clear();
+    texts.clear();
+    numberColumns.clear();
+    textColumns.clear();
+}
+
+void
+MetricStore::importRide(QString filename)
+{
+    // we'll get it when we load
+    if (!loaded) return;
+
+    // it may have moved if the date changed
+    deleteRide(filename);
+
+    SummaryMetrics ride;
+    QColor color;
+    if (!db->getRide(filename, ride, color)) return;
+
+    // after any others at the same time, as they are in the DB
+    int lo = 0, hi = dates.count();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (dates[mid] <= ride.getRideDate()) lo = mid + 1;
+        else hi = mid;
+    }
+    insert(lo, ride);
+}
+
+void
+MetricStore::deleteRide(QString filename)
+{
+    if (!loaded) return;
+
+    int at = fileNames.indexOf(filename);
+    if (at >= 0) remove(at);
+}
+
+MetricSlice
+MetricStore::slice(QDateTime start, QDateTime end)
+{
+    load();
+
+    // as for DBAccess::getAllMetricsFor, which compares dates not times
+    if (start == QDateTime()) start = QDateTime::currentDateTime().addYears(-10);
+    if (end == QDateTime()) end = QDateTime::currentDateTime().addYears(+10);
+    QDate first = start.date(), last = end.date();
+
+    // first on or after the start
+    int lo = 0, hi = dates.count();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (dates[mid].date() < first) lo = mid + 1;
+        else hi = mid;
+    }
+    int from = lo;
+
+    // first after the end
+    hi = dates.count();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (dates[mid].date() <= last) lo = mid + 1;
+        else hi = mid;
+    }
+    return MetricSlice(this, from, qMax(from, lo));
+}
+
+QList<SummaryMetrics>
+MetricStore::getAllMetricsFor(QDateTime start, QDateTime end)
+{
+    QList<SummaryMetrics> returning;
+    MetricSlice rides = slice(start, end);
+
+    for (int i=rides.first(); i<rides.first() + rides.count(); i++) returning << ride(i);
+    return returning;
+}
+
+SummaryMetrics
+MetricStore::ride(int at) const
+{
+    SummaryMetrics add;
+    add.setFileName(fileNames[at]);
+    add.setId(ids[at]);
+    add.setRideDate(dates[at]);
+
+    QHashIterator<QString, int> number(numbers);
+    while (number.hasNext()) {
+        number.next();
+        add.setForSymbol(number.key(), numberColumns[number.value()][at]);
+    }
+
+    // the ones we have, getText() has a fallback for the others
+    QHashIterator<QString, int> text(texts);
+    while (text.hasNext()) {
+        text.next();
+        const QString &value = textColumns[text.value()][at];
+        if (!value.isNull()) add.setText(text.key(), value);
+    }
+    return add;
+}
+
+const double *
+MetricStore::column(QString symbol) const
+{
+    QHash<QString, int>::const_iterator it = numbers.find(symbol);
+    if (it == numbers.end()) return NULL;
+    return numberColumns[it.value()].constData();
+}
+
+const QString *
+MetricStore::textColumn(QString name) const
+{
+    QHash<QString, int>::const_iterator it = texts.find(name);
+    if (it == texts.end()) return NULL;
+    return textColumns[it.value()].constData();
+}
+
+void
+MetricStore::append(SummaryMetrics &ride)
+{
+    insert(dates.count(), ride);
+}
+
+void
+MetricStore::insert(int at, SummaryMetrics &ride)
+{
+    changed++;
+    int before = dates.count();
+
+    dates.insert(at, ride.getRideDate());
+    fileNames.insert(at, ride.getFileName());
+    ids.insert(at, ride.getId());
+
+    // columns we haven't seen before, e.g. a new metadata field,
+    // are zero or null for the rides we already have
+    QMapIterator<QString, double> value(ride.values());
+    while (value.hasNext()) {
+        value.next();
+        if (!numbers.contains(value.key())) {
+            numbers.insert(value.key(), numberColumns.count());
+            numberColumns << QVector<double>(before, 0.0);
+        }
+    }
+    QMapIterator<QString, QString> text(ride.texts());
+    while (text.hasNext()) {
+        text.next();
+        if (!texts.contains(text.key())) {
+            texts.insert(text.key(), textColumns.count());
+            textColumns << QVector<QString>(before);
+        }
+    }
+
+    QHashIterator<QString, int> number(numbers);
+    while (number.hasNext()) {
+        number.next();
+        numberColumns[number.value()].insert(at, ride.values().value(number.key(), 0.0));
+    }
+    QHashIterator<QString, int> name(texts);
+    while (name.hasNext()) {
+        name.next();
+        textColumns[name.value()].insert(at, ride.texts().value(name.key()));
+    }
+}
+
+void
+MetricStore::remove(int at)
+{
+    changed++;
+    dates.remove(at);
+    fileNames.remove(at);
+    ids.remove(at);
+    for (int i=0; i<numberColumns.count(); i++) numberColumns[i].remove(at);
+    for (int i=0; i<textColumns.count(); i++) textColumns[i].remove(at);
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_MetricStore_h
+#define _GC_MetricStore_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+#include "SummaryMetrics.h"
+
+class DBAccess;
+class MetricStore;
+
+// The rides in a date range of the store, the arrays are the store's
+// own so they are only good until it changes, i.e. until the next
+// MetricAggregator::dataChanged(). After that it is empty, so a chart
+// holding on to one draws nothing rather than the wrong rides.
+class MetricSlice
+{
+    public:
+        MetricSlice() : store(NULL), from(0), to(0), changes(0) {}
+        MetricSlice(const MetricStore *store, int from, int to);
+
+        bool isValid() const;
+        int count() const { return isValid() ? to - from : 0; }
+
+        // count() values, or NULL if we don't have the symbol
+        const double *values(QString symbol) const;
+        const QDateTime *dates() const;
+        const QString *fileNames() const;
+
+        // text metadata, null strings where a ride doesn't have it
+        const QString *texts(QString name) const;
+
+        // a copy of a ride, for code that wants a SummaryMetrics
+        SummaryMetrics ride(int i) const;
+
+        // where we are in the store
+        int first() const { return from; }
+
+    private:
+        const MetricStore *store;
+        int from, to;
+        int changes; // the store's when we were sliced
+};
+
+// Every ride's metrics and metadata in memory, a column for each in
+// ride date order, for all the season charts to share. It is loaded
+// from the metricDB the first time it's needed and kept up to date as
+// rides are imported and deleted, so charts don't each go back to the
+// DB and get their own copy every time they refresh.
+//
+// Owned by the MetricAggregator, and only used on the gui thread.
+//
+class MetricStore
+{
+    public:
+        MetricStore(DBAccess *db) : db(db), loaded(false), changed(0) {}
+
+        // load it if we haven't, or forget it all to be reloaded when
+        // it is next used, e.g. when most of the rides were recomputed
+        void load();
+        void clear();
+        bool isLoaded() const { return loaded; }
+
+        // keep up to date, we get the ride's row back from the DB so
+        // we have its metadata as well as its metrics
+        void importRide(QString filename);
+        void deleteRide(QString filename);
+
+        // the rides in a date range, as DBAccess::getAllMetricsFor
+        // null dates are 10 years either side of today
+        MetricSlice slice(QDateTime start, QDateTime end);
+
+        // for code that wants a list of SummaryMetrics, without a trip
+        // to the DB, it is a copy so it is slower than using a slice
+        QList<SummaryMetrics> getAllMetricsFor(QDateTime start, QDateTime end);
+
+        // the columns
+        int count() const { return dates.count(); }
+        QStringList symbols() const { return numbers.keys(); }
+        const double *column(QString symbol) const;
+        const QString *textColumn(QString name) const;
+        const QVector<QDateTime> &rideDates() const { return dates; }
+        const QVector<QString> &rideFileNames() const { return fileNames; }
+        SummaryMetrics ride(int at) const;
+
+        // bumped whenever the rides change, to spot stale slices
+        int changes() const { return changed; }
+
+    private:
+        void append(SummaryMetrics &ride);
+        void insert(int at, SummaryMetrics &ride);
+        void remove(int at);
+
+        DBAccess *db;
+        bool loaded;
+        int changed;
+
+        QVector<QDateTime> dates;
+        QVector<QString> fileNames, ids;
+
+        // metric and numeric metadata, and text metadata, by name
+        QHash<QString, int> numbers, texts;
+        QVector<QVector<double> > numberColumns;
+        QVector<QVector<QString> > textColumns;
+};
+
+#endif // _GC_MetricStore_h
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MetricTableModel.h"
+
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QDebug>
+
+// SQLite limits the number of host parameters in a statement
+static const int MAXBATCH = 500;
+
+MetricTableModel::MetricTableModel(QObject *parent, QSqlDatabase db) : QAbstractTableModel(parent), db(db),
+    fileColumn(-1), stampColumn(-1), rows(0)
+{
+}
+
+QStringList
+MetricTableModel::schema() const
+{
+    QStringList returning;
+    QSqlRecord record = db.record("metrics");
+    for (int i=0; i<record.count(); i++) returning << record.fieldName(i);
+    return returning;
+}
+
+int
+MetricTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows;
+}
+
+int
+MetricTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : columns.count();
+}
+
+QVariant
+MetricTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows || index.column() >= columns.count()) return QVariant();
+    if (role != Qt::DisplayRole && role != Qt::EditRole) return QVariant();
+
+    if (!loaded[index.column()]) loadColumn(index.column());
+    return values[index.column()][index.row()];
+}
+
+QVariant
+MetricTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && (role == Qt::DisplayRole || role == Qt::EditRole)) {
+        if (section < 0 || section >= columns.count()) return QVariant();
+        if (headers.contains(section)) return headers.value(section);
+        return columns[section];
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+bool
+MetricTableModel::setHeaderData(int section, Qt::Orientation orientation, const QVariant &value, int role)
+{
+    if (orientation != Qt::Horizontal || section < 0 || section >= columns.count()) return false;
+    if (role != Qt::DisplayRole && role != Qt::EditRole) return false;
+
+    headers.insert(section, value);
+    emit headerDataChanged(orientation, section, section);
+    return true;
+}
+
+void
+MetricTableModel::select()
+{
+    beginResetModel();
+
+    // the user set header names are kept unless the columns change
+    QStringList now = schema();
+    if (now != columns) headers.clear();
+    columns = now;
+    fileColumn = columns.indexOf("filename");
+    stampColumn = columns.indexOf("timestamp");
+
+    values.clear();
+    values.resize(columns.count());
+    loaded.fill(false, columns.count());
+    rowByFile.clear();
+    rows = 0;
+
+    // the rows are keyed by filename, we read the timestamp at
+    // the same time since we will need it to spot changes
+    if (fileColumn >= 0 && stampColumn >= 0) {
+        QSqlQuery query(db);
+        bool rc = query.exec("SELECT filename, timestamp FROM metrics;");
+        while (rc && query.next()) {
+            rowByFile.insert(query.value(0).toString(), rows++);
+            values[fileColumn] << query.value(0);
+            values[stampColumn] << query.value(1);
+        }
+        query.finish();
+        loaded[fileColumn] = loaded[stampColumn] = true;
+    }
+
+    endResetModel();
+}
+
+void
+MetricTableModel::refresh()
+{
+    // metrics or metadata config changed, the table will have been
+    // recreated so there is nothing worth keeping
+    if (columns.isEmpty() || fileColumn < 0 || stampColumn < 0 || schema() != columns) {
+        select();
+        return;
+    }
+
+    // what's in the DB now
+    QStringList current;
+    QHash<QString, QVariant> stamps;
+    QSqlQuery query(db);
+    bool rc = query.exec("SELECT filename, timestamp FROM metrics;");
+    while (rc && query.next()) {
+        current << query.value(0).toString();
+        stamps.insert(current.last(), query.value(1));
+    }
+    query.finish();
+
+    // compare with what we have, the DB stamps a ride every time
+    // it is (re)imported so that is all we need to check
+    QVector<bool> keep(rows, true);
+    QStringList changed, added;
+    int removed = 0, first = rows, last = -1;
+    for (int i=0; i<rows; i++) {
+        QString filename = values[fileColumn][i].toString();
+        QHash<QString, QVariant>::const_iterator stamp = stamps.constFind(filename);
+        if (stamp == stamps.constEnd()) {
+            keep[i] = false;
+            removed++;
+        } else if (stamp.value() != values[stampColumn][i]) {
+            changed << filename;
+            if (i < first) first = i;
+            if (i > last) last = i;
+        }
+    }
+    foreach(QString filename, current) if (!rowByFile.contains(filename)) added << filename;
+
+    if (!removed && added.isEmpty()) {
+
+        // just updates, keep the rows where they are
+        if (changed.isEmpty()) return;
+
+        loadRows(changed);
+        emit dataChanged(index(first, 0), index(last, columns.count()-1));
+        return;
+    }
+
+    beginResetModel();
+
+    // drop the rides that went away
+    if (removed) {
+        for (int c=0; c<columns.count(); c++) {
+            if (!loaded[c]) continue;
+            QVector<QVariant> &column = values[c];
+            int to = 0;
+            for (int i=0; i<rows; i++) if (keep[i]) column[to++] = column[i];
+            column.resize(to);
+        }
+        rows -= removed;
+        rowByFile.clear();
+        for (int i=0; i<rows; i++) rowByFile.insert(values[fileColumn][i].toString(), i);
+    }
+
+    // and add the new ones on the end
+    foreach(QString filename, added) {
+        for (int c=0; c<columns.count(); c++) if (loaded[c]) values[c] << QVariant();
+        values[fileColumn][rows] = filename;
+        rowByFile.insert(filename, rows++);
+    }
+    loadRows(changed + added);
+
+    endResetModel();
+}
+
+void
+MetricTableModel::loadColumn(int column) const
+{
+    QVector<QVariant> &loading = values[column];
+    loading.fill(QVariant(), rows);
+
+    QSqlQuery query(db);
+    bool rc = query.exec(QString("SELECT filename, %1 FROM metrics;").arg(columns[column]));
+    if (!rc) qDebug()<<"metric table column load failed:"<<columns[column];
+
+    while (rc && query.next()) {
+        int row = rowByFile.value(query.value(0).toString(), -1);
+        if (row >= 0) loading[row] = query.value(1);
+    }
+    query.finish();
+
+    loaded[column] = true;
+}
+
+void
+MetricTableModel::loadRows(QStringList filenames)
+{
+    // re-read the columns we have loaded for these rides
+    QList<int> wanted;
+    QString select = "SELECT filename";
+    for (int c=0; c<columns.count(); c++) {
+        if (loaded[c] && c != fileColumn) {
+            wanted << c;
+            select += QString(", %1").arg(columns[c]);
+        }
+    }
+    select += " FROM metrics WHERE filename IN (";
+
+    for (int from=0; from < filenames.count(); from += MAXBATCH) {
+
+        QStringList batch = filenames.mid(from, MAXBATCH);
+        QStringList params;
+        for (int i=0; i<batch.count(); i++) params << "?";
+
+        QSqlQuery query(db);
+        query.prepare(select + params.join(",") + ");");
+        foreach(QString filename, batch) query.addBindValue(filename);
+
+        bool rc = query.exec();
+        if (!rc) qDebug()<<"metric table row load failed";
+
+        while (rc && query.next()) {
+            int row = rowByFile.value(query.value(0).toString(), -1);
+            if (row < 0) continue;
+            for (int i=0; i<wanted.count(); i++) values[wanted[i]][row] = query.value(i+1);
+        }
+        query.finish();
+    }
+}
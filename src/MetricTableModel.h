@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_MetricTableModel_h
+#define _GC_MetricTableModel_h 1
+
+#include <QAbstractTableModel>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QVector>
+#include <QVariant>
+#include <QHash>
+#include <QMap>
+
+//
+// Read-only model of the metrics table for the ride navigator and diary
+//
+// This replaces the QSqlTableModel we used to have, which had to be
+// select()ed and then fetchMore()'d until every column of every ride
+// was in memory, and did that again every time anything changed.
+//
+// Instead we hold the table column by column and only read a column
+// from the DB the first time somebody asks for data from it, since the
+// navigator only ever shows a handful of the ~150 columns, and the rest
+// are hidden. The filename and timestamp columns are always loaded
+// since we use them to key the rows and spot changes.
+//
+// refresh() compares the timestamps with the DB and only re-reads the
+// rides that have been added or updated, emitting a single dataChanged
+// (or a reset if rides were added or removed) so the proxies above us
+// only regroup once.
+//
+// Column headers are the SQL column names, as they were with the
+// QSqlTableModel, and can be overridden with setHeaderData().
+//
+class MetricTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+    public:
+        MetricTableModel(QObject *parent, QSqlDatabase db);
+
+        int rowCount(const QModelIndex &parent = QModelIndex()) const;
+        int columnCount(const QModelIndex &parent = QModelIndex()) const;
+        QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+        QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+        bool setHeaderData(int section, Qt::Orientation orientation, const QVariant &value, int role = Qt::EditRole);
+
+        // find the column for an sql column name, -1 if not found
+        int column(QString name) const { return columns.indexOf(name); }
+
+    public slots:
+        // reload everything, e.g. after the table was recreated
+        void select();
+
+        // bring up to date with the DB, only re-reading rides that changed
+        void refresh();
+
+    private:
+        QSqlDatabase db;
+
+        QStringList columns;            // sql column names
+        QMap<int, QVariant> headers;    // overridden by setHeaderData
+        int fileColumn, stampColumn;
+
+        QHash<QString, int> rowByFile;
+        int rows;
+
+        // values for each column, only valid if loaded
+        mutable QVector<QVector<QVariant> > values;
+        mutable QVector<bool> loaded;
+
+        QStringList schema() const;
+        void loadColumn(int column) const;
+        void loadRows(QStringList filenames);
+};
+
+#endif // _GC_MetricTableModel_h
@@ -30,6 +30,7 @@
 #include "AddDeviceWizard.h"
 #include "DeviceTypes.h"
 #include "DeviceConfiguration.h"
+#include "ErgControl.h"
 #include "ColorButton.h"
 #include "SpecialFields.h"
 #include "DataProcessor.h"
@@ -883,6 +884,14 @@ DevicePage::DevicePage(QWidget *parent, Context *context) : QWidget(parent), con
     multiCheck = new QCheckBox("Allow multiple devices in Train View", this);
     multiCheck->setChecked(appsettings->value(this, TRAIN_MULTI, false).toBool());
 
+    ergRate = new QSpinBox(this);
+    ergRate->setRange(ErgControl::MinRate, ErgControl::MaxRate);
+    ergRate->setSuffix(tr(" Hz"));
+    ergRate->setValue(appsettings->value(this, TRAIN_ERGRATE, ErgControl::DefaultRate).toInt());
+
+    closedLoop = new QCheckBox(tr("Correct the load from measured power in ERG mode"), this);
+    closedLoop->setChecked(appsettings->value(this, TRAIN_CLOSEDLOOP, false).toBool());
+
     mainLayout->addWidget(deviceList);
     QHBoxLayout *bottom = new QHBoxLayout;
     bottom->setSpacing(2);
@@ -892,6 +901,14 @@ DevicePage::DevicePage(QWidget *parent, Context *context) : QWidget(parent), con
     bottom->addWidget(delButton);
     mainLayout->addLayout(bottom);
 
+    QHBoxLayout *control = new QHBoxLayout;
+    control->addWidget(new QLabel(tr("Load control rate"), this));
+    control->addWidget(ergRate);
+    control->addSpacing(10);
+    control->addWidget(closedLoop);
+    control->addStretch();
+    mainLayout->addLayout(control);
+
     connect(addButton, SIGNAL(clicked()), this, SLOT(devaddClicked()));
     connect(delButton, SIGNAL(clicked()), this, SLOT(devdelClicked()));
 }
@@ -903,6 +920,8 @@ DevicePage::saveClicked()
     DeviceConfigurations all;
     all.writeConfig(deviceListModel->Configuration);
     appsettings->setValue(TRAIN_MULTI, multiCheck->isChecked());
+    appsettings->setValue(TRAIN_ERGRATE, ergRate->value());
+    appsettings->setValue(TRAIN_CLOSEDLOOP, closedLoop->isChecked());
 }
 
 void
@@ -23,6 +23,7 @@
 #include <QGridLayout>
 #include <QProgressDialog>
 #include <QFontComboBox>
+#include <QSpinBox>
 #include "DeviceTypes.h"
 #include "DeviceConfiguration.h"
 #include "RideMetadata.h"
@@ -256,6 +257,8 @@ class DevicePage : public QWidget
         deviceModel *deviceListModel;
 
         QCheckBox   *multiCheck;
+        QSpinBox    *ergRate;
+        QCheckBox   *closedLoop;
 };
 
 class BestsMetricsPage : public QWidget
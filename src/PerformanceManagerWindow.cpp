@@ -113,7 +113,7 @@ PerformanceManagerWindow::PerformanceManagerWindow(Context *context) :
     connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(replot()));
     connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(replot()));
     connect(this, SIGNAL(rideItemChanged(RideItem*)), this, SLOT(rideSelected()));
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     connect(context, SIGNAL(filterChanged()), this, SLOT(filterChanged()));
 #endif
 }
@@ -124,7 +124,7 @@ PerformanceManagerWindow::~PerformanceManagerWindow()
 	delete sc;
 }
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
 void 
 PerformanceManagerWindow::filterChanged()
 {
@@ -209,7 +209,7 @@ void PerformanceManagerWindow::replot()
 		    endTime,
 		    (appsettings->cvalue(context->athlete->cyclist, GC_STS_DAYS,7)).toInt(),
 		    (appsettings->cvalue(context->athlete->cyclist, GC_LTS_DAYS,42)).toInt());
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
             sc->calculateStress(context,context->athlete->home.absolutePath(),newMetric,isfiltered,filter);
 #else
             sc->calculateStress(context,context->athlete->home.absolutePath(),newMetric);
@@ -54,7 +54,7 @@ class PerformanceManagerWindow : public GcWindow
     int scheme() const { return metricCombo->currentIndex(); }
     void setScheme(int x) const { metricCombo->setCurrentIndex(x); }
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     bool isFiltered() const { return isfiltered; }
 #endif
 
@@ -67,7 +67,7 @@ class PerformanceManagerWindow : public GcWindow
         void metricChanged();
         void rideSelected();
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     void filterChanged();
 #endif
 
@@ -179,6 +179,11 @@ PfPvPlot::PfPvPlot(Context *context)
     curve = new QwtPlotCurve();
     curve->attach(this);
 
+    preparer = new ChartPreparer(this);
+    connect(preparer, SIGNAL(prepared(ChartJob*)), this, SLOT(setPrepared(ChartJob*)));
+    connect(context, SIGNAL(rideDirty(RideItem*)), preparer, SLOT(clear()));
+    connect(context, SIGNAL(rideClean(RideItem*)), preparer, SLOT(clear())); // saved or reverted
+
     cl_ = appsettings->value(this, GC_CRANKLENGTH).toDouble() / 1000.0;
 
     // markup timeInQuadrant
@@ -429,76 +434,103 @@ PfPvPlot::setData(RideItem *_rideItem)
         // quickly erase old data
         curve->setVisible(false);
 
+        // the points are worked out in the background, see setPrepared()
+        QString key = QString("%1/%2 %3").arg(rideItem->path).arg(rideItem->fileName).arg(cl_);
+        preparer->prepare(new PfPvJob(ride, cl_, key));
 
-        // due to the discrete power and cadence values returned by the
-        // power meter, there will very likely be many duplicate values.
-        // Rather than pass them all to the curve, use a set to strip
-        // out duplicates.
-        std::set<std::pair<double, double> > dataSet;
-        std::set<std::pair<double, double> > dataSetSelected;
+    } else {
 
-        long tot_cad = 0;
-        long tot_cad_points = 0;
+        //setTitle("no data");
+        preparer->cancel();
+        refreshZoneItems();
+        curve->setVisible(false);
+    }
 
-        foreach(const RideFilePoint *p1, ride->dataPoints()) {
+    replot();
+}
 
-            if (p1->watts != 0 && p1->cad != 0) {
+PfPvJob::PfPvJob(RideFile *ride, double cl, QString key) : ChartJob(key), cadence(0), cl(cl)
+{
+    foreach(const RideFilePoint *p1, ride->dataPoints()) {
+        if (p1->watts != 0 && p1->cad != 0) {
+            watts << p1->watts;
+            cad << p1->cad;
+        }
+    }
+}
 
-                double aepf = (p1->watts * 60.0) / (p1->cad * cl_ * 2.0 * PI);
-                double cpv = (p1->cad * cl_ * 2.0 * PI) / 60.0;
+void
+PfPvJob::prepare()
+{
+    // due to the discrete power and cadence values returned by the
+    // power meter, there will very likely be many duplicate values.
+    // Rather than pass them all to the curve, use a set to strip
+    // out duplicates.
+    std::set<std::pair<double, double> > dataSet;
 
-                if (aepf <= 2500) { // > 2500 newtons is our out of bounds
-                    dataSet.insert(std::make_pair<double, double>(aepf, cpv));
-                    tot_cad += p1->cad;
-                    tot_cad_points++;
-                }
-            }
+    long tot_cad = 0;
+    long tot_cad_points = 0;
+
+    for (int i=0; i<watts.count(); i++) {
+
+        // selected another ride already?
+        if ((i & 0xfff) == 0 && cancelled()) return;
+
+        double aepf = (watts[i] * 60.0) / (cad[i] * cl * 2.0 * PI);
+        double cpv = (cad[i] * cl * 2.0 * PI) / 60.0;
+
+        if (aepf <= 2500) { // > 2500 newtons is our out of bounds
+            dataSet.insert(std::make_pair<double, double>(aepf, cpv));
+            tot_cad += cad[i];
+            tot_cad_points++;
         }
+    }
 
-        setCAD(tot_cad_points ? tot_cad / tot_cad_points : 0);
+    cadence = tot_cad_points ? tot_cad / tot_cad_points : 0;
 
-        if (tot_cad_points == 0) {
-            //setTitle(tr("no cadence"));
-            refreshZoneItems();
-            curve->setVisible(false);
+    // Now that we have the set of points, transform them into the
+    // QwtArrays needed to set the curve's data.
+    std::set<std::pair<double, double> >::const_iterator j(dataSet.begin());
+    while (j != dataSet.end()) {
+        const std::pair<double, double>& dataPoint = *j;
 
-        } else {
-            // Now that we have the set of points, transform them into the
-            // QwtArrays needed to set the curve's data.
-            QwtArray<double> aepfArray;
-            QwtArray<double> cpvArray;
+        aepfArray.push_back(dataPoint.first);
+        cpvArray.push_back(dataPoint.second);
 
-            std::set<std::pair<double, double> >::const_iterator j(dataSet.begin());
-            while (j != dataSet.end()) {
-                const std::pair<double, double>& dataPoint = *j;
+        ++j;
+    }
+}
 
-                aepfArray.push_back(dataPoint.first);
-                cpvArray.push_back(dataPoint.second);
+void
+PfPvPlot::setPrepared(ChartJob *job)
+{
+    if (context->isCompareIntervals) return;
+    PfPvJob *prepared = static_cast<PfPvJob*>(job);
 
-                ++j;
-            }
+    setCAD(prepared->cadence);
 
-            curve->setSamples(cpvArray, aepfArray);
+    if (prepared->cpvArray.isEmpty()) {
+        //setTitle(tr("no cadence"));
+        refreshZoneItems();
+        curve->setVisible(false);
 
-            QwtSymbol *sym = new QwtSymbol;
-            sym->setStyle(QwtSymbol::Ellipse);
-            sym->setSize(6);
-            sym->setPen(QPen(Qt::red));
-            sym->setBrush(QBrush(Qt::NoBrush));
-            curve->setSymbol(sym);
-            curve->setStyle(QwtPlotCurve::Dots);
-            curve->setRenderHint(QwtPlotItem::RenderAntialiased);
-
-            // now show the data (zone shading would already be visible)
-            refreshZoneItems();
-            curve->setSymbol(sym);
-            curve->setVisible(true);
-        }
     } else {
 
-        //setTitle("no data");
+        curve->setSamples(prepared->cpvArray, prepared->aepfArray);
+
+        QwtSymbol *sym = new QwtSymbol;
+        sym->setStyle(QwtSymbol::Ellipse);
+        sym->setSize(6);
+        sym->setPen(QPen(Qt::red));
+        sym->setBrush(QBrush(Qt::NoBrush));
+        curve->setSymbol(sym);
+        curve->setStyle(QwtPlotCurve::Dots);
+        curve->setRenderHint(QwtPlotItem::RenderAntialiased);
+
+        // now show the data (zone shading would already be visible)
         refreshZoneItems();
-        curve->setVisible(false);
+        curve->setSymbol(sym);
+        curve->setVisible(true);
     }
 
     replot();
@@ -25,6 +25,8 @@
 #include <qwt_point_3d.h>
 #include <qwt_compat.h>
 
+#include "ChartPrep.h"
+
 // forward references
 class RideFile;
 class RideItem;
@@ -76,6 +78,7 @@ class PfPvPlot : public QwtPlot
 
     public slots:
         void configChanged();
+        void setPrepared(ChartJob *job); // the points for setData
 
     signals:
         void changedCP( const QString& );
@@ -105,6 +108,23 @@ class PfPvPlot : public QwtPlot
 
         double timeInQuadrant[4]; // time in seconds spent in each quadrant
         QwtPlotMarker *tiqMarker[4]; // time in seconds spent in each quadrant
+
+        ChartPreparer *preparer;
+};
+
+// the points for a ride, deduplicated, worked out in the background
+class PfPvJob : public ChartJob
+{
+    public:
+        PfPvJob(RideFile *ride, double cl, QString key);
+        void prepare();
+
+        QwtArray<double> aepfArray, cpvArray;
+        int cadence; // average, 0 if there isn't any
+
+    private:
+        double cl;
+        QVector<double> watts, cad;
 };
 
 #endif // _GC_QaPlot_h
@@ -109,6 +109,14 @@ PowerHist::PowerHist(Context *context, bool rangemode) :
     setAxisMaxMinor(xBottom, 0);
     setAxisMaxMinor(yLeft, 0);
 
+    // the distributions for a ride are binned in the background, and again
+    // if it is edited or the zones change, the intervals selected are in the key
+    preparer = new ChartPreparer(this);
+    connect(preparer, SIGNAL(prepared(ChartJob*)), this, SLOT(setPrepared(ChartJob*)));
+    connect(context, SIGNAL(rideDirty(RideItem*)), preparer, SLOT(clear()));
+    connect(context, SIGNAL(rideClean(RideItem*)), preparer, SLOT(clear())); // saved or reverted
+    connect(context->athlete, SIGNAL(zonesChanged()), preparer, SLOT(clear()));
+
     configChanged();
 }
 
@@ -1458,14 +1466,6 @@ PowerHist::updatePlot()
 void
 PowerHist::setData(RideItem *_rideItem, bool force)
 {
-    // predefined deltas for each series
-    static const double wattsDelta = 1.0;
-    static const double wattsKgDelta = 0.01;
-    static const double nmDelta    = 0.1;
-    static const double hrDelta    = 1.0;
-    static const double kphDelta   = 0.1;
-    static const double cadDelta   = 1.0;
-
     source = Ride;
 
     // we set with this data already
@@ -1476,6 +1476,9 @@ PowerHist::setData(RideItem *_rideItem, bool force)
 
     RideFile *ride = rideItem->ride();
 
+    // only worked out when it is asked for
+    if (series == RideFile::aPower) ride->recalculateDerivedSeries(RideFile::aPower);
+
     bool hasData = ((series == RideFile::watts || series == RideFile::wattsKg) && ride->areDataPresent()->watts) ||
                    (series == RideFile::nm && ride->areDataPresent()->nm) ||
                    (series == RideFile::kph && ride->areDataPresent()->kph) ||
@@ -1486,8 +1489,6 @@ PowerHist::setData(RideItem *_rideItem, bool force)
     if (ride && hasData) {
         //setTitle(ride->startTime().toString(GC_DATETIME_FORMAT));
 
-        static const int maxSize = 4096;
-
         // recording interval in minutes
         dt = ride->recIntSecs() / 60.0;
 
@@ -1512,184 +1513,247 @@ PowerHist::setData(RideItem *_rideItem, bool force)
         standard.kphSelectedArray.resize(0);
         standard.cadSelectedArray.resize(0);
 
-        // unit conversion factor for imperial units for selected parameters
-        double torque_factor = (context->athlete->useMetricUnits ? 1.0 : 0.73756215);
-        double speed_factor  = (context->athlete->useMetricUnits ? 1.0 : 0.62137119);
+        // the points are binned in the background, see setPrepared()
+        QList<QPair<double,double> > intervals;
+        if (context->athlete->allIntervalItems() != NULL) {
+            for (int i=0; i<context->athlete->allIntervalItems()->childCount(); i++) {
+                IntervalItem *current = dynamic_cast<IntervalItem*>(context->athlete->allIntervalItems()->child(i));
+                if (current != NULL && current->isSelected())
+                    intervals << QPair<double,double>(current->start, current->stop);
+            }
+        }
+        RideFileCacheZones zones(context, ride->startTime().date());
 
-        // cp and zones
-        int CP = 0;
-        const Zones *zones = rideItem->zones;
-        int zoneRange = zones ? zones->whichRange(ride->startTime().date()) : -1;
-        if (zoneRange != -1) CP=zones->getCP(zoneRange);
-    
-        foreach(const RideFilePoint *p1, ride->dataPoints()) {
-            bool selected = isSelected(p1, ride->recIntSecs());
+        QString key = QString("%1/%2 %3 %4 %5").arg(rideItem->path).arg(rideItem->fileName)
+                      .arg(series == RideFile::aPower).arg(withz).arg(context->athlete->useMetricUnits);
+        for (int i=0; i<intervals.count(); i++) key += QString(" %1-%2").arg(intervals[i].first).arg(intervals[i].second);
 
-            // watts array
-            int wattsIndex = int(floor(p1->watts / wattsDelta));
-            if (wattsIndex >= 0 && wattsIndex < maxSize) {
-                if (wattsIndex >= standard.wattsArray.size())
-                    standard.wattsArray.resize(wattsIndex + 1);
-                standard.wattsArray[wattsIndex]++;
+        preparer->prepare(new PowerHistJob(ride, zones, intervals, withz, context->athlete->useMetricUnits, key));
 
-                if (selected) {
-                    if (wattsIndex >= standard.wattsSelectedArray.size())
-                        standard.wattsSelectedArray.resize(wattsIndex + 1);
-                    standard.wattsSelectedArray[wattsIndex]++;
-                }
-            }
+    } else {
 
-            // watts zoned array
-            // Only calculate zones if we have a valid range and check zeroes
-            if (zoneRange > -1 && (withz || (!withz && p1->watts))) {
+        // create empty curves when no data
+        preparer->cancel();
+        const double zero = 0;
+        curve->setSamples(&zero, &zero, 0);
+        curveSelected->setSamples(&zero, &zero, 0);
+        updatePlot();
+    }
+    curveSelected->show();
+    zoomer->setZoomBase();
 
-                // cp zoned
-                if (standard.wattsCPZoneArray.size() < 3) {
-                    standard.wattsCPZoneArray.resize(3);
-                }
+    // dont show legend in metric mode
+    //XXX legend()->hide();
+    //XXX updateLegend();
+}
 
-                if (p1->watts < 1 && withz) { // moderate zero watts
-                    standard.wattsCPZoneArray[0] ++;
-                } else if (p1->watts < (CP * 0.85f)) { // moderate
-                    standard.wattsCPZoneArray[0] ++;
-                } else if (p1->watts < CP) { // heavy
-                    standard.wattsCPZoneArray[1] ++;
-                } else { // severe
-                    standard.wattsCPZoneArray[2] ++;
-                }
+PowerHistJob::PowerHistJob(RideFile *ride, const RideFileCacheZones &zones, QList<QPair<double,double> > intervals,
+                           bool withz, bool useMetricUnits, QString key) :
+    ChartJob(key), zones(zones), intervals(intervals), withz(withz),
+    recIntSecs(ride->recIntSecs()), weight(ride->getWeight())
+{
+    // unit conversion factor for imperial units for selected parameters
+    torque_factor = (useMetricUnits ? 1.0 : 0.73756215);
+    speed_factor  = (useMetricUnits ? 1.0 : 0.62137119);
 
-                // get the zone
-                wattsIndex = zones->whichZone(zoneRange, p1->watts);
+    points.reserve(ride->dataPoints().size());
+    foreach(const RideFilePoint *p1, ride->dataPoints()) points << *p1;
+}
 
-                // zoned
-                if (wattsIndex >= 0 && wattsIndex < maxSize) {
-                    if (wattsIndex >= standard.wattsZoneArray.size())
-                        standard.wattsZoneArray.resize(wattsIndex + 1);
-                    standard.wattsZoneArray[wattsIndex]++;
+// is it in one of the intervals selected
+bool
+PowerHistJob::isSelected(const RideFilePoint &p) const
+{
+    for (int i=0; i<intervals.count(); i++)
+        if (p.secs+recIntSecs>intervals[i].first && p.secs<intervals[i].second)
+            return true;
+    return false;
+}
 
-                    if (selected) {
-                        if (wattsIndex >= standard.wattsZoneSelectedArray.size())
-                            standard.wattsZoneSelectedArray.resize(wattsIndex + 1);
-                        standard.wattsZoneSelectedArray[wattsIndex]++;
-                    }
-                }
-            }
+void
+PowerHistJob::prepare()
+{
+    // predefined deltas for each series
+    static const double wattsDelta = 1.0;
+    static const double wattsKgDelta = 0.01;
+    static const double nmDelta    = 0.1;
+    static const double hrDelta    = 1.0;
+    static const double kphDelta   = 0.1;
+    static const double cadDelta   = 1.0;
 
-            // aPower array
-            int aPowerIndex = int(floor(p1->apower / wattsDelta));
-            if (aPowerIndex >= 0 && aPowerIndex < maxSize) {
-                if (aPowerIndex >= standard.aPowerArray.size())
-                    standard.aPowerArray.resize(aPowerIndex + 1);
-                standard.aPowerArray[aPowerIndex]++;
+    static const int maxSize = 4096;
 
-                if (selected) {
-                    if (aPowerIndex >= standard.aPowerSelectedArray.size())
-                        standard.aPowerSelectedArray.resize(aPowerIndex + 1);
-                    standard.aPowerSelectedArray[aPowerIndex]++;
-                }
+    for (int i=0; i<points.count(); i++) {
+
+        // selected another ride already?
+        if ((i & 0xfff) == 0 && cancelled()) return;
+
+        const RideFilePoint &p = points[i];
+        bool selected = isSelected(p);
+
+        // watts array
+        int wattsIndex = int(floor(p.watts / wattsDelta));
+        if (wattsIndex >= 0 && wattsIndex < maxSize) {
+            if (wattsIndex >= standard.wattsArray.size())
+                standard.wattsArray.resize(wattsIndex + 1);
+            standard.wattsArray[wattsIndex]++;
+
+            if (selected) {
+                if (wattsIndex >= standard.wattsSelectedArray.size())
+                    standard.wattsSelectedArray.resize(wattsIndex + 1);
+                standard.wattsSelectedArray[wattsIndex]++;
             }
+        }
 
-            // wattsKg array
-            int wattsKgIndex = int(floor(p1->watts / ride->getWeight() / wattsKgDelta));
-            if (wattsKgIndex >= 0 && wattsKgIndex < maxSize) {
-                if (wattsKgIndex >= standard.wattsKgArray.size())
-                    standard.wattsKgArray.resize(wattsKgIndex + 1);
-                standard.wattsKgArray[wattsKgIndex]++;
+        // watts zoned array
+        // Only calculate zones if we have a valid range and check zeroes
+        if (!zones.wattsLows.isEmpty() && (withz || (!withz && p.watts))) {
 
-                if (selected) {
-                    if (wattsKgIndex >= standard.wattsKgSelectedArray.size())
-                        standard.wattsKgSelectedArray.resize(wattsKgIndex + 1);
-                    standard.wattsKgSelectedArray[wattsKgIndex]++;
-                }
+            // cp zoned
+            if (standard.wattsCPZoneArray.size() < 3) {
+                standard.wattsCPZoneArray.resize(3);
             }
 
-            int nmIndex = int(floor(p1->nm * torque_factor / nmDelta));
-            if (nmIndex >= 0 && nmIndex < maxSize) {
-                if (nmIndex >= standard.nmArray.size())
-                    standard.nmArray.resize(nmIndex + 1);
-                standard.nmArray[nmIndex]++;
+            if (p.watts < 1 && withz) { // moderate zero watts
+                standard.wattsCPZoneArray[0] ++;
+            } else if (p.watts < (zones.CP * 0.85f)) { // moderate
+                standard.wattsCPZoneArray[0] ++;
+            } else if (p.watts < zones.CP) { // heavy
+                standard.wattsCPZoneArray[1] ++;
+            } else { // severe
+                standard.wattsCPZoneArray[2] ++;
+            }
+
+            // get the zone
+            wattsIndex = RideFileCacheZones::whichZone(zones.wattsLows, zones.wattsHighs, p.watts);
+
+            // zoned
+            if (wattsIndex >= 0 && wattsIndex < maxSize) {
+                if (wattsIndex >= standard.wattsZoneArray.size())
+                    standard.wattsZoneArray.resize(wattsIndex + 1);
+                standard.wattsZoneArray[wattsIndex]++;
 
                 if (selected) {
-                    if (nmIndex >= standard.nmSelectedArray.size())
-                        standard.nmSelectedArray.resize(nmIndex + 1);
-                    standard.nmSelectedArray[nmIndex]++;
+                    if (wattsIndex >= standard.wattsZoneSelectedArray.size())
+                        standard.wattsZoneSelectedArray.resize(wattsIndex + 1);
+                    standard.wattsZoneSelectedArray[wattsIndex]++;
                 }
             }
+        }
 
-            int hrIndex = int(floor(p1->hr / hrDelta));
-            if (hrIndex >= 0 && hrIndex < maxSize) {
-                if (hrIndex >= standard.hrArray.size())
-                    standard.hrArray.resize(hrIndex + 1);
-                standard.hrArray[hrIndex]++;
+        // aPower array
+        int aPowerIndex = int(floor(p.apower / wattsDelta));
+        if (aPowerIndex >= 0 && aPowerIndex < maxSize) {
+            if (aPowerIndex >= standard.aPowerArray.size())
+                standard.aPowerArray.resize(aPowerIndex + 1);
+            standard.aPowerArray[aPowerIndex]++;
+
+            if (selected) {
+                if (aPowerIndex >= standard.aPowerSelectedArray.size())
+                    standard.aPowerSelectedArray.resize(aPowerIndex + 1);
+                standard.aPowerSelectedArray[aPowerIndex]++;
+            }
+        }
 
-                if (selected) {
-                    if (hrIndex >= standard.hrSelectedArray.size())
-                        standard.hrSelectedArray.resize(hrIndex + 1);
-                    standard.hrSelectedArray[hrIndex]++;
-                }
+        // wattsKg array
+        int wattsKgIndex = int(floor(p.watts / weight / wattsKgDelta));
+        if (wattsKgIndex >= 0 && wattsKgIndex < maxSize) {
+            if (wattsKgIndex >= standard.wattsKgArray.size())
+                standard.wattsKgArray.resize(wattsKgIndex + 1);
+            standard.wattsKgArray[wattsKgIndex]++;
+
+            if (selected) {
+                if (wattsKgIndex >= standard.wattsKgSelectedArray.size())
+                    standard.wattsKgSelectedArray.resize(wattsKgIndex + 1);
+                standard.wattsKgSelectedArray[wattsKgIndex]++;
             }
+        }
 
-            // hr zoned array
-            int hrZoneRange = context->athlete->hrZones() ? context->athlete->hrZones()->whichRange(ride->startTime().date()) : -1;
+        int nmIndex = int(floor(p.nm * torque_factor / nmDelta));
+        if (nmIndex >= 0 && nmIndex < maxSize) {
+            if (nmIndex >= standard.nmArray.size())
+                standard.nmArray.resize(nmIndex + 1);
+            standard.nmArray[nmIndex]++;
 
-            // Only calculate zones if we have a valid range
-            if (hrZoneRange > -1 && (withz || (!withz && p1->hr))) {
-                hrIndex = context->athlete->hrZones()->whichZone(hrZoneRange, p1->hr);
+            if (selected) {
+                if (nmIndex >= standard.nmSelectedArray.size())
+                    standard.nmSelectedArray.resize(nmIndex + 1);
+                standard.nmSelectedArray[nmIndex]++;
+            }
+        }
 
-                if (hrIndex >= 0 && hrIndex < maxSize) {
-                    if (hrIndex >= standard.hrZoneArray.size())
-                        standard.hrZoneArray.resize(hrIndex + 1);
-                    standard.hrZoneArray[hrIndex]++;
+        int hrIndex = int(floor(p.hr / hrDelta));
+        if (hrIndex >= 0 && hrIndex < maxSize) {
+            if (hrIndex >= standard.hrArray.size())
+                standard.hrArray.resize(hrIndex + 1);
+            standard.hrArray[hrIndex]++;
 
-                    if (selected) {
-                        if (hrIndex >= standard.hrZoneSelectedArray.size())
-                            standard.hrZoneSelectedArray.resize(hrIndex + 1);
-                        standard.hrZoneSelectedArray[hrIndex]++;
-                    }
-                }
+            if (selected) {
+                if (hrIndex >= standard.hrSelectedArray.size())
+                    standard.hrSelectedArray.resize(hrIndex + 1);
+                standard.hrSelectedArray[hrIndex]++;
             }
+        }
+
+        // hr zoned array
+        // Only calculate zones if we have a valid range
+        if (!zones.hrLows.isEmpty() && (withz || (!withz && p.hr))) {
+            hrIndex = RideFileCacheZones::whichZone(zones.hrLows, zones.hrHighs, p.hr);
 
-            int kphIndex = int(floor(p1->kph * speed_factor / kphDelta));
-            if (kphIndex >= 0 && kphIndex < maxSize) {
-                if (kphIndex >= standard.kphArray.size())
-                    standard.kphArray.resize(kphIndex + 1);
-                standard.kphArray[kphIndex]++;
+            if (hrIndex >= 0 && hrIndex < maxSize) {
+                if (hrIndex >= standard.hrZoneArray.size())
+                    standard.hrZoneArray.resize(hrIndex + 1);
+                standard.hrZoneArray[hrIndex]++;
 
                 if (selected) {
-                    if (kphIndex >= standard.kphSelectedArray.size())
-                        standard.kphSelectedArray.resize(kphIndex + 1);
-                    standard.kphSelectedArray[kphIndex]++;
+                    if (hrIndex >= standard.hrZoneSelectedArray.size())
+                        standard.hrZoneSelectedArray.resize(hrIndex + 1);
+                    standard.hrZoneSelectedArray[hrIndex]++;
                 }
             }
+        }
 
-            int cadIndex = int(floor(p1->cad / cadDelta));
-            if (cadIndex >= 0 && cadIndex < maxSize) {
-                if (cadIndex >= standard.cadArray.size())
-                    standard.cadArray.resize(cadIndex + 1);
-                standard.cadArray[cadIndex]++;
+        int kphIndex = int(floor(p.kph * speed_factor / kphDelta));
+        if (kphIndex >= 0 && kphIndex < maxSize) {
+            if (kphIndex >= standard.kphArray.size())
+                standard.kphArray.resize(kphIndex + 1);
+            standard.kphArray[kphIndex]++;
 
-                if (selected) {
-                    if (cadIndex >= standard.cadSelectedArray.size())
-                        standard.cadSelectedArray.resize(cadIndex + 1);
-                    standard.cadSelectedArray[cadIndex]++;
-                }
+            if (selected) {
+                if (kphIndex >= standard.kphSelectedArray.size())
+                    standard.kphSelectedArray.resize(kphIndex + 1);
+                standard.kphSelectedArray[kphIndex]++;
             }
         }
 
-    } else {
+        int cadIndex = int(floor(p.cad / cadDelta));
+        if (cadIndex >= 0 && cadIndex < maxSize) {
+            if (cadIndex >= standard.cadArray.size())
+                standard.cadArray.resize(cadIndex + 1);
+            standard.cadArray[cadIndex]++;
 
-        // create empty curves when no data
-        const double zero = 0;
-        curve->setSamples(&zero, &zero, 0);
-        curveSelected->setSamples(&zero, &zero, 0);
-        updatePlot();
+            if (selected) {
+                if (cadIndex >= standard.cadSelectedArray.size())
+                    standard.cadSelectedArray.resize(cadIndex + 1);
+                standard.cadSelectedArray[cadIndex]++;
+            }
+        }
     }
-    curveSelected->show();
-    zoomer->setZoomBase();
+}
 
-    // dont show legend in metric mode
-    //XXX legend()->hide();
-    //XXX updateLegend();
+void
+PowerHist::setPrepared(ChartJob *job)
+{
+    // moved on to a cache or the metrics since
+    if (source != Ride || !rideItem) return;
+
+    // the metrics' counts aren't ours
+    QVector<unsigned int> metricArray = standard.metricArray;
+    standard = static_cast<PowerHistJob*>(job)->standard;
+    standard.metricArray = metricArray;
+
+    recalc(true);
+    replot();
 }
 
 void
@@ -1828,20 +1892,6 @@ bool PowerHist::shadeHRZones() const
     return (rideItem && rideItem->ride() && series == RideFile::hr && !zoned && shade == true);
 }
 
-bool PowerHist::isSelected(const RideFilePoint *p, double sample) {
-    if (context->athlete->allIntervalItems() != NULL) {
-        for (int i=0; i<context->athlete->allIntervalItems()->childCount(); i++) {
-            IntervalItem *current = dynamic_cast<IntervalItem*>(context->athlete->allIntervalItems()->child(i));
-            if (current != NULL) {
-                if (current->isSelected() && p->secs+sample>current->start && p->secs<current->stop) {
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
-}
-
 void
 PowerHist::pointHover(QwtPlotCurve *curve, int index)
 {
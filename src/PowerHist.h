@@ -26,6 +26,8 @@
 #include "Athlete.h"
 #include "Zones.h"
 #include "HrZones.h"
+#include "RideFileCache.h"
+#include "ChartPrep.h"
 
 #include <qwt_plot.h>
 #include <qwt_plot_canvas.h>
@@ -168,6 +170,8 @@ class PowerHist : public QwtPlot
         // react to plot signals
         void pointHover(QwtPlotCurve *curve, int index);
 
+        void setPrepared(ChartJob *job); // the distributions for setData
+
         // get told to refresh
         void recalc(bool force=false); // normal mode recalc
         void recalcCompare(); // compare mode recalc
@@ -184,7 +188,6 @@ class PowerHist : public QwtPlot
 
         void refreshHRZoneLabels();
         void setParameterAxisTitle();
-        bool isSelected(const RideFilePoint *p, double);
         void percentify(QVector<double> &, double factor); // and a function to convert
 
         bool shadeZones() const; // check if zone shading is both wanted and possible
@@ -254,6 +257,29 @@ class PowerHist : public QwtPlot
         bool LASTwithz;        // whether zeros are included in histogram
         double LASTdt;         // length of sample
         bool LASTabsolutetime; // do we sum absolute or percentage?
+
+        ChartPreparer *preparer;
+};
+
+// the distributions for a ride, binned in the background
+class PowerHistJob : public ChartJob
+{
+    public:
+        PowerHistJob(RideFile *ride, const RideFileCacheZones &zones, QList<QPair<double,double> > intervals,
+                     bool withz, bool useMetricUnits, QString key);
+        void prepare();
+
+        HistData standard;
+
+    private:
+        bool isSelected(const RideFilePoint &p) const;
+
+        RideFileCacheZones zones;
+        QList<QPair<double,double> > intervals; // selected, start and stop
+        bool withz;
+        double recIntSecs, weight;
+        double torque_factor, speed_factor;
+        QVector<RideFilePoint> points;
 };
 
 /*----------------------------------------------------------------------
@@ -28,6 +28,7 @@ bool quarqInterpreterInstalled( void );
 struct QuarqFileReader : public RideFileReader {
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const; 
     bool hasWrite() const { return false; }
+    bool isReentrant() const { return false; } // the interpreter lookup is a static
 };
 
 #endif // _QuarqRideFile_h
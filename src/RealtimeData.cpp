@@ -27,6 +27,7 @@ RealtimeData::RealtimeData()
 	hr= watts= altWatts= speed= wheelRpm= load= slope = 0.0;
 	cadence = distance = virtualSpeed = 0.0;
 	lap = msecs = lapMsecs = lapMsecsRemaining = 0;
+    received = 0;
 
     memset(spinScan, 0, 24);
 }
@@ -342,3 +343,12 @@ long RealtimeData::getLap() const
 {
     return lap;
 }
+
+void RealtimeData::setReceived(double x)
+{
+    this->received = x;
+}
+double RealtimeData::getReceived() const
+{
+    return received;
+}
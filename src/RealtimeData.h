@@ -69,6 +69,7 @@ public:
     void setJoules(long);
     void setXPower(long);
     void setLap(long);
+    void setReceived(double);
 
     const char *getName() const;
     double getWatts() const;
@@ -85,6 +86,7 @@ public:
     long getLapMsecs() const;
     double getDistance() const;
     long getLap() const;
+    double getReceived() const;
 
     uint8_t spinScan[24];
 
@@ -102,6 +104,10 @@ private:
     long msecs;
     long lapMsecs;
     long lapMsecsRemaining;
+
+    // when the device last received sensor data, seconds since the
+    // epoch or 0 if the device doesn't say
+    double received;
 };
 
 #endif
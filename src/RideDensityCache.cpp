@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideDensityCache.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "RideFile.h"
+#include "RideFileCache.h"
+#include "Settings.h"
+
+#include <math.h>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QRegExp>
+#include <QDebug>
+
+static const quint32 RideDensityCacheMagic = 0x67637064; // 'gcpd'
+
+// the binning for each pair
+static const struct {
+    double xmin, xbin;
+    int xbins;
+    double ymin, ybin;
+    int ybins;
+} bins[RideDensityCache::NumPairs] = {
+    { 0, 10, 200,   0, 2, 100 },        // watts 0-2000w x cadence 0-200rpm
+    { 0, 10, 200,   0, 2, 110 },        // watts 0-2000w x hr 0-220bpm
+    { 0, 1, 100,    -20, 0.5, 80 },     // speed 0-100kph x slope -20% to +20%
+    { 0, 0.02, 150, 0, 5, 160 },        // CPV 0-3m/s x AEPF 0-800N
+};
+
+int RideDensityCache::xBins(Pair pair) { return bins[pair].xbins; }
+int RideDensityCache::yBins(Pair pair) { return bins[pair].ybins; }
+double RideDensityCache::xMin(Pair pair) { return bins[pair].xmin; }
+double RideDensityCache::yMin(Pair pair) { return bins[pair].ymin; }
+double RideDensityCache::xBinSize(Pair pair) { return bins[pair].xbin; }
+double RideDensityCache::yBinSize(Pair pair) { return bins[pair].ybin; }
+
+QString
+RideDensityCache::xName(Pair pair)
+{
+    switch (pair) {
+    case WattsCad:
+    case WattsHr: return tr("Power");
+    case SpeedSlope: return tr("Speed");
+    case AEPFCPV: return tr("Circumferential Pedal Velocity");
+    default: return "";
+    }
+}
+
+QString
+RideDensityCache::yName(Pair pair)
+{
+    switch (pair) {
+    case WattsCad: return tr("Cadence");
+    case WattsHr: return tr("Heartrate");
+    case SpeedSlope: return tr("Slope");
+    case AEPFCPV: return tr("Average Effective Pedal Force");
+    default: return "";
+    }
+}
+
+static inline int binFor(double value, double min, double size, int count)
+{
+    int bin = floor((value - min) / size);
+    if (bin < 0) return 0;
+    if (bin >= count) return count-1;
+    return bin;
+}
+
+QString
+RideDensityCache::cacheFileFor(QString rideFileName)
+{
+    QFileInfo rideFileInfo(rideFileName);
+    return rideFileInfo.path() + "/" + rideFileInfo.baseName() + ".cpd";
+}
+
+// the .cpd is there and the ride hasn't been saved since
+static bool newerThanRide(QString rideFileName)
+{
+    QFileInfo rideFileInfo(rideFileName);
+    QFileInfo cacheFileInfo(RideDensityCache::cacheFileFor(rideFileName));
+    return cacheFileInfo.exists() && rideFileInfo.lastModified() <= cacheFileInfo.lastModified();
+}
+
+// in the header to the nearest tenth of a mm
+static quint32 crankTenths(double crankLength)
+{
+    return quint32(qRound(crankLength * 10000.0));
+}
+
+void
+RideDensityCache::reset()
+{
+    for (int i=0; i<NumPairs; i++) cells[i].fill(0.0, bins[i].xbins * bins[i].ybins);
+}
+
+double
+RideDensityCache::seconds(Pair pair, int x, int y) const
+{
+    if (x < 0 || x >= bins[pair].xbins || y < 0 || y >= bins[pair].ybins) return 0;
+    return cells[pair][y * bins[pair].xbins + x];
+}
+
+void
+RideDensityCache::merge(const RideDensityCache &other)
+{
+    for (int i=0; i<NumPairs; i++) {
+        double *into = cells[i].data();
+        const double *from = other.cells[i].constData();
+        for (int j=0; j<cells[i].count(); j++) into[j] += from[j];
+    }
+}
+
+//
+// CONSTRUCTORS
+//
+double
+RideDensityCache::crankLength()
+{
+    return appsettings->value(NULL, GC_CRANKLENGTH, 0.0).toDouble() / 1000.0;
+}
+
+RideDensityCache::RideDensityCache(RideFile *ride) : missing_(0)
+{
+    reset();
+    compute(ride, crankLength());
+}
+
+RideDensityCache::RideDensityCache(Context *context, QString fileName, RideFile *ride) : missing_(0)
+{
+    reset();
+
+    // is it up-to-date?
+    double cl = crankLength();
+    if (newerThanRide(fileName) && read(cacheFileFor(fileName), cl)) return;
+
+    // NEED TO UPDATE!!
+    reset();
+    RideFile *opened = NULL;
+    if (!ride) {
+        QStringList errors;
+        QFile file(fileName);
+        ride = opened = RideFileFactory::instance().openRideFile(context, file, errors);
+        if (!ride) return;
+    }
+    compute(ride, cl);
+    write(cacheFileFor(fileName), cl);
+    delete opened;
+}
+
+// same as RideFileCache
+static QDate dateFromFileName(const QString filename) {
+    QRegExp rx("^(\\d\\d\\d\\d)_(\\d\\d)_(\\d\\d)_\\d\\d_\\d\\d_\\d\\d\\..*$");
+    if (rx.exactMatch(filename)) {
+        QDate date(rx.cap(1).toInt(), rx.cap(2).toInt(), rx.cap(3).toInt());
+        if (date.isValid()) return date;
+    }
+    return QDate(); // nil date
+}
+
+RideDensityCache::RideDensityCache(Context *context, QDate start, QDate end, bool filter, QStringList files, bool onhome) :
+    missing_(0)
+{
+    reset();
+    double cl = crankLength();
+
+    foreach (QString rideFileName, RideFileFactory::instance().listRideFiles(context->athlete->home)) {
+        QDate rideDate = dateFromFileName(rideFileName);
+        if (((filter == true && files.contains(rideFileName)) || filter == false) &&
+            rideDate >= start && rideDate <= end) {
+
+            // skip globally filtered values
+            if (context->isfiltered && !context->filters.contains(rideFileName)) continue;
+            if (onhome && context->ishomefiltered && !context->homeFilters.contains(rideFileName)) continue;
+
+            // the refresher brings them up to date, we don't open
+            // the rides on the gui thread to do it ourselves
+            QString path = context->athlete->home.absolutePath() + "/" + rideFileName;
+            if (!newerThanRide(path) || !read(cacheFileFor(path), cl)) missing_++;
+        }
+    }
+}
+
+bool
+RideDensityCache::update(QString rideFileName, RideFile *ride, double crankLength)
+{
+    RideDensityCache updater;
+    updater.compute(ride, crankLength);
+    return updater.write(cacheFileFor(rideFileName), crankLength);
+}
+
+//
+// COMPUTATION
+//
+void
+RideDensityCache::compute(RideFile *ride, double cl)
+{
+    if (!ride) return;
+
+    const double secs = ride->recIntSecs();
+    const RideFileDataPresent *present = ride->areDataPresent();
+
+    double *wattscad = cells[WattsCad].data();
+    double *wattshr = cells[WattsHr].data();
+    double *speedslope = cells[SpeedSlope].data();
+    double *aepfcpv = cells[AEPFCPV].data();
+
+    const RideFilePoint *prev = NULL;
+    foreach (const RideFilePoint *p, ride->dataPoints()) {
+
+        int wattsbin = binFor(p->watts, bins[WattsCad].xmin, bins[WattsCad].xbin, bins[WattsCad].xbins);
+
+        if (present->watts && p->watts >= 0) {
+            if (present->cad && p->cad > 0)
+                wattscad[binFor(p->cad, bins[WattsCad].ymin, bins[WattsCad].ybin, bins[WattsCad].ybins)
+                         * bins[WattsCad].xbins + wattsbin] += secs;
+
+            if (present->hr && p->hr > 0)
+                wattshr[binFor(p->hr, bins[WattsHr].ymin, bins[WattsHr].ybin, bins[WattsHr].ybins)
+                        * bins[WattsHr].xbins + wattsbin] += secs;
+        }
+
+        if (present->kph && p->kph > 0) {
+
+            // use the slope if we have it, otherwise from altitude
+            bool haveslope = false;
+            double slope = 0;
+            if (present->slope) {
+                slope = p->slope;
+                haveslope = true;
+            } else if (present->alt && prev && p->km > prev->km) {
+                slope = 100.0 * (p->alt - prev->alt) / ((p->km - prev->km) * 1000.0);
+                haveslope = true;
+            }
+
+            if (haveslope)
+                speedslope[binFor(slope, bins[SpeedSlope].ymin, bins[SpeedSlope].ybin, bins[SpeedSlope].ybins)
+                           * bins[SpeedSlope].xbins
+                           + binFor(p->kph, bins[SpeedSlope].xmin, bins[SpeedSlope].xbin, bins[SpeedSlope].xbins)] += secs;
+        }
+
+        if (cl > 0 && present->watts && present->cad && p->watts > 0 && p->cad > 0) {
+            double aepf = (p->watts * 60.0) / (p->cad * cl * 2.0 * M_PI);
+            double cpv = (p->cad * cl * 2.0 * M_PI) / 60.0;
+
+            if (aepf <= 2500) // > 2500 newtons is out of bounds, as for the PfPv plot
+                aepfcpv[binFor(aepf, bins[AEPFCPV].ymin, bins[AEPFCPV].ybin, bins[AEPFCPV].ybins)
+                        * bins[AEPFCPV].xbins
+                        + binFor(cpv, bins[AEPFCPV].xmin, bins[AEPFCPV].xbin, bins[AEPFCPV].xbins)] += secs;
+        }
+
+        prev = p;
+    }
+}
+
+//
+// PERSISTANCE
+//
+// magic, version, count of pairs and the crank length in tenths of a mm
+// then for each pair the count of non-empty cells followed by
+// (quint16 x, quint16 y, float seconds)
+//
+static bool readHeader(QDataStream &in, double crankLength)
+{
+    quint32 magic, version, pairs, crank;
+    in >> magic >> version >> pairs >> crank;
+    return in.status() == QDataStream::Ok && magic == RideDensityCacheMagic &&
+           version == RideDensityCacheVersion && pairs == RideDensityCache::NumPairs &&
+           crank == crankTenths(crankLength);
+}
+
+bool
+RideDensityCache::isCurrent(QString rideFileName, double crankLength)
+{
+    if (!newerThanRide(rideFileName)) return false;
+
+    QFile cacheFile(cacheFileFor(rideFileName));
+    if (!cacheFile.open(QIODevice::ReadOnly)) return false;
+    QDataStream in(&cacheFile);
+    return readHeader(in, crankLength);
+}
+
+bool
+RideDensityCache::write(QString cacheFileName, double crankLength) const
+{
+    QByteArray contents;
+    QDataStream out(&contents, QIODevice::WriteOnly);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    out << RideDensityCacheMagic << quint32(RideDensityCacheVersion) << quint32(NumPairs)
+        << crankTenths(crankLength);
+
+    for (int i=0; i<NumPairs; i++) {
+        quint32 count = 0;
+        for (int j=0; j<cells[i].count(); j++) if (cells[i][j] > 0) count++;
+        out << count;
+
+        for (int j=0; j<cells[i].count(); j++) {
+            if (cells[i][j] <= 0) continue;
+            out << quint16(j % bins[i].xbins) << quint16(j / bins[i].xbins) << float(cells[i][j]);
+        }
+    }
+
+    // the refresher threads write them whilst charts read them
+    if (!RideFileCache::replaceCache(cacheFileName, contents)) {
+        qDebug()<<"cannot create cache file"<<cacheFileName;
+        return false;
+    }
+    return true;
+}
+
+bool
+RideDensityCache::read(QString cacheFileName, double crankLength)
+{
+    QFile cacheFile(cacheFileName);
+    if (!cacheFile.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&cacheFile);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    if (!readHeader(in, crankLength)) return false;
+
+    // we add to what we have, so only once the whole file has been read
+    QVector<int> index[NumPairs];
+    QVector<float> value[NumPairs];
+    for (int i=0; i<NumPairs && in.status() == QDataStream::Ok; i++) {
+        quint32 count;
+        in >> count;
+
+        for (quint32 j=0; j<count && in.status() == QDataStream::Ok; j++) {
+            quint16 x, y;
+            float seconds;
+            in >> x >> y >> seconds;
+            if (x < bins[i].xbins && y < bins[i].ybins) {
+                index[i] << y * bins[i].xbins + x;
+                value[i] << seconds;
+            }
+        }
+    }
+    if (in.status() != QDataStream::Ok) return false;
+
+    for (int i=0; i<NumPairs; i++) {
+        double *into = cells[i].data();
+        for (int j=0; j<index[i].count(); j++) into[index[i][j]] += value[i][j];
+    }
+    return true;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideDensityCache_h
+#define _GC_RideDensityCache_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QDate>
+#include <QApplication>
+
+class Context;
+class RideFile;
+
+static const unsigned int RideDensityCacheVersion = 2;
+// revision history:
+// version  date         description
+// 1        01-Apr-14    Initial - watts/cad, watts/hr, speed/slope and AEPF/CPV
+// 2        19-Oct-26    Crank length in the header, AEPF/CPV depend on it
+
+// RideDensityCache holds 2d histograms (seconds spent in each cell) for
+// a few common pairs of channels, so scatter and density plots can be
+// drawn for a whole season without opening every ride.
+//
+// It is kept alongside the .cpx file for each ride in a .cpd file, which
+// the RideFileCacheRefresher brings up to date in the background along
+// with the .cpx, when the ride is newer than it or the crank length has
+// changed. Most cells are empty so only the non-empty cells are stored,
+// as (x, y, seconds) triples, which is usually a few KB per ride.
+//
+// As with the RideFileCache the caches for a date range are just summed
+// together, so a season's worth is one pass over the .cpd files. Rides
+// that aren't up to date yet are left out rather than opened, they are
+// counted in missing() so a chart can say so and wait for the refresher.
+//
+// The constructors read the crank length from the settings, so are for
+// the gui thread, isCurrent() and update() are for the refresher.
+class RideDensityCache
+{
+    Q_DECLARE_TR_FUNCTIONS(RideDensityCache)
+
+    public:
+        enum pair { WattsCad=0, WattsHr, SpeedSlope, AEPFCPV, NumPairs };
+        typedef enum pair Pair;
+
+        // for a ride, will refresh the .cpd if it is missing or out of
+        // date, opening the ride file unless it is passed
+        RideDensityCache(Context *context, QString filename, RideFile *ride = 0);
+
+        // across a date range, filtering as for RideFileCache
+        RideDensityCache(Context *context, QDate start, QDate end, bool filter = false,
+                         QStringList files = QStringList(), bool onhome = true);
+        int missing() const { return missing_; } // rides in the range left out
+
+        // just from a raw ride file class (usually for intervals)
+        RideDensityCache(RideFile *ride);
+
+        // add another ride or date range into this one
+        void merge(const RideDensityCache &other);
+
+        // seconds spent in each cell, x varies fastest
+        // i.e. the cell for (x,y) is [y * xBins(pair) + x]
+        const QVector<double> &density(Pair pair) const { return cells[pair]; }
+        double seconds(Pair pair, int x, int y) const;
+
+        // explain the binning, values outside the range
+        // are counted in the first or last bin
+        static int xBins(Pair pair);
+        static int yBins(Pair pair);
+        static double xMin(Pair pair);
+        static double yMin(Pair pair);
+        static double xBinSize(Pair pair);
+        static double yBinSize(Pair pair);
+        static QString xName(Pair pair);
+        static QString yName(Pair pair);
+
+        static QString cacheFileFor(QString rideFileName);
+
+        // in metres, from the settings so on the gui thread
+        static double crankLength();
+
+        // is the .cpd for a ride there, newer than it and for this crank
+        // length, and write it for an open ride if not
+        static bool isCurrent(QString rideFileName, double crankLength);
+        static bool update(QString rideFileName, RideFile *ride, double crankLength);
+
+    private:
+        RideDensityCache() : missing_(0) { reset(); } // for update()
+        QVector<double> cells[NumPairs];
+        int missing_;
+
+        void reset();
+        void compute(RideFile *ride, double crankLength); // metres
+        bool read(QString cacheFileName, double crankLength); // adds to what we have
+        bool write(QString cacheFileName, double crankLength) const;
+};
+
+#endif // _GC_RideDensityCache_h
@@ -29,6 +29,7 @@
 
 // for strtod
 #include <stdlib.h>
+#include <math.h>
 
 // used to make a lookup string for row/col anomalies
 static QString xsstring(int x, RideFile::SeriesType series)
@@ -59,6 +60,8 @@ static void secsMsecs(double value, int &secs, int &msecs)
 RideEditor::RideEditor(Context *context) : GcChartWindow(context), data(NULL), ride(NULL), context(context), inLUW(false), colMapper(NULL)
 {
     setControls(NULL);
+    unchecked.from = unchecked.to = -1;
+    unchecked.spikes = unchecked.all = false;
 
     QVBoxLayout *mainLayout = new QVBoxLayout;
     mainLayout->setSpacing(0);
@@ -206,10 +209,7 @@ RideEditor::isAnomaly(int row, int col)
 {
     if (row < 0 || col < 0) return false;
 
-    if (data->anomalies.value(xsstring(row,model->columnType(col)), "") != "")
-        return true;
-
-    return false;
+    return data->anomalies.contains(row, model->columnType(col));
 }
 
 bool
@@ -217,10 +217,7 @@ RideEditor::isFound(int row, int col)
 {
     if (row < 0 || col < 0) return false;
 
-    if (data->found.value(xsstring(row,model->columnType(col)), "") != "")
-        return true;
-
-    return false;
+    return data->found.contains(row, model->columnType(col));
 }
 
 bool
@@ -229,13 +226,17 @@ RideEditor::isTooPrecise(int row, int column)
     if (row < 0 || column < 0) return false;
 
     RideFile::SeriesType what = model->columnType(column);
-    int dp;
-    QString value = QString("%1").arg(getValue(row, column), 0, 'g', 10);
+    double value = fabs(getValue(row, column));
+    if (value == 0 || value != value || value > 1e15) return false;
 
-    if ((dp = value.indexOf(".")) >= 0)
-        if (value.length()-(dp+1) > RideFile::decimalsFor(what)) return true;
+    // the value is shown to 10 significant digits, is there
+    // anything in them after the decimals we allow for?
+    int dp = RideFile::decimalsFor(what);
+    int last = floor(log10(value)) - 9; // power of the 10th digit
+    if (last >= -dp) return false;
 
-    return false;
+    double scaled = value * pow(10.0, dp);
+    return fabs(scaled - floor(scaled + 0.5)) > pow(10.0, last + dp) / 2.0;
 }
 
 bool
@@ -320,74 +321,95 @@ AnomalyDialog::check()
     // run through all the available channels and find anomalies
     rideEditor->data->anomalies.clear();
 
-    // clear the list
-    anomalyList->clear();
-    //QStringList header;
-    //header << "Id" << "Anomalies";
-    //anomalyList->setHorizontalHeaderLabels(header);
-    anomalyList->horizontalHeader()->hide();
+    checkRows(0, rideEditor->ride->ride()->dataPoints().count()-1);
+    checkSpikes();
+    refreshList();
+}
+
+void
+AnomalyDialog::check(int row, int count, bool spikes)
+{
+    // the row after those changed is compared with them
+    // for gaps in recording and distance going backwards
+    int last = rideEditor->ride->ride()->dataPoints().count()-1;
+    checkRows(qMax(0, row), qMin(last, row+count));
+    if (spikes) checkSpikes();
+    refreshList();
+}
+
+void
+AnomalyDialog::checkRows(int from, int to)
+{
+    const QVector<RideFilePoint*> &points = rideEditor->ride->ride()->dataPoints();
+    EditorCells &anomalies = rideEditor->data->anomalies;
+    bool cadPresent = rideEditor->ride->ride()->areDataPresent()->cad;
+    double recIntSecs = rideEditor->ride->ride()->recIntSecs();
 
-    QVector<double> power;
-    QVector<double> secs;
-    double lastdistance=9;
-    int count = 0;
+    static const RideFile::SeriesType checked[] = { RideFile::secs, RideFile::km, RideFile::cad, RideFile::hr,
+                                                     RideFile::kph, RideFile::lat, RideFile::lon, RideFile::nm };
 
-    foreach (RideFilePoint *point, rideEditor->ride->ride()->dataPoints()) {
-        power.append(point->watts);
-        secs.append(point->secs);
+    for (int count = from; count <= to; count++) {
+        const RideFilePoint *point = points[count];
+
+        // forget what we found here last time
+        for (unsigned int i=0; i<sizeof(checked)/sizeof(checked[0]); i++) anomalies.remove(count, checked[i]);
 
         if (count) {
+            const RideFilePoint *prev = points[count-1];
 
             // whilst we are here we might as well check for gaps in recording
             // anything bigger than a second is of a material concern
             // and we assume time always flows forward ;-)
-            double diff = secs[count] - (secs[count-1] + rideEditor->ride->ride()->recIntSecs());
-            if (diff > (double)1.0 || diff < (double)-1.0 || secs[count] < secs[count-1]) {
-                rideEditor->data->anomalies.insert(xsstring(count, RideFile::secs),
-                                       tr("Invalid recording gap"));
+            double diff = point->secs - (prev->secs + recIntSecs);
+            if (diff > (double)1.0 || diff < (double)-1.0 || point->secs < prev->secs) {
+                anomalies.insert(count, RideFile::secs, tr("Invalid recording gap"));
             }
 
             // and on the same theme what about distance going backwards?
-            if (point->km < lastdistance)
-                rideEditor->data->anomalies.insert(xsstring(count, RideFile::km),
-                                       tr("Distance goes backwards."));
+            if (point->km < prev->km)
+                anomalies.insert(count, RideFile::km, tr("Distance goes backwards."));
 
         }
-        lastdistance = point->km;
 
         // suspicious values
         if (point->cad > 150) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::cad),
-                                   tr("Suspiciously high cadence"));
+            anomalies.insert(count, RideFile::cad, tr("Suspiciously high cadence"));
         }
         if (point->hr > 200) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::hr),
-                                   tr("Suspiciously high heartrate"));
+            anomalies.insert(count, RideFile::hr, tr("Suspiciously high heartrate"));
         }
         if (point->kph > 100) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::kph),
-                                   tr("Suspiciously high speed"));
+            anomalies.insert(count, RideFile::kph, tr("Suspiciously high speed"));
         }
         if (point->lat > 90 || point->lat < -90) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::lat),
-                                   tr("Out of bounds value"));
+            anomalies.insert(count, RideFile::lat, tr("Out of bounds value"));
         }
         if (point->lon > 180 || point->lon < -180) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::lon),
-                                   tr("Out of bounds value"));
+            anomalies.insert(count, RideFile::lon, tr("Out of bounds value"));
         }
-        if (rideEditor->ride->ride()->areDataPresent()->cad && point->nm && !point->cad) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::nm),
-                                   tr("Non-zero torque but zero cadence"));
-
+        if (cadPresent && point->nm && !point->cad) {
+            anomalies.insert(count, RideFile::nm, tr("Non-zero torque but zero cadence"));
         }
-        count++;
     }
+}
+
+void
+AnomalyDialog::checkSpikes()
+{
+    // spikes are ranked across the whole ride so always start again
+    rideEditor->data->anomalies.deleteSeries(RideFile::watts);
 
     // lets look at the Power Column if its there and has enough data
     int column = rideEditor->model->headings().indexOf(tr("Power"));
     if (column >= 0 && rideEditor->ride->ride()->dataPoints().count() >= 30) {
 
+        QVector<double> power;
+        QVector<double> secs;
+        foreach (RideFilePoint *point, rideEditor->ride->ride()->dataPoints()) {
+            power.append(point->watts);
+            secs.append(point->secs);
+        }
+
         // get spike config
         double max = appsettings->value(this, GC_DPFS_MAX, "1500").toDouble();
         double variance = appsettings->value(this, GC_DPFS_VARIANCE, "1000").toDouble();
@@ -405,27 +427,33 @@ AnomalyDialog::check()
             if (outliers.getYForRank(i) < max) continue;
 
             // which one is it
-            rideEditor->data->anomalies.insert(xsstring(outliers.getIndexForRank(i), RideFile::watts), tr("Data spike candidate"));
+            rideEditor->data->anomalies.insert(outliers.getIndexForRank(i), RideFile::watts, tr("Data spike candidate"));
         }
     }
+}
+
+void
+AnomalyDialog::refreshList()
+{
+    // clear the list
+    anomalyList->clear();
+    anomalyList->horizontalHeader()->hide();
 
     // now fill in the anomaly list
+    QList<QPair<int, RideFile::SeriesType> > cells = rideEditor->data->anomalies.cells();
     anomalyList->setRowCount(0); // <<< fixes crash at ZZZZ
-    anomalyList->setRowCount(rideEditor->data->anomalies.count()); // <<< ZZZZ
+    anomalyList->setRowCount(cells.count()); // <<< ZZZZ
 
     int counter = 0;
-    QMapIterator<QString,QString> f(rideEditor->data->anomalies);
-    while (f.hasNext()) {
-
-        f.next();
+    for (int i=0; i<cells.count(); i++) {
 
         QTableWidgetItem *t = new QTableWidgetItem;
-        t->setText(f.key());
+        t->setText(xsstring(cells[i].first, cells[i].second));
         t->setFlags(t->flags() & (~Qt::ItemIsEditable));
         anomalyList->setItem(counter, 0, t);
 
         t = new QTableWidgetItem;
-        t->setText(f.value());
+        t->setText(rideEditor->data->anomalies.value(cells[i].first, cells[i].second));
         t->setFlags(t->flags() & (~Qt::ItemIsEditable));
         t->setForeground(QBrush(Qt::red));
         anomalyList->setItem(counter, 1, t);
@@ -438,9 +466,7 @@ AnomalyDialog::check()
     else rideEditor->checkAct->setEnabled(false);
 
     // redraw - even if no anomalies were found since
-    // some may have been highlighted previouslt. This is
-    // an expensive operation, but then so is the check()
-    // function.
+    // some may have been highlighted previouslt.
     rideEditor->model->forceRedraw();
 }
 
@@ -930,8 +956,6 @@ RideEditor::clear()
 void
 RideEditor::smooth()
 {
-    QString xs = xsstring(currentCell.row, model->columnType(currentCell.column));
-
     // calculate smoothed value
     double left = 0.0;
     double right = 0.0;
@@ -1050,7 +1074,7 @@ void CellDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
     // best place to update the tooltip is here, rather than whenever we update the editor
     // data, since this is just before it is used...
     rideEditor->model->setToolTip(index.row(), rideEditor->model->columnType(index.column()),
-        rideEditor->data->anomalies.value(xsstring(index.row(), rideEditor->model->columnType(index.column())),""));
+        rideEditor->data->anomalies.value(index.row(), rideEditor->model->columnType(index.column())));
 
     // found items in yellow
     if (rideEditor->isFound(index.row(), index.column()) == true) {
@@ -1256,6 +1280,7 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
         case RideCommand::SetPointValue:
         {
             SetPointValueCommand *spv = (SetPointValueCommand*)cmd;
+            uncheck(spv->row, 1, spv->series == RideFile::watts || spv->series == RideFile::secs);
 
             // move cursor to point updated
             QModelIndex cursor = model->index(spv->row, model->columnFor(spv->series));
@@ -1276,8 +1301,10 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
             InsertPointCommand *ip = (InsertPointCommand *)cmd;
             if (undo) { // deleted this row...
                 data->deleteRows(ip->row, 1);
+                uncheck(ip->row, 0, true);
             } else {
                 data->insertRows(ip->row, 1);
+                uncheck(ip->row, 1, true);
             }
             break;
         }
@@ -1299,9 +1326,11 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
 
                 // update the EditorData maps
                 data->insertRows(dp->row, 1);
+                uncheck(dp->row, 1, true);
             } else {
                 // update the EditorData maps
                 data->deleteRows(dp->row, 1);
+                uncheck(dp->row, 0, true);
             }
             break;
         }
@@ -1324,20 +1353,26 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
                                                             QItemSelectionModel::SelectCurrent);
                 // update the EditorData maps
                 data->insertRows(dp->row, dp->count);
+                uncheck(dp->row, dp->count, true);
             } else {
                 // update the EditorData maps
                 data->deleteRows(dp->row, dp->count);
+                uncheck(dp->row, 0, true);
             }
             break;
         }
         case RideCommand::AppendPoints:
-            if (!undo) {
+        {
+            AppendPointsCommand *ap = (AppendPointsCommand*)cmd;
+            if (undo) {
+                data->deleteRows(ap->row, ap->count);
+                uncheck(ap->row, 0, true);
+            } else {
 
                 // clear current
                 if (!inLUW) table->selectionModel()->clearSelection();
 
                 // show the user where the rows went
-                AppendPointsCommand *ap = (AppendPointsCommand*)cmd;
                 QModelIndex topleft = model->index(ap->row, 0);
                 QItemSelection highlight(topleft, model->index(ap->row+ap->count-1, model->headings().count()-1));
 
@@ -1345,11 +1380,16 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
                 table->selectionModel()->setCurrentIndex(topleft, QItemSelectionModel::Select);
                 table->selectionModel()->select(highlight, inLUW ? QItemSelectionModel::Select :
                                                     QItemSelectionModel::SelectCurrent);
+                uncheck(ap->row, ap->count, true);
             }
+        }
             break;
 
         case RideCommand::SetDataPresent:
             {
+                // torque without cadence depends on cadence being present
+                unchecked.all = true;
+
                 // clear current
                 if (!inLUW) table->selectionModel()->clearSelection();
 
@@ -1394,10 +1434,39 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
         }
             break;
 
+        case RideCommand::NoOp:
+            break;
+
         default:
+            unchecked.all = true;
             break;
     }
-    if (!inLUW) anomalyTool->check(); // refresh the anomalies...
+
+    // refresh the anomalies, just for the rows changed if we can
+    if (!inLUW) {
+        if (unchecked.all) anomalyTool->check();
+        else if (unchecked.from >= 0) anomalyTool->check(unchecked.from, unchecked.to - unchecked.from, unchecked.spikes);
+        unchecked.from = unchecked.to = -1;
+        unchecked.spikes = unchecked.all = false;
+    }
+}
+
+// remember the rows to check for anomalies once the command, or
+// the whole LUW, is done. rows inserted ahead of those already
+// remembered move them along, rows deleted leave the range a
+// little larger than it needs to be which does no harm
+void
+RideEditor::uncheck(int row, int count, bool spikes)
+{
+    if (unchecked.from < 0) {
+        unchecked.from = row;
+        unchecked.to = row + count;
+    } else {
+        if (row <= unchecked.to) unchecked.to += count;
+        unchecked.from = qMin(unchecked.from, row);
+        unchecked.to = qMax(unchecked.to, row + count);
+    }
+    unchecked.spikes |= spikes;
 }
 
 void
@@ -1417,152 +1486,139 @@ RideEditor::rideDirty()
 //----------------------------------------------------------------------
 // EditorData functions
 //----------------------------------------------------------------------
-void
-EditorData::deleteRows(int row, int count)
+QString
+EditorCells::value(int row, RideFile::SeriesType series) const
 {
+    if (!contains(row, series)) return "";
+    return text[static_cast<int>(series)].value(row);
+}
 
-    // anomalies
-    if (anomalies.count()) {
-        QMutableMapIterator <QString, QString> a(anomalies);
-        QMap<QString,QString> newa; // updated QMap
-        while (a.hasNext()) {
-            a.next();
-
-            int crow;
-            RideFile::SeriesType series;
-            unxsstring(a.key(), crow, series);
+int
+EditorCells::count() const
+{
+    int returning = 0;
+    for (int i=0; i<text.count(); i++) returning += text[i].count();
+    return returning;
+}
 
-            if (crow >= row && crow <= (row+count-1)) {
-                // do nothing - i.e. don't copy across - it is zapped
-                ;
-            } else if (crow > (row+count-1)) {
-                crow -= count;
-                newa.insert(xsstring(crow,series), a.value());
-            } else {
-                newa.insert(a.key(), a.value());
-            }
+QList<QPair<int, RideFile::SeriesType> >
+EditorCells::cells() const
+{
+    QList<QPair<int, RideFile::SeriesType> > returning;
+    for (int i=0; i<text.count(); i++) {
+        QMapIterator<int, QString> t(text[i]);
+        while (t.hasNext()) {
+            t.next();
+            returning << QPair<int, RideFile::SeriesType>(t.key(), static_cast<RideFile::SeriesType>(i));
         }
-        anomalies = newa; // replace with resynced values
     }
+    qSort(returning);
+    return returning;
+}
 
-    // found
-    if (found.count()) {
-        QMutableMapIterator <QString, QString> r(found);
-        QMap<QString,QString> newr; // updated QMap
-        while (r.hasNext()) {
-            r.next();
-
-            int crow;
-            RideFile::SeriesType series;
-            unxsstring(r.key(), crow, series);
-
-            if (crow >= row && crow <= (row+count-1)) {
-                // do nothing - i.e. don't copy across
-                ;
-            } else if (crow > (row+count-1)) {
-                crow -= count;
-                newr.insert(xsstring(crow,series), r.value());
-            } else {
-                newr.insert(r.key(), r.value());
-            }
-        }
-        found = newr; // replace with resynced values
+void
+EditorCells::insert(int row, RideFile::SeriesType series, QString value)
+{
+    if (row < 0) return;
+
+    int s = static_cast<int>(series);
+    if (s >= bits.count()) {
+        bits.resize(s+1);
+        text.resize(s+1);
     }
+
+    // grow in chunks, we are usually filled in row order
+    if (row >= bits[s].size()) bits[s].resize(qMax(row+1, bits[s].size()*2));
+
+    bits[s].setBit(row);
+    text[s].insert(row, value);
 }
 
 void
-EditorData::deleteSeries(RideFile::SeriesType series)
+EditorCells::remove(int row, RideFile::SeriesType series)
 {
+    if (!contains(row, series)) return;
 
-    // anomalies
-    if (anomalies.count()) {
-        QMutableMapIterator <QString, QString> a(anomalies);
-        QMap<QString,QString> newa; // updated QMap
-        while (a.hasNext()) {
-            a.next();
-
-            int crow;
-            RideFile::SeriesType cseries;
-            unxsstring(a.key(), crow, cseries);
+    int s = static_cast<int>(series);
+    bits[s].clearBit(row);
+    text[s].remove(row);
+}
 
-            if (cseries == series) {
-                // do nothing - i.e. don't copy across - it is zapped
-                ;
-            } else {
-                newa.insert(a.key(), a.value());
-            }
-        }
-        anomalies = newa; // replace with resynced values
-    }
+void
+EditorCells::clear()
+{
+    bits.clear();
+    text.clear();
+}
 
-    // found
-    if (found.count()) {
-        QMutableMapIterator <QString, QString> r(found);
-        QMap<QString,QString> newr; // updated QMap
-        while (r.hasNext()) {
-            r.next();
+void
+EditorCells::deleteRows(int row, int count)
+{
+    // only the cells at or after row need to move
+    for (int s=0; s<text.count(); s++) {
 
-            int crow;
-            RideFile::SeriesType cseries;
-            unxsstring(r.key(), crow, cseries);
+        QList<QPair<int, QString> > moved;
+        QMap<int, QString>::iterator i = text[s].lowerBound(row);
+        while (i != text[s].end()) {
+            bits[s].clearBit(i.key());
+            if (i.key() >= row+count) moved << QPair<int, QString>(i.key()-count, i.value());
+            i = text[s].erase(i);
+        }
 
-            if (cseries == series) {
-                // do nothing - i.e. don't copy across
-                ;
-            } else {
-                newr.insert(r.key(), r.value());
-            }
+        for (int j=0; j<moved.count(); j++) {
+            bits[s].setBit(moved[j].first);
+            text[s].insert(moved[j].first, moved[j].second);
         }
-        found = newr; // replace with resynced values
     }
 }
 
 void
-EditorData::insertRows(int row, int count)
+EditorCells::insertRows(int row, int count)
 {
+    for (int s=0; s<text.count(); s++) {
 
-    // anomalies
-    if (anomalies.count()) {
-        QMutableMapIterator <QString, QString> a(anomalies);
-        QMap<QString,QString> newa; // updated QMap
-        while (a.hasNext()) {
-            a.next();
-
-            int crow;
-            RideFile::SeriesType series;
-            unxsstring(a.key(), crow, series);
-
-            if (crow > row) {
-                crow += count;
-                newa.insert(xsstring(crow,series), a.value());
-            } else {
-                newa.insert(a.key(), a.value());
-            }
+        QList<QPair<int, QString> > moved;
+        QMap<int, QString>::iterator i = text[s].lowerBound(row);
+        while (i != text[s].end()) {
+            bits[s].clearBit(i.key());
+            moved << QPair<int, QString>(i.key()+count, i.value());
+            i = text[s].erase(i);
         }
-        anomalies = newa; // replace with resynced values
+
+        for (int j=0; j<moved.count(); j++)
+            insert(moved[j].first, static_cast<RideFile::SeriesType>(s), moved[j].second);
     }
+}
 
-    // found
-    if (found.count()) {
-        QMutableMapIterator <QString, QString> r(found);
-        QMap<QString,QString> newr; // updated QMap
+void
+EditorCells::deleteSeries(RideFile::SeriesType series)
+{
+    int s = static_cast<int>(series);
+    if (s >= text.count()) return;
 
-        while (r.hasNext()) {
-            r.next();
+    bits[s].clear();
+    text[s].clear();
+}
 
-            int crow;
-            RideFile::SeriesType series;
-            unxsstring(r.key(), crow, series);
+void
+EditorData::deleteRows(int row, int count)
+{
+    anomalies.deleteRows(row, count);
+    found.deleteRows(row, count);
+}
 
-            if (crow > row) {
-                crow += count;
-                newr.insert(xsstring(crow,series), r.value());
-            } else {
-                newr.insert(r.key(), r.value());
-            }
-        }
-        found = newr; // replace with resynced values
-    }
+void
+EditorData::deleteSeries(RideFile::SeriesType series)
+{
+    anomalies.deleteSeries(series);
+    found.deleteSeries(series);
+}
+
+void
+EditorData::insertRows(int row, int count)
+{
+    anomalies.insertRows(row, count);
+    found.insertRows(row, count);
 }
 
 //----------------------------------------------------------------------
@@ -1756,7 +1812,7 @@ FindDialog::find()
                     if (match == true) {
 
                         // highlight on the table
-                        rideEditor->data->found.insert(xsstring(i,rideEditor->model->columnType(col)), QString("%1").arg(value));
+                        rideEditor->data->found.insert(i, rideEditor->model->columnType(col), QString("%1").arg(value));
 
                     }
                 }
@@ -1785,21 +1841,18 @@ FindDialog::dataChanged()
     resultsTable->setRowCount(0); // <<< fixes crash at ZZZZ
     resultsTable->setColumnCount(0);
 
-    resultsTable->setRowCount(rideEditor->data->found.count()); // <<< ZZZZ
+    QList<QPair<int, RideFile::SeriesType> > found = rideEditor->data->found.cells();
+    resultsTable->setRowCount(found.count()); // <<< ZZZZ
     resultsTable->setColumnCount(4);
     resultsTable->setColumnHidden(3, true); // has start xystring
-    QMapIterator<QString,QString> f(rideEditor->data->found);
 
     resultsTable->setSortingEnabled(false);// see QT Bug QTBUG-7483
 
     int counter =0;
-    while (f.hasNext()) {
-
-        f.next();
+    for (int i=0; i<found.count(); i++) {
 
-        int row;
-        RideFile::SeriesType series;
-        unxsstring(f.key(), row, series);
+        int row = found[i].first;
+        RideFile::SeriesType series = found[i].second;
 
         // time -- format correctly... held as a double in the model
         int seconds, msecs;
@@ -1825,7 +1878,7 @@ FindDialog::dataChanged()
 
         // xs for selection
         t = new QTableWidgetItem;
-        t->setText(f.key());
+        t->setText(xsstring(row, series));
         t->setFlags(t->flags() & (~Qt::ItemIsEditable));
         resultsTable->setItem(counter, 3, t);
 
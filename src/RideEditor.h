@@ -36,6 +36,7 @@
 #include <QDesktopWidget>
 #include <QToolBar>
 #include <QItemDelegate>
+#include <QBitArray>
 
 class EditorData;
 class CellDelegate;
@@ -151,13 +152,45 @@ class RideEditor : public GcChartWindow
 
         // state data
         struct { int row, column; } currentCell;
+
+        // rows changed since the anomalies were last checked
+        struct { int from, to; bool spikes, all; } unchecked;
+        void uncheck(int row, int count, bool spikes);
+};
+
+// Cells flagged in the editor, the anomalies or search results.
+// There is a bitset per series so the delegate can test a cell as it
+// paints without building a key, the text for the tooltips and result
+// lists is held alongside, by series and row.
+class EditorCells
+{
+    public:
+        bool contains(int row, RideFile::SeriesType series) const {
+            int s = static_cast<int>(series);
+            return row >= 0 && s < bits.count() && row < bits[s].size() && bits[s].testBit(row);
+        }
+        QString value(int row, RideFile::SeriesType series) const;
+        int count() const;
+        QList<QPair<int, RideFile::SeriesType> > cells() const; // in row order
+
+        void insert(int row, RideFile::SeriesType series, QString value);
+        void remove(int row, RideFile::SeriesType series);
+        void clear();
+
+        void deleteRows(int row, int count);
+        void insertRows(int row, int count);
+        void deleteSeries(RideFile::SeriesType series);
+
+    private:
+        QVector<QBitArray> bits;            // by series, set for each row
+        QVector<QMap<int, QString> > text;  // by series, row to text
 };
 
 class EditorData
 {
     public:
-        QMap<QString, QString> anomalies;
-        QMap<QString, QString> found;
+        EditorCells anomalies;
+        EditorCells found;
 
         // when underlying data is modified
         // these are called to adjust references
@@ -219,12 +252,20 @@ class AnomalyDialog : public QWidget
         void closeEvent(QCloseEvent*event);
         QTableWidget *anomalyList;
 
+        // just the rows changed by an edit, with the spike
+        // check over the whole ride if the power may have moved
+        void check(int row, int count, bool spikes);
+
     public slots:
         void reject();
         void check();
 
     private:
         RideEditor *rideEditor;
+
+        void checkRows(int from, int to);
+        void checkSpikes();
+        void refreshList();
 };
 
 //
@@ -27,7 +27,9 @@
 #include "SummaryMetrics.h"
 #include "Settings.h"
 #include "Units.h"
+#include "GcTrace.h"
 #include <QtXml/QtXml>
+#include <QMutex>
 #include <algorithm> // for std::lower_bound
 #include <assert.h>
 
@@ -39,10 +41,29 @@
     start = point->secs; \
 }
 
+// the derived series, a bit each in dstale
+static inline unsigned int derived(RideFile::SeriesType series) { return 1u << series; }
+static const unsigned int ALLDERIVED = derived(RideFile::kphd) | derived(RideFile::NP) |
+                                       derived(RideFile::xPower) | derived(RideFile::aPower);
+
+// the derived series calculated from a series, so changing
+// it only makes those out of date
+static unsigned int
+dependents(RideFile::SeriesType series)
+{
+    switch (series) {
+        case RideFile::secs : return derived(RideFile::kphd) | derived(RideFile::xPower);
+        case RideFile::kph : return derived(RideFile::kphd);
+        case RideFile::watts : return derived(RideFile::NP) | derived(RideFile::xPower) | derived(RideFile::aPower);
+        case RideFile::alt : return derived(RideFile::aPower);
+        default : return 0;
+    }
+}
+
 RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
             startTime_(startTime), recIntSecs_(recIntSecs),
             deviceType_("unknown"), data(NULL), weight_(0),
-            totalCount(0), dstale(true), wprime_(NULL), wstale(true)
+            totalCount(0), dstale(ALLDERIVED), wprime_(NULL), wstale(true)
 {
     command = new RideFileCommand(this);
 
@@ -52,7 +73,7 @@ RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
     totalPoint = new RideFilePoint();
 }
 
-RideFile::RideFile() : recIntSecs_(0.0), deviceType_("unknown"), data(NULL), weight_(0), totalCount(0), dstale(true), wprime_(NULL), wstale(true)
+RideFile::RideFile() : recIntSecs_(0.0), deviceType_("unknown"), data(NULL), weight_(0), totalCount(0), dstale(ALLDERIVED), wprime_(NULL), wstale(true)
 {
     command = new RideFileCommand(this);
 
@@ -341,9 +362,18 @@ RideFileFactory::writeRideFile(Context *context, const RideFile *ride, QFile &fi
     else return reader->writeRideFile(context, ride, file);
 }
 
+// the readers that aren't reentrant (e.g. the csv reader) are only
+// used by one thread at a time, the others parse files in parallel.
+// the data processors are shared and they, like the settings they
+// read, aren't thread safe so they also work on one ride at a time
+static QMutex readerLock, processLock;
+
 RideFile *RideFileFactory::openRideFile(Context *context, QFile &file,
                                            QStringList &errors, QList<RideFile*> *rideList) const
 {
+    GC_TRACE("openRideFile", "io");
+    GC_TRACE_DETAIL(QFileInfo(file.fileName()).fileName());
+
     QString suffix = file.fileName();
     int dot = suffix.lastIndexOf(".");
     assert(dot >= 0);
@@ -351,7 +381,13 @@ RideFile *RideFileFactory::openRideFile(Context *context, QFile &file,
     RideFileReader *reader = readFuncs_.value(suffix.toLower());
     assert(reader);
 //qDebug()<<"open"<<file.fileName()<<"start:"<<QDateTime::currentDateTime().toString("hh:mm:ss.zzz");
-    RideFile *result = reader->openRideFile(file, errors, rideList);
+    RideFile *result;
+    if (reader->isReentrant()) {
+        result = reader->openRideFile(file, errors, rideList);
+    } else {
+        QMutexLocker locker(&readerLock);
+        result = reader->openRideFile(file, errors, rideList);
+    }
 //qDebug()<<"open"<<file.fileName()<<"end:"<<QDateTime::currentDateTime().toString("hh:mm:ss.zzz");
 
     // NULL returned to indicate openRide failed
@@ -404,10 +440,11 @@ RideFile *RideFileFactory::openRideFile(Context *context, QFile &file,
         result->setTag("Month", result->startTime().toString("MMMM"));
         result->setTag("Weekday", result->startTime().toString("ddd"));
 
-        // calculate derived data series
-        result->recalculateDerivedSeries();
+        // derived data series are calculated when they are asked for
 
+        processLock.lock();
         DataProcessorFactory::instance().autoProcess(result);
+        processLock.unlock();
 
         // what data is present - after processor in case 'derived' or adjusted
         QString flags;
@@ -607,12 +644,15 @@ void RideFile::appendPoint(double secs, double cad, double hr, double km,
     updateMin(point);
     updateMax(point);
     updateAvg(point);
+
+    dstale = ALLDERIVED;
 }
 
 void RideFile::appendPoint(const RideFilePoint &point)
 {
     dataPoints_.append(new RideFilePoint(point.secs,point.cad,point.hr,point.km,point.kph,point.nm,point.watts,point.alt,point.lon,point.lat,
                                          point.headwind, point.slope, point.temp, point.lrbalance, point.interval));
+    dstale = ALLDERIVED;
 }
 
 void
@@ -638,6 +678,7 @@ RideFile::setDataPresent(SeriesType series, bool value)
         default:
         case none : break;
     }
+    dstale |= dependents(series);
 }
 
 bool
@@ -687,6 +728,7 @@ RideFile::setPointValue(int index, SeriesType series, double value)
         default:
         case none : break;
     }
+    dstale |= dependents(series);
 }
 
 double
@@ -855,6 +897,7 @@ RideFile::deletePoint(int index)
 {
     delete dataPoints_[index];
     dataPoints_.remove(index);
+    dstale = ALLDERIVED;
 }
 
 void
@@ -862,25 +905,29 @@ RideFile::deletePoints(int index, int count)
 {
     for(int i=index; i<(index+count); i++) delete dataPoints_[i];
     dataPoints_.remove(index, count);
+    dstale = ALLDERIVED;
 }
 
 void
 RideFile::insertPoint(int index, RideFilePoint *point)
 {
     dataPoints_.insert(index, point);
+    dstale = ALLDERIVED;
 }
 
 void
 RideFile::appendPoints(QVector <struct RideFilePoint *> newRows)
 {
     dataPoints_ += newRows;
+    dstale = ALLDERIVED;
 }
 
 void
 RideFile::emitSaved()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = true;
+    dstale = ALLDERIVED;
     emit saved();
 }
 
@@ -888,15 +935,17 @@ void
 RideFile::emitReverted()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = true;
+    dstale = ALLDERIVED;
     emit reverted();
 }
 
 void
 RideFile::emitModified()
 {
+    // the commands mark the derived series they make stale
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = true;
     emit modified();
 }
 
@@ -905,24 +954,30 @@ RideFile::getWeight()
 {
     if (weight_) return weight_; // cached value
 
+    // withings measures up to the start of the ride
+    return getWeight(context->athlete->metricDB->getAllMeasuresFor(QDateTime::fromString("Jan 1 00:00:00 1900"), startTime()));
+}
+
+// as above, but the caller fetched the measures, which lets the
+// metric refresh threads work without touching the DB connection
+double
+RideFile::getWeight(QList<SummaryMetrics> measures)
+{
+    if (weight_) return weight_; // cached value
+
     // ride
     if ((weight_ = getTag("Weight", "0.0").toDouble()) > 0) {
         return weight_;
     }
 
-    // withings?
-    QList<SummaryMetrics> measures = context->athlete->metricDB->getAllMeasuresFor(QDateTime::fromString("Jan 1 00:00:00 1900"), startTime());
-    int i = measures.count()-1;
-    if (i) {
-        while (i>=0) {
-            if ((weight_ = measures[i].getText("Weight", "0.0").toDouble()) > 0) {
-               return weight_;
-            }
-            i--;
+    // withings? most recent before the ride
+    for (int i=measures.count()-1; i>=0; i--) {
+        if (measures[i].getDateTime() > startTime()) continue;
+        if ((weight_ = measures[i].getText("Weight", "0.0").toDouble()) > 0) {
+           return weight_;
         }
     }
 
-
     // global options
     weight_ = appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT, "75.0").toString().toDouble(); // default to 75kg
 
@@ -966,192 +1021,250 @@ RideFile::parseRideFileName(const QString &name, QDateTime *dt)
     return true;
 }
 
-//
-// Calculate derived data series, including a new metric aPower
-// aPower is based upon the models and research presented in
-// "Altitude training and Athletic Performance" by Randall L. Wilber
-// and Peronnet et al. (1991): Peronnet, F., G. Thibault, and D.L. Cousineau 1991.
-// "A theoretical analisys of the effect of altitude on running
-// performance." Journal of Applied Physiology 70:399-404
-//
+// the derived series are worked out on contiguous arrays of the samples
+// they need, the loops without a dependency from one sample to the next
+// are kept apart so the compiler can vectorise them
+static QVector<double>
+gather(const QVector<RideFilePoint*> &points, double RideFilePoint::*field)
+{
+    QVector<double> returning(points.count());
+    double *to = returning.data();
+    for (int i=0; i<points.count(); i++) to[i] = points[i]->*field;
+    return returning;
+}
+
+static void
+scatter(const QVector<RideFilePoint*> &points, double RideFilePoint::*field, const QVector<double> &values)
+{
+    const double *from = values.constData();
+    for (int i=0; i<points.count(); i++) points[i]->*field = from[i];
+}
+
+// the min and max start at zero, as they do for points appended
+static void
+minmax(const QVector<double> &values, double &min, double &max)
+{
+    min = max = 0;
+    const double *v = values.constData();
+    for (int i=0; i<values.count(); i++) {
+        if (v[i] < min) min = v[i];
+        if (v[i] > max) max = v[i];
+    }
+}
 
 void
-RideFile::recalculateDerivedSeries()
+RideFile::recalculateDerivedSeries(SeriesType series) const
 {
     // derived data is calculated from the data that is present
     // we should set to 0 where we cannot derive since we may
     // be called after data is deleted or added
-    if (dstale == false) return; // we're already up to date
-
-    //
-    // NP Initialisation -- working variables
-    //
-    QVector<double> NProlling;
-    int NProllingwindowsize = 30 / (recIntSecs_ ? recIntSecs_ : 1);
-    if (NProllingwindowsize > 1) NProlling.resize(NProllingwindowsize);
-    double NPtotal = 0;
-    int NPcount = 0;
-    int NPindex = 0;
-    double NPsum = 0;
-
-    //
-    // XPower Initialisation -- working variables
-    //
-    static const double EPSILON = 0.1;
-    static const double NEGLIGIBLE = 0.1;
-    double XPsecsDelta = recIntSecs_ ? recIntSecs_ : 1;
-    double XPsampsPerWindow = 25.0 / XPsecsDelta;
-    double XPattenuation = XPsampsPerWindow / (XPsampsPerWindow + XPsecsDelta);
-    double XPsampleWeight = XPsecsDelta / (XPsampsPerWindow + XPsecsDelta);
-    double XPlastSecs = 0.0;
-    double XPweighted = 0.0;
-    double XPtotal = 0.0;
-    int XPcount = 0;
-
-    //
-    // APower Initialisation -- working variables
-    double APtotal=0;
-    double APcount=0;
-    
-
-    // last point looked at
-    RideFilePoint *lastP = NULL;
-
-    foreach(RideFilePoint *p, dataPoints_) {
-
-        //
-        // Acceleration
-        if (lastP) {
-
-            double deltaSpeed = p->kph - lastP->kph;
-            double deltaTime = p->secs - lastP->secs;
-
-            // from kph to meters /s /s
-            double acc = deltaSpeed;
-
-            if (deltaTime) {
-                acc /= deltaTime;
-                // now from kilometers per hour to m/s/s
-                acc *= 1000; // meters per hour
-                acc /= 3600; // meters per second
-                p->kphd = acc;
+    if (!(dstale & derived(series))) return; // up to date, or not derived
 
-            }
-        }
+    GC_TRACE("recalculateDerivedSeries", "ride");
+    GC_TRACE_DETAIL(seriesName(series));
 
-        //
-        // NP
-        //
-        if (dataPresent.watts && NProllingwindowsize > 1) {
+    switch (series) {
+        case kphd : deriveAcceleration(); break;
+        case NP : deriveNP(); break;
+        case xPower : deriveXPower(); break;
+        case aPower : deriveAPower(); break;
+        default : break;
+    }
+    dstale &= ~derived(series);
+}
 
-            dataPresent.np = true;
+void
+RideFile::recalculateDerivedSeries() const
+{
+    recalculateDerivedSeries(kphd);
+    recalculateDerivedSeries(NP);
+    recalculateDerivedSeries(xPower);
+    recalculateDerivedSeries(aPower);
+}
 
-            // sum last 30secs
-            NPsum += p->watts;
-            NPsum -= NProlling[NPindex];
-            NProlling[NPindex] = p->watts;
+//
+// Acceleration in m/s/s, left as it was where there is
+// no time between samples
+//
+void
+RideFile::deriveAcceleration() const
+{
+    int n = dataPoints_.count();
+    QVector<double> secs = gather(dataPoints_, &RideFilePoint::secs);
+    QVector<double> kph = gather(dataPoints_, &RideFilePoint::kph);
+    QVector<double> kphd = gather(dataPoints_, &RideFilePoint::kphd);
+
+    const double *t = secs.constData();
+    const double *v = kph.constData();
+    double *acc = kphd.data();
+    for (int i=1; i<n; i++) {
+        double deltaTime = t[i] - t[i-1];
+        // from kilometers per hour to meters per second
+        acc[i] = deltaTime ? (v[i] - v[i-1]) / deltaTime / 3.6 : acc[i];
+    }
+    scatter(dataPoints_, &RideFilePoint::kphd, kphd);
+}
 
-            // running total and count
-            NPtotal += pow(NPsum/NProllingwindowsize,4); // raise rolling average to 4th power
-            NPcount ++;
+//
+// NP, the 4th root of the average of the 30s rolling
+// average raised to the 4th power, for the ride so far
+//
+void
+RideFile::deriveNP() const
+{
+    int n = dataPoints_.count();
+    QVector<double> np(n, 0.0);
+    double total = 0;
 
-            // root for ride so far
-            if (NPcount && NPcount*recIntSecs_ > 30) {
-                p->np = pow(NPtotal / (NPcount), 0.25);
-            } else {
-                p->np = 0.00f;
-            }
+    int window = 30 / (recIntSecs_ ? recIntSecs_ : 1);
+    dataPresent.np = dataPresent.watts && window > 1;
 
-            // move index on/round
-            NPindex = (NPindex >= NProllingwindowsize-1) ? 0 : NPindex+1;
+    if (dataPresent.np) {
 
-        } else {
+        QVector<double> watts = gather(dataPoints_, &RideFilePoint::watts);
+        const double *w = watts.constData();
+        double *out = np.data();
 
-            p->np = 0.00f;
+        // sum last 30secs, then its average to the 4th power
+        double sum = 0;
+        for (int i=0; i<n; i++) {
+            sum += w[i];
+            if (i >= window) sum -= w[i-window];
+            out[i] = sum;
+        }
+        for (int i=0; i<n; i++) {
+            double avg = out[i] / window;
+            double avg2 = avg * avg;
+            out[i] = avg2 * avg2;
         }
 
-        // now the min and max values for NP
-        if (p->np > maxPoint->np) maxPoint->np = p->np;
-        if (p->np < minPoint->np) minPoint->np = p->np;
+        // running total, then the root for the ride so far
+        for (int i=0; i<n; i++) {
+            total += out[i];
+            out[i] = total;
+        }
+        for (int i=0; i<n; i++) {
+            out[i] = ((i+1) * recIntSecs_ > 30) ? sqrt(sqrt(out[i] / (i+1))) : 0;
+        }
+    }
+    scatter(dataPoints_, &RideFilePoint::np, np);
 
-        //
-        // xPower
-        //
-        if (dataPresent.watts) {
+    minmax(np, minPoint->np, maxPoint->np);
+    avgPoint->np = (dataPresent.np && n) ? (total / n) : 0;
+    totalPoint->np = total;
+}
 
-            dataPresent.xp = true;
+//
+// xPower, an exponentially weighted 25s average, with the
+// gaps filled in, raised to the 4th power
+//
+void
+RideFile::deriveXPower() const
+{
+    static const double EPSILON = 0.1;
+    static const double NEGLIGIBLE = 0.1;
 
-            while ((XPweighted > NEGLIGIBLE) && (p->secs > XPlastSecs + XPsecsDelta + EPSILON)) {
-                XPweighted *= XPattenuation;
-                XPlastSecs += XPsecsDelta;
-                XPtotal += pow(XPweighted, 4.0);
-                XPcount++;
+    int n = dataPoints_.count();
+    QVector<double> xp(n, 0.0);
+    double total = 0;
+    int count = 0;
+
+    dataPresent.xp = dataPresent.watts;
+
+    if (dataPresent.xp) {
+
+        double secsDelta = recIntSecs_ ? recIntSecs_ : 1;
+        double sampsPerWindow = 25.0 / secsDelta;
+        double attenuation = sampsPerWindow / (sampsPerWindow + secsDelta);
+        double sampleWeight = secsDelta / (sampsPerWindow + secsDelta);
+        double lastSecs = 0.0;
+        double weighted = 0.0;
+
+        QVector<double> watts = gather(dataPoints_, &RideFilePoint::watts);
+        QVector<double> secs = gather(dataPoints_, &RideFilePoint::secs);
+        QVector<double> counts(n);
+        const double *w = watts.constData();
+        const double *t = secs.constData();
+        double *out = xp.data();
+        double *c = counts.data();
+
+        // each sample depends on the last, so this can't be vectorised
+        // but at least the 4th power doesn't need pow()
+        for (int i=0; i<n; i++) {
+
+            while ((weighted > NEGLIGIBLE) && (t[i] > lastSecs + secsDelta + EPSILON)) {
+                weighted *= attenuation;
+                lastSecs += secsDelta;
+                double weighted2 = weighted * weighted;
+                total += weighted2 * weighted2;
+                count++;
             }
 
-            XPweighted *= XPattenuation;
-            XPweighted += XPsampleWeight * p->watts;
-            XPlastSecs = p->secs;
-            XPtotal += pow(XPweighted, 4.0);
-            XPcount++;
-        
-            p->xp = pow(XPtotal / XPcount, 0.25);
-        }
+            weighted *= attenuation;
+            weighted += sampleWeight * w[i];
+            lastSecs = t[i];
+            double weighted2 = weighted * weighted;
+            total += weighted2 * weighted2;
+            count++;
 
-        // now the min and max values for NP
-        if (p->xp > maxPoint->xp) maxPoint->xp = p->xp;
-        if (p->xp < minPoint->xp) minPoint->xp = p->xp;
+            out[i] = total;
+            c[i] = count;
+        }
 
-        // aPower
-        if (dataPresent.watts == true && dataPresent.alt == true) {
+        // root for the ride so far
+        for (int i=0; i<n; i++) out[i] = sqrt(sqrt(out[i] / c[i]));
+    }
+    scatter(dataPoints_, &RideFilePoint::xp, xp);
 
-            dataPresent.apower = true;
+    minmax(xp, minPoint->xp, maxPoint->xp);
+    avgPoint->xp = count ? (total / count) : 0;
+    totalPoint->xp = total;
+}
 
-            static const double a0  = -174.1448622;
-            static const double a1  = 1.0899959;
-            static const double a2  = -0.0015119;
-            static const double a3  = 7.2674E-07;
-            static const double E = 2.71828183;
+//
+// aPower is based upon the models and research presented in
+// "Altitude training and Athletic Performance" by Randall L. Wilber
+// and Peronnet et al. (1991): Peronnet, F., G. Thibault, and D.L. Cousineau 1991.
+// "A theoretical analisys of the effect of altitude on running
+// performance." Journal of Applied Physiology 70:399-404
+//
+void
+RideFile::deriveAPower() const
+{
+    static const double a0  = -174.1448622;
+    static const double a1  = 1.0899959;
+    static const double a2  = -0.0015119;
+    static const double a3  = 7.2674E-07;
 
-            if (p->alt > 0) {
-                // pbar [mbar]= 0.76*EXP( -alt[m] / 7000 )*1000 
-                double pbar = 0.76 * pow(E, p->alt / 7000) * 1000;
+    int n = dataPoints_.count();
+    QVector<double> apower = gather(dataPoints_, &RideFilePoint::watts);
 
-                // %Vo2max= a0 + a1 * pbar + a2 * pbar ^2 + a3 * pbar ^3 (with pbar in mbar)
-                double vo2maxPCT = a0 + (a1 * pbar) + (a2 * pow(pbar,2)) + (a3 * pow(pbar,3)); 
+    dataPresent.apower = dataPresent.watts && dataPresent.alt;
 
-                p->apower = (p->watts / 100) * vo2maxPCT;
+    if (dataPresent.apower) {
 
-            } else {
+        QVector<double> alt = gather(dataPoints_, &RideFilePoint::alt);
+        const double *a = alt.constData();
+        double *out = apower.data();
 
-                p->apower = p->watts;
-            }
+        for (int i=0; i<n; i++) {
+            // pbar [mbar]= 0.76*EXP( -alt[m] / 7000 )*1000
+            double pbar = 0.76 * exp(a[i] / 7000) * 1000;
 
-        } else {
+            // %Vo2max= a0 + a1 * pbar + a2 * pbar ^2 + a3 * pbar ^3 (with pbar in mbar)
+            double vo2maxPCT = a0 + pbar * (a1 + pbar * (a2 + pbar * a3));
 
-            p->apower = p->watts;
+            // no correction at or below sea level
+            out[i] = a[i] > 0 ? (out[i] / 100) * vo2maxPCT : out[i];
         }
-
-        // now the min and max values for NP
-        if (p->apower > maxPoint->apower) maxPoint->apower = p->apower;
-        if (p->apower < minPoint->apower) minPoint->apower = p->apower;
-
-        APtotal += p->apower;
-        APcount++;
-
-        // last point
-        lastP = p;
     }
+    scatter(dataPoints_, &RideFilePoint::apower, apower);
 
-    // Averages and Totals
-    avgPoint->np = NPcount ? (NPtotal / NPcount) : 0;
-    totalPoint->np = NPtotal;
-
-    avgPoint->xp = XPcount ? (XPtotal / XPcount) : 0;
-    totalPoint->xp = XPtotal;
-
-    avgPoint->apower = APcount ? (APtotal / APcount) : 0;
-    totalPoint->apower = APtotal;
+    double total = 0;
+    const double *v = apower.constData();
+    for (int i=0; i<n; i++) total += v[i];
 
-    // and we're done
-    dstale=false;
+    minmax(apower, minPoint->apower, maxPoint->apower);
+    avgPoint->apower = n ? (total / n) : 0;
+    totalPoint->apower = total;
 }
@@ -37,6 +37,7 @@ struct RideFileInterval;
 class EditorData;      // attached to a RideFile
 class RideFileCommand; // for manipulating ride data
 class Context;      // for context; cyclist, homedir
+class SummaryMetrics; // for withings weight measures
 
 // This file defines four classes:
 //
@@ -144,16 +145,19 @@ class RideFile : public QObject // QObject to emit signals
         void appendPoint(const RideFilePoint &);
         const QVector<RideFilePoint*> &dataPoints() const { return dataPoints_; }
 
-        // recalculate all the derived data series
-        // might want to move to a factory for these
-        // at some point, but for now hard coded
+        // recalculate the derived data series (kphd, NP,
+        // xPower and aPower) might want to move to a factory
+        // for these at some point, but for now hard coded
         //
         // YOU MUST ALWAYS CALL THIS BEFORE ACESSING
         // THE DERIVED DATA. IT IS REFRESHED ON DEMAND.
-        // STATE IS MAINTAINED IN 'bool dstale' BELOW
-        // TO ENSURE IT IS ONLY REFRESHED IF NEEDED
+        // EACH SERIES HAS A BIT IN 'dstale' BELOW, SET WHEN
+        // THE DATA IT IS CALCULATED FROM IS CHANGED, TO
+        // ENSURE IT IS ONLY REFRESHED IF NEEDED, SO IT IS
+        // CONST AND CAN BE CALLED ON A CONST RIDE TOO
         //
-        void recalculateDerivedSeries();
+        void recalculateDerivedSeries(SeriesType series) const; // just the one
+        void recalculateDerivedSeries() const; // all of them
 
         // Working with DATAPRESENT flags
         inline const RideFileDataPresent *areDataPresent() const { return &dataPresent; }
@@ -204,6 +208,7 @@ class RideFile : public QObject // QObject to emit signals
 
         Context *context;
         double getWeight();
+        double getWeight(QList<SummaryMetrics> measures); // when measures already fetched
 
         WPrime *wprimeData(); // return wprime, init/refresh if needed
 
@@ -254,7 +259,7 @@ class RideFile : public QObject // QObject to emit signals
         RideFilePoint* maxPoint;
         RideFilePoint* avgPoint;
         RideFilePoint* totalPoint;
-        RideFileDataPresent dataPresent;
+        mutable RideFileDataPresent dataPresent; // the derived series are set on demand
         QString deviceType_;
         QString fileFormat_;
         QList<RideFileInterval> intervals_;
@@ -271,7 +276,13 @@ class RideFile : public QObject // QObject to emit signals
         void updateMax(RideFilePoint* point);
         void updateAvg(RideFilePoint* point);
 
-        bool dstale; // is derived data up to date?
+        // derived series, each is calculated by itself
+        void deriveAcceleration() const;
+        void deriveNP() const;
+        void deriveXPower() const;
+        void deriveAPower() const;
+
+        mutable unsigned int dstale; // a bit for each derived series that is out of date
 };
 
 struct RideFilePoint
@@ -304,6 +315,11 @@ struct RideFileReader {
     virtual ~RideFileReader() {}
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const = 0;
 
+    // readers that keep parse state outside the call (a generated parser,
+    // statics) aren't safe to use from two threads at once, they should
+    // return false and are then only used by one thread at a time
+    virtual bool isReentrant() const { return true; }
+
     // if hasWrite capability should re-implement writeRideFile and hasWrite
     virtual bool hasWrite() const { return false; }
     virtual bool writeRideFile(Context *, const RideFile *, QFile &) const { return false; }
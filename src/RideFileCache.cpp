@@ -17,6 +17,7 @@
  */
 
 #include "RideFileCache.h"
+#include "GcTrace.h"
 #include "MainWindow.h"
 #include "Context.h"
 #include "Athlete.h"
@@ -27,13 +28,86 @@
 #include "LTMSettings.h" // getAllBestsFor needs this
 
 #include <math.h> // for pow()
+#include <string.h> // for memcpy()
 #include <QDebug>
 #include <QFileInfo>
+#include <QTemporaryFile>
+#if QT_VERSION >= 0x050000
+#include <QSaveFile>
+#endif
 #include <QMessageBox>
 #include <QtAlgorithms> // for qStableSort
 
 static const int maxcache = 25; // lets max out at 25 caches
 
+// the zones used to compute time in zone for a ride on date
+RideFileCacheZones::RideFileCacheZones(Context *context, QDate date) : CP(0), LTHR(0)
+{
+    if (!context) return;
+
+    const Zones *zones = context->athlete->zones();
+    int zoneRange = zones ? zones->whichRange(date) : -1;
+    if (zoneRange != -1) {
+        CP = zones->getCP(zoneRange);
+        wattsLows = zones->getZoneLows(zoneRange);
+        wattsHighs = zones->getZoneHighs(zoneRange);
+    }
+
+    const HrZones *hrZones = context->athlete->hrZones();
+    int hrZoneRange = hrZones ? hrZones->whichRange(date) : -1;
+    if (hrZoneRange != -1) {
+        LTHR = hrZones->getLT(hrZoneRange);
+        hrLows = hrZones->getZoneLows(hrZoneRange);
+        hrHighs = hrZones->getZoneHighs(hrZoneRange);
+    }
+}
+
+int
+RideFileCacheZones::whichZone(const QList<int> &lows, const QList<int> &highs, double value)
+{
+    for (int j=0; j<lows.count() && j<highs.count(); j++) {
+        // note: the "end" of range is actually in the next zone
+        if ((value >= lows[j]) && (value < highs[j]))
+            return j;
+    }
+
+    // if we got here either it is negative, nan, inf or way high
+    if (value < 0 || isnan(value)) return 0;
+    else return lows.count()-1;
+}
+
+// write the .cpx alongside and then swap it in, so anyone reading it
+// whilst we work, like the gui rebuilding it, gets the old one or the
+// new one but never half of each
+bool
+RideFileCache::replaceCache(QString cacheFileName, const QByteArray &contents)
+{
+#if QT_VERSION >= 0x050000
+    QSaveFile cacheFile(cacheFileName);
+    if (cacheFile.open(QIODevice::WriteOnly) == false) return false;
+    if (cacheFile.write(contents) != contents.size()) {
+        cacheFile.cancelWriting();
+        return false;
+    }
+    return cacheFile.commit();
+#else
+    // Qt4 can't rename over a file, so it is only missing for a moment
+    QTemporaryFile cacheFile(cacheFileName + ".XXXXXX");
+    cacheFile.setAutoRemove(false);
+    if (cacheFile.open() == false) return false;
+
+    bool ok = cacheFile.write(contents) == contents.size();
+    cacheFile.close();
+
+    if (ok) {
+        QFile::remove(cacheFileName);
+        ok = QFile::rename(cacheFile.fileName(), cacheFileName);
+    }
+    if (!ok) QFile::remove(cacheFile.fileName());
+    return ok;
+#endif
+}
+
 // cache from ride
 RideFileCache::RideFileCache(Context *context, QString fileName, RideFile *passedride, bool check) :
                context(context), rideFileName(fileName), ride(passedride)
@@ -155,6 +229,7 @@ RideFileCache::RideFileCache(RideFile *ride) :
     ride->recalculateDerivedSeries(); // accel and others
 
     // calculate all the arrays
+    zoning = RideFileCacheZones(context, ride->startTime().date());
     compute();
 
     // setup the doubles the users use
@@ -378,30 +453,102 @@ RideFileCache::createCacheFor(RideFile*rideFile)
     return new RideFileCache(rideFile);
 }
 
+// cache for the refresher threads
+RideFileCache::RideFileCache(Context *context, QString fileName, RideFile *ride, const RideFileCacheZones &zoning) :
+               context(context), rideFileName(fileName), ride(ride), zoning(zoning)
+{
+    // time in zone are fixed to 10 zone max
+    wattsTimeInZone.resize(10);
+    wattsCPTimeInZone.resize(4);
+    hrTimeInZone.resize(10);
+
+    QFileInfo rideFileInfo(rideFileName);
+    cacheFileName = rideFileInfo.path() + "/" + rideFileInfo.baseName() + ".cpx";
+}
+
+RideFileCache::CacheState
+RideFileCache::cacheState(QString fileName, const RideFileCacheZones &zoning)
+{
+    QFileInfo rideFileInfo(fileName);
+    QString cacheFileName = rideFileInfo.path() + "/" + rideFileInfo.baseName() + ".cpx";
+    QFileInfo cacheFileInfo(cacheFileName);
+
+    // missing or older than the ride, as the constructor checks
+    if (!cacheFileInfo.exists() || rideFileInfo.lastModified() > cacheFileInfo.lastModified() ||
+        cacheFileInfo.size() < (int)sizeof(struct RideFileCacheHeader)) return stale;
+
+    RideFileCacheHeader head;
+    QFile cacheFile(cacheFileName);
+    if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == false) return stale;
+    QDataStream inFile(&cacheFile);
+    inFile.readRawData((char *) &head, sizeof(head));
+    cacheFile.close();
+
+    if (head.version != RideFileCacheVersion) return stale;
+
+    // the zones in use when it was computed
+    if (head.CP != zoning.CP || head.LTHR != zoning.LTHR) return zones;
+
+    return current;
+}
+
+bool
+RideFileCache::update(Context *context, QString fileName, CacheState state,
+                      const RideFileCacheZones &zoning, const QList<SummaryMetrics> &measures,
+                      RideFile *ride)
+{
+    if (state == current) return true;
+
+    // just the time in zone, without opening the ride
+    if (state == zones) {
+        RideFileCache updater(context, fileName, NULL, zoning);
+        if (updater.writeZones()) return true;
+    }
+
+    RideFile *opened = NULL;
+    if (!ride) {
+        QStringList errors;
+        QFile file(fileName);
+        ride = opened = RideFileFactory::instance().openRideFile(context, file, errors);
+        if (!ride) return false;
+        ride->getWeight(measures); // not from the DB, we're not on its thread
+    }
+
+    RideFileCache updater(context, fileName, ride, zoning);
+    bool updated = updater.writeCache();
+    delete opened;
+    return updated;
+}
+
 //
 // COMPUTATION
 //
-void
-RideFileCache::refreshCache()
+bool
+RideFileCache::writeCache()
 {
-    static bool writeerror=false;
+    // lets go recalculate it all
+    compute();
 
-    // update cache!
-    QFile cacheFile(cacheFileName);
+    QByteArray contents;
+    QDataStream outFile(&contents, QIODevice::WriteOnly);
 
-    if (cacheFile.open(QIODevice::WriteOnly) == true) {
+    // go write it out
+    serialize(&outFile);
 
-        // ok so we are going to be able to write this stuff
-        // so lets go recalculate it all
-        compute();
+    // all done now, phew
+    return replaceCache(cacheFileName, contents);
+}
 
-        QDataStream outFile(&cacheFile);
+void
+RideFileCache::refreshCache()
+{
+    static bool writeerror=false;
 
-        // go write it out
-        serialize(&outFile);
+    // we're on the gui thread so we can look at the zones
+    zoning = RideFileCacheZones(context, ride->startTime().date());
 
-        // all done now, phew
-        cacheFile.close();
+    // update cache!
+    if (writeCache() == true) {
 
         // invalidate any incore cache of aggregate
         // that contains this ride in its date range
@@ -419,8 +566,12 @@ RideFileCache::refreshCache()
 
         // popup the first time...
         writeerror = true;
-        QMessageBox err;
         QString errMessage = QString("Cannot create cache file %1.").arg(cacheFileName);
+        if (!context->mainWindow) { // headless
+            qDebug()<<errMessage;
+            return;
+        }
+        QMessageBox err;
         err.setText(errMessage);
         err.setIcon(QMessageBox::Warning);
         err.exec();
@@ -439,9 +590,12 @@ RideFileCache::refreshCache()
 // with many cores would benefit enormously
 void RideFileCache::RideFileCache::compute()
 {
+    GC_TRACE("RideFileCache::compute", "cpx");
+
     if (ride == NULL) {
         return;
     }
+    GC_TRACE_DETAIL(ride->getTag("Filename", ""));
 
     // all the mean maxes
     MeanMaxComputer thread1(ride, wattsMeanMax, RideFile::watts); thread1.start();
@@ -478,6 +632,9 @@ void RideFileCache::RideFileCache::compute()
     thread9.wait();
     thread10.wait();
     thread11.wait();
+
+    // time in zone, and the CP and LTHR for it
+    computeZones();
 }
 
 //----------------------------------------------------------------------
@@ -700,6 +857,9 @@ MeanMaxComputer::divided_max_mean(data_t *dataseries_i, int datalength, int leng
 void
 MeanMaxComputer::run()
 {
+    GC_TRACE("MeanMaxComputer", "cpx");
+    GC_TRACE_DETAIL(RideFile::seriesName(series));
+
     // xPower and NP need watts to be present
     RideFile::SeriesType baseSeries = (series == RideFile::xPower || series == RideFile::NP || series == RideFile::wattsKg) ?
                                       RideFile::watts : series;
@@ -937,16 +1097,6 @@ RideFileCache::computeDistribution(QVector<float> &array, RideFile::SeriesType s
     // only bother if the data series is actually present
     if (ride->isDataPresent(needSeries) == false) return;
 
-    // get zones that apply, if any
-    int zoneRange = context->athlete->zones() ? context->athlete->zones()->whichRange(ride->startTime().date()) : -1;
-    int hrZoneRange = context->athlete->hrZones() ? context->athlete->hrZones()->whichRange(ride->startTime().date()) : -1;
-
-    if (zoneRange != -1) CP=context->athlete->zones()->getCP(zoneRange);
-    else CP=0;
-
-    if (hrZoneRange != -1) LTHR=context->athlete->hrZones()->getLT(hrZoneRange);
-    else LTHR=0;
-
     // setup the array based upon the ride
     int decimals = decimalsFor(series); //RideFile::decimalsFor(series) ? 1 : 0;
     double min = RideFile::minimumFor(series) * pow(10, decimals);
@@ -965,28 +1115,59 @@ RideFileCache::computeDistribution(QVector<float> &array, RideFile::SeriesType s
 
         float lvalue = value * pow(10, decimals);
 
-        // watts time in zone
-        if (series == RideFile::watts && zoneRange != -1)
-            wattsTimeInZone[context->athlete->zones()->whichZone(zoneRange, dp->value(series))] += ride->recIntSecs();
-
-        // CP zones :- moderate(<Z2), heavy (<CP and >Z2), severe (>CP)
-        if (series == RideFile::watts && zoneRange != -1 && CP) {
-            if (dp->value(series) < 1) // moderate zero watts
-                wattsCPTimeInZone[0] += ride->recIntSecs();
-            if (dp->value(series) < (CP*0.85f)) // moderate
-                wattsCPTimeInZone[1] += ride->recIntSecs();
-            else if (dp->value(series) < CP) // heavy
-                wattsCPTimeInZone[2] += ride->recIntSecs();
-            else // severe
-                wattsCPTimeInZone[3] += ride->recIntSecs();
+        int offset = lvalue - min;
+        if (offset >= 0 && offset < array.size()) array[offset] += ride->recIntSecs();
+    }
+}
+
+// the only part of the cache that depends upon the zones, it is taken
+// from the watts and hr distributions so writeZones() can do it again
+// without the ride. They are binned by the whole watt and bpm which is
+// exact against the zone boundaries, apart from the bin 85% of CP is in,
+// but anything past the top of the distribution isn't counted
+void
+RideFileCache::computeZones()
+{
+    CP = zoning.CP;
+    LTHR = zoning.LTHR;
+
+    wattsTimeInZone.fill(0);
+    wattsCPTimeInZone.fill(0);
+    hrTimeInZone.fill(0);
+
+    // watts time in zone
+    if (zoning.wattsLows.count()) {
+        double min = RideFile::minimumFor(RideFile::watts);
+        for (int i=0; i<wattsDistribution.size(); i++) {
+            float secs = wattsDistribution[i];
+            if (secs == 0) continue;
+
+            double watts = min + i;
+            wattsTimeInZone[RideFileCacheZones::whichZone(zoning.wattsLows, zoning.wattsHighs, watts)] += secs;
+
+            // CP zones :- moderate(<Z2), heavy (<CP and >Z2), severe (>CP)
+            if (CP) {
+                if (watts < 1) // moderate zero watts
+                    wattsCPTimeInZone[0] += secs;
+                if (watts < (CP*0.85f)) // moderate
+                    wattsCPTimeInZone[1] += secs;
+                else if (watts < CP) // heavy
+                    wattsCPTimeInZone[2] += secs;
+                else // severe
+                    wattsCPTimeInZone[3] += secs;
+            }
         }
+    }
 
-        // hr time in zone
-        if (series == RideFile::hr && hrZoneRange != -1)
-            hrTimeInZone[context->athlete->hrZones()->whichZone(hrZoneRange, dp->value(series))] += ride->recIntSecs();
+    // hr time in zone
+    if (zoning.hrLows.count()) {
+        double min = RideFile::minimumFor(RideFile::hr);
+        for (int i=0; i<hrDistribution.size(); i++) {
+            float secs = hrDistribution[i];
+            if (secs == 0) continue;
 
-        int offset = lvalue - min;
-        if (offset >= 0 && offset < array.size()) array[offset] += ride->recIntSecs();
+            hrTimeInZone[RideFileCacheZones::whichZone(zoning.hrLows, zoning.hrHighs, min + i)] += secs;
+        }
     }
 }
 
@@ -1028,6 +1209,8 @@ static void distAggregate(QVector<double> &into, QVector<double> &other)
 RideFileCache::RideFileCache(Context *context, QDate start, QDate end, bool filter, QStringList files, bool onhome)
                : start(start), end(end), context(context), rideFileName(""), ride(0) 
 {
+    GC_TRACE("RideFileCache::aggregate", "cpx");
+
 
     // Oh lets get from the cache if we can -- but not if filtered
     if (!filter && !context->isfiltered) {
@@ -1075,7 +1258,7 @@ RideFileCache::RideFileCache(Context *context, QDate start, QDate end, bool filt
 
     // set cursor busy whilst we aggregate -- bit of feedback
     // and less intrusive than a popup box
-    context->mainWindow->setCursor(Qt::WaitCursor);
+    if (context->mainWindow) context->mainWindow->setCursor(Qt::WaitCursor);
 
     // Iterate over the ride files (not the cpx files since they /might/ not
     // exist, or /might/ be out of date.
@@ -1125,7 +1308,7 @@ RideFileCache::RideFileCache(Context *context, QDate start, QDate end, bool filt
     }
 
     // set the cursor back to normal
-    context->mainWindow->setCursor(Qt::ArrowCursor);
+    if (context->mainWindow) context->mainWindow->setCursor(Qt::ArrowCursor);
 
     // lets add to the cache for others to re-use -- but not if filtered
     if (!context->isfiltered && (!context->ishomefiltered || !onhome) && !filter) {
@@ -1371,6 +1554,54 @@ static long offsetForTiz(RideFileCacheHeader head, RideFile::SeriesType series)
     return offset;
 }
 
+// offset to the distribution arrays, watts then hr
+static long offsetForDistribution(RideFileCacheHeader head)
+{
+    // skip past the mean max arrays
+    return offsetForMeanMax(head, RideFile::aPower) + head.aPowerMeanMaxCount * sizeof(float);
+}
+
+// recompute the time in zone from the distributions we already have
+// and write a new .cpx with it, nothing else depends upon the zones
+bool
+RideFileCache::writeZones()
+{
+    QFile cacheFile(cacheFileName);
+    if (cacheFile.open(QIODevice::ReadOnly) == false) return false;
+    QByteArray contents = cacheFile.readAll();
+    cacheFile.close();
+
+    // not what we expected, the caller will do it all
+    RideFileCacheHeader head;
+    if (contents.size() < (int)sizeof(head)) return false;
+    memcpy(&head, contents.constData(), sizeof(head));
+    if (head.version != RideFileCacheVersion) return false;
+
+    long offset = sizeof(head) + offsetForTiz(head, RideFile::watts);
+    long size = sizeof(float) * (wattsTimeInZone.size() + wattsCPTimeInZone.size() + hrTimeInZone.size());
+    if (contents.size() < offset + size) return false;
+
+    // the watts and hr distributions
+    const char *dist = contents.constData() + sizeof(head) + offsetForDistribution(head);
+    wattsDistribution.resize(head.wattsDistCount);
+    memcpy(wattsDistribution.data(), dist, sizeof(float) * head.wattsDistCount);
+    hrDistribution.resize(head.hrDistCount);
+    memcpy(hrDistribution.data(), dist + sizeof(float) * head.wattsDistCount, sizeof(float) * head.hrDistCount);
+
+    computeZones();
+    head.CP = CP;
+    head.LTHR = LTHR;
+
+    char *data = contents.data();
+    memcpy(data, &head, sizeof(head));
+    memcpy(data + offset, wattsTimeInZone.constData(), sizeof(float) * wattsTimeInZone.size());
+    offset += sizeof(float) * wattsTimeInZone.size();
+    memcpy(data + offset, wattsCPTimeInZone.constData(), sizeof(float) * wattsCPTimeInZone.size());
+    offset += sizeof(float) * wattsCPTimeInZone.size();
+    memcpy(data + offset, hrTimeInZone.constData(), sizeof(float) * hrTimeInZone.size());
+
+    return replaceCache(cacheFileName, contents);
+}
 
 // returns offset from end of head
 static long countForMeanMax(RideFileCacheHeader head, RideFile::SeriesType series)
@@ -22,6 +22,8 @@
 #include <QString>
 #include <QDataStream>
 #include <QVector>
+#include <QList>
+#include <QDate>
 #include <QThread>
 
 class Context;
@@ -112,16 +114,37 @@ struct RideFileCacheHeader {
 // values they desire. If the values have not been computed or are
 // out of date then they are computed as needed.
 //
-// This cache is also updated by the metricaggregator to ensure it
-// is updated alongside the metrics. So, in theory, at runtime, once
-// the arrays have been computed they can be retrieved quickly.
+// This cache is also updated in the background by the RideFileCacheRefresher
+// after the metricaggregator refreshes the metrics. So, in theory, at runtime,
+// once the arrays have been computed they can be retrieved quickly.
 //
 // This is the main user entry to the ridefile cached data.
+
+// The zones a ride's time in zone is computed with, copied from the
+// athlete's zones on the gui thread since they can be edited whilst
+// the refresher threads are working.
+struct RideFileCacheZones
+{
+    RideFileCacheZones() : CP(0), LTHR(0) {}
+    RideFileCacheZones(Context *context, QDate date); // gui thread only
+
+    int CP, LTHR; // zero when there are no zones for the date
+    QList<int> wattsLows, wattsHighs, hrLows, hrHighs;
+
+    // as Zones::whichZone and HrZones::whichZone
+    static int whichZone(const QList<int> &lows, const QList<int> &highs, double value);
+};
+
 class RideFileCache
 {
     public:
         enum cachetype { meanmax, distribution, none };
         typedef enum cachetype CacheType;
+
+        // how up to date a ride's .cpx is, when CP or LTHR have changed
+        // only the time in zone is out of date
+        enum cachestate { current, zones, stale };
+        typedef enum cachestate CacheState;
         QDate start, end;
 
         // Construct from a ridefile or its filename
@@ -154,6 +177,22 @@ class RideFileCache
 
         static int decimalsFor(RideFile::SeriesType series);
 
+        // check the .cpx header for a ride, and bring it up to date. These
+        // don't touch anything owned by the gui so the refresher threads
+        // can use them, the caller takes the zones for the ride's date and
+        // fetches the measures for the weight. When only the zones have
+        // changed the ride isn't opened, the time in zone is recomputed
+        // from the distributions already in the .cpx, otherwise it is
+        // opened unless the caller already has it open
+        static CacheState cacheState(QString filename, const RideFileCacheZones &zoning);
+        static bool update(Context *context, QString filename, CacheState state,
+                           const RideFileCacheZones &zoning, const QList<SummaryMetrics> &measures,
+                           RideFile *ride = NULL);
+
+        // write a cache file so readers on other threads never see it
+        // half written, it's the old one or the new one
+        static bool replaceCache(QString cacheFileName, const QByteArray &contents);
+
         // compute the cache and return it for the ride
         static RideFileCache *createCacheFor(RideFile*);
 
@@ -176,10 +215,13 @@ class RideFileCache
     protected:
 
         void refreshCache();              // compute arrays and update cache
+        bool writeCache();                // compute and write, but no popups or invalidating
+        bool writeZones();                // rewrite just the time in zone, from the distributions
         void readCache();                 // just read from saved file and setup arrays
         void serialize(QDataStream *out); // write to file
 
         void compute();             // compute all arrays
+        void computeZones();        // CP, LTHR and time in zone, from the distributions
 
         // NOW replaced computeMeanMax with MeanMaxComputer class see bottom of file
         //void computeMeanMax(QVector<float>&, RideFile::SeriesType);      // compute mean max arrays
@@ -188,12 +230,16 @@ class RideFileCache
 
     private:
 
+        // for update(), ride is NULL when just doing the zones
+        RideFileCache(Context *context, QString filename, RideFile *ride, const RideFileCacheZones &zoning);
+
         Context *context;
         QString rideFileName; // filename of ride
         QString cacheFileName; // filename of cache file
         RideFile *ride;
 
         // used for zoning
+        RideFileCacheZones zoning;
         int CP;
         int LTHR;
 
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideFileCacheRefresher.h"
+#include "MetricAggregator.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "RideFile.h"
+#include "RideDensityCache.h"
+#include "GcTrace.h"
+
+#include <QDebug>
+#include <QtAlgorithms>
+
+static QDate dateFor(QString name)
+{
+    QDateTime dt;
+    if (RideFile::parseRideFileName(name, &dt)) return dt.date();
+    return QDate();
+}
+
+RideFileCacheRefresher::RideFileCacheRefresher(MetricAggregator *aggregator, Context *context) :
+    QObject(aggregator), aggregator(aggregator), context(context), crankLength(0), done_(0), total_(0), aborted(false)
+{
+    threads = QThread::idealThreadCount();
+    if (threads < 1) threads = 1;
+
+    connect(this, SIGNAL(rideUpdated(QString)), this, SLOT(updated(QString)), Qt::QueuedConnection);
+}
+
+RideFileCacheRefresher::~RideFileCacheRefresher()
+{
+    abort();
+    wait();
+}
+
+void
+RideFileCacheRefresher::abort()
+{
+    QMutexLocker locker(&lock);
+    aborted = true;
+}
+
+void
+RideFileCacheRefresher::wait()
+{
+    foreach(RideFileCacheRefreshThread *worker, workers) {
+        worker->wait();
+        delete worker;
+    }
+    workers.clear();
+}
+
+bool
+RideFileCacheRefresher::isRunning()
+{
+    QMutexLocker locker(&lock);
+    return !aborted && done_ < total_;
+}
+
+int
+RideFileCacheRefresher::done()
+{
+    QMutexLocker locker(&lock);
+    return done_;
+}
+
+int
+RideFileCacheRefresher::total()
+{
+    QMutexLocker locker(&lock);
+    return total_;
+}
+
+void
+RideFileCacheRefresher::refresh()
+{
+    GC_TRACE("RideFileCacheRefresher::refresh", "cpx");
+
+    // start again
+    abort();
+    wait();
+
+    // newest first, the names sort by date
+    QStringList names = RideFileFactory::instance().listRideFiles(context->athlete->home);
+    qSort(names.begin(), names.end(), qGreater<QString>());
+
+    // which ones need doing, it's just the headers so this is quick, and
+    // the zones they need since the threads mustn't look at the athlete's
+    QStringList stale;
+    zoning.clear();
+    crankLength = RideDensityCache::crankLength();
+    foreach(QString name, names) {
+        QString path = context->athlete->home.absolutePath() + "/" + name;
+        RideFileCacheZones zones(context, dateFor(name));
+        if (RideFileCache::cacheState(path, zones) != RideFileCache::current ||
+            !RideDensityCache::isCurrent(path, crankLength)) {
+            stale << name;
+            zoning.insert(name, zones);
+        }
+    }
+    GC_TRACE_COUNTER("stale cpx", stale.count());
+    if (stale.isEmpty()) return;
+
+    // the threads can't use the DB so fetch the weight measures now
+    measures = aggregator->getAllMeasuresFor(QDateTime::fromString("Jan 1 00:00:00 1900"), QDateTime::currentDateTime().addYears(1));
+
+    lock.lock();
+    queue = stale;
+    done_ = 0;
+    total_ = stale.count();
+    aborted = false;
+    lock.unlock();
+
+    // whatever is on screen
+    DateRange range = context->currentDateRange();
+    if (range.from.isValid() || range.to.isValid()) prioritise(range.from, range.to);
+
+    int count = threads > stale.count() ? stale.count() : threads;
+    for (int i=0; i<count; i++) {
+        RideFileCacheRefreshThread *worker = new RideFileCacheRefreshThread(this);
+        workers << worker;
+        worker->start(QThread::LowPriority);
+    }
+    emit progress(0, total_);
+}
+
+void
+RideFileCacheRefresher::prioritise(QDate from, QDate to)
+{
+    QMutexLocker locker(&lock);
+
+    // keeping them newest to oldest within each
+    QStringList inside, outside;
+    foreach(QString name, queue) {
+        QDate date = dateFor(name);
+        if ((!from.isValid() || date >= from) && (!to.isValid() || date <= to)) inside << name;
+        else outside << name;
+    }
+    queue = inside + outside;
+}
+
+void
+RideFileCacheRefresher::updated(QString name)
+{
+    // charts have to aggregate this one again
+    QDate date = dateFor(name);
+    for (int i=0; i<context->athlete->cpxCache.count();) {
+        if (date >= context->athlete->cpxCache.at(i)->start &&
+            date <= context->athlete->cpxCache.at(i)->end) {
+            delete context->athlete->cpxCache.at(i);
+            context->athlete->cpxCache.removeAt(i);
+        } else i++;
+    }
+
+    int done = this->done(), total = this->total();
+    emit progress(done, total);
+    if (done == total) emit finished();
+}
+
+void
+RideFileCacheRefreshThread::run()
+{
+    RideFileCacheRefresher *r = refresher;
+
+    forever {
+
+        r->lock.lock();
+        if (r->aborted || r->queue.isEmpty()) {
+            r->lock.unlock();
+            return;
+        }
+        QString name = r->queue.takeFirst();
+        RideFileCacheZones zones = r->zoning.value(name);
+        r->lock.unlock();
+
+        // check again, a chart may have needed it before we got to it
+        QString path = r->context->athlete->home.absolutePath() + "/" + name;
+        RideFileCache::CacheState state = RideFileCache::cacheState(path, zones);
+        bool density = !RideDensityCache::isCurrent(path, r->crankLength);
+
+        // open it once for both, unless it's just the time in zone
+        RideFile *ride = NULL;
+        if (density || state == RideFileCache::stale) {
+            QStringList errors;
+            QFile file(path);
+            ride = RideFileFactory::instance().openRideFile(r->context, file, errors);
+            if (ride) ride->getWeight(r->measures); // not from the DB, we're not on its thread
+        }
+
+        if (!RideFileCache::update(r->context, path, state, zones, r->measures, ride))
+            qDebug()<<"cannot update cache file for"<<name;
+        if (density && (!ride || !RideDensityCache::update(path, ride, r->crankLength)))
+            qDebug()<<"cannot update density cache file for"<<name;
+        delete ride;
+
+        r->lock.lock();
+        r->done_++;
+        r->lock.unlock();
+
+        emit r->rideUpdated(name);
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideFileCacheRefresher_h
+#define _GC_RideFileCacheRefresher_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QStringList>
+#include <QHash>
+#include <QDate>
+
+#include "RideFileCache.h"
+#include "SummaryMetrics.h"
+
+class Context;
+class MetricAggregator;
+class RideFileCacheRefresher;
+
+class RideFileCacheRefreshThread : public QThread
+{
+    public:
+        RideFileCacheRefreshThread(RideFileCacheRefresher *refresher) : refresher(refresher) {}
+        void run();
+
+    private:
+        RideFileCacheRefresher *refresher;
+};
+
+// Keeps the .cpx and .cpd files up to date in the background. After the
+// metrics are refreshed every ride's .cpx and .cpd header is checked and
+// the ones that are out of date are brought up to date on a pool of
+// threads, opening the ride once for both when they both need it, the
+// rides in the date range being looked at first and then the rest
+// newest to oldest. When only CP or LTHR have changed just the time in
+// zone is recomputed, from the distributions in the .cpx, and the ride
+// isn't opened at all.
+//
+// Anything that needs a .cpx before we get to it still refreshes it
+// itself, as it always has, so this just gets there first.
+//
+// Owned by the MetricAggregator, refresh() and prioritise() are called
+// on the gui thread and the signals are delivered there too. The zones
+// for each ride and the crank length are taken in refresh() so the
+// threads never use them.
+//
+class RideFileCacheRefresher : public QObject
+{
+    Q_OBJECT
+    G_OBJECT
+
+    public:
+        RideFileCacheRefresher(MetricAggregator *aggregator, Context *context);
+        ~RideFileCacheRefresher(); // stops the threads
+
+        // check them all and start on the ones that need it, stopping
+        // anything we were doing first since the zones may have changed
+        void refresh();
+
+        // do the rides between these dates next
+        void prioritise(QDate from, QDate to);
+
+        // stop when the threads finish the rides they are on
+        void abort();
+
+        // until they're all done, for batch processing
+        void wait();
+
+        void setThreads(int threads) { this->threads = threads > 0 ? threads : 1; }
+        bool isRunning();
+        int done();
+        int total();
+
+    signals:
+        void progress(int done, int total);
+        void finished();
+
+        // from the threads, for us to pick up on our own thread
+        void rideUpdated(QString name);
+
+    private slots:
+        void updated(QString name);
+
+    private:
+        friend class RideFileCacheRefreshThread;
+
+        MetricAggregator *aggregator;
+        Context *context;
+        int threads;
+
+        QList<RideFileCacheRefreshThread*> workers;
+        QList<SummaryMetrics> measures; // for ride weight
+        QHash<QString, RideFileCacheZones> zoning; // by ride name
+        double crankLength; // for the .cpd
+
+        QMutex lock;
+        QStringList queue; // next first
+        int done_, total_;
+        bool aborted;
+};
+
+#endif // _GC_RideFileCacheRefresher_h
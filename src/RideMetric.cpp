@@ -17,6 +17,7 @@
  */
 
 #include "RideMetric.h"
+#include "GcTrace.h"
 #include "Zones.h"
 #include "HrZones.h"
 
@@ -27,15 +28,40 @@ QHash<QString,RideMetricPtr>
 RideMetric::computeMetrics(const Context *context, const RideFile *ride, const Zones *zones, const HrZones *hrZones,
                            const QStringList &metrics)
 {
+    GC_TRACE("computeMetrics", "metrics");
+    GC_TRACE_DETAIL(ride->getTag("Filename", ""));
+
     int zoneRange = zones->whichRange(ride->startTime().date());
     int hrZoneRange = hrZones->whichRange(ride->startTime().date());
 
     const RideMetricFactory &factory = RideMetricFactory::instance();
-    QStringList todo = metrics;
     QHash<QString,RideMetric*> done;
+
+    // the accumulating metrics we need (directly or as a dependency)
+    // are all computed up front in a single pass over the samples
+    QList<AccumulatingRideMetric*> accumulators;
+    QStringList wanted = metrics;
+    for (int i=0; i<wanted.count(); i++) {
+        if (!factory.haveMetric(wanted[i])) continue;
+        const QVector<QString> &deps = factory.dependencies(wanted[i]);
+        foreach (QString dep, deps) if (!wanted.contains(dep)) wanted.append(dep);
+        if (deps.isEmpty() && !done.contains(wanted[i]) &&
+            dynamic_cast<const AccumulatingRideMetric*>(factory.rideMetric(wanted[i]))) {
+            AccumulatingRideMetric *m = static_cast<AccumulatingRideMetric*>(factory.newMetric(wanted[i]));
+            accumulators << m;
+            done.insert(wanted[i], m);
+        }
+    }
+    AccumulatingRideMetric::accumulate(accumulators, ride, zones, zoneRange, hrZones, hrZoneRange, context);
+    foreach (AccumulatingRideMetric *m, accumulators) {
+        if (ride->metricOverrides.contains(m->symbol()))
+            m->override(ride->metricOverrides.value(m->symbol()));
+    }
+
+    QStringList todo = metrics;
     while (!todo.isEmpty()) {
         QString symbol = todo.takeFirst();
-        if (!factory.haveMetric(symbol)) continue;
+        if (!factory.haveMetric(symbol) || done.contains(symbol)) continue;
         const QVector<QString> &deps = factory.dependencies(symbol);
         bool ready = true;
         foreach (QString dep, deps) {
@@ -67,3 +93,47 @@ RideMetric::computeMetrics(const Context *context, const RideFile *ride, const Z
         delete done.value(symbol);
     return result;
 }
+
+void
+AccumulatingRideMetric::accumulate(const QList<AccumulatingRideMetric*> &metrics, const RideFile *ride,
+                                   const Zones *zones, int zoneRange,
+                                   const HrZones *hrZones, int hrZoneRange,
+                                   const Context *context)
+{
+    if (metrics.isEmpty()) return;
+
+    RideMetricPass pass;
+    pass.ride = ride;
+    pass.zones = zones;
+    pass.zoneRange = zoneRange;
+    pass.hrZones = hrZones;
+    pass.hrZoneRange = hrZoneRange;
+    pass.context = context;
+    pass.secs = ride->recIntSecs();
+    pass.point = NULL;
+    pass.zone = pass.hrZone = -1;
+
+    bool wantsZone = false, wantsHrZone = false;
+    foreach (AccumulatingRideMetric *m, metrics) {
+        wantsZone |= m->wantsZone();
+        wantsHrZone |= m->wantsHrZone();
+        m->begin(pass);
+    }
+    wantsZone = wantsZone && zones && zoneRange >= 0;
+    wantsHrZone = wantsHrZone && hrZones && hrZoneRange >= 0;
+
+    // plain array so the inner loop is just a virtual call per metric
+    const int count = metrics.count();
+    QVector<AccumulatingRideMetric*> todo = metrics.toVector();
+    AccumulatingRideMetric * const *m = todo.constData();
+
+    foreach (const RideFilePoint *point, ride->dataPoints()) {
+        pass.point = point;
+        if (wantsZone) pass.zone = zones->whichZone(zoneRange, point->watts);
+        if (wantsHrZone) pass.hrZone = hrZones->whichZone(hrZoneRange, point->hr);
+        for (int i=0; i<count; i++) m[i]->sample(pass);
+    }
+
+    pass.point = NULL;
+    foreach (AccumulatingRideMetric *m, metrics) m->end(pass);
+}
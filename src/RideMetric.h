@@ -23,6 +23,7 @@
 #include <QHash>
 #include <QString>
 #include <QVector>
+#include <QList>
 #include <QSharedPointer>
 #include <assert.h>
 #include <math.h>
@@ -167,6 +168,60 @@ public:
         MetricType type_;
 };
 
+// The state shared by the metrics computed together in a single
+// pass over the samples, see AccumulatingRideMetric below
+struct RideMetricPass {
+    const RideFile *ride;
+    const Zones *zones;
+    int zoneRange;
+    const HrZones *hrZones;
+    int hrZoneRange;
+    const Context *context;
+    double secs; // recording interval
+
+    // the current sample and its power and hr zone (-1 if
+    // no zones or if none of the metrics asked for them)
+    const RideFilePoint *point;
+    int zone, hrZone;
+};
+
+// Metrics that just accumulate something over the samples, and don't
+// depend on any other metrics, can derive from this and implement
+// begin(), sample() and end() instead of compute().
+//
+// RideMetric::computeMetrics() runs all of them together in a single
+// pass over the ride, rather than each walking all the samples in turn,
+// and looks up the power and hr zone for each sample just the once.
+class AccumulatingRideMetric : public RideMetric {
+
+public:
+
+    virtual void begin(const RideMetricPass &) {}
+    virtual void sample(const RideMetricPass &pass) = 0;
+    virtual void end(const RideMetricPass &) = 0;
+
+    // does sample() need pass.zone / pass.hrZone ?
+    virtual bool wantsZone() const { return false; }
+    virtual bool wantsHrZone() const { return false; }
+
+    // when computed on its own
+    void compute(const RideFile *ride,
+                 const Zones *zones, int zoneRange,
+                 const HrZones *hrZones, int hrZoneRange,
+                 const QHash<QString,RideMetric*> &,
+                 const Context *context = 0) {
+        QList<AccumulatingRideMetric*> metrics;
+        metrics << this;
+        accumulate(metrics, ride, zones, zoneRange, hrZones, hrZoneRange, context);
+    }
+
+    // one pass over the samples for all of them
+    static void accumulate(const QList<AccumulatingRideMetric*> &metrics, const RideFile *ride,
+                           const Zones *zones, int zoneRange,
+                           const HrZones *hrZones, int hrZoneRange,
+                           const Context *context);
+};
+
 class RideMetricFactory {
 
     static RideMetricFactory *_instance;
@@ -46,8 +46,7 @@ RideNavigator::RideNavigator(Context *context, bool mainwindow) : context(contex
     if (mainwindow) mainLayout->setContentsMargins(0,0,0,0);
     else mainLayout->setContentsMargins(2,2,2,2); // so we can resize!
 
-    context->athlete->sqlModel->select();
-    while (context->athlete->sqlModel->canFetchMore(QModelIndex())) context->athlete->sqlModel->fetchMore(QModelIndex());
+    context->athlete->sqlModel->refresh();
 
     searchFilter = new SearchFilter(this);
     searchFilter->setSourceModel(context->athlete->sqlModel); // filter out/in search results
@@ -59,7 +58,7 @@ RideNavigator::RideNavigator(Context *context, bool mainwindow) : context(contex
     sortModel->setSourceModel(groupByModel);
     sortModel->setDynamicSortFilter(true);
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     if (!mainwindow) {
         searchFilterBox = new SearchFilterBox(this, context, false);
         mainLayout->addWidget(searchFilterBox);
@@ -117,7 +116,7 @@ RideNavigator::RideNavigator(Context *context, bool mainwindow) : context(contex
     connect(tableView,SIGNAL(customContextMenuRequested(const QPoint &)), this, SLOT(showTreeContextMenuPopup(const QPoint &)));
     connect(tableView->header(), SIGNAL(sortIndicatorChanged(int,Qt::SortOrder)), this, SLOT(setSortBy(int,Qt::SortOrder)));
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     if (!mainwindow) {
         connect(searchFilterBox, SIGNAL(searchResults(QStringList)), this, SLOT(searchStrings(QStringList)));
         connect(searchFilterBox, SIGNAL(searchClear()), this, SLOT(clearSearch()));
@@ -139,9 +138,10 @@ RideNavigator::refresh()
 {
     fontHeight = QFontMetrics(QFont()).height();
 
-    context->athlete->sqlModel->select();
-    while (context->athlete->sqlModel->canFetchMore(QModelIndex()))
-        context->athlete->sqlModel->fetchMore(QModelIndex());
+    // only re-reads rides that changed, if nothing changed
+    // the model is untouched so we just repaint in case units changed
+    context->athlete->sqlModel->refresh();
+    tableView->viewport()->update();
 
     active=false;
     rideTreeSelectionChanged();
@@ -28,7 +28,7 @@
 #include "Settings.h"
 #include "Colors.h"
 
-#include <QSqlTableModel>
+#include "MetricTableModel.h"
 #include <QTableView>
 #include <QHeaderView>
 #include <QScrollBar>
@@ -76,6 +76,7 @@ private:
 
     QMap<QString, QVector<int>*> groupToSourceRow;
     QVector<int> sourceRowToGroupRow;
+    QVector<int> sourceRowToGroup; // group number, so mapFromSource needn't regroup
     QList<rankx> rankedRows;
 
     void clearGroups() {
@@ -89,6 +90,7 @@ private:
         groupIndexes.clear();
         groupToSourceRow.clear();
         sourceRowToGroupRow.clear();
+        sourceRowToGroup.clear();
         rankedRows.clear();
     }
 
@@ -175,15 +177,16 @@ public:
     QModelIndex mapFromSource(const QModelIndex &sourceIndex) const {
 
         // which group did we put this row into?
-        QString group = whichGroup(sourceIndex.row());
-        int groupNo = groups.indexOf(group);
+        int groupNo = sourceIndex.row() >= 0 && sourceIndex.row() < sourceRowToGroup.count() ?
+                      sourceRowToGroup[sourceIndex.row()] : -1;
 
         if (groupNo < 0) {
             return QModelIndex();
         } else {
-            QModelIndex *p = new QModelIndex(createIndex(groupNo, 0, (void*)NULL));
+            // parent is the group's index, as index() does, which lives as long as the groups do
             if (sourceIndex.row() > 0 && sourceIndex.row() < sourceRowToGroupRow.size())
-                return createIndex(sourceRowToGroupRow[sourceIndex.row()], sourceIndex.column()+2, &p); // accomodate virtual columns
+                return createIndex(sourceRowToGroupRow[sourceIndex.row()], sourceIndex.column()+2,
+                                   (void*)&groupIndexes[groupNo]); // accomodate virtual columns
             else
                 return QModelIndex();
         }
@@ -467,14 +470,21 @@ public:
         // wipe whatever is there first
         clearGroups();
 
+        int sourceRows = sourceModel()->rowCount(QModelIndex());
+        QVector<QString> rowGroup(sourceRows);
+
         if (groupBy >= 0) {
 
-            // rank all the values
-            for (int i=0; i<sourceModel()->rowCount(QModelIndex()); i++) {
+            // fetch the values just the once, the source
+            // model is a proxy so each data() call costs
+            QVector<QString> strings(sourceRows);
+            for (int i=0; i<sourceRows; i++) {
+                QVariant value = sourceModel()->data(sourceModel()->index(i,groupBy));
                 rankx rank;
-                rank.value = sourceModel()->data(sourceModel()->index(i,groupBy)).toDouble();
+                rank.value = value.toDouble();
                 rank.row = i;
                 rankedRows << rank;
+                strings[i] = value.toString();
             }
 
             // rank the entries
@@ -488,10 +498,12 @@ public:
 
 
             // create a QMap from 'group' string to list of rows in that group
-            for (int i=0; i<sourceModel()->rowCount(QModelIndex()); i++) {
+            QString heading = headerData(groupBy+2, Qt::Horizontal).toString(); // accomodate virtual column
+            for (int i=0; i<sourceRows; i++) {
 
-                // which group are we in?
-                QString value = whichGroup(i); // uses rankedRows
+                // which group are we in? same as whichGroup(i)
+                QString value = groupFromValue(heading, strings[i], rankedRows[i].value, sourceRows);
+                rowGroup[i] = value;
 
                 QVector<int> *rows;
                 if ((rows=groupToSourceRow.value(value,NULL)) == NULL) {
@@ -512,9 +524,10 @@ public:
 
             // Just one group by 'All Rides'
             QVector<int> *rows = new QVector<int>;
-            for (int i=0; i<sourceModel()->rowCount(QModelIndex()); i++) {
+            for (int i=0; i<sourceRows; i++) {
                 rows->append(i);
                 sourceRowToGroupRow.append(i);
+                rowGroup[i] = "All Rides";
             }
             groupToSourceRow.insert("All Rides", rows);
 
@@ -522,13 +535,19 @@ public:
 
         // Update list of groups
         int group=0;
+        QHash<QString, int> groupNo;
         QMapIterator<QString, QVector<int>*> j(groupToSourceRow);
         while (j.hasNext()) {
             j.next();
             groups << j.key();
+            groupNo.insert(j.key(), group);
             groupIndexes << createIndex(group++,0,(void*)NULL);
         }
 
+        // and remember which group each row ended up in
+        sourceRowToGroup.resize(sourceRows);
+        for (int i=0; i<sourceRows; i++) sourceRowToGroup[i] = groupNo.value(rowGroup[i], -1);
+
         // all done. let the views know everything changed
         endResetModel();
     }
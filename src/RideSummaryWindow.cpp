@@ -53,7 +53,7 @@ RideSummaryWindow::RideSummaryWindow(Context *context, bool ridesummary) :
         cl->setSpacing(0);
         setControls(c);
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         // filter / searchbox
         searchBox = new SearchFilterBox(this, context);
         connect(searchBox, SIGNAL(searchClear()), this, SLOT(clearFilter()));
@@ -107,7 +107,7 @@ RideSummaryWindow::RideSummaryWindow(Context *context, bool ridesummary) :
     setChartLayout(vlayout);
 }
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
 void
 RideSummaryWindow::clearFilter()
 {
@@ -690,12 +690,6 @@ RideSummaryWindow::htmlSummary() const
                     f.appendPoint(p->secs, p->cad, p->hr, p->km, p->kph, p->nm,
                                 p->watts, p->alt, p->lon, p->lat, p->headwind,
                                 p->slope, p->temp, p->lrbalance, 0);
-
-                    // derived data
-                    RideFilePoint *l = f.dataPoints().last();
-                    l->np = p->np;
-                    l->xp = p->xp;
-                    l->apower = p->apower;
                 }
                 if (f.dataPoints().size() == 0) {
                     // Interval empty, do not compute any metrics
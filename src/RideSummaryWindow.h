@@ -29,7 +29,7 @@
 
 #include "SummaryMetrics.h"
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
 #include "SearchFilterBox.h"
 #endif
 
@@ -39,7 +39,7 @@ class RideSummaryWindow : public GcChartWindow
     Q_OBJECT
     G_OBJECT
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
     Q_PROPERTY(QString filter READ filter WRITE setFilter USER true)
 #endif
     Q_PROPERTY(QDate fromDate READ fromDate WRITE setFromDate USER true)
@@ -70,7 +70,7 @@ class RideSummaryWindow : public GcChartWindow
         void setLastNX(int x) { dateSetting->setLastNX(x); }
         int prevN() { return dateSetting->prevN(); }
         void setPrevN(int x) { dateSetting->setPrevN(x); }
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         bool isFiltered() const { if (!ridesummary) return (filtered || context->ishomefiltered || context->isfiltered);
                                   else return false; }
         // filter
@@ -94,7 +94,7 @@ class RideSummaryWindow : public GcChartWindow
         void useStandardRange();
         void useThruToday();
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         void clearFilter();
         void setFilter(QStringList);
 #endif
@@ -120,7 +120,7 @@ class RideSummaryWindow : public GcChartWindow
         bool useCustom;
         bool useToToday;
         DateRange custom;
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         SearchFilterBox *searchBox;
 #endif
         QStringList filters; // empty when no lucene
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RouteGeometry.h"
+
+#include <QPair>
+#include <math.h>
+
+// a pixel or so at street level, less than GPS error
+const double RouteGeometry::MAPTOLERANCE = 3.0;
+const double RouteGeometry::EXPORTTOLERANCE = 1.0;
+
+static bool hasGPS(const RideFilePoint *p)
+{
+    return p->lat || p->lon;
+}
+
+QVector<int>
+RouteGeometry::simplify(const RideFile *ride, double tolerance, int from, int to)
+{
+    const QVector<RideFilePoint*> &samples = ride->dataPoints();
+    if (to < 0 || to >= samples.count()) to = samples.count() - 1;
+
+    // the ones we can draw
+    QVector<int> gps;
+    for (int i=qMax(0, from); i<=to; i++)
+        if (hasGPS(samples[i])) gps << i;
+    if (gps.count() < 3) return gps;
+
+    // in metres, flat is fine at the tolerances we use
+    QVector<double> x(gps.count()), y(gps.count());
+    double lat0 = samples[gps[0]]->lat;
+    double scale = cos(lat0 * M_PI / 180.0) * 111320.0;
+    for (int i=0; i<gps.count(); i++) {
+        x[i] = (samples[gps[i]]->lon - samples[gps[0]]->lon) * scale;
+        y[i] = (samples[gps[i]]->lat - lat0) * 110540.0;
+    }
+
+    // Douglas-Peucker, with our own stack since a long ride
+    // could go deep enough to trouble a recursive version
+    QVector<bool> keep(gps.count(), false);
+    keep[0] = keep[gps.count()-1] = true;
+
+    QVector<QPair<int,int> > stack;
+    stack << QPair<int,int>(0, gps.count()-1);
+
+    while (!stack.isEmpty()) {
+        QPair<int,int> span = stack.last();
+        stack.pop_back();
+
+        int a = span.first, b = span.second;
+        if (b - a < 2) continue;
+
+        // the furthest from the line between the ends
+        double dx = x[b] - x[a], dy = y[b] - y[a];
+        double len2 = dx*dx + dy*dy;
+        double furthest = -1;
+        int at = a;
+        for (int i=a+1; i<b; i++) {
+            double px = x[i] - x[a], py = y[i] - y[a];
+            double d2;
+            if (len2 > 0) {
+                double t = qBound(0.0, (px*dx + py*dy) / len2, 1.0);
+                double ex = px - t*dx, ey = py - t*dy;
+                d2 = ex*ex + ey*ey;
+            } else {
+                d2 = px*px + py*py; // back where we started
+            }
+            if (d2 > furthest) {
+                furthest = d2;
+                at = i;
+            }
+        }
+
+        if (furthest > tolerance * tolerance) {
+            keep[at] = true;
+            stack << QPair<int,int>(a, at) << QPair<int,int>(at, b);
+        }
+    }
+
+    QVector<int> returning;
+    for (int i=0; i<gps.count(); i++)
+        if (keep[i]) returning << gps[i];
+    return returning;
+}
+
+static void encodeValue(int value, QString &out)
+{
+    // zig-zag, then 5 bits a character least significant first
+    unsigned int v = value < 0 ? ~(unsigned(value) << 1) : (unsigned(value) << 1);
+    while (v >= 0x20) {
+        out += QChar(char((0x20 | (v & 0x1f)) + 63));
+        v >>= 5;
+    }
+    out += QChar(char(v + 63));
+}
+
+QString
+RouteGeometry::encode(const RideFile *ride, const QVector<int> &points)
+{
+    QVector<double> lat(points.count()), lon(points.count());
+    for (int i=0; i<points.count(); i++) {
+        lat[i] = ride->dataPoints()[points[i]]->lat;
+        lon[i] = ride->dataPoints()[points[i]]->lon;
+    }
+    return encode(lat, lon);
+}
+
+QString
+RouteGeometry::encode(const QVector<double> &lats, const QVector<double> &lons)
+{
+    QString returning;
+    returning.reserve(lats.count() * 8);
+
+    // each is the difference from the one before
+    int lastLat = 0, lastLon = 0;
+    for (int i=0; i<lats.count() && i<lons.count(); i++) {
+        int lat = floor(lats[i] * 100000.0 + 0.5);
+        int lon = floor(lons[i] * 100000.0 + 0.5);
+        encodeValue(lat - lastLat, returning);
+        encodeValue(lon - lastLon, returning);
+        lastLat = lat;
+        lastLon = lon;
+    }
+    return returning;
+}
+
+QList<RouteGeometry::Stretch>
+RouteGeometry::stretches(const RideFile *ride, double secs, double tolerance)
+{
+    QList<Stretch> returning;
+    const QVector<RideFilePoint*> &samples = ride->dataPoints();
+
+    double rtime = 0, rwatts = 0, prevtime = 0;
+    int count = 0, from = 0;
+
+    for (int i=0; i<samples.count(); i++) {
+        const RideFilePoint *p = samples[i];
+
+        rtime += p->secs - prevtime;
+        rwatts += p->watts;
+        prevtime = p->secs;
+        count++;
+
+        // end of a stretch, or the bit left at the end
+        if (rtime >= secs || i == samples.count()-1) {
+            Stretch add;
+            add.watts = rwatts / count;
+            add.points = simplify(ride, tolerance, from, i);
+            if (add.points.count() > 1) returning << add;
+
+            rtime = rwatts = 0;
+            count = 0;
+            from = i;
+        }
+    }
+    return returning;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RouteGeometry_h
+#define _GC_RouteGeometry_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QList>
+#include <QString>
+
+#include "RideFile.h"
+
+// Drawing a route doesn't need every sample, a 1s recording of a long
+// ride is tens of thousands of points most of which lie on a straight
+// line between their neighbours. The maps and the KML export draw the
+// samples left after Douglas-Peucker simplification, which drops every
+// sample that is within a tolerance of the line drawn without it.
+//
+// The maps are sent their lines in Google's encoded polyline format,
+// a few characters a point, rather than a JavaScript statement each.
+//
+// Everything works with indexes into the ride's dataPoints() so the
+// caller can get at the other data series for the samples we keep.
+//
+class RouteGeometry
+{
+    public:
+        // metres, for drawing on a map and for export
+        static const double MAPTOLERANCE;
+        static const double EXPORTTOLERANCE;
+
+        // the samples with GPS from and to the given indexes, both
+        // kept, simplified to within tolerance metres
+        static QVector<int> simplify(const RideFile *ride, double tolerance, int from = 0, int to = -1);
+
+        // Google's encoded polyline format, in 1e-5 degrees, note it
+        // may contain backslashes so needs escaping in a script
+        static QString encode(const RideFile *ride, const QVector<int> &points);
+        static QString encode(const QVector<double> &lats, const QVector<double> &lons);
+
+        // the route in stretches of secs each for colouring by their
+        // average power, simplified within each stretch so the ends of
+        // one are the start of the next
+        struct Stretch {
+            QVector<int> points;
+            double watts;
+        };
+        static QList<Stretch> stretches(const RideFile *ride, double secs, double tolerance);
+};
+
+#endif // _GC_RouteGeometry_h
@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RouteIndex.h"
+
+#include <QSet>
+#include <QDataStream>
+#include <math.h>
+
+// metres between the points we keep
+static const double SPACING = 25.0;
+
+// degrees, about 550m north to south
+static const double CELL = 0.005;
+
+// how far off the reference we can be and still be on the same road,
+// GPS error on both rides and the spacing between the points
+static const double TOLERANCE = 40.0;
+
+// how many points we look ahead for the next reference point, so
+// we cope with the odd dropout but not a detour
+static const int LOOKAHEAD = 8;
+
+static bool hasGPS(const RideFilePoint *p)
+{
+    return (p->lat || p->lon) && fabs(p->lat) <= 90 && fabs(p->lon) <= 180;
+}
+
+// metres, flat earth is fine over the distances we compare
+static double distance(double lat1, double lon1, double lat2, double lon2)
+{
+    double dx = (lon2 - lon1) * cos((lat1 + lat2) * M_PI / 360.0) * 111320.0;
+    double dy = (lat2 - lat1) * 110540.0;
+    return sqrt(dx*dx + dy*dy);
+}
+
+static double distance(const RoutePoint &a, const RoutePoint &b)
+{
+    return distance(a.lat, a.lon, b.lat, b.lon);
+}
+
+//
+// Tracks
+//
+RouteTrack::RouteTrack(const RideFile *ride, double from, double to)
+{
+    const QVector<RideFilePoint*> &samples = ride->dataPoints();
+    if (samples.isEmpty()) return;
+
+    int start = 0, stop = samples.count() - 1;
+    if (to >= from) {
+        start = ride->timeIndex(from);
+        stop = ride->timeIndex(to);
+    }
+
+    const RideFilePoint *last = NULL;
+    double travelled = 0;
+    int kept = -1, lastIndex = -1;
+
+    for (int i=start; i<=stop; i++) {
+        const RideFilePoint *p = samples[i];
+        if (!hasGPS(p)) continue;
+
+        if (last) travelled += distance(last->lat, last->lon, p->lat, p->lon);
+        last = p;
+        lastIndex = i;
+
+        if (kept < 0 || travelled >= SPACING) {
+            RoutePoint add;
+            add.index = kept = i;
+            add.secs = p->secs;
+            add.lat = p->lat;
+            add.lon = p->lon;
+            points << add;
+            travelled = 0;
+        }
+    }
+
+    // always finish where the ride did
+    if (last && kept != lastIndex) {
+        RoutePoint add;
+        add.index = lastIndex;
+        add.secs = last->secs;
+        add.lat = last->lat;
+        add.lon = last->lon;
+        points << add;
+    }
+}
+
+qint64
+RouteTrack::cell(double lat, double lon)
+{
+    qint64 y = floor((lat + 90.0) / CELL);
+    qint64 x = floor((lon + 180.0) / CELL);
+    return y * 100000 + x;
+}
+
+QList<qint64>
+RouteTrack::around(double lat, double lon)
+{
+    QList<qint64> returning;
+    for (int dy=-1; dy<=1; dy++)
+        for (int dx=-1; dx<=1; dx++)
+            returning << cell(lat + dy * CELL, lon + dx * CELL);
+    return returning;
+}
+
+QList<qint64>
+RouteTrack::cells() const
+{
+    QSet<qint64> returning;
+    foreach(RoutePoint p, points) returning.insert(cell(p.lat, p.lon));
+    return returning.toList();
+}
+
+QByteArray
+RouteTrack::serialize() const
+{
+    QByteArray raw;
+    QDataStream out(&raw, QIODevice::WriteOnly);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    // microdegrees are ample and compress better
+    out << qint32(points.count());
+    foreach(RoutePoint p, points)
+        out << qint32(p.index) << p.secs << qint32(floor(p.lat * 1000000.0 + 0.5)) << qint32(floor(p.lon * 1000000.0 + 0.5));
+
+    return qCompress(raw);
+}
+
+RouteTrack
+RouteTrack::deserialize(QByteArray data)
+{
+    RouteTrack returning;
+
+    QByteArray raw = qUncompress(data);
+    QDataStream in(raw);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    qint32 count = 0;
+    in >> count;
+    returning.points.reserve(count);
+    for (int i=0; i<count && in.status() == QDataStream::Ok; i++) {
+        qint32 index, lat, lon;
+        RoutePoint p;
+        in >> index >> p.secs >> lat >> lon;
+        p.index = index;
+        p.lat = lat / 1000000.0;
+        p.lon = lon / 1000000.0;
+        returning.points << p;
+    }
+    return returning;
+}
+
+//
+// Segments
+//
+RouteSegment::RouteSegment(const RideFile *ride, double start, double stop)
+    : reference(ride, start, stop), length(0)
+{
+    for (int i=1; i<reference.points.count(); i++)
+        length += distance(reference.points[i-1], reference.points[i]);
+}
+
+QList<qint64>
+RouteSegment::startCells() const
+{
+    if (!isValid()) return QList<qint64>();
+    return RouteTrack::around(reference.points.first().lat, reference.points.first().lon);
+}
+
+QList<qint64>
+RouteSegment::stopCells() const
+{
+    if (!isValid()) return QList<qint64>();
+    return RouteTrack::around(reference.points.last().lat, reference.points.last().lon);
+}
+
+QList<RouteMatch>
+RouteSegment::match(const RouteTrack &track) const
+{
+    QList<RouteMatch> returning;
+    if (!isValid()) return returning;
+
+    const QVector<RoutePoint> &r = reference.points;
+    const QVector<RoutePoint> &t = track.points;
+    int m = r.count(), n = t.count();
+
+    for (int i=0; i<n; i++) {
+
+        // at the start, from the closest point as we go past it, but
+        // if it doesn't match from there we carry on from where we were
+        if (distance(t[i], r[0]) > TOLERANCE) continue;
+        int from = i;
+        while (i+1 < n && distance(t[i+1], r[0]) < distance(t[i], r[0])) i++;
+
+        // then along each reference point in turn
+        int j = i;
+        bool along = true;
+        for (int k=1; k<m && along; k++) {
+            int best = -1;
+            double nearest = TOLERANCE;
+            for (int next=j; next<n && next<=j+LOOKAHEAD; next++) {
+                double d = distance(t[next], r[k]);
+                if (d <= nearest) {
+                    nearest = d;
+                    best = next;
+                }
+            }
+            if (best < 0) along = false;
+            else j = best;
+        }
+        if (!along) {
+            i = from;
+            continue;
+        }
+
+        // and to the closest point at the end
+        while (j+1 < n && distance(t[j+1], r[m-1]) < distance(t[j], r[m-1])) j++;
+
+        // not the long way round
+        double travelled = 0;
+        for (int k=i+1; k<=j; k++) travelled += distance(t[k-1], t[k]);
+        if (travelled > length * 1.2 + 2 * TOLERANCE) {
+            i = from;
+            continue;
+        }
+
+        RouteMatch add;
+        add.fileName = track.fileName;
+        add.rideDate = track.rideDate;
+        add.startIndex = t[i].index;
+        add.stopIndex = t[j].index;
+        add.start = t[i].secs;
+        add.stop = t[j].secs;
+        returning << add;
+
+        // the next time round starts after this one
+        i = j;
+    }
+    return returning;
+}
+
+QList<SummaryMetrics>
+RouteSegment::series(const QList<RouteMatch> &matches) const
+{
+    QList<SummaryMetrics> returning;
+    foreach(RouteMatch match, matches) {
+        SummaryMetrics add;
+        add.setFileName(match.fileName);
+        add.setRideDate(match.rideDate);
+        add.setForSymbol("Segment Time", match.elapsed());
+        add.setForSymbol("Segment Speed", match.elapsed() > 0 ? length / match.elapsed() * 3.6 : 0);
+        returning << add;
+    }
+    return returning;
+}
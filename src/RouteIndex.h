@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RouteIndex_h
+#define _GC_RouteIndex_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QList>
+#include <QString>
+#include <QDateTime>
+#include <QByteArray>
+
+#include "RideFile.h"
+#include "SummaryMetrics.h"
+
+// Finding every ride that went over a climb or a loop.
+//
+// Each ride's GPS track is resampled to a point every few metres along
+// the road, which is all the detail we need to tell one road from the
+// next and a fraction of the samples, and kept in the metricDB with the
+// ride's metrics. Alongside it we record which grid cells, about half
+// a kilometre square, the ride passed through, so the rides that could
+// have gone over a segment are found with an indexed lookup for the
+// cells at either end of it, and only those tracks are read and
+// matched point by point.
+//
+// Each point remembers the sample it came from, so a match has the
+// start and stop in the ride's own samples and times.
+
+struct RoutePoint
+{
+    int index;          // in the ride's dataPoints()
+    float secs;
+    double lat, lon;
+};
+
+class RouteTrack
+{
+    public:
+        RouteTrack() {}
+
+        // resampled from the GPS in the ride, between from and to
+        // secs if given, otherwise all of it
+        RouteTrack(const RideFile *ride, double from = 0, double to = -1);
+
+        bool isEmpty() const { return points.count() < 2; }
+
+        // the cells we pass through, each once
+        QList<qint64> cells() const;
+
+        // the cell a point is in, and it with its neighbours
+        static qint64 cell(double lat, double lon);
+        static QList<qint64> around(double lat, double lon);
+
+        // for the metricDB, compressed
+        QByteArray serialize() const;
+        static RouteTrack deserialize(QByteArray data);
+
+        QString fileName;   // when read back from the metricDB
+        QDateTime rideDate;
+        QVector<RoutePoint> points;
+};
+
+struct RouteMatch
+{
+    QString fileName;
+    QDateTime rideDate;
+    int startIndex, stopIndex;  // in the ride's dataPoints()
+    double start, stop;         // secs
+
+    double elapsed() const { return stop - start; }
+};
+
+class RouteSegment
+{
+    public:
+        // the stretch of the ride between start and stop secs
+        RouteSegment(const RideFile *ride, double start, double stop);
+
+        bool isValid() const { return !reference.isEmpty(); }
+
+        // where the rides we want to look at must have been
+        QList<qint64> startCells() const;
+        QList<qint64> stopCells() const;
+
+        // every time the track went along the segment, start to end
+        QList<RouteMatch> match(const RouteTrack &track) const;
+
+        // matches as a series for charting over time, one per match with
+        // "Segment Time" in secs and "Segment Speed" in kph
+        QList<SummaryMetrics> series(const QList<RouteMatch> &matches) const;
+
+    private:
+        RouteTrack reference;
+        double length;  // metres
+};
+
+#endif // _GC_RouteIndex_h
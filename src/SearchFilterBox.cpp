@@ -18,7 +18,12 @@
 
 #include "SearchFilterBox.h"
 #include "Context.h"
+#include "Athlete.h"
+#ifdef GC_HAVE_LUCENE
 #include "Lucene.h"
+#else
+#include "MetadataIndex.h"
+#endif
 #include "DataFilter.h"
 #include "SearchBox.h"
 
@@ -34,12 +39,19 @@ SearchFilterBox::SearchFilterBox(QWidget *parent, Context *context, bool nochoos
     searchbox = new SearchBox(context, this, nochooser);
     contents->addWidget(searchbox);
 
+#ifdef GC_HAVE_LUCENE
     lucene = new Lucene(this, context);
+#endif
     datafilter = new DataFilter(this,context);
 
     // text searching
+#ifdef GC_HAVE_LUCENE
     connect(searchbox, SIGNAL(submitQuery(QString)), lucene, SLOT(search(QString)));
     connect(lucene, SIGNAL(results(QStringList)), this, SIGNAL(searchResults(QStringList)));
+#else
+    // the built in index is shared by the athlete
+    connect(searchbox, SIGNAL(submitQuery(QString)), this, SLOT(searchIndex(QString)));
+#endif
     connect(searchbox, SIGNAL(clearQuery()), this, SIGNAL(searchClear()));
 
     // data filtering
@@ -52,6 +64,14 @@ SearchFilterBox::SearchFilterBox(QWidget *parent, Context *context, bool nochoos
     connect(datafilter, SIGNAL(parseBad(QStringList)), searchbox, SLOT(setBad(QStringList)));
 }
 
+#ifndef GC_HAVE_LUCENE
+void
+SearchFilterBox::searchIndex(QString query)
+{
+    emit searchResults(context->athlete->metadataIndex->search(query));
+}
+#endif
+
 QString
 SearchFilterBox::filter()
 {
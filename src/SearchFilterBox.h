@@ -43,6 +43,9 @@ public:
     void setContext(Context *c) { context = c; searchbox->setContext(c); }
 
 private slots:
+#ifndef GC_HAVE_LUCENE
+    void searchIndex(QString); // using the built in index
+#endif
 
 signals:
     void searchResults(QStringList);    // what was search/filtered
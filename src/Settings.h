@@ -195,6 +195,8 @@
 
 #define FORTIUS_FIRMWARE          "fortius/firmware"
 #define TRAIN_MULTI               "train/multi"
+#define TRAIN_ERGRATE             "train/ergrate"
+#define TRAIN_CLOSEDLOOP          "train/closedloop"
 
 // batch export last options
 #define GC_BE_LASTDIR             "batchexport/lastdir"
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "SimulatorController.h"
+#include "RideFile.h"
+#include "GcTrace.h"
+
+#include <QFile>
+#include <QDateTime>
+#include <QDebug>
+#include <math.h>
+
+// don't let a silly speedup hang the gui thread
+static const int MAXTICKS = 10000;
+
+static const double G = 9.81;
+static const double RHO = 1.226; // air density at sea level
+
+SimulatorController::SimulatorController(TrainSidebar *parent, Context *context, DeviceConfiguration *dc)
+  : RealtimeController(parent, dc), context(context), replay(NULL), replayIndex(0),
+    speedup(1), rate(4), noise(5), riderPower(200), riderCadence(90),
+    mass(85), cda(0.32), crr(0.004), lag(2), seed(1),
+    mode(RT_MODE_ERGO), load(100), slope(0), running(false), ticks(0),
+    pausedMsecs(0), pausedAt(0), secs(0), watts(0), hr(60), cadence(0), kph(0), received(0)
+{
+    if (dc) {
+        replayFile = dc->portSpec;
+        seed = qHash(dc->name) | 1;
+        parseOptions(dc->deviceProfile);
+    }
+}
+
+SimulatorController::~SimulatorController()
+{
+    if (replay) delete replay;
+}
+
+void
+SimulatorController::parseOptions(QString options)
+{
+    foreach(QString option, options.split(",", QString::SkipEmptyParts)) {
+        QString name = option.section("=", 0, 0).trimmed();
+        double value = option.section("=", 1, 1).trimmed().toDouble();
+
+        if (name == "speed" && value > 0) speedup = value;
+        else if (name == "rate" && value > 0) rate = value;
+        else if (name == "noise" && value >= 0) noise = value;
+        else if (name == "power" && value >= 0) riderPower = value;
+        else if (name == "cadence" && value >= 0) riderCadence = value;
+        else if (name == "mass" && value > 0) mass = value;
+        else if (name == "cda" && value > 0) cda = value;
+        else if (name == "crr" && value >= 0) crr = value;
+        else if (name == "lag" && value >= 0) lag = value;
+        else if (name == "seed") seed = (quint32)value;
+        else qDebug()<<"simulator: unknown option"<<option;
+    }
+}
+
+int
+SimulatorController::start()
+{
+    if (replay) delete replay;
+    replay = NULL;
+    replayIndex = 0;
+
+    // the ride to replay, if there is one
+    if (replayFile != "" && context) {
+        QFile file(replayFile);
+        QStringList errors;
+        replay = RideFileFactory::instance().openRideFile(context, file, errors);
+        if (!replay || replay->dataPoints().isEmpty()) {
+            qDebug()<<"simulator: cannot replay"<<replayFile<<errors;
+            if (replay) delete replay;
+            replay = NULL;
+        }
+    }
+
+    secs = watts = cadence = kph = received = 0;
+    hr = 60;
+    ticks = pausedMsecs = pausedAt = 0;
+    clock.start();
+    running = true;
+    return 0;
+}
+
+int
+SimulatorController::stop()
+{
+    running = false;
+    if (replay) delete replay;
+    replay = NULL;
+    return 0;
+}
+
+int
+SimulatorController::pause()
+{
+    if (running) {
+        pausedAt = clock.elapsed();
+        running = false;
+    }
+    return 0;
+}
+
+int
+SimulatorController::restart()
+{
+    if (!running && clock.isValid()) {
+        pausedMsecs += clock.elapsed() - pausedAt;
+        running = true;
+    }
+    return 0;
+}
+
+double
+SimulatorController::gaussian()
+{
+    // box-muller on a fixed sequence, so a run can be repeated
+    seed = seed * 1664525 + 1013904223;
+    double u1 = ((seed >> 8) + 1) / double((1<<24) + 1);
+    seed = seed * 1664525 + 1013904223;
+    double u2 = (seed >> 8) / double(1<<24);
+    return sqrt(-2.0 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+void
+SimulatorController::tick(double dt)
+{
+    secs += dt;
+
+    // what the rider is doing
+    double riderWatts = riderPower;
+    double riderCad = riderCadence;
+    double riderHr = 0;
+    if (replay) {
+        const QVector<RideFilePoint*> &points = replay->dataPoints();
+        double duration = points.last()->secs;
+        double t = duration > 0 ? fmod(secs, duration) : 0;
+
+        // the replay loops, otherwise always moving forward
+        if (t < points[replayIndex]->secs) replayIndex = 0;
+        while (replayIndex+1 < points.count() && points[replayIndex+1]->secs <= t) replayIndex++;
+
+        const RideFilePoint *p = points[replayIndex];
+        riderWatts = p->watts;
+        riderCad = p->cad;
+        riderHr = p->hr;
+    }
+
+    // what the trainer does with it, in erg mode it holds the load
+    // after a short lag, otherwise the rider is on a virtual road
+    double grade = 0;
+    if (mode == RT_MODE_ERGO) {
+        double target = riderCad > 0 ? load : 0;
+        watts += (target - watts) * (lag > 0 ? 1 - exp(-dt / lag) : 1);
+    } else {
+        watts = riderWatts;
+        grade = atan(slope / 100.0);
+    }
+
+    // speed on the road, in small steps for the inertia
+    double v = kph / 3.6;
+    for (double step = 0; step < dt; step += 0.05) {
+        double h = qMin(0.05, dt - step);
+        double resist = mass * G * (crr * cos(grade) + sin(grade)) + 0.5 * RHO * cda * v * v;
+        v += (watts / qMax(v, 1.0) - resist) / mass * h;
+        if (v < 0) v = 0;
+    }
+    kph = v * 3.6;
+    cadence = riderCad;
+
+    // heartrate lags effort by around half a minute
+    if (riderHr > 0) hr = riderHr;
+    else hr += (60 + 0.45 * watts - hr) * (1 - exp(-dt / 30.0));
+}
+
+void
+SimulatorController::getRealtimeData(RealtimeData &rtData)
+{
+    GC_TRACE("SimulatorController::getRealtimeData", "train");
+
+    if (running) {
+
+        // catch up with the samples the sensors would have sent
+        double period = 1.0 / rate;
+        qint64 elapsed = clock.elapsed() - pausedMsecs;
+        qint64 due = elapsed * speedup * rate / 1000.0;
+
+        int generated = 0;
+        while (ticks < due && generated++ < MAXTICKS) {
+            tick(period);
+            ticks++;
+        }
+        if (ticks < due) ticks = due; // can't keep up, skip
+
+        // when the newest sample would have arrived
+        qint64 at = QDateTime::currentMSecsSinceEpoch() - elapsed + qint64(ticks * period * 1000.0 / speedup);
+        received = at / 1000.0;
+        GC_TRACE_COUNTER("simulator samples", generated);
+    }
+
+    rtData.setName((char *)"Simulator");
+    rtData.setWatts(qMax(0.0, watts + noise * gaussian()));
+    rtData.setHr(qMax(0.0, hr + noise / 5.0 * gaussian()));
+    rtData.setCadence(cadence > 0 ? qMax(0.0, cadence + noise / 3.0 * gaussian()) : 0);
+    rtData.setSpeed(kph);
+    rtData.setLoad(load);
+    rtData.setReceived(received);
+    processRealtimeData(rtData); // for virtual power
+}
+
+void
+SimulatorController::pushRealtimeData(RealtimeData &)
+{
+}
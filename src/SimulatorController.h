@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_SimulatorController_h
+#define _GC_SimulatorController_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QElapsedTimer>
+
+#include "RealtimeController.h"
+#include "RealtimeData.h"
+#include "DeviceTypes.h"
+#include "DeviceConfiguration.h"
+
+class Context;
+class RideFile;
+
+// A virtual trainer for testing train mode without any hardware.
+//
+// The rider is either replayed from a recorded ride (the port is the
+// path to any ride file we can read) or generated, and the trainer
+// responds to setLoad and setGradient with simple road physics and
+// some sensor noise. Samples are generated at a fixed sensor rate so
+// the data displayed is as stale as it would be from a real device.
+//
+// The options go in the device profile as a comma separated list, the
+// defaults are shown:
+//
+//     speed=1        replay/simulation speed, 4 is four times real time
+//     rate=4         sensor samples per second
+//     noise=5        watts standard deviation, hr and cadence are scaled
+//     power=200      rider power when not replaying
+//     cadence=90     rider cadence when not replaying
+//     mass=85        rider and bike in kg
+//     cda=0.32       m^2
+//     crr=0.004
+//     lag=2          seconds for the trainer to respond to a new load
+//     seed=n         noise seed, defaults from the device name
+//
+// Any number of simulators can be configured and selected at once,
+// each with its own replay file and options.
+//
+class SimulatorController : public RealtimeController
+{
+    Q_OBJECT;
+
+    public:
+        SimulatorController(TrainSidebar *parent, Context *context, DeviceConfiguration *dc);
+        ~SimulatorController();
+
+        int start();
+        int stop();
+        int pause();
+        int restart();
+        bool find() { return true; }
+        bool discover(QString) { return true; }
+        bool doesPush() { return false; }
+        bool doesPull() { return true; }
+        bool doesLoad() { return true; }
+
+        void setLoad(double watts) { load = watts; }
+        void setGradient(double gradient) { slope = gradient; }
+        void setMode(int mode) { this->mode = mode; }
+
+        void getRealtimeData(RealtimeData &rtData);
+        void pushRealtimeData(RealtimeData &rtData);
+
+    private:
+        void parseOptions(QString options);
+        void tick(double dt);  // advance the simulation one sample
+        double gaussian();     // mean 0, sd 1
+
+        Context *context;
+        QString replayFile;
+        RideFile *replay;
+        int replayIndex;
+
+        // options
+        double speedup, rate, noise, riderPower, riderCadence;
+        double mass, cda, crr, lag;
+        quint32 seed;
+
+        // controlled by train mode
+        int mode;
+        double load, slope;
+
+        // simulation state
+        QElapsedTimer clock;
+        bool running;
+        qint64 ticks;          // samples generated since start
+        qint64 pausedMsecs;    // time spent paused
+        qint64 pausedAt;
+        double secs;           // simulated time
+        double watts, hr, cadence, kph;
+        double received;       // when the newest sample was generated, for latency
+};
+
+#endif // _GC_SimulatorController_h
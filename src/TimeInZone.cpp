@@ -23,7 +23,7 @@
 #include <math.h>
 #include <QApplication>
 
-class ZoneTime : public RideMetric {
+class ZoneTime : public AccumulatingRideMetric {
     Q_DECLARE_TR_FUNCTIONS(ZoneTime)
     int level;
     double seconds;
@@ -42,22 +42,17 @@ class ZoneTime : public RideMetric {
         setConversion(1.0);
     }
     void setLevel(int level) { this->level=level-1; } // zones start from zero not 1
-    void compute(const RideFile *ride, const Zones *zone, int zoneRange,
-                 const HrZones *, int,
-                 const QHash<QString,RideMetric*> &,
-                 const Context *)
-    {
+    void begin(const RideMetricPass &) {
         seconds = 0;
-        // get zone ranges
-        if (zone && zoneRange >= 0) {
-            // iterate and compute
-            foreach(const RideFilePoint *point, ride->dataPoints()) {
-                if (zone->whichZone(zoneRange, point->watts) == level)
-                    seconds += ride->recIntSecs();
-            }
-        }
+    }
+    void sample(const RideMetricPass &pass) {
+        // pass.zone is -1 if there are no zones for this ride
+        if (pass.zone == level) seconds += pass.secs;
+    }
+    void end(const RideMetricPass &) {
         setValue(seconds);
     }
+    bool wantsZone() const { return true; }
 
     bool canAggregate() { return false; }
     void aggregateWith(const RideMetric &) {}
@@ -26,6 +26,9 @@
 // 01  21 Dec 2012  Mark Liversedge    Initial Build
 
 static int TrainDBSchemaVersion = 1;
+
+// the scan index can be rebuilt by itself, the others go with it
+static int TrainDBScanIndexVersion = 2;
 TrainDB *trainDB;
 
 TrainDB::TrainDB(QDir home) : home(home)
@@ -84,6 +87,51 @@ TrainDB::rebuildDB()
     createWorkoutTable();
     dropVideoTable();
     createVideoTable();
+    dropScanIndexTable();
+    createScanIndexTable();
+}
+
+bool TrainDB::createScanIndexTable()
+{
+    QSqlQuery query(db->database(sessionid));
+    bool rc;
+    bool createTables = true;
+
+    // does the table exist?
+    rc = query.exec("SELECT name FROM sqlite_master WHERE type='table' ORDER BY name;");
+    if (rc) {
+        while (query.next()) {
+
+            QString table = query.value(0).toString();
+            if (table == "scanindex") {
+                createTables = false;
+                break;
+            }
+        }
+    }
+    // we need to create it!
+    if (rc && createTables) {
+
+        QString createScanIndexTable = "create table scanindex (path varchar primary key,"
+                                    "size integer,"
+                                    "mtime integer,"
+                                    "hash varchar,"
+                                    "type integer,"
+                                    "cp double);";
+
+        rc = query.exec(createScanIndexTable);
+
+        // add row to version database
+        query.exec("DELETE FROM version where table_name = \"scanindex\"");
+
+        // insert into table
+        query.prepare("INSERT INTO version (table_name, schema_version, creation_date) values (?,?,?);");
+        query.addBindValue("scanindex");
+	    query.addBindValue(TrainDBScanIndexVersion);
+	    query.addBindValue(QDateTime::currentDateTime().toTime_t());
+        rc = query.exec();
+    }
+    return rc;
 }
 
 bool TrainDB::createVideoTable()
@@ -196,6 +244,13 @@ bool TrainDB::dropVideoTable()
     return rc;
 }
 
+bool TrainDB::dropScanIndexTable()
+{
+    QSqlQuery query("DROP TABLE scanindex", db->database(sessionid));
+    bool rc = query.exec();
+    return rc;
+}
+
 bool TrainDB::dropWorkoutTable()
 {
     QSqlQuery query("DROP TABLE workouts", db->database(sessionid));
@@ -211,6 +266,7 @@ bool TrainDB::createDatabase()
     // Workouts
 	createWorkoutTable();
 	createVideoTable();
+    createScanIndexTable();
 
     return true;
 }
@@ -239,6 +295,9 @@ void TrainDB::checkDBVersion()
 
         dropVideoTable();
         createVideoTable();
+
+        dropScanIndexTable();
+        createScanIndexTable();
         return;
     }
 
@@ -246,6 +305,7 @@ void TrainDB::checkDBVersion()
     // tne current version / crc
     bool dropWorkout = false;
     bool dropVideo = false;
+    bool dropScanIndex = false;
     while (query.next()) {
 
         QString table_name = query.value(0).toString();
@@ -253,12 +313,16 @@ void TrainDB::checkDBVersion()
 
         if (table_name == "workouts" && currentversion != TrainDBSchemaVersion) dropWorkout = true;
         if (table_name == "videos" && currentversion != TrainDBSchemaVersion) dropVideo = true;
+        if (table_name == "scanindex" && currentversion != TrainDBScanIndexVersion) dropScanIndex = true;
     }
     query.finish();
 
     // "workouts" table, is it up-to-date?
     if (dropWorkout) dropWorkoutTable();
     if (dropVideo) dropVideoTable();
+
+    // the index says what is in the other tables, so it goes with them
+    if (dropScanIndex || dropWorkout || dropVideo) dropScanIndexTable();
 }
 
 int TrainDB::getCount()
@@ -354,6 +418,59 @@ bool TrainDB::importWorkout(QString pathname, ErgFile *ergFile)
 	return rc;
 }
 
+bool TrainDB::copyWorkout(QString from, QString pathname)
+{
+	QSqlQuery query(db->database(sessionid));
+    QDateTime timestamp = QDateTime::currentDateTime();
+
+    // zap the current row - if there is one
+    query.prepare("DELETE FROM workouts WHERE filepath = ?;");
+    query.addBindValue(pathname);
+    query.exec();
+
+    // the same content so the same metrics, no need to parse it again
+    query.prepare("insert into workouts ( filepath, "
+                                    "filename,"
+                                    "timestamp,"
+                                    "description,"
+                                    "source,"
+                                    "ftp,"
+                                    "length,"
+                                    "coggan_tss,"
+                                    "coggan_if,"
+                                    "elevation,"
+                                    "grade ) select ?,?,?,"
+                                    "description,"
+                                    "source,"
+                                    "ftp,"
+                                    "length,"
+                                    "coggan_tss,"
+                                    "coggan_if,"
+                                    "elevation,"
+                                    "grade from workouts where filepath = ?;");
+	query.addBindValue(pathname);
+	query.addBindValue(QFileInfo(pathname).fileName());
+	query.addBindValue(timestamp);
+	query.addBindValue(from);
+
+	if (!query.exec()) return false;
+    return query.numRowsAffected() > 0;
+}
+
+QStringList TrainDB::workoutPaths()
+{
+    QStringList returning;
+
+    // not the manual modes, they aren't files
+    QSqlQuery query("SELECT filepath from workouts where filepath not like '//%';", db->database(sessionid));
+    bool rc = query.exec();
+
+    if (rc) {
+        while (query.next()) returning << query.value(0).toString();
+    }
+    return returning;
+}
+
 bool TrainDB::deleteVideo(QString pathname)
 {
 	QSqlQuery query(db->database(sessionid));
@@ -388,3 +505,61 @@ bool TrainDB::importVideo(QString pathname)
 
 	return rc;
 }
+
+QStringList TrainDB::videoPaths()
+{
+    QStringList returning;
+
+    QSqlQuery query("SELECT filepath from videos;", db->database(sessionid));
+    bool rc = query.exec();
+
+    if (rc) {
+        while (query.next()) returning << query.value(0).toString();
+    }
+    return returning;
+}
+
+QHash<QString, TrainDBScanEntry> TrainDB::scanIndex()
+{
+    QHash<QString, TrainDBScanEntry> returning;
+
+    QSqlQuery query("SELECT path, size, mtime, hash, type, cp from scanindex;", db->database(sessionid));
+    bool rc = query.exec();
+
+    if (rc) {
+        while (query.next()) {
+            TrainDBScanEntry entry;
+            entry.size = query.value(1).toLongLong();
+            entry.mtime = query.value(2).toLongLong();
+            entry.hash = query.value(3).toString();
+            entry.type = query.value(4).toInt();
+            entry.cp = query.value(5).toDouble();
+            returning.insert(query.value(0).toString(), entry);
+        }
+    }
+    return returning;
+}
+
+bool TrainDB::updateScanIndex(QString path, TrainDBScanEntry entry)
+{
+	QSqlQuery query(db->database(sessionid));
+
+    query.prepare("insert or replace into scanindex ( path, size, mtime, hash, type, cp ) values ( ?,?,?,?,?,? );");
+	query.addBindValue(path);
+	query.addBindValue(entry.size);
+	query.addBindValue(entry.mtime);
+	query.addBindValue(entry.hash);
+	query.addBindValue(entry.type);
+	query.addBindValue(entry.cp);
+
+	return query.exec();
+}
+
+bool TrainDB::deleteScanIndex(QString path)
+{
+	QSqlQuery query(db->database(sessionid));
+
+    query.prepare("DELETE FROM scanindex WHERE path = ?;");
+    query.addBindValue(path);
+    return query.exec();
+}
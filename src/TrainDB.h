@@ -26,6 +26,18 @@
 #include <QtSql>
 
 class ErgFile;
+
+// what the library search found last time, so a rescan only has to
+// look at directories and files that have changed, see Library.cpp
+struct TrainDBScanEntry {
+    qint64 size;    // bytes, 0 for directories
+    qint64 mtime;   // msecs since epoch
+    QString hash;   // content hash for workouts, what was searched for in directories
+    int type;       // one of the below
+    double cp;      // workouts are scaled to the CP when parsed, 0 if not a workout
+};
+enum { SCAN_DIRECTORY = 0, SCAN_WORKOUT = 1, SCAN_VIDEO = 2, SCAN_INVALID = 3 };
+
 class TrainDB : public QObject
 {
 
@@ -50,11 +62,22 @@ class TrainDB : public QObject
     void startLUW() { db->database(sessionid).transaction(); }
     void endLUW() { db->database(sessionid).commit(); emit dataChanged(); }
 
+    // commit what we have so far and carry on, without telling everyone
+    void commitLUW() { db->database(sessionid).commit(); db->database(sessionid).transaction(); }
+
     bool importWorkout(QString pathname, ErgFile *ergFile);
+    bool copyWorkout(QString from, QString pathname); // same workout, another file
     bool deleteWorkout(QString pathname);
+    QStringList workoutPaths();
 
     bool importVideo(QString pathname);
     bool deleteVideo(QString pathname);
+    QStringList videoPaths();
+
+    // the library scan index
+    QHash<QString, TrainDBScanEntry> scanIndex();
+    bool updateScanIndex(QString path, TrainDBScanEntry entry);
+    bool deleteScanIndex(QString path);
 
     // drop and recreate tables
     void rebuildDB();
@@ -74,6 +97,8 @@ class TrainDB : public QObject
         bool dropWorkoutTable();
         bool createVideoTable();
         bool dropVideoTable();
+        bool createScanIndexTable();
+        bool dropScanIndexTable();
 };
 
 extern TrainDB *trainDB;
@@ -17,6 +17,7 @@
  */
 
 #include "TrainSidebar.h"
+#include "GcTrace.h"
 #include "MainWindow.h"
 #include "Context.h"
 #include "Athlete.h"
@@ -34,6 +35,7 @@
 #include "ComputrainerController.h"
 #include "ANTlocalController.h"
 #include "NullController.h"
+#include "SimulatorController.h"
 #ifdef GC_HAVE_WFAPI
 #include "KickrController.h"
 #endif
@@ -354,6 +356,7 @@ intensity->hide(); //XXX!!! temporary
     gui_timer = new QTimer(this);
     disk_timer = new QTimer(this);
     load_timer = new QTimer(this);
+    ergControl = new ErgControl(context, this);
 
     session_time = QTime();
     session_elapsed_msec = 0;
@@ -520,6 +523,8 @@ TrainSidebar::configChanged()
 #endif
         } else if (Devices.at(i).type == DEV_NULL) {
             Devices[i].controller = new NullController(this, &Devices[i]);
+        } else if (Devices.at(i).type == DEV_SIMULATOR) {
+            Devices[i].controller = new SimulatorController(this, context, &Devices[i]);
         } else if (Devices.at(i).type == DEV_ANTLOCAL) {
             Devices[i].controller = new ANTlocalController(this, &Devices[i]);
 #ifdef GC_HAVE_WFAPI
@@ -758,9 +763,12 @@ void TrainSidebar::Start()       // when start button is pressed
         status &=~RT_PAUSED;
         foreach(int dev, devices()) Devices[dev].controller->restart();
         gui_timer->start(REFRESHRATE);
+        gui_period.restart();
         if (status & RT_RECORDING) disk_timer->start(SAMPLERATE);
-        load_period.restart();
-        if (status & RT_WORKOUT) load_timer->start(LOADRATE);
+        if (status & RT_WORKOUT) {
+            ergControl->resumeWorkout();
+            load_timer->start(LOADRATE);
+        }
 
 #if defined Q_OS_MAC || defined GC_HAVE_VLC
         mediaTree->setEnabled(false);
@@ -780,8 +788,10 @@ void TrainSidebar::Start()       // when start button is pressed
         status |=RT_PAUSED;
         gui_timer->stop();
         if (status & RT_RECORDING) disk_timer->stop();
-        if (status & RT_WORKOUT) load_timer->stop();
-        load_msecs += load_period.restart();
+        if (status & RT_WORKOUT) {
+            ergControl->pauseWorkout();
+            load_timer->stop();
+        }
 
 #if defined Q_OS_MAC || defined GC_HAVE_VLC
         // enable media tree so we can change movie - mid workout
@@ -840,7 +850,6 @@ void TrainSidebar::Start()       // when start button is pressed
         // we're away!
         status |=RT_RUNNING;
 
-        load_period.restart();
         session_time.start();
         session_elapsed_msec = 0;
         lap_time.start();
@@ -848,6 +857,16 @@ void TrainSidebar::Start()       // when start button is pressed
         calibrating = false;
 
         if (status & RT_WORKOUT) {
+
+            // the workout runs on its own thread
+            QList<RealtimeController*> controllers;
+            foreach(int dev, devices()) controllers << Devices[dev].controller;
+            ergControl->setDevices(controllers);
+            ergControl->setWorkout(ergFile);
+            ergControl->setRate(appsettings->value(this, TRAIN_ERGRATE, ErgControl::DefaultRate).toInt());
+            ergControl->setClosedLoop(appsettings->value(this, TRAIN_CLOSEDLOOP, false).toBool());
+            ergControl->startWorkout(status&RT_MODE_ERGO);
+
             load_timer->start(LOADRATE);      // start recording
         }
 
@@ -876,6 +895,7 @@ void TrainSidebar::Start()       // when start button is pressed
             }
         }
         gui_timer->start(REFRESHRATE);      // start recording
+        gui_period.start();
 
     }
 }
@@ -892,9 +912,12 @@ void TrainSidebar::Pause()        // pause capture to recalibrate
         status &=~RT_PAUSED;
         foreach(int dev, devices()) Devices[dev].controller->restart();
         gui_timer->start(REFRESHRATE);
+        gui_period.restart();
         if (status & RT_RECORDING) disk_timer->start(SAMPLERATE);
-        load_period.restart();
-        if (status & RT_WORKOUT) load_timer->start(LOADRATE);
+        if (status & RT_WORKOUT) {
+            ergControl->resumeWorkout();
+            load_timer->start(LOADRATE);
+        }
 
 #if defined Q_OS_MAC || defined GC_HAVE_VLC
         mediaTree->setEnabled(false);
@@ -911,8 +934,10 @@ void TrainSidebar::Pause()        // pause capture to recalibrate
         status |=RT_PAUSED;
         gui_timer->stop();
         if (status & RT_RECORDING) disk_timer->stop();
-        if (status & RT_WORKOUT) load_timer->stop();
-        load_msecs += load_period.restart();
+        if (status & RT_WORKOUT) {
+            ergControl->pauseWorkout();
+            load_timer->stop();
+        }
 
         // enable media tree so we can change movie
 #if defined Q_OS_MAC || defined GC_HAVE_VLC
@@ -968,6 +993,7 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
     }
 
     if (status & RT_WORKOUT) {
+        ergControl->stopWorkout();
         load_timer->stop();
         load_msecs = 0;
     }
@@ -1022,6 +1048,8 @@ void TrainSidebar::updateData(RealtimeData &rtData)
 
 void TrainSidebar::guiUpdate()           // refreshes the telemetry
 {
+    GC_TRACE("TrainSidebar::guiUpdate", "train");
+
     RealtimeData rtData;
     rtData.setLap(displayLap + displayWorkoutLap); // user laps + predefined workout lap
     rtData.mode = mode;
@@ -1044,6 +1072,7 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
                   Devices[dev].controller->getRealtimeData(local); // See if the F3 button has been pressed
             }
             // and exit.  Nothing else to do until we finish calibrating
+            gui_period.restart(); // not riding, so no distance
             return;
         } else {
             rtData.setLoad(load); // always set load..
@@ -1080,13 +1109,27 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
                     rtData.setWatts(local.getWatts());
                     rtData.setAltWatts(local.getAltWatts());
                 }
+
+                // age of the newest sensor data we're about to display
+                if (local.getReceived() > 0)
+                    GC_TRACE_COUNTER("sensor latency ms", QDateTime::currentMSecsSinceEpoch() - local.getReceived() * 1000.0);
             }
 
-            // Distance assumes current speed for the last second. from km/h to km/sec
-            displayDistance += displaySpeed / (5 * 3600); // assumes 200ms refreshrate
-            displayWorkoutDistance += displaySpeed / (5 * 3600); // assumes 200ms refreshrate
+            // Distance at the current speed for the time since the last
+            // update, the timer doesn't fire exactly every REFRESHRATE ms
+            double secs = gui_period.restart() / 1000.0;
+            displayDistance += displaySpeed * secs / 3600;
             rtData.setDistance(displayDistance);
 
+            // the workout distance is integrated by the erg control
+            // thread, which needs the latest speed and power
+            if (status&RT_WORKOUT) {
+                ergControl->setMeasured(rtData.getWatts(), rtData.getSpeed());
+                if (!(status&RT_MODE_ERGO)) displayWorkoutDistance = ergControl->distance();
+            } else {
+                displayWorkoutDistance += displaySpeed * secs / 3600;
+            }
+
             // time
             total_msecs = session_elapsed_msec + session_time.elapsed();
             lap_msecs = lap_elapsed_msec + lap_time.elapsed();
@@ -1199,6 +1242,8 @@ void TrainSidebar::warnnoConfig()
 //----------------------------------------------------------------------
 void TrainSidebar::diskUpdate()
 {
+    GC_TRACE("TrainSidebar::diskUpdate", "train");
+
     double  Minutes;
 
     long Torq = 0, Altitude = 0;
@@ -1231,47 +1276,34 @@ void TrainSidebar::diskUpdate()
 
 void TrainSidebar::loadUpdate()
 {
-    int curLap;
+    GC_TRACE("TrainSidebar::loadUpdate", "train");
 
     // we hold our horses whilst calibration is taking place...
     if (calibrating) return;
 
-    // the period between loadUpdate calls is not constant, and not exactly LOADRATE,
-    // therefore, use a QTime timer to measure the load period
-    load_msecs += load_period.restart();
-
-    if (status&RT_MODE_ERGO) {
-        load = ergFile->wattsAt(load_msecs, curLap);
+    // the devices are set by the erg control thread, we just
+    // keep the displays up to date with where it has got to
+    int curLap = ergControl->lap();
+    if(displayWorkoutLap != curLap)
+    {
+        context->notifyNewLap();
+    }
+    displayWorkoutLap = curLap;
 
-        if(displayWorkoutLap != curLap)
-        {
-            context->notifyNewLap();
-        }
-        displayWorkoutLap = curLap;
+    // we got to the end!
+    if (ergControl->finished()) {
+        Stop(DEVICE_OK);
+        return;
+    }
 
-        // we got to the end!
-        if (load == -100) {
-            Stop(DEVICE_OK);
-        } else {
-            foreach(int dev, devices()) Devices[dev].controller->setLoad(load);
-            context->notifySetNow(load_msecs);
-        }
+    if (status&RT_MODE_ERGO) {
+        load_msecs = ergControl->msecs();
+        load = ergControl->load();
+        context->notifySetNow(load_msecs);
     } else {
-        slope = ergFile->gradientAt(displayWorkoutDistance*1000, curLap);
-
-        if(displayWorkoutLap != curLap)
-        {
-            context->notifyNewLap();
-        }
-        displayWorkoutLap = curLap;
-
-        // we got to the end!
-        if (slope == -100) {
-            Stop(DEVICE_OK);
-        } else {
-            foreach(int dev, devices()) Devices[dev].controller->setGradient(slope);
-            context->notifySetNow(displayWorkoutDistance * 1000);
-        }
+        displayWorkoutDistance = ergControl->distance();
+        slope = ergControl->slope();
+        context->notifySetNow(displayWorkoutDistance * 1000);
     }
 }
 
@@ -1286,7 +1318,6 @@ void TrainSidebar::Calibrate()
         // restart gui etc
         session_time.start();
         lap_time.start();
-        load_period.restart();
         if (status & RT_WORKOUT) load_timer->start(LOADRATE);
         if (status & RT_RECORDING) disk_timer->start(SAMPLERATE);
         context->notifyUnPause(); // get video started again, amongst other things
@@ -1305,6 +1336,7 @@ void TrainSidebar::Calibrate()
                 Devices[dev].controller->setGradient(slope);
             }
         }
+        if (status & RT_WORKOUT) ergControl->resumeWorkout();
 
     } else {
 
@@ -1324,8 +1356,10 @@ void TrainSidebar::Calibrate()
         lap_elapsed_msec += lap_time.elapsed();
 
         if (status & RT_RECORDING) disk_timer->stop();
-        if (status & RT_WORKOUT) load_timer->stop();
-        load_msecs += load_period.restart();
+        if (status & RT_WORKOUT) {
+            ergControl->pauseWorkout();
+            load_timer->stop();
+        }
 
         context->notifyPause(); // get video started again, amongst other things
 
@@ -1342,11 +1376,14 @@ void TrainSidebar::FFwd()
     if ((status&RT_RUNNING) == 0) return;
 
     if (status&RT_MODE_ERGO) {
+        if (status&RT_WORKOUT) load_msecs = ergControl->msecs();
         load_msecs += 10000; // jump forward 10 seconds
+        if (status&RT_WORKOUT) ergControl->seek(load_msecs);
         context->notifySeek(load_msecs);
+    } else {
+        displayWorkoutDistance += 1; // jump forward a kilometer in the workout
+        if (status&RT_WORKOUT) ergControl->seekDistance(displayWorkoutDistance);
     }
-    else displayWorkoutDistance += 1; // jump forward a kilometer in the workout
-
 }
 
 void TrainSidebar::Rewind()
@@ -1354,12 +1391,15 @@ void TrainSidebar::Rewind()
     if ((status&RT_RUNNING) == 0) return;
 
     if (status&RT_MODE_ERGO) {
+        if (status&RT_WORKOUT) load_msecs = ergControl->msecs();
         load_msecs -=10000; // jump back 10 seconds
         if (load_msecs < 0) load_msecs = 0;
+        if (status&RT_WORKOUT) ergControl->seek(load_msecs);
         context->notifySeek(load_msecs);
     } else {
         displayWorkoutDistance -=1; // jump back a kilometer
         if (displayWorkoutDistance < 0) displayWorkoutDistance = 0;
+        if (status&RT_WORKOUT) ergControl->seekDistance(displayWorkoutDistance);
     }
 }
 
@@ -1372,12 +1412,15 @@ void TrainSidebar::FFwdLap()
     double lapmarker;
 
     if (status&RT_MODE_ERGO) {
+        load_msecs = ergControl->msecs();
         lapmarker = ergFile->nextLap(load_msecs);
         if (lapmarker != -1) load_msecs = lapmarker; // jump forward to lapmarker
+        ergControl->seek(load_msecs);
         context->notifySeek(load_msecs);
     } else {
         lapmarker = ergFile->nextLap(displayWorkoutDistance*1000);
         if (lapmarker != -1) displayWorkoutDistance = lapmarker/1000; // jump forward to lapmarker
+        ergControl->seekDistance(displayWorkoutDistance);
     }
 }
 
@@ -1513,10 +1556,14 @@ void TrainSidebar::adjustIntensity()
         last = context->currentErgFile()->Points.at(i);
     }
 
-    // recalculate metrics
+    // reindex and recalculate metrics
+    context->currentErgFile()->compile();
     context->currentErgFile()->calculateMetrics();
     setLabels();
 
+    // the erg control thread works from a copy
+    if (status&RT_WORKOUT) ergControl->setWorkout(context->currentErgFile());
+
     // unblock signals now we are done
     context->mainWindow->blockSignals(false);
 
@@ -27,6 +27,7 @@
 #include "DeviceTypes.h"
 #include "ErgFile.h"
 #include "ErgFilePlot.h"
+#include "ErgControl.h"
 #include "GcSideBarItem.h"
 
 // standard stuff
@@ -40,6 +41,7 @@
 #include <QHeaderView>
 #include <QFormLayout>
 #include <QSqlTableModel>
+#include <QElapsedTimer>
 
 #include "math.h" // for round()
 #include "Units.h" // for MILES_PER_KM
@@ -225,7 +227,8 @@ class TrainSidebar : public GcWindow
         long total_msecs,
              lap_msecs,
              load_msecs;
-        QTime load_period;
+        ErgControl *ergControl; // sets the load, on its own thread
+        QElapsedTimer gui_period; // for distance
 
         uint session_elapsed_msec, lap_elapsed_msec;
         QTime session_time, lap_time;
@@ -65,15 +65,22 @@ TreeMapPlot::setData(TMSettings *settings)
 {
     root->clear();
 
-    foreach (SummaryMetrics rideMetrics, *(settings->data)) {
+    // straight from the metric store's columns
+    const MetricSlice &rides = *(settings->data);
+    const QString *fileNames = rides.fileNames();
+    const double *values = rides.values(settings->symbol);
+    const QString *texts1 = rides.texts(settings->field1);
+    const QString *texts2 = rides.texts(settings->field2);
+
+    for (int i=0; i<rides.count(); i++) {
 
         // don't plot if filtered
-        if (context->isfiltered && !context->filters.contains(rideMetrics.getFileName())) continue;
-        if (context->ishomefiltered && !context->homeFilters.contains(rideMetrics.getFileName())) continue;
+        if (context->isfiltered && !context->filters.contains(fileNames[i])) continue;
+        if (context->ishomefiltered && !context->homeFilters.contains(fileNames[i])) continue;
 
-        double value = rideMetrics.getForSymbol(settings->symbol);
-        QString text1 = rideMetrics.getText(settings->field1, "(unknown)");
-        QString text2 = rideMetrics.getText(settings->field2, "(unknown)");
+        double value = values ? values[i] : 0.0;
+        QString text1 = texts1 ? texts1[i] : QString();
+        QString text2 = texts2 ? texts2[i] : QString();
         if (text1 == "") text1 = "(unknown)";
         if (text2 == "") text2 = "(unknown)";
 
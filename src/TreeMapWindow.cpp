@@ -227,9 +227,8 @@ TreeMapWindow::refresh()
         settings.field2 = field2->currentText();
         settings.data = &results;
 
-        // get the data
-        results.clear(); // clear any old data
-        results = context->athlete->metricDB->getAllMetricsFor(QDateTime(settings.from, QTime(0,0,0)),
+        // get the data, it's the metric store's own so not a copy
+        results = context->athlete->metricDB->getMetricSlice(QDateTime(settings.from, QTime(0,0,0)),
                                                    QDateTime(settings.to, QTime(0,0,0)));
 
         refreshPlot();
@@ -255,6 +254,13 @@ TreeMapWindow::fieldSelected(int)
     refresh();
 }
 
+// as SummaryMetrics::getText(name, "(unknown)")
+static QString textFor(const QString *texts, int i)
+{
+    if (texts && !texts[i].isNull()) return texts[i];
+    return "(unknown)";
+}
+
 void
 TreeMapWindow::cellClicked(QString f1, QString f2)
 {
@@ -262,10 +268,11 @@ TreeMapWindow::cellClicked(QString f1, QString f2)
 
     // create a list of activities in this cell
     int count = 0;
-    foreach(SummaryMetrics x, results) {
-        if (x.getText(settings.field1, "(unknown)") == f1 &&
-            x.getText(settings.field2, "(unknown)") == f2) {
-            cell.append(x);
+    const QString *texts1 = results.texts(settings.field1);
+    const QString *texts2 = results.texts(settings.field2);
+    for (int i=0; i<results.count(); i++) {
+        if (textFor(texts1, i) == f1 && textFor(texts2, i) == f2) {
+            cell.append(results.ride(i));
             count++;
         }
     }
@@ -40,7 +40,7 @@ class TMSettings
         QString symbol;
         QString field1, field2;
         QDate from, to;
-        QList<SummaryMetrics> *data;
+        MetricSlice *data;
 };
 
 class TreeMapPlot;
@@ -66,7 +66,7 @@ class TreeMapWindow : public GcWindow
         TreeMapWindow(Context *); 
         ~TreeMapWindow();
 
-#ifdef GC_HAVE_LUCENE
+#ifdef GC_HAVE_SEARCH
         bool isFiltered() const { return context->ishomefiltered || context->isfiltered; }
 #endif
         QString f1() const { return field1->currentText(); }
@@ -145,7 +145,7 @@ class TreeMapWindow : public GcWindow
         DateRange custom; // custom date range supplied
         QList<KeywordDefinition> keywordDefinitions;
         QList<FieldDefinition>   fieldDefinitions;
-        QList<SummaryMetrics> results;
+        MetricSlice results;
 
         // Widgets
         QVBoxLayout *mainLayout;
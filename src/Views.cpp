@@ -24,6 +24,9 @@
 #include "BlankState.h"
 #include "TrainDB.h"
 #include "ComparePane.h"
+#include "Athlete.h"
+#include "MetricAggregator.h"
+#include "RideFileCacheRefresher.h"
 
 AnalysisView::AnalysisView(Context *context, QStackedWidget *controls) : TabView(context, VIEW_ANALYSIS)
 {
@@ -155,6 +158,9 @@ void
 HomeView::dateRangeChanged(DateRange dr)
 {
     context->dr_ = dr;
+
+    // any cpx files still to be updated for it go first
+    context->athlete->metricDB->cacheRefresher()->prioritise(dr.from, dr.to);
     page()->setProperty("dateRange", QVariant::fromValue<DateRange>(dr));
 }
 bool
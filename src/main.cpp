@@ -23,6 +23,9 @@
 #include "MainWindow.h"
 #include "Settings.h"
 #include "TrainDB.h"
+#include "GcBatch.h"
+#include "GcBenchmark.h"
+#include "GcTrace.h"
 
 #include "GcUpgrade.h"
 
@@ -83,6 +86,10 @@ main(int argc, char *argv[])
 #endif
 
     bool help = false;
+    bool batch = false;
+    bool benchmark = false;
+    bool trace = false;
+    QString traceFile;
 
     // honour command line switches
     foreach (QString arg, sargs) {
@@ -98,9 +105,26 @@ main(int argc, char *argv[])
 #else
             fprintf(stderr, "--debug             to direct diagnostic messages to the terminal instead of goldencheetah.log\n");
 #endif
+            fprintf(stderr, "--batch             to process an athlete without a window, see --batch --help\n");
+            fprintf(stderr, "--benchmark         to time the ride processing code, see --benchmark --help\n");
+            fprintf(stderr, "--trace[=file]      to record a performance trace (chrome://tracing format),\n");
+            fprintf(stderr, "                    the default file is goldencheetah-trace.json in the library folder\n");
             fprintf (stderr, "\nSpecify the folder and/or athlete to open on startup\n");
             fprintf(stderr, "If no parameters are passed it will reopen the last athlete.\n\n");
 
+        } else if (arg == "--batch") {
+
+            batch = true;
+
+        } else if (arg == "--benchmark") {
+
+            benchmark = true;
+
+        } else if (arg == "--trace" || arg.startsWith("--trace=")) {
+
+            trace = true;
+            traceFile = arg.mid(8);
+
         } else if (arg == "--debug") {
 
 #ifdef GC_DEBUG
@@ -119,6 +143,8 @@ main(int argc, char *argv[])
 
     // help or version printed so just exit now
     if (help) {
+        if (batch) GcBatch::usage();
+        if (benchmark) GcBenchmark::usage();
         exit(0);
     }
 
@@ -139,6 +165,11 @@ main(int argc, char *argv[])
     }
 #endif
 
+#if QT_VERSION > 0x050000
+    // batch runs on servers without a display
+    if ((batch || benchmark) && qgetenv("QT_QPA_PLATFORM").isEmpty()) qputenv("QT_QPA_PLATFORM", "offscreen");
+#endif
+
     // create the application -- only ever ONE regardless of restarts
     application = new QApplication(argc, argv);
 
@@ -219,11 +250,15 @@ main(int argc, char *argv[])
         // set global root directory
         gcroot = home.absolutePath();
 
-        // now redirect stderr
+        // now redirect stderr (batch reports to the terminal)
 #ifndef WIN32
-        if (!debug) nostderr(home.absolutePath());
+        if (!debug && !batch && !benchmark) nostderr(home.absolutePath());
 #endif
 
+        // start tracing (only once, we may be restarting)
+        if (trace && !GcTrace::isRecording())
+            GcTrace::start(traceFile != "" ? traceFile : home.absolutePath() + "/goldencheetah-trace.json");
+
         // install QT Translator to enable QT Dialogs translation
         // we may have restarted JUST to get this!
         QTranslator qtTranslator;
@@ -241,6 +276,13 @@ main(int argc, char *argv[])
         // Initialize metrics once the translator is installed
         RideMetricFactory::instance().initialize();
 
+        // no windows, just process the athlete and exit
+        if (batch || benchmark) {
+            ret = batch ? GcBatch::run(home, args) : GcBenchmark::run(home, args);
+            GcTrace::stop();
+            return ret;
+        }
+
         // Initialize global registry once the translator is installed
         GcWindowRegistry::initialize();
 
@@ -300,6 +342,7 @@ main(int argc, char *argv[])
             // choose cancel?
             if ((ret=d.exec()) != QDialog::Accepted) {
                 delete trainDB;
+                GcTrace::stop();
                 return ret;
             }
 
@@ -322,5 +365,8 @@ main(int argc, char *argv[])
 
     } while (restarting);
 
+    // write the trace, if we were recording
+    GcTrace::stop();
+
     return ret;
 }
@@ -151,14 +151,23 @@ CONFIG(debug, debug|release) {
     }
 }
 
+# search and filter is always available, free text search
+# uses CLucene if we have it, otherwise a built in index
+DEFINES     += GC_HAVE_SEARCH
+HEADERS     += DataFilter.h SearchBox.h NamedSearch.h SearchFilterBox.h
+SOURCES     += DataFilter.cpp SearchBox.cpp NamedSearch.cpp SearchFilterBox.cpp
+YACCSOURCES += DataFilter.y
+LEXSOURCES  += DataFilter.l
+
 !isEmpty( CLUCENE_LIBS ) {
     INCLUDEPATH += $${CLUCENE_INCLUDE}
     LIBS        += $${CLUCENE_LIBS}
     DEFINES     += GC_HAVE_LUCENE
-    HEADERS     += Lucene.h DataFilter.h SearchBox.h NamedSearch.h SearchFilterBox.h
-    SOURCES     += Lucene.cpp DataFilter.cpp SearchBox.cpp NamedSearch.cpp SearchFilterBox.cpp
-    YACCSOURCES += DataFilter.y
-    LEXSOURCES  += DataFilter.l
+    HEADERS     += Lucene.h
+    SOURCES     += Lucene.cpp
+} else {
+    HEADERS     += MetadataIndex.h
+    SOURCES     += MetadataIndex.cpp
 }
 
 # Mac specific build for
@@ -256,8 +265,10 @@ HEADERS += \
         AddDeviceWizard.h \
         AddIntervalDialog.h \
         Aerolab.h \
+        AerolabEngine.h \
         AerolabWindow.h \
         AllPlot.h \
+        AllPlotSmoother.h \
         AllPlotWindow.h \
         AnalysisSidebar.h \
         ANT.h \
@@ -274,6 +285,7 @@ HEADERS += \
         BingMap.h \
         BlankState.h \
         CalendarDownload.h \
+        ChartPrep.h \
         ChartSettings.h \
         ChooseCyclistDialog.h \
         Colors.h \
@@ -292,6 +304,7 @@ HEADERS += \
         DataProcessor.h \
         DBAccess.h \
         DaysScaleDraw.h \
+        DensityWindow.h \
         Device.h \
         DeviceTypes.h \
         DeviceConfiguration.h \
@@ -299,6 +312,7 @@ HEADERS += \
         DiarySidebar.h \
         DragBar.h \
         DownloadRideDialog.h \
+        ErgControl.h \
         ErgFile.h \
         ErgDB.h \
         ErgDBDownloadDialog.h \
@@ -307,6 +321,8 @@ HEADERS += \
         FitlogRideFile.h \
         FitlogParser.h \
         FitRideFile.h \
+        GcBatch.h \
+        GcBenchmark.h \
         GcCalendarModel.h \
         GcCrashDialog.h \
         GcPane.h \
@@ -314,6 +330,7 @@ HEADERS += \
         GcScopeBar.h \
         GcSideBarItem.h \
         GcToolBar.h \
+        GcTrace.h \
         GcUpgrade.h \
         GcWindowLayout.h \
         GcWindowRegistry.h \
@@ -335,6 +352,7 @@ HEADERS += \
         Library.h \
         LibraryParser.h \
         LogTimeScaleDraw.h \
+        LTMAggregate.h \
         LTMCanvasPicker.h \
         LTMChartParser.h \
         LTMOutliers.h \
@@ -351,8 +369,11 @@ HEADERS += \
         ManualRideDialog.h \
         ManualRideFile.h \
         MergeActivityWizard.h \
+        MergeAlign.h \
         MetadataWindow.h \
         MetricAggregator.h \
+        MetricStore.h \
+        MetricTableModel.h \
         NewCyclistDialog.h \
         NullController.h \
         Pages.h \
@@ -374,9 +395,11 @@ HEADERS += \
         ReferenceLineDialog.h \
         ComputrainerController.h \
         RealtimePlot.h \
+        RideDensityCache.h \
         RideEditor.h \
         RideFile.h \
         RideFileCache.h \
+        RideFileCacheRefresher.h \
         RideFileCommand.h \
         RideFileTableModel.h \
         RideImportWizard.h \
@@ -386,6 +409,8 @@ HEADERS += \
         RideNavigator.h \
         RideNavigatorProxy.h \
         RideWindow.h \
+        RouteGeometry.h \
+        RouteIndex.h \
         SaveDialogs.h \
         SmallPlot.h \
         RideSummaryWindow.h \
@@ -395,6 +420,7 @@ HEADERS += \
         SeasonParser.h \
         Serial.h \
         Settings.h \
+        SimulatorController.h \
         SpecialFields.h \
         SpinScanPlot.h \
         SpinScanPolarPlot.h \
@@ -446,8 +472,10 @@ SOURCES += \
         AddIntervalDialog.cpp \
         AerobicDecoupling.cpp \
         Aerolab.cpp \
+        AerolabEngine.cpp \
         AerolabWindow.cpp \
         AllPlot.cpp \
+        AllPlotSmoother.cpp \
         AllPlotWindow.cpp \
         AnalysisSidebar.cpp \
         ANT.cpp \
@@ -465,6 +493,7 @@ SOURCES += \
         BingMap.cpp \
         BlankState.cpp \
         CalendarDownload.cpp \
+        ChartPrep.cpp \
         ChartSettings.cpp \
         ChooseCyclistDialog.cpp \
         Coggan.cpp \
@@ -484,6 +513,7 @@ SOURCES += \
         DanielsPoints.cpp \
         DataProcessor.cpp \
         DBAccess.cpp \
+        DensityWindow.cpp \
         Device.cpp \
         DeviceTypes.cpp \
         DeviceConfiguration.cpp \
@@ -493,6 +523,7 @@ SOURCES += \
         DragBar.cpp \
         ErgDB.cpp \
         ErgDBDownloadDialog.cpp \
+        ErgControl.cpp \
         ErgFile.cpp \
         ErgFilePlot.cpp \
         ExtendedCriticalPower.cpp \
@@ -504,12 +535,15 @@ SOURCES += \
         FixSpikes.cpp \
         FixTorque.cpp \
         FixHRSpikes.cpp \
+        GcBatch.cpp \
+        GcBenchmark.cpp \
         GcCrashDialog.cpp \
         GcPane.cpp \
         GcRideFile.cpp \
         GcScopeBar.cpp \
         GcSideBarItem.cpp \
         GcToolBar.cpp \
+        GcTrace.cpp \
         GcUpgrade.cpp \
         GcWindowLayout.cpp \
         GcWindowRegistry.cpp \
@@ -532,6 +566,7 @@ SOURCES += \
         Library.cpp \
         LibraryParser.cpp \
         LogTimeScaleDraw.cpp \
+        LTMAggregate.cpp \
         LTMCanvasPicker.cpp \
         LTMChartParser.cpp \
         LTMOutliers.cpp \
@@ -547,8 +582,11 @@ SOURCES += \
         ManualRideDialog.cpp \
         ManualRideFile.cpp \
         MergeActivityWizard.cpp \
+        MergeAlign.cpp \
         MetadataWindow.cpp \
         MetricAggregator.cpp \
+        MetricStore.cpp \
+        MetricTableModel.cpp \
         NewCyclistDialog.cpp \
         NullController.cpp \
         Pages.cpp \
@@ -571,9 +609,11 @@ SOURCES += \
         RealtimePlot.cpp \
         RealtimePlotWindow.cpp \
         ReferenceLineDialog.cpp \
+        RideDensityCache.cpp \
         RideEditor.cpp \
         RideFile.cpp \
         RideFileCache.cpp \
+        RideFileCacheRefresher.cpp \
         RideFileCommand.cpp \
         RideFileTableModel.cpp \
         RideImportWizard.cpp \
@@ -583,6 +623,8 @@ SOURCES += \
         RideNavigator.cpp \
         RideSummaryWindow.cpp \
         RideWindow.cpp \
+        RouteGeometry.cpp \
+        RouteIndex.cpp \
         SaveDialogs.cpp \
         ScatterPlot.cpp \
         ScatterWindow.cpp \
@@ -590,6 +632,7 @@ SOURCES += \
         SeasonParser.cpp \
         Serial.cpp \
         Settings.cpp \
+        SimulatorController.cpp \
         SmallPlot.cpp \
         SpecialFields.cpp \
         SpinScanPlot.cpp \
@@ -0,0 +1,5 @@
+include(../unittests.pri)
+
+TARGET = testAllPlotSmoother
+HEADERS += $${SRC}/AllPlotSmoother.h
+SOURCES += testAllPlotSmoother.cpp $${SRC}/AllPlotSmoother.cpp
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "AllPlotSmoother.h"
+#include "RideFile.h"
+
+#include <QtTest>
+#include <math.h>
+
+// The smoother replaced a rolling average in AllPlot::recalc() that
+// pushed every sample onto a list and kept a running total for each
+// channel, this is that average for a single channel
+static QVector<double> rollingAverage(const QVector<double> &time, const QVector<double> &data,
+                                      int smooth, AllPlotSmoother::Channel channel)
+{
+    int rideTimeSecs = (int) ceil(time.last());
+    QVector<double> returning(rideTimeSecs + 1, 0.0);
+
+    QList<QPair<double,double> > list; // time and value
+    double total = 0.0, distance = 0.0;
+    int i = 0;
+
+    for (int secs = smooth; secs <= rideTimeSecs; ++secs) {
+        while (i < time.count() && time[i] <= secs) {
+            double value = data[i];
+            if (channel == AllPlotSmoother::Temp && value == RideFile::noTemp)
+                value = (i>0 && !list.isEmpty()) ? list.last().second : 0.0;
+            if (channel == AllPlotSmoother::Balance)
+                value = value > 0 ? value : 50;
+
+            total += value;
+            distance = data[i];
+            list.append(QPair<double,double>(time[i], value));
+            ++i;
+        }
+        while (!list.isEmpty() && list.first().first < secs - smooth) {
+            total -= list.first().second;
+            list.removeFirst();
+        }
+
+        if (channel == AllPlotSmoother::Distance) returning[secs] = distance;
+        else if (list.isEmpty()) returning[secs] = (channel == AllPlotSmoother::Alt) ? returning[secs-1] : 0.0;
+        else returning[secs] = total / list.count();
+    }
+    return returning;
+}
+
+// a ride of n samples, mostly 1s apart but with some faster
+// recording, the odd time that isn't whole and a few pauses
+static QVector<double> rideTimes(int n)
+{
+    QVector<double> time;
+    double secs = 0;
+    for (int i=0; i<n; i++) {
+        time << secs;
+        switch (qrand() % 20) {
+        case 0 : secs += 30 + qrand() % 120; break; // paused
+        case 1 : secs += 0.5; break;
+        case 2 : secs += 1.37; break;
+        default: secs += 1; break;
+        }
+    }
+    return time;
+}
+
+static QVector<double> rideData(int n, double lo, double hi)
+{
+    QVector<double> data;
+    for (int i=0; i<n; i++) data << lo + (hi - lo) * (qrand() % 1000) / 1000.0;
+    return data;
+}
+
+static bool same(const QVector<double> &a, const QVector<double> &b)
+{
+    if (a.count() != b.count()) return false;
+
+    // prefix sums round differently to running totals
+    for (int i=0; i<a.count(); i++)
+        if (fabs(a[i] - b[i]) > 1e-6 * qMax(1.0, fabs(a[i]))) return false;
+    return true;
+}
+
+class TestAllPlotSmoother : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+
+        void sameAsRollingAverage()
+        {
+            qsrand(1);
+            for (int ride=0; ride<20; ride++) {
+
+                int n = 500 + qrand() % 3000;
+                QVector<double> time = rideTimes(n);
+                QVector<double> watts = rideData(n, 0, 600);
+                QVector<double> alt = rideData(n, 200, 1800);
+                QVector<double> balance = rideData(n, -10, 70); // some missing
+                QVector<double> distance;
+                for (int i=0; i<n; i++) distance << i * 0.008;
+
+                AllPlotSmoother smoother;
+                smoother.setTime(time);
+                smoother.setChannel(AllPlotSmoother::Watts, watts);
+                smoother.setChannel(AllPlotSmoother::Alt, alt);
+                smoother.setChannel(AllPlotSmoother::Balance, balance);
+                smoother.setChannel(AllPlotSmoother::Distance, distance);
+
+                int widths[] = { 1, 3, 30, 90, 600 };
+                for (int w=0; w<5; w++) {
+                    int width = widths[w];
+                    QVERIFY(same(smoother.smoothed(AllPlotSmoother::Watts, width),
+                                 rollingAverage(time, watts, width, AllPlotSmoother::Watts)));
+                    QVERIFY(same(smoother.smoothed(AllPlotSmoother::Alt, width),
+                                 rollingAverage(time, alt, width, AllPlotSmoother::Alt)));
+                    QVERIFY(same(smoother.smoothed(AllPlotSmoother::Balance, width),
+                                 rollingAverage(time, balance, width, AllPlotSmoother::Balance)));
+                    QVERIFY(same(smoother.smoothed(AllPlotSmoother::Distance, width),
+                                 rollingAverage(time, distance, width, AllPlotSmoother::Distance)));
+                }
+            }
+        }
+
+        void missingTemperature()
+        {
+            // without pauses the last good reading is always in the window
+            QVector<double> time, temp;
+            for (int i=0; i<1000; i++) {
+                time << i;
+                temp << ((i % 7 == 3) ? double(RideFile::noTemp) : 15 + (i % 11));
+            }
+
+            AllPlotSmoother smoother;
+            smoother.setTime(time);
+            smoother.setChannel(AllPlotSmoother::Temp, temp);
+            QVERIFY(same(smoother.smoothed(AllPlotSmoother::Temp, 10),
+                         rollingAverage(time, temp, 10, AllPlotSmoother::Temp)));
+        }
+
+        void missingChannels()
+        {
+            QVector<double> time = rideTimes(100);
+
+            AllPlotSmoother smoother;
+            smoother.setTime(time);
+            smoother.setChannel(AllPlotSmoother::Hr, QVector<double>());
+            smoother.setChannel(AllPlotSmoother::Cad, rideData(50, 0, 120)); // wrong length
+
+            QVERIFY(!smoother.hasChannel(AllPlotSmoother::Hr));
+            QVERIFY(!smoother.hasChannel(AllPlotSmoother::Cad));
+            QVERIFY(smoother.smoothed(AllPlotSmoother::Hr, 30).isEmpty());
+        }
+
+        void newDataForgetsOld()
+        {
+            QVector<double> time = rideTimes(1000);
+            QVector<double> before = rideData(1000, 0, 300);
+            QVector<double> after = rideData(1000, 300, 600);
+
+            AllPlotSmoother smoother;
+            smoother.setTime(time);
+            smoother.setChannel(AllPlotSmoother::Watts, before);
+            smoother.smoothed(AllPlotSmoother::Watts, 30);
+
+            smoother.setChannel(AllPlotSmoother::Watts, after);
+            QVERIFY(same(smoother.smoothed(AllPlotSmoother::Watts, 30),
+                         rollingAverage(time, after, 30, AllPlotSmoother::Watts)));
+        }
+};
+
+QTEST_APPLESS_MAIN(TestAllPlotSmoother)
+#include "testAllPlotSmoother.moc"
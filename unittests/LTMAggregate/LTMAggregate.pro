@@ -0,0 +1,5 @@
+include(../unittests.pri)
+
+TARGET = testLTMAggregate
+HEADERS += $${SRC}/LTMAggregate.h
+SOURCES += testLTMAggregate.cpp $${SRC}/LTMAggregate.cpp $${SRC}/GcTrace.cpp
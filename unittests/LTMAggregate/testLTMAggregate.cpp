@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "LTMAggregate.h"
+
+#include <QtTest>
+#include <math.h>
+
+// The slices are read from these columns rather than the store, so
+// we don't need the metricDB or the rest of the metric store here
+static QHash<QString, QVector<double> > columns;
+
+MetricSlice::MetricSlice(const MetricStore *store, int from, int to) :
+    store(store), from(from), to(to), changes(0)
+{
+}
+
+bool
+MetricSlice::isValid() const
+{
+    return true;
+}
+
+const double *
+MetricSlice::values(QString symbol) const
+{
+    return columns.contains(symbol) ? columns[symbol].constData() + from : NULL;
+}
+
+// The aggregator replaced this loop in LTMPlot::createCurveData, that
+// went through the rides for each curve. The groups it worked with were
+// from groupForDate, never zero, so they are from start here.
+static void createCurveData(const QVector<int> &groups, int last, const LTMAggregate::Series &series,
+                            QVector<double> &x, QVector<double> &y, int &n)
+{
+    const int start = 1000;
+    QVector<double> values = columns.value(series.symbol);
+    QVector<double> workout = columns.value("workout_time");
+
+    x.resize(last+3);
+    y.resize(last+3);
+    n=-1;
+
+    int lastDay=0;
+    unsigned long secondsPerGroupBy=0;
+    bool wantZero = series.zeroes;
+    for (int i=0; i<groups.count(); i++) {
+
+        // filtered out or off the chart
+        if (groups[i] < 0 || groups[i] > last) continue;
+
+        int currentDay = start + groups[i];
+        double value = values.isEmpty() ? 0 : values[i];
+        if (isnan(value) || isinf(value)) value = 0;
+        value = value * series.scale + series.offset;
+
+        if (value || wantZero) {
+            unsigned long seconds = workout[i];
+            if (currentDay > lastDay) {
+                if (lastDay && wantZero) {
+                    while (lastDay<currentDay) {
+                        lastDay++;
+                        n++;
+                        x[n]=lastDay - start;
+                        y[n]=0;
+                    }
+                } else {
+                    n++;
+                }
+
+                y[n] = value;
+                x[n] = currentDay - start;
+                secondsPerGroupBy = seconds; // reset for new group
+            } else {
+                switch (series.kernel) {
+                case LTMAggregate::Sum:
+                    y[n] += value;
+                    break;
+                case LTMAggregate::Mean:
+                    y[n] = ((y[n]*secondsPerGroupBy)+(seconds*value)) / (secondsPerGroupBy+seconds);
+                    break;
+                case LTMAggregate::Min:
+                    if (value < y[n]) y[n] = value;
+                    break;
+                case LTMAggregate::Max:
+                    if (value > y[n]) y[n] = value;
+                    break;
+                }
+                secondsPerGroupBy += seconds; // increment for same group
+            }
+            lastDay = currentDay;
+        }
+    }
+}
+
+// a season of rides in date order, a few a group with gaps, some
+// filtered out, some without the metric and the odd one off the end
+static QVector<int> season(int rides, int last)
+{
+    columns.clear();
+
+    QVector<int> groups;
+    int group = qrand() % 3;
+    for (int i=0; i<rides; i++) {
+        if (qrand() % 3 == 0) group += 1 + (qrand() % 4 == 0 ? qrand() % 5 : 0);
+        groups << (qrand() % 10 == 0 ? -1 : group);
+
+        columns["workout_time"] << 600 + qrand() % 7200;
+        columns["power"] << (qrand() % 5 ? 80 + qrand() % 300 : 0.0);
+    }
+    return groups;
+}
+
+static LTMAggregate::Series series(QString symbol, LTMAggregate::Kernel kernel, bool zeroes)
+{
+    LTMAggregate::Series returning;
+    returning.symbol = symbol;
+    returning.kernel = kernel;
+    returning.scale = 0.5;
+    returning.offset = 0;
+    returning.zeroes = zeroes;
+    returning.n = -1;
+    return returning;
+}
+
+static bool same(const LTMAggregate::Series &series, const QVector<double> &x, const QVector<double> &y, int n)
+{
+    if (series.n != n) return false;
+    for (int i=0; i<=n; i++) {
+        if (series.x[i] != x[i]) return false;
+        if (fabs(series.y[i] - y[i]) > 1e-6 * qMax(1.0, fabs(y[i]))) return false;
+    }
+    return true;
+}
+
+class TestLTMAggregate : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+
+        void sameAsCreateCurveData_data()
+        {
+            QTest::addColumn<int>("kernel");
+            QTest::addColumn<bool>("zeroes");
+
+            QTest::newRow("sum") << int(LTMAggregate::Sum) << false;
+            QTest::newRow("sum bars") << int(LTMAggregate::Sum) << true;
+            QTest::newRow("mean") << int(LTMAggregate::Mean) << false;
+            QTest::newRow("mean bars") << int(LTMAggregate::Mean) << true;
+            QTest::newRow("max") << int(LTMAggregate::Max) << false;
+            QTest::newRow("max bars") << int(LTMAggregate::Max) << true;
+            QTest::newRow("min") << int(LTMAggregate::Min) << false;
+            QTest::newRow("min bars") << int(LTMAggregate::Min) << true;
+        }
+
+        void sameAsCreateCurveData()
+        {
+            QFETCH(int, kernel);
+            QFETCH(bool, zeroes);
+
+            qsrand(49);
+            for (int i=0; i<100; i++) {
+                int rides = qrand() % 400;
+                int last = 1 + qrand() % 60;
+                QVector<int> groups = season(rides, last);
+
+                LTMAggregate::Series power = series("power", LTMAggregate::Kernel(kernel), zeroes);
+                LTMAggregate::Series missing = series("not_in_store", LTMAggregate::Kernel(kernel), zeroes);
+                LTMAggregate(MetricSlice(NULL, 0, rides), groups, last).reduce(QList<LTMAggregate::Series*>()
+                                                                              << &power << &missing);
+
+                QVector<double> x, y;
+                int n;
+                createCurveData(groups, last, power, x, y, n);
+                QVERIFY(same(power, x, y, n));
+                createCurveData(groups, last, missing, x, y, n);
+                QVERIFY(same(missing, x, y, n));
+            }
+        }
+
+        void fromTheSlice()
+        {
+            // a slice part way through the store reads from there
+            qsrand(7);
+            QVector<int> groups = season(200, 30);
+
+            LTMAggregate::Series all = series("power", LTMAggregate::Sum, false);
+            LTMAggregate(MetricSlice(NULL, 0, 200), groups, 30).reduce(QList<LTMAggregate::Series*>() << &all);
+
+            LTMAggregate::Series part = series("power", LTMAggregate::Sum, false);
+            LTMAggregate(MetricSlice(NULL, 100, 200), groups.mid(100), 30).reduce(QList<LTMAggregate::Series*>() << &part);
+
+            columns["power"] = columns["power"].mid(100);
+            columns["workout_time"] = columns["workout_time"].mid(100);
+            QVector<double> x, y;
+            int n;
+            createCurveData(groups.mid(100), 30, part, x, y, n);
+            QVERIFY(same(part, x, y, n));
+            QVERIFY(part.n <= all.n);
+        }
+};
+
+QTEST_APPLESS_MAIN(TestLTMAggregate)
+#include "testLTMAggregate.moc"
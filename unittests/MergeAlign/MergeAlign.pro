@@ -0,0 +1,5 @@
+include(../unittests.pri)
+
+TARGET = testMergeAlign
+HEADERS += $${SRC}/MergeAlign.h
+SOURCES += testMergeAlign.cpp $${SRC}/MergeAlign.cpp $${SRC}/GcTrace.cpp
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MergeAlign.h"
+#include "RideFile.h"
+
+#include <QtTest>
+#include <math.h>
+
+// What a ride looks like to the sensors, a second at a time, the
+// power wanders about and the heart rate follows it
+struct Effort {
+    QVector<double> watts, hr, cad;
+
+    Effort(int secs) {
+        double w = 200, h = 120;
+        for (int i=0; i<secs; i++) {
+            w = qBound(0.0, w + (qrand() % 61) - 30, 600.0);
+            h += (100 + w / 4 - h) / 30;
+            watts << w;
+            hr << h;
+            cad << (w ? 80 + (qrand() % 11) : 0);
+        }
+    }
+
+    // linear between the seconds, as a head unit that isn't on the second
+    double at(const QVector<double> &values, double secs) const {
+        int i = qBound(0, int(floor(secs)), values.count()-2);
+        double w = secs - i;
+        return values[i] + (values[i+1] - values[i]) * w;
+    }
+};
+
+// the effort from one second to another as recorded by a device
+// that started at start, every interval seconds
+static QVector<RideFilePoint*> record(const Effort &effort, double from, double to, double start, double interval,
+                                      bool power, bool hr, bool cad)
+{
+    QVector<RideFilePoint*> points;
+    for (double secs = start; from + secs - start < to; secs += interval) {
+        double t = from + secs - start;
+        RideFilePoint *p = new RideFilePoint;
+        p->secs = secs;
+        if (power) p->watts = effort.at(effort.watts, t);
+        if (hr) p->hr = effort.at(effort.hr, t);
+        if (cad) p->cad = effort.at(effort.cad, t);
+        points << p;
+    }
+    return points;
+}
+
+static RideFileDataPresent present(bool power, bool hr, bool cad)
+{
+    RideFileDataPresent returning;
+    returning.watts = power;
+    returning.hr = hr;
+    returning.cad = cad;
+    return returning;
+}
+
+class TestMergeAlign : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+
+        void delay_data()
+        {
+            QTest::addColumn<double>("from1");  // when each device started in the effort
+            QTest::addColumn<double>("from2");
+            QTest::addColumn<double>("start1"); // and what it called that time
+            QTest::addColumn<double>("start2");
+
+            QTest::newRow("second started later") << 0.0 << 95.0 << 0.0 << 0.0;
+            QTest::newRow("first started later") << 240.0 << 0.0 << 0.0 << 0.0;
+            QTest::newRow("same time") << 0.0 << 0.0 << 0.0 << 0.0;
+            QTest::newRow("timestamps not from zero") << 0.0 << 30.0 << 12.0 << 700.0;
+        }
+
+        void delay()
+        {
+            QFETCH(double, from1);
+            QFETCH(double, from2);
+            QFETCH(double, start1);
+            QFETCH(double, start2);
+
+            qsrand(43);
+            Effort effort(3 * 3600);
+
+            // a head unit with hr and a power meter with power and cadence, both with hr
+            QVector<RideFilePoint*> points1 = record(effort, from1, 2 * 3600, start1, 1.0, false, true, false);
+            QVector<RideFilePoint*> points2 = record(effort, from2, 2.5 * 3600, start2, 1.0, true, true, true);
+
+            MergeAlign aligner(points1, present(false, true, false), points2, present(true, true, true));
+            aligner.start();
+            aligner.wait();
+
+            // a sample at secs in the first is secs + delay in the second
+            int delay = qRound((start2 - from2) - (start1 - from1));
+            QCOMPARE(aligner.delay(), delay);
+            QVERIFY(aligner.confidence() > 0.9);
+            QCOMPARE(aligner.matched(), QList<RideFile::SeriesType>() << RideFile::hr);
+
+            qDeleteAll(points1);
+            qDeleteAll(points2);
+        }
+
+        void partialOverlap()
+        {
+            qsrand(5);
+            Effort effort(3 * 3600);
+
+            // two long rides that only share the last and first half hour
+            QVector<RideFilePoint*> points1 = record(effort, 0, 2 * 3600, 0, 1.0, false, true, false);
+            QVector<RideFilePoint*> points2 = record(effort, 1.5 * 3600, 3 * 3600, 0, 1.0, true, true, true);
+
+            MergeAlign aligner(points1, present(false, true, false), points2, present(true, true, true));
+            aligner.start();
+            aligner.wait();
+
+            QCOMPARE(aligner.delay(), -5400);
+            QCOMPARE(aligner.matched(), QList<RideFile::SeriesType>() << RideFile::hr);
+
+            qDeleteAll(points1);
+            qDeleteAll(points2);
+        }
+
+        void channelsAgree()
+        {
+            qsrand(7);
+            Effort effort(2 * 3600);
+
+            // one recording every 1.5s, the other every second
+            QVector<RideFilePoint*> points1 = record(effort, 60, 2 * 3600, 0, 1.5, true, true, true);
+            QVector<RideFilePoint*> points2 = record(effort, 0, 2 * 3600, 0, 1.0, true, true, true);
+
+            MergeAlign aligner(points1, present(true, true, true), points2, present(true, true, true));
+            aligner.start();
+            aligner.wait();
+
+            QVERIFY(qAbs(aligner.delay() - 60) <= 1);
+            QVERIFY(aligner.matched().contains(RideFile::watts));
+            QVERIFY(aligner.matched().contains(RideFile::hr));
+            QVERIFY(aligner.matched().contains(RideFile::cad));
+
+            qDeleteAll(points1);
+            qDeleteAll(points2);
+        }
+
+        void nothingInCommon()
+        {
+            qsrand(11);
+            Effort effort(3600);
+
+            QVector<RideFilePoint*> points1 = record(effort, 0, 3600, 0, 1.0, false, true, false);
+            QVector<RideFilePoint*> points2 = record(effort, 0, 3600, 0, 1.0, true, false, false);
+
+            MergeAlign aligner(points1, present(false, true, false), points2, present(true, false, false));
+            aligner.start();
+            aligner.wait();
+
+            QCOMPARE(aligner.delay(), 0);
+            QCOMPARE(aligner.confidence(), 0.0);
+            QVERIFY(aligner.matched().isEmpty());
+
+            qDeleteAll(points1);
+            qDeleteAll(points2);
+        }
+};
+
+QTEST_APPLESS_MAIN(TestMergeAlign)
+#include "testMergeAlign.moc"
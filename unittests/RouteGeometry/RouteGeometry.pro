@@ -0,0 +1,5 @@
+include(../unittests.pri)
+
+TARGET = testRouteGeometry
+HEADERS += $${SRC}/RouteGeometry.h
+SOURCES += testRouteGeometry.cpp $${SRC}/RouteGeometry.cpp
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RouteGeometry.h"
+
+#include <QtTest>
+#include <math.h>
+
+#if QT_VERSION < 0x050000
+Q_DECLARE_METATYPE(QVector<double>)
+#endif
+
+// Google's decoder, as the maps run it in javascript
+static void decode(QString encoded, QVector<double> &lats, QVector<double> &lons)
+{
+    int index = 0, lat = 0, lon = 0;
+    while (index < encoded.length()) {
+        int *coordinate[] = { &lat, &lon };
+        for (int c=0; c<2; c++) {
+            int shift = 0, result = 0, b;
+            do {
+                b = encoded.at(index++).toLatin1() - 63;
+                result |= (b & 0x1f) << shift;
+                shift += 5;
+            } while (b >= 0x20);
+            *coordinate[c] += (result & 1) ? ~(result >> 1) : (result >> 1);
+        }
+        lats << lat / 100000.0;
+        lons << lon / 100000.0;
+    }
+}
+
+class TestRouteGeometry : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+
+        void encode_data()
+        {
+            QTest::addColumn<QVector<double> >("lats");
+            QTest::addColumn<QVector<double> >("lons");
+            QTest::addColumn<QString>("encoded");
+
+            // the examples in Google's description of the format
+            QTest::newRow("three points")
+                << (QVector<double>() << 38.5 << 40.7 << 43.252)
+                << (QVector<double>() << -120.2 << -120.95 << -126.453)
+                << QString("_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+            QTest::newRow("rounded")
+                << (QVector<double>() << 0.0)
+                << (QVector<double>() << -179.9832104)
+                << QString("?`~oia@");
+
+            QTest::newRow("nothing") << QVector<double>() << QVector<double>() << QString();
+            QTest::newRow("staying put")
+                << (QVector<double>() << 51.5 << 51.5)
+                << (QVector<double>() << -0.12 << -0.12)
+                << QString("_riyH~lV??");
+        }
+
+        void encode()
+        {
+            QFETCH(QVector<double>, lats);
+            QFETCH(QVector<double>, lons);
+            QFETCH(QString, encoded);
+
+            QCOMPARE(RouteGeometry::encode(lats, lons), encoded);
+        }
+
+        void roundTrip()
+        {
+            // a ride wandering about, every which way from the equator
+            // and the meridian, the differences are mostly small
+            qsrand(47);
+            QVector<double> lats, lons;
+            double lat = -0.5, lon = 0.5;
+            for (int i=0; i<5000; i++) {
+                lat += ((qrand() % 2001) - 1000) / 1000000.0;
+                lon -= ((qrand() % 2001) - 1000) / 1000000.0 + (i == 2500 ? 90 : 0);
+                lats << lat;
+                lons << lon;
+            }
+
+            QVector<double> decodedLats, decodedLons;
+            decode(RouteGeometry::encode(lats, lons), decodedLats, decodedLons);
+
+            QCOMPARE(decodedLats.count(), lats.count());
+            QCOMPARE(decodedLons.count(), lons.count());
+            for (int i=0; i<lats.count(); i++) {
+                QVERIFY(fabs(decodedLats[i] - lats[i]) <= 0.000005 + 1e-9);
+                QVERIFY(fabs(decodedLons[i] - lons[i]) <= 0.000005 + 1e-9);
+            }
+        }
+};
+
+QTEST_APPLESS_MAIN(TestRouteGeometry)
+#include "testRouteGeometry.moc"
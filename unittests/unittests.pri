@@ -0,0 +1,15 @@
+#
+# Common to all the checks, each builds the sources it tests from ../src
+#
+SRC = $$PWD/../src
+INCLUDEPATH += $${SRC}
+DEPENDPATH += $${SRC}
+
+TEMPLATE = app
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+QT += testlib
+greaterThan(QT_MAJOR_VERSION, 4) {
+    QT += widgets
+}
@@ -0,0 +1,12 @@
+#
+# Offline checks for the parts of GoldenCheetah that can be tested on
+# their own, they don't need the rest of the application or any data.
+# Build and run them with
+#
+#     cd unittests && qmake && make && make check
+#
+TEMPLATE = subdirs
+SUBDIRS = AllPlotSmoother \
+          LTMAggregate \
+          MergeAlign \
+          RouteGeometry